@@ -0,0 +1,182 @@
+#pragma once
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Bump allocator owning the records decoded for one unit
+// Memory is taken from chunks and never given back one by one,
+// Reset() makes every chunk reusable at once and the destructor frees them.
+// An arena is not thread safe, each thread decodes into its own arena.
+class Arena
+{
+public:
+    explicit Arena(const size_t chunkSize = 64 * 1024) :
+        _chunkSize(chunkSize),
+        _chunkIdx(0),
+        _pos(0),
+        _used(0)
+    {
+    }
+
+    ~Arena()
+    {
+        for (auto it = _chunks.begin(); it != _chunks.end(); it++)
+        {
+            std::free(it->Buf);
+        }
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *Allocate(const size_t size, const size_t align)
+    {
+        while (true)
+        {
+            if (_chunkIdx < _chunks.size())
+            {
+                Chunk &chunk = _chunks[_chunkIdx];
+                size_t pos = (_pos + align - 1) & ~(align - 1);
+                if (pos + size <= chunk.Size)
+                {
+                    _pos = pos + size;
+                    _used += size;
+                    return chunk.Buf + pos;
+                }
+                if (_chunkIdx + 1 < _chunks.size())
+                {
+                    // chunk kept by Reset()
+                    _chunkIdx++;
+                    _pos = 0;
+                    continue;
+                }
+            }
+
+            // a record larger than a chunk gets a chunk of its own
+            Chunk chunk;
+            chunk.Size = (size + align <= _chunkSize) ? _chunkSize : size + align;
+            chunk.Buf = (uint8_t *)std::malloc(chunk.Size);
+            if (chunk.Buf == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            _chunks.push_back(chunk);
+            _chunkIdx = _chunks.size() - 1;
+            _pos = 0;
+        }
+    }
+
+    const char *CopyString(const char *str, const size_t len)
+    {
+        char *copy = (char *)Allocate(len + 1, 1);
+        std::memcpy(copy, str, len);
+        copy[len] = '\0';
+        return copy;
+    }
+
+    // every record allocated so far becomes invalid
+    void Reset()
+    {
+        _chunkIdx = 0;
+        _pos = 0;
+        _used = 0;
+    }
+
+    size_t Used() const
+    {
+        return _used;
+    }
+
+    size_t Capacity() const
+    {
+        size_t capacity = 0;
+        for (auto it = _chunks.begin(); it != _chunks.end(); it++)
+        {
+            capacity += it->Size;
+        }
+        return capacity;
+    }
+
+private:
+    struct Chunk
+    {
+        uint8_t *Buf;
+        size_t Size;
+    };
+    std::vector<Chunk> _chunks;
+    size_t _chunkSize;
+    size_t _chunkIdx;           // chunk being filled
+    size_t _pos;                // next free byte of the chunk
+    size_t _used;
+};
+
+// std allocator on an Arena, deallocate does nothing
+// A default constructed allocator (no arena) uses the heap, so the same container type
+// can be decoded into an arena or built on the heap.
+template<typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator() :
+        _arena(nullptr)
+    {
+    }
+
+    ArenaAllocator(Arena *arena) :
+        _arena(arena)
+    {
+    }
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) :
+        _arena(other.GetArena())
+    {
+    }
+
+    T *allocate(const size_t n)
+    {
+        if (_arena == nullptr)
+        {
+            return (T *)::operator new(n * sizeof(T));
+        }
+        return (T *)_arena->Allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T *p, const size_t n)
+    {
+        if (_arena == nullptr)
+        {
+            ::operator delete(p, n * sizeof(T));
+        }
+    }
+
+    Arena *GetArena() const
+    {
+        return _arena;
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U> &other) const
+    {
+        return _arena == other.GetArena();
+    }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const
+    {
+        return _arena != other.GetArena();
+    }
+
+private:
+    Arena *_arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
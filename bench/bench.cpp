@@ -0,0 +1,465 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <iostream>
+
+#include "../elf_parser.h"
+#include "../dwarf.h"
+#include "../dwarf_cache.h"
+#include "../dwarf_type.h"
+#include "../parallel.h"
+#include "../stats.h"
+#include "../logger.h"
+#include "../common.h"
+
+// End-to-end benchmark of the parsers on the corpus written by gen_corpus.sh
+// Every phase is run --repeat times, the fastest run is reported.
+
+struct BenchOptions
+{
+    unsigned Repeat;
+    uint32_t LookupCount;
+    std::vector<unsigned> ThreadCounts;
+    bool Csv;
+    std::vector<std::string> Paths;
+};
+
+struct BenchTarget
+{
+    std::string Path;
+    const uint8_t *Bin;
+    uint64_t Size;
+    std::vector<Elf64_Shdr> Shdrs;
+    Elf64_Shdr SecStrShdr;
+    Elf64_Shdr SymTabShdr;
+    Elf64_Shdr StrTabShdr;
+    Elf64_Shdr ArangesShdr;
+    Elf64_Shdr LineShdr;
+    Elf64_Shdr LineStrShdr;
+    Elf64_Shdr AbbrevShdr;
+    Elf64_Shdr InfoShdr;
+    Elf64_Shdr StrShdr;
+};
+
+struct BenchResult
+{
+    std::string Phase;
+    unsigned ThreadCount;
+    uint64_t Bytes;             // input bytes of the phase, 0: not a decoding phase
+    uint64_t Ops;               // lookups of the phase, 0: not a lookup phase
+    double WallSec;
+    double CpuSec;
+    uint64_t AllocCount;
+    uint64_t AllocBytes;
+};
+
+static void showUsage()
+{
+    std::cout << "Usage) ./dwarf-bench [options] <elf path>..." << std::endl;
+    std::cout << "  --repeat <n>         runs of each phase, the fastest one is reported (default 3)" << std::endl;
+    std::cout << "  --lookups <n>        random addresses looked up (default 10000)" << std::endl;
+    std::cout << "  --threads <n,n,...>  thread counts of the scaling phases (default 1,2,4 and the number of CPUs)" << std::endl;
+    std::cout << "  --csv                print results as CSV" << std::endl;
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &opts)
+{
+    opts.Repeat = 3;
+    opts.LookupCount = 10000;
+    opts.Csv = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if ((arg == "--repeat") && (i + 1 < argc))
+        {
+            opts.Repeat = std::strtoul(argv[++i], nullptr, 0);
+        }
+        else if ((arg == "--lookups") && (i + 1 < argc))
+        {
+            opts.LookupCount = std::strtoul(argv[++i], nullptr, 0);
+        }
+        else if ((arg == "--threads") && (i + 1 < argc))
+        {
+            char *p = argv[++i];
+            while (*p != '\0')
+            {
+                opts.ThreadCounts.push_back(std::strtoul(p, &p, 0));
+                if (*p == ',')
+                {
+                    p++;
+                }
+            }
+        }
+        else if (arg == "--csv")
+        {
+            opts.Csv = true;
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            return false;
+        }
+        else
+        {
+            opts.Paths.push_back(arg);
+        }
+    }
+
+    if (opts.ThreadCounts.size() == 0)
+    {
+        unsigned cpuCount = Parallel::DefaultThreadCount();
+        for (unsigned count = 1; count <= 4; count *= 2)
+        {
+            opts.ThreadCounts.push_back(count);
+        }
+        if (4 < cpuCount)
+        {
+            opts.ThreadCounts.push_back(cpuCount);
+        }
+    }
+    if (opts.Repeat == 0)
+    {
+        opts.Repeat = 1;
+    }
+    return (opts.Paths.size() != 0);
+}
+
+static bool openTarget(const std::string &path, BenchTarget &target)
+{
+    struct stat st;
+    int fd = open(path.c_str(), O_RDONLY);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        Logger::ELog("%s can not be opened", path);
+        return false;
+    }
+    target.Path = path;
+    target.Size = st.st_size;
+    target.Bin = (uint8_t *)mmap(NULL, target.Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ((target.Bin == MAP_FAILED) || !Elf::IsElf64(target.Bin, target.Size) || !Elf::IsLittleEndian(target.Bin, target.Size))
+    {
+        Logger::ELog("%s is not a little endian ELF64 file", path);
+        return false;
+    }
+
+    Elf64_Ehdr ehdr;
+    Elf64::ReadEhdr(target.Bin, target.Size, ehdr);
+    uint64_t offset = ehdr.e_shoff;
+    for (uint32_t i = 0; i < ehdr.e_shnum; i++)
+    {
+        Elf64_Shdr shdr;
+        Elf64::ReadShdr(target.Bin, target.Size, offset, shdr);
+        target.Shdrs.push_back(shdr);
+        offset += ehdr.e_shentsize;
+    }
+    target.SecStrShdr = target.Shdrs[ehdr.e_shstrndx];
+
+    // sections not in the file are left empty
+    std::map<std::string, Elf64_Shdr *> nameShdrMap =
+    {
+        {".symtab", &target.SymTabShdr},
+        {".strtab", &target.StrTabShdr},
+        {".debug_aranges", &target.ArangesShdr},
+        {".debug_line", &target.LineShdr},
+        {".debug_line_str", &target.LineStrShdr},
+        {".debug_abbrev", &target.AbbrevShdr},
+        {".debug_info", &target.InfoShdr},
+        {".debug_str", &target.StrShdr},
+    };
+    for (auto it = nameShdrMap.begin(); it != nameShdrMap.end(); it++)
+    {
+        *it->second = {};
+    }
+    for (auto it = target.Shdrs.begin(); it != target.Shdrs.end(); it++)
+    {
+        auto nameIt = nameShdrMap.find(Elf64::GetSectionName(target.Bin, target.Size, target.SecStrShdr, it->sh_name));
+        if (nameIt != nameShdrMap.end())
+        {
+            *nameIt->second = *it;
+        }
+    }
+    if ((target.InfoShdr.sh_size == 0) || (target.LineShdr.sh_size == 0) || (target.ArangesShdr.sh_size == 0))
+    {
+        Logger::ELog("%s has no debug info", path);
+        return false;
+    }
+    return true;
+}
+
+// run prepare() then func() repeat times, keep the fastest run
+template<typename Prepare, typename Func>
+static BenchResult measure(const std::string &phase, const unsigned threadCount, const uint64_t bytes, const uint64_t ops, const unsigned repeat, Prepare prepare, Func func)
+{
+    BenchResult result;
+    result.Phase = phase;
+    result.ThreadCount = threadCount;
+    result.Bytes = bytes;
+    result.Ops = ops;
+    result.WallSec = -1;
+    for (unsigned i = 0; i < repeat; i++)
+    {
+        prepare();
+        Stats::BeginPhase(phase);
+        func();
+        Stats::EndPhase();
+        const StatsPhase &statsPhase = Stats::Phases().back();
+        if ((result.WallSec < 0) || (statsPhase.WallSec < result.WallSec))
+        {
+            result.WallSec = statsPhase.WallSec;
+            result.CpuSec = statsPhase.CpuSec;
+            result.AllocCount = statsPhase.AllocCount;
+            result.AllocBytes = statsPhase.AllocBytes;
+        }
+    }
+    return result;
+}
+
+static void buildFuncTable(const BenchTarget &target, ElfFunctionTable &elfFuncTable)
+{
+    std::vector<Elf64_Sym> symTbl;
+    Elf64::GetSymbolTbl(target.Bin, target.Size, target.SymTabShdr, symTbl);
+    elfFuncTable.Path = target.Path;
+    Elf64::GetElfFuncInfos(target.Bin, target.Size, target.Shdrs, symTbl, target.SecStrShdr, target.StrTabShdr, elfFuncTable.ElfFuncInfos);
+    Elf64::BuildAddrFuncIdxMap(elfFuncTable);
+}
+
+// same work as an --addr query of the eager path: unit, function and nearest line
+static uint64_t lookupAddr(const uint64_t addr, const ElfFunctionTable &elfFuncTable, const DwarfArangeMap &arangesMap, const std::vector<DwarfCuDebugInfo> &dbgInfos)
+{
+    uint64_t found = 0;
+    for (auto arangeIt = arangesMap.begin(); arangeIt != arangesMap.end(); arangeIt++)
+    {
+        for (auto segIt = arangeIt->second.Segments.begin(); segIt != arangeIt->second.Segments.end(); segIt++)
+        {
+            if ((segIt->Address <= addr) && (addr < segIt->Address + segIt->Length))
+            {
+                auto cuIt = std::lower_bound(dbgInfos.begin(), dbgInfos.end(), arangeIt->first, [](const DwarfCuDebugInfo &cu, const uint64_t offset)
+                {
+                    return cu.Offset < offset;
+                });
+                if ((cuIt != dbgInfos.end()) && (cuIt->Offset == arangeIt->first))
+                {
+                    found++;
+                }
+            }
+        }
+    }
+
+    uint32_t funcIdx = 0;
+    if (!Elf64::FindFuncIdx(elfFuncTable, addr, funcIdx))
+    {
+        return found;
+    }
+    const ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[funcIdx];
+    const LineAddrInfo *lineAddr = Elf64::FindLineAddr(elfFuncInfo, addr);
+    return found + ((lineAddr != nullptr) ? lineAddr->Line : 0);
+}
+
+static void benchTarget(const BenchOptions &opts, const BenchTarget &target, std::vector<BenchResult> &results)
+{
+    ElfFunctionTable baseFuncTable;
+    results.push_back(measure("func_table", 1, target.SymTabShdr.sh_size, 0, opts.Repeat, [&]()
+    {
+        baseFuncTable = ElfFunctionTable();
+    }, [&]()
+    {
+        buildFuncTable(target, baseFuncTable);
+    }));
+
+    DwarfArangeMap arangesMap;
+    results.push_back(measure("ReadAranges", 1, target.ArangesShdr.sh_size, 0, opts.Repeat, [&]()
+    {
+        arangesMap.clear();
+    }, [&]()
+    {
+        arangesMap = Dwarf::ReadAranges(target.Bin, target.Size, target.ArangesShdr);
+    }));
+
+    // the line tables are written to the function table, every run starts from a clean copy
+    ElfFunctionTable elfFuncTable;
+    DwarfLineInfoMap offsetLineInfoMap;
+    results.push_back(measure("ReadLineInfo", 1, target.LineShdr.sh_size, 0, opts.Repeat, [&]()
+    {
+        elfFuncTable = baseFuncTable;
+        offsetLineInfoMap.clear();
+    }, [&]()
+    {
+        offsetLineInfoMap = Dwarf::ReadLineInfo(target.Bin, target.Size, target.LineShdr, target.LineStrShdr, elfFuncTable, 1);
+    }));
+
+    std::vector<DwarfCuDebugInfo> dbgInfos;
+    results.push_back(measure("ReadDebugInfo", 1, target.InfoShdr.sh_size, 0, opts.Repeat, [&]()
+    {
+        dbgInfos.clear();
+    }, [&]()
+    {
+        dbgInfos = Dwarf::ReadDebugInfo(target.Bin, target.Size, target.InfoShdr, target.StrShdr, target.LineStrShdr, target.AbbrevShdr, arangesMap, offsetLineInfoMap, elfFuncTable.Files);
+    }));
+
+    // addresses inside functions, the same ones on every run
+    std::vector<uint64_t> addrs;
+    std::mt19937_64 rand(1);
+    for (uint32_t i = 0; (i < opts.LookupCount) && (elfFuncTable.ElfFuncInfos.size() != 0); i++)
+    {
+        const ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[rand() % elfFuncTable.ElfFuncInfos.size()];
+        addrs.push_back(elfFuncInfo.Addr + ((elfFuncInfo.Size != 0) ? rand() % elfFuncInfo.Size : 0));
+    }
+
+    uint64_t checksum = 0;
+    results.push_back(measure("lookups", 1, 0, addrs.size(), opts.Repeat, [&]() {}, [&]()
+    {
+        for (auto it = addrs.begin(); it != addrs.end(); it++)
+        {
+            checksum += lookupAddr(*it, elfFuncTable, arangesMap, dbgInfos);
+        }
+    }));
+
+    // lazy path: unit headers only, units are decoded by the lookups touching them
+    results.push_back(measure("lazy_lookups", 1, 0, addrs.size(), opts.Repeat, [&]()
+    {
+        elfFuncTable = baseFuncTable;
+    }, [&]()
+    {
+        DwarfCuCache cuCache(target.Bin, target.Size, target.InfoShdr, target.StrShdr, target.LineShdr, target.LineStrShdr, target.AbbrevShdr, arangesMap, elfFuncTable, 64);
+        for (auto it = addrs.begin(); it != addrs.end(); it++)
+        {
+            uint32_t cuIdx = 0;
+            if (cuCache.FindCuIdx(*it, cuIdx))
+            {
+                checksum += cuCache.GetCu(cuIdx).DebugInfo.Funcs.size();
+            }
+        }
+    }));
+    Logger::DLog("checksum:%ld", checksum);
+
+    // units and line programs are independent, so these scale with the number of threads
+    std::vector<DwarfCuEntry> cuEntries = Dwarf::ReadCuHeaders(target.Bin, target.Size, target.InfoShdr);
+    for (auto countIt = opts.ThreadCounts.begin(); countIt != opts.ThreadCounts.end(); countIt++)
+    {
+        if (*countIt != 1)
+        {
+            // the serial run is measured above
+            results.push_back(measure("ReadLineInfo", *countIt, target.LineShdr.sh_size, 0, opts.Repeat, [&]()
+            {
+                elfFuncTable = baseFuncTable;
+            }, [&]()
+            {
+                Dwarf::ReadLineInfo(target.Bin, target.Size, target.LineShdr, target.LineStrShdr, elfFuncTable, *countIt);
+            }));
+        }
+
+        std::vector<DwarfCuDebugInfo> cuDbgInfos;
+        results.push_back(measure("ReadCuDebugInfo", *countIt, target.InfoShdr.sh_size, 0, opts.Repeat, [&]()
+        {
+            cuDbgInfos.clear();
+            cuDbgInfos.resize(cuEntries.size());
+        }, [&]()
+        {
+            Parallel::For(cuEntries.size(), *countIt, [&](const size_t idx)
+            {
+                DwarfDieIndex dieIndex;
+                cuDbgInfos[idx] = Dwarf::ReadCuDebugInfo(target.Bin, target.Size, target.InfoShdr, target.StrShdr, target.LineStrShdr, target.AbbrevShdr, cuEntries[idx], offsetLineInfoMap, dieIndex);
+            });
+        }));
+
+        std::vector<DwarfTypeUnit> typeUnits;
+        results.push_back(measure("DwarfTypeGraph", *countIt, target.InfoShdr.sh_size, 0, opts.Repeat, [&]()
+        {
+            typeUnits.clear();
+            typeUnits.resize(cuEntries.size());
+        }, [&]()
+        {
+            Parallel::For(cuEntries.size(), *countIt, [&](const size_t idx)
+            {
+                typeUnits[idx] = DwarfTypeGraph::ReadUnit(target.Bin, target.Size, target.InfoShdr, target.StrShdr, target.LineStrShdr, target.AbbrevShdr, cuEntries[idx]);
+            });
+            DwarfTypeGraph typeGraph;
+            typeGraph.AddUnits(typeUnits);
+        }));
+    }
+}
+
+static void showResults(const BenchOptions &opts, const BenchTarget &target, const std::vector<BenchResult> &results)
+{
+    if (!opts.Csv)
+    {
+        std::cout << StringHelper::strprintf("%s (.debug_info:%ld .debug_line:%ld .debug_aranges:%ld bytes)", target.Path, target.InfoShdr.sh_size, target.LineShdr.sh_size, target.ArangesShdr.sh_size) << std::endl;
+        std::cout << StringHelper::strprintf("  %-16s %7s %10s %10s %10s %12s %10s %10s %8s", "phase", "threads", "wall ms", "cpu ms", "MB/s", "lookups/s", "allocs", "alloc MB", "speedup") << std::endl;
+    }
+
+    // speedup is relative to the single thread run of the same phase
+    std::map<std::string, double> singleWallSecMap;
+    for (auto it = results.begin(); it != results.end(); it++)
+    {
+        if (it->ThreadCount == 1)
+        {
+            singleWallSecMap[it->Phase] = it->WallSec;
+        }
+    }
+
+    for (auto it = results.begin(); it != results.end(); it++)
+    {
+        double wallSec = (it->WallSec <= 0) ? 1e-9 : it->WallSec;
+        double mbPerSec = (it->Bytes / (1024.0 * 1024.0)) / wallSec;
+        double opsPerSec = it->Ops / wallSec;
+        double speedup = 0;
+        auto singleIt = singleWallSecMap.find(it->Phase);
+        if (singleIt != singleWallSecMap.end())
+        {
+            speedup = singleIt->second / wallSec;
+        }
+
+        if (opts.Csv)
+        {
+            std::cout << StringHelper::strprintf("%s,%s,%d,%ld,%.3f,%.3f,%.2f,%.0f,%ld,%.3f,%.2f", target.Path, it->Phase, it->ThreadCount, it->Bytes,
+                                                 it->WallSec * 1000, it->CpuSec * 1000, mbPerSec, opsPerSec, it->AllocCount, it->AllocBytes / (1024.0 * 1024.0), speedup) << std::endl;
+            continue;
+        }
+        std::string mbPerSecStr = (it->Bytes != 0) ? StringHelper::strprintf("%.2f", mbPerSec) : "-";
+        std::string opsPerSecStr = (it->Ops != 0) ? StringHelper::strprintf("%.0f", opsPerSec) : "-";
+        std::cout << StringHelper::strprintf("  %-16s %7d %10.3f %10.3f %10s %12s %10ld %10.3f %7.2fx", it->Phase, it->ThreadCount, it->WallSec * 1000, it->CpuSec * 1000,
+                                             mbPerSecStr, opsPerSecStr, it->AllocCount, it->AllocBytes / (1024.0 * 1024.0), speedup) << std::endl;
+    }
+    if (!opts.Csv)
+    {
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opts;
+    if (!parseOptions(argc, argv, opts))
+    {
+        showUsage();
+        std::exit(EXIT_FAILURE);
+    }
+
+    Logger::SetLevel(LOG_LEVEL_ERROR);
+    Stats::Enable();
+    if (opts.Csv)
+    {
+        std::cout << "target,phase,threads,bytes,wall_ms,cpu_ms,mb_per_sec,lookups_per_sec,allocs,alloc_mb,speedup" << std::endl;
+    }
+    for (auto it = opts.Paths.begin(); it != opts.Paths.end(); it++)
+    {
+        BenchTarget target;
+        if (!openTarget(*it, target))
+        {
+            std::exit(EXIT_FAILURE);
+        }
+        std::vector<BenchResult> results;
+        benchTarget(opts, target, results);
+        showResults(opts, target, results);
+        munmap((void *)target.Bin, target.Size);
+    }
+    std::exit(EXIT_SUCCESS);
+}
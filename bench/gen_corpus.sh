@@ -0,0 +1,82 @@
+#!/bin/sh
+# Generate synthetic ELF binaries with debug info of a controllable shape.
+#
+# Usage) ./bench/gen_corpus.sh <out dir> [<name> <cus> <funcs/cu> <inline depth> <lines/func> <dwarf version>]
+#
+# Without a shape the default corpus (small / medium / large / bigfunc, DWARF 4 and 5) is generated.
+# Every function has <lines/func> statements on separate lines (one line table row each)
+# and calls a chain of <inline depth> always_inline functions (nested DW_TAG_inlined_subroutine).
+# Binaries already generated are kept, remove <out dir> to regenerate.
+
+set -e
+
+CC=${CC:-cc}
+
+gen_cu()
+{
+    # $1: source path, $2: cu index, $3: funcs, $4: inline depth, $5: lines
+    awk -v cu="$2" -v funcs="$3" -v depth="$4" -v lines="$5" 'BEGIN {
+        for (d = 0; d < depth; d++) {
+            printf("static inline __attribute__((always_inline)) int cu%d_inl%d(volatile int *p, int x)\n{\n", cu, d);
+            printf("    x += p[%d] * %d;\n", d % 8, d + 3);
+            if (0 < d) {
+                printf("    x = cu%d_inl%d(p, x);\n", cu, d - 1);
+            }
+            printf("    x ^= p[%d];\n    return x;\n}\n\n", (d + 1) % 8);
+        }
+        for (f = 0; f < funcs; f++) {
+            printf("int cu%d_func%d(volatile int *p, int x)\n{\n", cu, f);
+            for (l = 0; l < lines; l++) {
+                printf("    x %s= p[%d] + %d;\n", (l % 2) ? "^" : "+", l % 8, f * lines + l);
+            }
+            if (0 < depth) {
+                printf("    x = cu%d_inl%d(p, x);\n", cu, depth - 1);
+            }
+            printf("    return x;\n}\n\n");
+        }
+    }' > "$1"
+}
+
+gen_elf()
+{
+    # $1: out dir, $2: name, $3: cus, $4: funcs/cu, $5: inline depth, $6: lines/func, $7: dwarf version
+    elf="$1/$2.elf"
+    if [ -f "$elf" ]; then
+        return
+    fi
+    src="$1/$2.src"
+    mkdir -p "$src"
+    echo "generating $elf (cus:$3 funcs/cu:$4 inline depth:$5 lines/func:$6 dwarf:$7)"
+    objs=""
+    cu=0
+    while [ $cu -lt "$3" ]; do
+        gen_cu "$src/cu$cu.c" $cu "$4" "$5" "$6"
+        $CC -O1 -g -gdwarf-$7 -fno-inline-functions -c "$src/cu$cu.c" -o "$src/cu$cu.o"
+        objs="$objs $src/cu$cu.o"
+        cu=$((cu + 1))
+    done
+    printf 'int main(void)\n{\n    return 0;\n}\n' > "$src/main.c"
+    $CC -O1 -g -gdwarf-$7 -c "$src/main.c" -o "$src/main.o"
+    $CC $objs "$src/main.o" -o "$elf"
+    rm -rf "$src"
+}
+
+if [ $# -lt 1 ]; then
+    echo "Usage) $0 <out dir> [<name> <cus> <funcs/cu> <inline depth> <lines/func> <dwarf version>]"
+    exit 1
+fi
+out=$1
+mkdir -p "$out"
+
+if [ $# -ge 7 ]; then
+    gen_elf "$out" "$2" "$3" "$4" "$5" "$6" "$7"
+    exit 0
+fi
+
+for ver in 4 5; do
+    gen_elf "$out" small-dwarf$ver 8 32 2 8 $ver
+    gen_elf "$out" medium-dwarf$ver 32 128 3 16 $ver
+    gen_elf "$out" large-dwarf$ver 128 128 4 16 $ver
+    # one function with 12k line table rows, ingestion must stay linear in rows per function
+    gen_elf "$out" bigfunc-dwarf$ver 1 1 0 12000 $ver
+done
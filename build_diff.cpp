@@ -0,0 +1,353 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include "build_diff.h"
+#include "dwarf.h"
+#include "dwarf_inline.h"
+#include "logger.h"
+#include "common.h"
+
+BuildIndex::BuildIndex() :
+    _bin(nullptr),
+    _size(0)
+{
+}
+
+BuildIndex::~BuildIndex()
+{
+    if (_bin != nullptr)
+    {
+        munmap(_bin, _size);
+    }
+}
+
+bool BuildIndex::Load(const std::string &path, const unsigned threadCount)
+{
+    Logger::TLog("BuildIndex::Load In...");
+    struct stat st;
+    int fd = open(path.c_str(), O_RDONLY);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        Logger::ELog("%s can not be opened", path);
+        return false;
+    }
+    _path = path;
+    _size = st.st_size;
+    void *bin = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (bin == MAP_FAILED)
+    {
+        Logger::ELog("%s can not be mapped", path);
+        return false;
+    }
+    _bin = (uint8_t *)bin;
+    if (!Elf::IsElf64(_bin, _size) || !Elf::IsLittleEndian(_bin, _size))
+    {
+        Logger::ELog("%s is not a little endian ELF64 file", path);
+        return false;
+    }
+
+    Elf64_Ehdr ehdr;
+    std::vector<Elf64_Shdr> shdrs;
+    Elf64::ReadEhdr(_bin, _size, ehdr);
+    uint64_t offset = ehdr.e_shoff;
+    for (uint32_t i = 0; i < ehdr.e_shnum; i++)
+    {
+        Elf64_Shdr shdr;
+        Elf64::ReadShdr(_bin, _size, offset, shdr);
+        shdrs.push_back(shdr);
+        offset += ehdr.e_shentsize;
+    }
+    Elf64_Shdr secStrShdr = shdrs[ehdr.e_shstrndx];
+
+    // sections not in the file are left empty
+    std::map<std::string, Elf64_Shdr> nameShdrMap;
+    for (auto it = shdrs.begin(); it != shdrs.end(); it++)
+    {
+        nameShdrMap[Elf64::GetSectionName(_bin, _size, secStrShdr, it->sh_name)] = *it;
+    }
+    auto findShdr = [&](const std::string &name)
+    {
+        auto it = nameShdrMap.find(name);
+        return (it != nameShdrMap.end()) ? it->second : Elf64_Shdr{};
+    };
+    Elf64_Shdr symTabShdr = findShdr(".symtab");
+    if (symTabShdr.sh_size == 0)
+    {
+        Logger::ELog("%s has no .symtab", path);
+        return false;
+    }
+
+    std::vector<Elf64_Sym> symTbl;
+    Elf64::GetSymbolTbl(_bin, _size, symTabShdr, symTbl);
+    ElfFunctionTable elfFuncTable;
+    elfFuncTable.Path = path;
+    Elf64::GetElfFuncInfos(_bin, _size, shdrs, symTbl, secStrShdr, findShdr(".strtab"), elfFuncTable.ElfFuncInfos);
+    Elf64::BuildAddrFuncIdxMap(elfFuncTable);
+
+    Elf64_Shdr lineShdr = findShdr(".debug_line");
+    Elf64_Shdr lineStrShdr = findShdr(".debug_line_str");
+    if (lineShdr.sh_size != 0)
+    {
+        Dwarf::ReadLineInfo(_bin, _size, lineShdr, lineStrShdr, elfFuncTable, threadCount);
+    }
+
+    const std::vector<ElfFunctionInfo> &funcInfos = elfFuncTable.ElfFuncInfos;
+    _funcs.resize(funcInfos.size());
+    for (size_t i = 0; i < funcInfos.size(); i++)
+    {
+        BuildFunc &func = _funcs[i];
+        func.Name = funcInfos[i].Name;
+        func.Size = funcInfos[i].Size;
+        func.SecName = funcInfos[i].SecName;
+        func.LineCount = funcInfos[i].LineAddrs.size();
+    }
+
+    // inlined copies of each function, by the concrete subprogram DIE at its address
+    Elf64_Shdr infoShdr = findShdr(".debug_info");
+    Elf64_Shdr abbrevShdr = findShdr(".debug_abbrev");
+    if ((infoShdr.sh_size != 0) && (abbrevShdr.sh_size != 0))
+    {
+        DwarfInlineTable inlineTable;
+        inlineTable.Build(_bin, _size, infoShdr, findShdr(".debug_str"), lineStrShdr, abbrevShdr, findShdr(".debug_ranges"), findShdr(".debug_rnglists"), threadCount);
+        std::unordered_map<uint64_t, uint32_t> dieFuncIdxMap;
+        for (uint32_t funcIdx = 0; funcIdx < funcInfos.size(); funcIdx++)
+        {
+            uint64_t dieOffset = 0;
+            if (inlineTable.FindFunc(funcInfos[funcIdx].Addr, dieOffset))
+            {
+                dieFuncIdxMap.emplace(dieOffset, funcIdx);
+            }
+        }
+        for (auto it = inlineTable.Sites().begin(); it != inlineTable.Sites().end(); it++)
+        {
+            auto funcIt = dieFuncIdxMap.find(it->FuncOffset);
+            if (funcIt != dieFuncIdxMap.end())
+            {
+                _funcs[funcIt->second].Inlines[inlineTable.GetName(it->OriginOffset)]++;
+            }
+        }
+    }
+
+    // local functions sharing a name are told apart by their order in the file
+    std::vector<uint32_t> funcIdxs(funcInfos.size());
+    for (uint32_t i = 0; i < funcIdxs.size(); i++)
+    {
+        funcIdxs[i] = i;
+    }
+    std::sort(funcIdxs.begin(), funcIdxs.end(), [&](const uint32_t a, const uint32_t b)
+    {
+        return (funcInfos[a].Addr < funcInfos[b].Addr);
+    });
+    std::unordered_map<std::string, uint32_t> nameCountMap;
+    for (auto it = funcIdxs.begin(); it != funcIdxs.end(); it++)
+    {
+        BuildFunc &func = _funcs[*it];
+        uint32_t count = ++nameCountMap[func.Name];
+        func.Key = (count == 1) ? func.Name : StringHelper::strprintf("%s#%d", func.Name, count);
+        _keyFuncIdxMap[func.Key] = *it;
+    }
+    Logger::TLog("BuildIndex::Load Out...");
+    return true;
+}
+
+const std::vector<BuildFunc> &BuildIndex::Funcs() const
+{
+    return _funcs;
+}
+
+bool BuildIndex::Find(const std::string &key, uint32_t &funcIdx) const
+{
+    auto it = _keyFuncIdxMap.find(key);
+    if (it == _keyFuncIdxMap.end())
+    {
+        return false;
+    }
+    funcIdx = it->second;
+    return true;
+}
+
+uint64_t BuildIndex::TextSize() const
+{
+    uint64_t size = 0;
+    for (auto it = _funcs.begin(); it != _funcs.end(); it++)
+    {
+        size += it->Size;
+    }
+    return size;
+}
+
+BuildDiff::BuildDiff(const BuildIndex &oldIndex, const BuildIndex &newIndex) :
+    _oldIndex(oldIndex),
+    _newIndex(newIndex)
+{
+}
+
+void BuildDiff::Compare()
+{
+    _pairs.clear();
+    const std::vector<BuildFunc> &oldFuncs = _oldIndex.Funcs();
+    const std::vector<BuildFunc> &newFuncs = _newIndex.Funcs();
+    for (uint32_t oldIdx = 0; oldIdx < oldFuncs.size(); oldIdx++)
+    {
+        uint32_t newIdx = 0;
+        bool found = _newIndex.Find(oldFuncs[oldIdx].Key, newIdx);
+        _pairs.push_back({oldIdx, found ? (int64_t)newIdx : -1});
+    }
+    for (uint32_t newIdx = 0; newIdx < newFuncs.size(); newIdx++)
+    {
+        uint32_t oldIdx = 0;
+        if (!_oldIndex.Find(newFuncs[newIdx].Key, oldIdx))
+        {
+            _pairs.push_back({-1, newIdx});
+        }
+    }
+}
+
+void BuildDiff::Write(std::ostream &os, const size_t maxRows) const
+{
+    size_t matchCount = 0;
+    std::vector<std::pair<int64_t, const FuncPair *>> sizeDeltas;
+    std::vector<const FuncPair *> sectionChanges;
+    std::vector<const FuncPair *> coldSplits;
+    std::vector<std::pair<int64_t, const FuncPair *>> lineDeltas;
+    std::vector<std::pair<uint32_t, std::string>> inlineChanges;     // first: inlined copies added or removed
+    for (auto it = _pairs.begin(); it != _pairs.end(); it++)
+    {
+        const BuildFunc *oldFunc = getOld(*it);
+        const BuildFunc *newFunc = getNew(*it);
+        int64_t sizeDelta = (int64_t)((newFunc != nullptr) ? newFunc->Size : 0) - (int64_t)((oldFunc != nullptr) ? oldFunc->Size : 0);
+        if (sizeDelta != 0)
+        {
+            sizeDeltas.push_back(std::make_pair(sizeDelta, &*it));
+        }
+        if (oldFunc == nullptr)
+        {
+            // gcc names the parts split out of a function foo.cold, foo.part.0
+            if ((newFunc->Name.find(".cold") != std::string::npos) || (newFunc->Name.find(".part.") != std::string::npos))
+            {
+                coldSplits.push_back(&*it);
+            }
+            continue;
+        }
+        if (newFunc == nullptr)
+        {
+            continue;
+        }
+
+        matchCount++;
+        if (oldFunc->SecName != newFunc->SecName)
+        {
+            sectionChanges.push_back(&*it);
+        }
+        if (oldFunc->LineCount != newFunc->LineCount)
+        {
+            lineDeltas.push_back(std::make_pair((int64_t)newFunc->LineCount - (int64_t)oldFunc->LineCount, &*it));
+        }
+        if (oldFunc->Inlines != newFunc->Inlines)
+        {
+            // both maps are sorted by origin, so they are merged in one pass
+            std::string changes;
+            uint32_t changeCount = 0;
+            auto oldIt = oldFunc->Inlines.begin();
+            auto newIt = newFunc->Inlines.begin();
+            while ((oldIt != oldFunc->Inlines.end()) || (newIt != newFunc->Inlines.end()))
+            {
+                int64_t delta = 0;
+                std::string origin;
+                if ((newIt == newFunc->Inlines.end()) || ((oldIt != oldFunc->Inlines.end()) && (oldIt->first < newIt->first)))
+                {
+                    origin = oldIt->first;
+                    delta = -(int64_t)oldIt->second;
+                    oldIt++;
+                }
+                else if ((oldIt == oldFunc->Inlines.end()) || (newIt->first < oldIt->first))
+                {
+                    origin = newIt->first;
+                    delta = newIt->second;
+                    newIt++;
+                }
+                else
+                {
+                    origin = oldIt->first;
+                    delta = (int64_t)newIt->second - (int64_t)oldIt->second;
+                    oldIt++;
+                    newIt++;
+                }
+                if (delta != 0)
+                {
+                    changes += StringHelper::strprintf(" %s%ld %s", (0 < delta) ? "+" : "", delta, origin);
+                    changeCount += std::abs(delta);
+                }
+            }
+            inlineChanges.push_back(std::make_pair(changeCount, newFunc->Name + ":" + changes));
+        }
+    }
+
+    auto byMagnitude = [](const std::pair<int64_t, const FuncPair *> &a, const std::pair<int64_t, const FuncPair *> &b)
+    {
+        return (std::abs(b.first) < std::abs(a.first));
+    };
+    std::stable_sort(sizeDeltas.begin(), sizeDeltas.end(), byMagnitude);
+    std::stable_sort(lineDeltas.begin(), lineDeltas.end(), byMagnitude);
+    std::stable_sort(inlineChanges.begin(), inlineChanges.end(), [](const std::pair<uint32_t, std::string> &a, const std::pair<uint32_t, std::string> &b)
+    {
+        return (b.first < a.first);
+    });
+
+    uint64_t oldSize = _oldIndex.TextSize();
+    uint64_t newSize = _newIndex.TextSize();
+    os << StringHelper::strprintf("functions: old %ld, new %ld, matched %ld, added %ld, removed %ld", _oldIndex.Funcs().size(), _newIndex.Funcs().size(), matchCount, _newIndex.Funcs().size() - matchCount, _oldIndex.Funcs().size() - matchCount) << "\n";
+    os << StringHelper::strprintf("function bytes: old %ld, new %ld, delta %+ld", oldSize, newSize, (int64_t)(newSize - oldSize)) << "\n";
+
+    os << "\n" << StringHelper::strprintf("size changes: %ld", sizeDeltas.size()) << "\n";
+    for (size_t i = 0; (i < sizeDeltas.size()) && (i < maxRows); i++)
+    {
+        const BuildFunc *oldFunc = getOld(*sizeDeltas[i].second);
+        const BuildFunc *newFunc = getNew(*sizeDeltas[i].second);
+        const char *status = (oldFunc == nullptr) ? "added" : (newFunc == nullptr) ? "removed" : "";
+        os << StringHelper::strprintf("  %+10ld %10ld %10ld %-8s %s", sizeDeltas[i].first, (oldFunc != nullptr) ? oldFunc->Size : 0, (newFunc != nullptr) ? newFunc->Size : 0, status, (newFunc != nullptr) ? newFunc->Name : oldFunc->Name) << "\n";
+    }
+
+    os << "\n" << StringHelper::strprintf("section changes: %ld", sectionChanges.size()) << "\n";
+    for (size_t i = 0; (i < sectionChanges.size()) && (i < maxRows); i++)
+    {
+        const BuildFunc *oldFunc = getOld(*sectionChanges[i]);
+        const BuildFunc *newFunc = getNew(*sectionChanges[i]);
+        os << StringHelper::strprintf("  %s -> %s %s", oldFunc->SecName, newFunc->SecName, newFunc->Name) << "\n";
+    }
+
+    os << "\n" << StringHelper::strprintf("new cold splits: %ld", coldSplits.size()) << "\n";
+    for (size_t i = 0; (i < coldSplits.size()) && (i < maxRows); i++)
+    {
+        const BuildFunc *newFunc = getNew(*coldSplits[i]);
+        os << StringHelper::strprintf("  %10ld %s %s", newFunc->Size, newFunc->SecName, newFunc->Name) << "\n";
+    }
+
+    os << "\n" << StringHelper::strprintf("inlining changes: %ld", inlineChanges.size()) << "\n";
+    for (size_t i = 0; (i < inlineChanges.size()) && (i < maxRows); i++)
+    {
+        os << "  " << inlineChanges[i].second << "\n";
+    }
+
+    os << "\n" << StringHelper::strprintf("line coverage changes: %ld", lineDeltas.size()) << "\n";
+    for (size_t i = 0; (i < lineDeltas.size()) && (i < maxRows); i++)
+    {
+        const BuildFunc *oldFunc = getOld(*lineDeltas[i].second);
+        const BuildFunc *newFunc = getNew(*lineDeltas[i].second);
+        os << StringHelper::strprintf("  %+10ld %10d %10d %s", lineDeltas[i].first, oldFunc->LineCount, newFunc->LineCount, newFunc->Name) << "\n";
+    }
+}
+
+const BuildFunc *BuildDiff::getOld(const FuncPair &pair) const
+{
+    return (pair.OldIdx < 0) ? nullptr : &_oldIndex.Funcs()[pair.OldIdx];
+}
+
+const BuildFunc *BuildDiff::getNew(const FuncPair &pair) const
+{
+    return (pair.NewIdx < 0) ? nullptr : &_newIndex.Funcs()[pair.NewIdx];
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "elf_parser.h"
+
+// Function of one build as compared by BuildDiff
+struct BuildFunc
+{
+    std::string Name;                           // linkage name
+    std::string Key;                            // Name, "Name#n" for the n-th local function of the name
+    uint64_t Size;
+    std::string SecName;
+    uint32_t LineCount;                         // source lines with a row
+    std::map<std::string, uint32_t> Inlines;    // key: abstract origin, value: inlined copies
+};
+
+// Functions of one build, indexed by linkage name
+// Only the symbol table, the line tables and the inline tree are read, so the index is small
+// and two of them are built concurrently.
+class BuildIndex
+{
+public:
+    BuildIndex();
+    ~BuildIndex();
+    bool Load(const std::string &path, const unsigned threadCount);
+    const std::vector<BuildFunc> &Funcs() const;
+    bool Find(const std::string &key, uint32_t &funcIdx) const;
+    uint64_t TextSize() const;
+
+private:
+    std::string _path;
+    uint8_t *_bin;
+    uint64_t _size;
+    std::vector<BuildFunc> _funcs;
+    std::unordered_map<std::string, uint32_t> _keyFuncIdxMap;   // key: Key of BuildFunc
+};
+
+// Differences between an old and a new build of one binary
+class BuildDiff
+{
+public:
+    BuildDiff(const BuildIndex &oldIndex, const BuildIndex &newIndex);
+    void Compare();
+    void Write(std::ostream &os, const size_t maxRows) const;
+
+private:
+    struct FuncPair
+    {
+        int64_t OldIdx;         // -1: added
+        int64_t NewIdx;         // -1: removed
+    };
+    const BuildFunc *getOld(const FuncPair &pair) const;
+    const BuildFunc *getNew(const FuncPair &pair) const;
+
+private:
+    const BuildIndex &_oldIndex;
+    const BuildIndex &_newIndex;
+    std::vector<FuncPair> _pairs;
+};
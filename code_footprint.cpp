@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <map>
+#include "code_footprint.h"
+
+static const uint64_t FOOTPRINT_SMALL_PAGE = 4 * 1024;
+static const uint64_t FOOTPRINT_HUGE_PAGE = 2 * 1024 * 1024;
+
+// share of the samples taken by the hot functions
+static const double FOOTPRINT_HOT_RATIO = 0.99;
+
+// bytes fetched and decoded at once, function entries are aligned to it by -falign-functions
+static const uint64_t FOOTPRINT_FETCH_SIZE = 16;
+
+CodeFootprintAnalyzer::CodeFootprintAnalyzer(const ElfFunctionTable &elfFuncTable, const uint32_t cacheLineSize) :
+    _elfFuncTable(elfFuncTable),
+    _cacheLineSize(cacheLineSize)
+{
+}
+
+bool CodeFootprintAnalyzer::ReadSamples(const std::string &path)
+{
+    return SampleReader::ReadSamples(path, [&](const std::vector<uint64_t> &stack, const uint64_t count)
+    {
+        uint32_t funcIdx = 0;
+        if (Elf64::FindFuncIdx(_elfFuncTable, stack[0], funcIdx))
+        {
+            _samples.Add(funcIdx, count);
+        }
+    });
+}
+
+CodeFootprintReport CodeFootprintAnalyzer::Analyze()
+{
+    _samples.Flush();
+
+    const std::vector<ElfFunctionInfo> &funcInfos = _elfFuncTable.ElfFuncInfos;
+    CodeFootprintReport report = {};
+    report.FuncCount = funcInfos.size();
+    report.TotalSamples = _samples.Total();
+
+    // without samples every function is hot, weighted by its size
+    std::vector<uint64_t> samples(funcInfos.size(), 0);
+    if (report.TotalSamples == 0)
+    {
+        for (size_t i = 0; i < funcInfos.size(); i++)
+        {
+            samples[i] = funcInfos[i].Size;
+        }
+    }
+
+    // aliases of one body (C1/C2, D1/D2) are one range, their samples go to the kept symbol
+    std::vector<bool> isAliases = Elf64::FindAliases(_elfFuncTable);
+    std::map<std::pair<uint64_t, uint64_t>, uint32_t> bodyIdxMap;
+    for (uint32_t funcIdx = 0; funcIdx < funcInfos.size(); funcIdx++)
+    {
+        if (!isAliases[funcIdx])
+        {
+            bodyIdxMap.insert(std::make_pair(std::make_pair(funcInfos[funcIdx].Addr, funcInfos[funcIdx].Size), funcIdx));
+        }
+    }
+    for (auto it = _samples.Counts().begin(); it != _samples.Counts().end(); it++)
+    {
+        uint32_t funcIdx = it->first;
+        if (isAliases[funcIdx])
+        {
+            funcIdx = bodyIdxMap[std::make_pair(funcInfos[funcIdx].Addr, funcInfos[funcIdx].Size)];
+        }
+        samples[funcIdx] += it->second;
+    }
+
+    std::vector<uint32_t> funcIdxs;
+    uint64_t totalWeight = 0;
+    for (uint32_t funcIdx = 0; funcIdx < funcInfos.size(); funcIdx++)
+    {
+        if ((samples[funcIdx] != 0) && (funcInfos[funcIdx].Size != 0) && !isAliases[funcIdx])
+        {
+            funcIdxs.push_back(funcIdx);
+            totalWeight += samples[funcIdx];
+        }
+    }
+    std::sort(funcIdxs.begin(), funcIdxs.end(), [&](const uint32_t a, const uint32_t b)
+    {
+        if (samples[a] != samples[b])
+        {
+            return (samples[b] < samples[a]);
+        }
+        return (funcInfos[a].Addr < funcInfos[b].Addr);
+    });
+
+    // hottest functions up to the ratio
+    uint64_t weight = 0;
+    size_t hotCount = 0;
+    double hotRatio = (report.TotalSamples == 0) ? 1.0 : FOOTPRINT_HOT_RATIO;
+    while ((hotCount < funcIdxs.size()) && (weight < totalWeight * hotRatio))
+    {
+        weight += samples[funcIdxs[hotCount]];
+        hotCount++;
+    }
+    funcIdxs.resize(hotCount);
+    report.HotFuncCount = hotCount;
+    report.HotSamples = (report.TotalSamples == 0) ? 0 : weight;
+
+    std::vector<Range> ranges;
+    for (auto it = funcIdxs.begin(); it != funcIdxs.end(); it++)
+    {
+        ranges.push_back({funcInfos[*it].Addr, funcInfos[*it].Addr + funcInfos[*it].Size});
+    }
+    report.Hot = getFootprint(ranges);
+
+    // packed densest first, each entry keeps its alignment (up to the fetch size)
+    std::vector<uint32_t> packedIdxs = funcIdxs;
+    std::stable_sort(packedIdxs.begin(), packedIdxs.end(), [&](const uint32_t a, const uint32_t b)
+    {
+        return ((double)samples[b] * funcInfos[a].Size < (double)samples[a] * funcInfos[b].Size);
+    });
+    ranges.clear();
+    uint64_t addr = 0;
+    for (auto it = packedIdxs.begin(); it != packedIdxs.end(); it++)
+    {
+        uint64_t align = std::min(funcInfos[*it].Addr & (~funcInfos[*it].Addr + 1), FOOTPRINT_FETCH_SIZE);
+        addr = (addr + align - 1) & ~(align - 1);
+        ranges.push_back({addr, addr + funcInfos[*it].Size});
+        addr += funcInfos[*it].Size;
+    }
+    report.Packed = getFootprint(ranges);
+
+    for (auto it = funcIdxs.begin(); it != funcIdxs.end(); it++)
+    {
+        const ElfFunctionInfo &funcInfo = funcInfos[*it];
+        uint32_t lineOffset = funcInfo.Addr % _cacheLineSize;
+        bool straddle = (_cacheLineSize < lineOffset + std::min(funcInfo.Size, FOOTPRINT_FETCH_SIZE));
+        if (((funcInfo.Addr % FOOTPRINT_FETCH_SIZE) != 0) || straddle)
+        {
+            report.Misaligned.push_back({*it, samples[*it], lineOffset, straddle});
+        }
+    }
+    return report;
+}
+
+uint64_t CodeFootprintAnalyzer::countUnits(const std::vector<Range> &ranges, const uint64_t unitSize)
+{
+    // ranges are sorted by Begin, a unit shared by two ranges is counted once
+    uint64_t count = 0;
+    uint64_t next = 0;
+    for (auto it = ranges.begin(); it != ranges.end(); it++)
+    {
+        uint64_t first = std::max(it->Begin / unitSize, next);
+        uint64_t last = (it->End - 1) / unitSize;
+        if (first <= last)
+        {
+            count += last - first + 1;
+            next = last + 1;
+        }
+    }
+    return count;
+}
+
+CodeFootprint CodeFootprintAnalyzer::getFootprint(std::vector<Range> &ranges) const
+{
+    std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b)
+    {
+        return (a.Begin < b.Begin);
+    });
+
+    CodeFootprint footprint = {};
+    footprint.Bytes = countUnits(ranges, 1);
+    footprint.CacheLines = countUnits(ranges, _cacheLineSize);
+    footprint.SmallPages = countUnits(ranges, FOOTPRINT_SMALL_PAGE);
+    footprint.HugePages = countUnits(ranges, FOOTPRINT_HUGE_PAGE);
+    return footprint;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "elf_parser.h"
+#include "sample_reader.h"
+
+// Cache lines and pages touched by a set of functions
+struct CodeFootprint
+{
+    uint64_t Bytes;
+    uint64_t CacheLines;
+    uint64_t SmallPages;        // 4 KiB
+    uint64_t HugePages;         // 2 MiB
+};
+
+// hot function entry which starts a fetch block in the middle of a line
+struct MisalignedEntry
+{
+    uint32_t FuncIdx;
+    uint64_t Samples;
+    uint32_t LineOffset;        // offset of the entry in its cache line
+    bool Straddle;              // the first fetch block crosses a cache line
+};
+
+struct CodeFootprintReport
+{
+    uint32_t FuncCount;
+    uint32_t HotFuncCount;
+    uint64_t HotSamples;
+    uint64_t TotalSamples;      // 0: no sample file, every function is hot
+    CodeFootprint Hot;          // hot functions where they are linked
+    CodeFootprint Packed;       // hot functions packed densest first from a huge page boundary
+    std::vector<MisalignedEntry> Misaligned;    // most sampled first
+};
+
+// i-cache / iTLB footprint of the hot code
+// Hot functions are the most sampled functions holding FOOTPRINT_HOT_RATIO of the samples.
+// Their footprint is compared with the one they would have if they were packed together,
+// which is what reordering (--function-order) and huge page text remapping can win.
+class CodeFootprintAnalyzer
+{
+public:
+    CodeFootprintAnalyzer(const ElfFunctionTable &elfFuncTable, const uint32_t cacheLineSize);
+    bool ReadSamples(const std::string &path);
+    CodeFootprintReport Analyze();
+
+private:
+    struct Range
+    {
+        uint64_t Begin;
+        uint64_t End;
+    };
+    static uint64_t countUnits(const std::vector<Range> &ranges, const uint64_t unitSize);
+    CodeFootprint getFootprint(std::vector<Range> &ranges) const;
+
+private:
+    const ElfFunctionTable &_elfFuncTable;
+    uint32_t _cacheLineSize;
+    SampleCounter<uint32_t> _samples;       // key: Index of ElfFuncInfos
+};
@@ -0,0 +1,371 @@
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include "code_size.h"
+#include "demangler.h"
+#include "parallel.h"
+#include "logger.h"
+#include "common.h"
+
+CodeSizeAnalyzer::CodeSizeAnalyzer(const ElfFunctionTable &elfFuncTable, const SourceLineIndex &lineIndex, const unsigned threadCount) :
+    _elfFuncTable(elfFuncTable),
+    _lineIndex(lineIndex),
+    _threadCount(threadCount)
+{
+}
+
+void CodeSizeAnalyzer::Build(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgLineShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const DwarfArangeMap &arangesMap)
+{
+    Logger::TLog("CodeSizeAnalyzer::Build In...");
+    std::vector<DwarfCuEntry> cuEntries = Dwarf::ReadCuHeaders(bin, size, dbgInfoShdr);
+    std::vector<CodeSizeUnit> units(cuEntries.size());
+    Parallel::For(cuEntries.size(), _threadCount, [&](size_t idx)
+    {
+        units[idx] = ReadUnit(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, dbgRangesShdr, dbgRngListsShdr, cuEntries[idx]);
+    });
+
+    // each unit owns the debug bytes up to the next unit / line program
+    std::vector<uint64_t> stmtLists;
+    for (auto it = units.begin(); it != units.end(); it++)
+    {
+        if (it->StmtList != UINT64_MAX)
+        {
+            stmtLists.push_back(it->StmtList);
+        }
+    }
+    std::sort(stmtLists.begin(), stmtLists.end());
+    stmtLists.erase(std::unique(stmtLists.begin(), stmtLists.end()), stmtLists.end());
+    for (size_t i = 0; i < units.size(); i++)
+    {
+        CodeSizeUnit &unit = units[i];
+        unit.DebugBytes = ((i + 1 < units.size()) ? units[i + 1].Offset : dbgInfoShdr.sh_size) - unit.Offset;
+        if (unit.StmtList != UINT64_MAX)
+        {
+            auto nextIt = std::upper_bound(stmtLists.begin(), stmtLists.end(), unit.StmtList);
+            uint64_t end = (nextIt != stmtLists.end()) ? *nextIt : dbgLineShdr.sh_size;
+            unit.DebugBytes += (unit.StmtList < end) ? end - unit.StmtList : 0;
+        }
+        auto arangeIt = arangesMap.find(unit.Offset);
+        if (arangeIt != arangesMap.end())
+        {
+            const DwarfArangeInfoHdr &hdr = arangeIt->second.Header;
+            unit.DebugBytes += hdr.UnitLength + ((hdr.DwarfFormat == DWARF_64BIT_FORMAT) ? 12 : 4);
+        }
+    }
+
+    // functions of each unit, the last list holds the functions outside of every unit
+    struct UnitRange
+    {
+        uint64_t Low;
+        uint64_t High;
+        uint32_t UnitIdx;
+    };
+    std::vector<UnitRange> unitRanges;
+    for (uint32_t unitIdx = 0; unitIdx < units.size(); unitIdx++)
+    {
+        for (auto it = units[unitIdx].Ranges.begin(); it != units[unitIdx].Ranges.end(); it++)
+        {
+            unitRanges.push_back({it->Low, it->High, unitIdx});
+        }
+    }
+    std::sort(unitRanges.begin(), unitRanges.end(), [](const UnitRange &a, const UnitRange &b)
+    {
+        return (a.Low < b.Low);
+    });
+    std::vector<std::vector<uint32_t>> unitFuncIdxs(units.size() + 1);
+    const std::vector<ElfFunctionInfo> &funcInfos = _elfFuncTable.ElfFuncInfos;
+    std::vector<bool> isAliases = Elf64::FindAliases(_elfFuncTable);
+    for (uint32_t funcIdx = 0; funcIdx < funcInfos.size(); funcIdx++)
+    {
+        uint64_t addr = funcInfos[funcIdx].Addr;
+        if ((funcInfos[funcIdx].Size == 0) || isAliases[funcIdx])
+        {
+            continue;
+        }
+        auto it = std::upper_bound(unitRanges.begin(), unitRanges.end(), addr, [](const uint64_t key, const UnitRange &range)
+        {
+            return key < range.Low;
+        });
+        uint32_t unitIdx = units.size();
+        if ((it != unitRanges.begin()) && (addr < (it - 1)->High))
+        {
+            unitIdx = (it - 1)->UnitIdx;
+        }
+        unitFuncIdxs[unitIdx].push_back(funcIdx);
+    }
+
+    std::vector<UnitSizes> unitSizes(unitFuncIdxs.size());
+    Parallel::For(unitFuncIdxs.size(), _threadCount, [&](size_t idx)
+    {
+        attributeFuncs(unitFuncIdxs[idx], unitSizes[idx]);
+    });
+
+    // merge
+    for (uint32_t i = 0; i < CODE_SIZE_REPORT_COUNT; i++)
+    {
+        _reports[i].clear();
+    }
+    std::unordered_map<uint32_t, CodeSizeEntry> fileEntryMap;
+    std::unordered_map<std::string, CodeSizeEntry> funcEntryMap;
+    for (size_t unitIdx = 0; unitIdx < unitFuncIdxs.size(); unitIdx++)
+    {
+        CodeSizeEntry unitEntry = {};
+        if (unitIdx < units.size())
+        {
+            const CodeSizeUnit &unit = units[unitIdx];
+            unitEntry.Name = (unit.Name.size() != 0) ? unit.Name : StringHelper::strprintf("[unit 0x%lx]", unit.Offset);
+            unitEntry.DebugBytes = unit.DebugBytes;
+        }
+        else
+        {
+            unitEntry.Name = "[no unit]";
+        }
+        for (auto it = unitFuncIdxs[unitIdx].begin(); it != unitFuncIdxs[unitIdx].end(); it++)
+        {
+            unitEntry.TextBytes += funcInfos[*it].Size;
+            unitEntry.Count += (funcInfos[*it].ParentIdx == ELF_FUNC_IDX_NONE) ? 1 : 0;
+        }
+        if ((unitEntry.TextBytes != 0) || (unitEntry.DebugBytes != 0))
+        {
+            _reports[CODE_SIZE_BY_CU].push_back(unitEntry);
+        }
+
+        const UnitSizes &sizes = unitSizes[unitIdx];
+        for (auto it = sizes.FileSizes.begin(); it != sizes.FileSizes.end(); it++)
+        {
+            CodeSizeEntry &entry = fileEntryMap[it->first];
+            entry.TextBytes += it->second.TextBytes;
+            entry.Count += it->second.Count;
+        }
+        for (auto it = sizes.Funcs.begin(); it != sizes.Funcs.end(); it++)
+        {
+            CodeSizeEntry &entry = funcEntryMap[it->Name];
+            entry.TextBytes += it->TextBytes;
+            entry.Count += it->Count;
+        }
+    }
+
+    for (auto it = fileEntryMap.begin(); it != fileEntryMap.end(); it++)
+    {
+        it->second.Name = (it->first != 0) ? _elfFuncTable.Files.GetPath(it->first) : "[no line info]";
+        _reports[CODE_SIZE_BY_FILE].push_back(it->second);
+    }
+    std::unordered_map<std::string, CodeSizeEntry> templateEntryMap;
+    for (auto it = funcEntryMap.begin(); it != funcEntryMap.end(); it++)
+    {
+        it->second.Name = it->first;
+        _reports[CODE_SIZE_BY_FUNC].push_back(it->second);
+
+        std::string family = GetTemplateFamily(it->first);
+        if (family.find("<>") != std::string::npos)
+        {
+            CodeSizeEntry &entry = templateEntryMap[family];
+            entry.TextBytes += it->second.TextBytes;
+            entry.Count += it->second.Count;
+        }
+    }
+    for (auto it = templateEntryMap.begin(); it != templateEntryMap.end(); it++)
+    {
+        it->second.Name = it->first;
+        _reports[CODE_SIZE_BY_TEMPLATE].push_back(it->second);
+    }
+
+    for (uint32_t i = 0; i < CODE_SIZE_REPORT_COUNT; i++)
+    {
+        std::sort(_reports[i].begin(), _reports[i].end(), [](const CodeSizeEntry &a, const CodeSizeEntry &b)
+        {
+            if (a.TextBytes != b.TextBytes)
+            {
+                return (b.TextBytes < a.TextBytes);
+            }
+            if (a.DebugBytes != b.DebugBytes)
+            {
+                return (b.DebugBytes < a.DebugBytes);
+            }
+            return (a.Name < b.Name);
+        });
+    }
+    Logger::TLog("CodeSizeAnalyzer::Build Out...");
+}
+
+CodeSizeUnit CodeSizeAnalyzer::ReadUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const DwarfCuEntry &cuEntry)
+{
+    CodeSizeUnit unit;
+    unit.Offset = cuEntry.Offset;
+    unit.StmtList = UINT64_MAX;
+    unit.DebugBytes = 0;
+
+    // only the unit DIE is read
+    DwarfDieReader reader(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, cuEntry);
+    DwarfDie die;
+    if (!reader.Next(die) || ((die.Tag != DW_TAG_compile_unit) && (die.Tag != DW_TAG_partial_unit)))
+    {
+        return unit;
+    }
+
+    const DwarfAttrValue *nameVal = die.Find(DW_AT_name);
+    if ((nameVal != nullptr) && (nameVal->Class == DWARF_VALUE_STRING))
+    {
+        unit.Name = nameVal->Str;
+    }
+    const DwarfAttrValue *stmtListVal = die.Find(DW_AT_stmt_list);
+    if ((stmtListVal != nullptr) && ((stmtListVal->Class == DWARF_VALUE_SEC_OFFSET) || (stmtListVal->Class == DWARF_VALUE_CONSTANT)))
+    {
+        unit.StmtList = stmtListVal->UData;
+    }
+    const DwarfAttrValue *lowVal = die.Find(DW_AT_low_pc);
+    uint64_t baseAddr = ((lowVal != nullptr) && (lowVal->Class == DWARF_VALUE_ADDRESS)) ? lowVal->UData : 0;
+    const Elf64_Shdr &rangesShdr = (5 <= cuEntry.Header.Version) ? dbgRngListsShdr : dbgRangesShdr;
+    if (!Dwarf::ReadDieRanges(bin, size, rangesShdr, cuEntry.Header, die, baseAddr, unit.Ranges))
+    {
+        Logger::DLog("ranges of unit at 0x%x are read partially", unit.Offset);
+    }
+    return unit;
+}
+
+const std::vector<CodeSizeEntry> &CodeSizeAnalyzer::GetReport(const uint32_t kind) const
+{
+    return _reports[kind];
+}
+
+std::string CodeSizeAnalyzer::GetTemplateFamily(const std::string &name)
+{
+    // operators which are not template brackets
+    static const char *operators[] = {"operator<=>", "operator<<=", "operator>>=", "operator<<", "operator>>", "operator<=", "operator>=", "operator->", "operator<", "operator>"};
+
+    std::string family;
+    uint32_t depth = 0;
+    size_t pos = 0;
+    while (pos < name.size())
+    {
+        bool isOperator = false;
+        for (size_t i = 0; (i < sizeof(operators) / sizeof(operators[0])) && !isOperator; i++)
+        {
+            if (name.compare(pos, std::strlen(operators[i]), operators[i]) == 0)
+            {
+                if (depth == 0)
+                {
+                    family += operators[i];
+                }
+                pos += std::strlen(operators[i]);
+                isOperator = true;
+            }
+        }
+        if (isOperator)
+        {
+            continue;
+        }
+
+        char c = name[pos++];
+        if (c == '<')
+        {
+            if (depth == 0)
+            {
+                family += "<>";
+            }
+            depth++;
+        }
+        else if ((c == '>') && (depth != 0))
+        {
+            depth--;
+        }
+        else if (depth == 0)
+        {
+            family += c;
+        }
+    }
+
+    // parameters and qualifiers after them: from the '(' matching the last ')'
+    size_t close = family.rfind(')');
+    uint32_t parens = 0;
+    for (size_t i = (close != std::string::npos) ? close + 1 : 0; 0 < i; i--)
+    {
+        if (family[i - 1] == ')')
+        {
+            parens++;
+        }
+        else if ((family[i - 1] == '(') && (--parens == 0))
+        {
+            if (i - 1 != 0)
+            {
+                family.resize(i - 1);
+            }
+            break;
+        }
+    }
+
+    // return type of a template function: up to the last space outside of parentheses
+    parens = 0;
+    for (size_t i = family.size(); 0 < i; i--)
+    {
+        char c = family[i - 1];
+        if (c == ')')
+        {
+            parens++;
+        }
+        else if ((c == '(') && (parens != 0))
+        {
+            parens--;
+        }
+        else if ((c == ' ') && (parens == 0))
+        {
+            // "operator new", "operator< <>" are one name
+            size_t operatorPos = family.rfind("operator", i - 1);
+            if ((operatorPos != std::string::npos) && (family.find(' ', operatorPos) == i - 1))
+            {
+                continue;
+            }
+            family.erase(0, i);
+            break;
+        }
+    }
+    return family;
+}
+
+void CodeSizeAnalyzer::attributeFuncs(const std::vector<uint32_t> &funcIdxs, UnitSizes &sizes) const
+{
+    std::unordered_map<uint32_t, CodeSizeEntry> fileEntryMap;
+    std::vector<SourceLineEntry> rows;
+    std::vector<uint32_t> fileIds;
+    for (auto it = funcIdxs.begin(); it != funcIdxs.end(); it++)
+    {
+        const ElfFunctionInfo &funcInfo = _elfFuncTable.ElfFuncInfos[*it];
+        uint64_t end = funcInfo.Addr + funcInfo.Size;
+
+        // bytes from a row to the next one belong to the file of the row
+        rows.clear();
+        _lineIndex.FindAddrRange(funcInfo.Addr, end, rows);
+        uint64_t addr = funcInfo.Addr;
+        uint32_t fileId = funcInfo.SrcFileId;
+        fileIds.clear();
+        for (auto rowIt = rows.begin(); (rowIt != rows.end()) && (rowIt->Addr < end); rowIt++)
+        {
+            if (addr < rowIt->Addr)
+            {
+                fileEntryMap[fileId].TextBytes += rowIt->Addr - addr;
+                fileIds.push_back(fileId);
+                addr = rowIt->Addr;
+            }
+            fileId = rowIt->FileId;
+        }
+        fileEntryMap[fileId].TextBytes += end - addr;
+        fileIds.push_back(fileId);
+
+        // functions with code from the file
+        std::sort(fileIds.begin(), fileIds.end());
+        fileIds.erase(std::unique(fileIds.begin(), fileIds.end()), fileIds.end());
+        for (auto fileIt = fileIds.begin(); fileIt != fileIds.end(); fileIt++)
+        {
+            fileEntryMap[*fileIt].Count++;
+        }
+
+        // a fragment adds its bytes to the function it was split from
+        if (funcInfo.ParentIdx != ELF_FUNC_IDX_NONE)
+        {
+            sizes.Funcs.push_back(CodeSizeEntry{Demangler::Demangle(_elfFuncTable.ElfFuncInfos[funcInfo.ParentIdx].Name), funcInfo.Size, 0, 0});
+            continue;
+        }
+        sizes.Funcs.push_back(CodeSizeEntry{Demangler::Demangle(funcInfo.Name), funcInfo.Size, 0, 1});
+    }
+    sizes.FileSizes.assign(fileEntryMap.begin(), fileEntryMap.end());
+}
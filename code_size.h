@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <elf.h>
+#include <string>
+#include <vector>
+
+#include "elf_parser.h"
+#include "dwarf.h"
+#include "line_index.h"
+
+// Reports of CodeSizeAnalyzer
+enum
+{
+    CODE_SIZE_BY_CU         = 0,
+    CODE_SIZE_BY_FILE       = 1,
+    CODE_SIZE_BY_FUNC       = 2,
+    CODE_SIZE_BY_TEMPLATE   = 3,
+    CODE_SIZE_REPORT_COUNT  = 4,
+};
+
+// bytes attributed to one unit, file, function or template family
+struct CodeSizeEntry
+{
+    std::string Name;
+    uint64_t TextBytes;         // function bytes from the symbol table
+    uint64_t DebugBytes;        // .debug_info, .debug_line and .debug_aranges bytes (units only)
+    uint32_t Count;             // functions
+};
+
+// Unit DIE and debug section bytes of one unit
+struct CodeSizeUnit
+{
+    uint64_t Offset;            // offset of the unit in .debug_info
+    std::string Name;           // DW_AT_name
+    uint64_t StmtList;          // DW_AT_stmt_list, UINT64_MAX: none
+    uint64_t DebugBytes;
+    std::vector<DwarfRange> Ranges;
+};
+
+// bloaty-like attribution of function bytes
+// A function belongs to the unit whose ranges hold its address. Its bytes are split between
+// source files by the line rows covering them, so code inlined from headers is counted in the header.
+// Aliases sharing one body (C1/C2, D1/D2) are counted once.
+// Units are read and their functions attributed in parallel, then the per unit counts are merged.
+class CodeSizeAnalyzer
+{
+public:
+    CodeSizeAnalyzer(const ElfFunctionTable &elfFuncTable, const SourceLineIndex &lineIndex, const unsigned threadCount);
+    void Build(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgLineShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const DwarfArangeMap &arangesMap);
+    static CodeSizeUnit ReadUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const DwarfCuEntry &cuEntry);
+    // largest first
+    const std::vector<CodeSizeEntry> &GetReport(const uint32_t kind) const;
+    // name without template arguments and parameters, "std::vector<>::push_back"
+    static std::string GetTemplateFamily(const std::string &name);
+
+private:
+    struct UnitSizes
+    {
+        std::vector<std::pair<uint32_t, CodeSizeEntry>> FileSizes;     // first: file id
+        std::vector<CodeSizeEntry> Funcs;       // Name: demangled name, of the parent for a fragment
+    };
+    void attributeFuncs(const std::vector<uint32_t> &funcIdxs, UnitSizes &sizes) const;
+
+private:
+    const ElfFunctionTable &_elfFuncTable;
+    const SourceLineIndex &_lineIndex;
+    unsigned _threadCount;
+    std::vector<CodeSizeEntry> _reports[CODE_SIZE_REPORT_COUNT];
+};
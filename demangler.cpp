@@ -0,0 +1,749 @@
+#include <cxxabi.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include "demangler.h"
+#include "parallel.h"
+
+// locks of the cache, a power of 2
+static const size_t DEMANGLER_SHARD_COUNT = 64;
+// names demangled by one task of DemangleAll
+static const size_t DEMANGLER_CHUNK_NAMES = 4096;
+// nesting of v0 paths and types, in case of a broken back reference loop
+static const uint32_t RUST_V0_MAX_DEPTH = 256;
+
+struct DemanglerShard
+{
+    std::mutex Mutex;
+    std::unordered_map<std::string, std::string> NameMap;   // key: mangled, value: demangled
+};
+
+static DemanglerShard s_shards[DEMANGLER_SHARD_COUNT];
+
+// Recursive descent parser of Rust v0 symbols
+// https://doc.rust-lang.org/rustc/symbol-mangling/v0.html
+// Lifetimes bound by for<> are named 'a, 'b, ..., crate disambiguators are not printed.
+class RustV0Parser
+{
+public:
+    RustV0Parser(const std::string &sym) : _sym(sym), _pos(0), _depth(0), _boundLifetimes(0), _failed(false)
+    {
+    }
+
+    bool Parse(std::string &out)
+    {
+        // "_R" [<decimal-number>] <path> [<instantiating-crate>] [<vendor-specific-suffix>]
+        if (_sym.compare(0, 2, "_R") != 0)
+        {
+            return false;
+        }
+        _pos = 2;
+        if ((_pos < _sym.size()) && isDigit(_sym[_pos]))
+        {
+            // encoding version, only 0 is defined
+            return false;
+        }
+        _begin = _pos;
+        path(out, true);
+        return !_failed;
+    }
+
+private:
+    static bool isDigit(const char c)
+    {
+        return ('0' <= c) && (c <= '9');
+    }
+
+    static bool isLower(const char c)
+    {
+        return ('a' <= c) && (c <= 'z');
+    }
+
+    static bool isUpper(const char c)
+    {
+        return ('A' <= c) && (c <= 'Z');
+    }
+
+    char peek() const
+    {
+        return (_pos < _sym.size()) ? _sym[_pos] : '\0';
+    }
+
+    bool eat(const char c)
+    {
+        if (peek() != c)
+        {
+            return false;
+        }
+        _pos++;
+        return true;
+    }
+
+    char next()
+    {
+        if (_sym.size() <= _pos)
+        {
+            _failed = true;
+            return '\0';
+        }
+        return _sym[_pos++];
+    }
+
+    // <base-62-number> = {<0-9a-zA-Z>} "_", "_" is 0, "0_" is 1
+    uint64_t base62()
+    {
+        if (eat('_'))
+        {
+            return 0;
+        }
+        uint64_t val = 0;
+        while (!_failed && !eat('_'))
+        {
+            char c = next();
+            uint64_t digit = 0;
+            if (isDigit(c))
+            {
+                digit = c - '0';
+            }
+            else if (isLower(c))
+            {
+                digit = 10 + (c - 'a');
+            }
+            else if (isUpper(c))
+            {
+                digit = 36 + (c - 'A');
+            }
+            else
+            {
+                _failed = true;
+                return 0;
+            }
+            val = val * 62 + digit;
+        }
+        return val + 1;
+    }
+
+    // [<base-62-number>] prefixed by tag, 0: absent
+    uint64_t optBase62(const char tag)
+    {
+        return eat(tag) ? base62() + 1 : 0;
+    }
+
+    uint64_t decimal()
+    {
+        if (!isDigit(peek()))
+        {
+            _failed = true;
+            return 0;
+        }
+        if (eat('0'))
+        {
+            return 0;
+        }
+        uint64_t val = 0;
+        while (isDigit(peek()))
+        {
+            val = val * 10 + (next() - '0');
+            if (_sym.size() < val)
+            {
+                _failed = true;
+                return 0;
+            }
+        }
+        return val;
+    }
+
+    // <undisambiguated-identifier> = ["u"] <decimal-number> ["_"] <bytes>
+    std::string ident()
+    {
+        bool punycode = eat('u');
+        uint64_t len = decimal();
+        eat('_');
+        if (_failed || (_sym.size() - _pos < len))
+        {
+            _failed = true;
+            return "";
+        }
+        std::string name = _sym.substr(_pos, len);
+        _pos += len;
+        // punycode is shown encoded
+        return punycode ? "punycode{" + name + "}" : name;
+    }
+
+    // "B" <base-62-number>, parse at the referenced position and come back
+    void backref(const std::function<void()> &parse)
+    {
+        size_t refPos = _begin + base62();
+        if (_failed || (_pos <= refPos))
+        {
+            _failed = true;
+            return;
+        }
+        size_t pos = _pos;
+        _pos = refPos;
+        parse();
+        _pos = pos;
+    }
+
+    bool enter()
+    {
+        if (RUST_V0_MAX_DEPTH <= ++_depth)
+        {
+            _failed = true;
+        }
+        return !_failed;
+    }
+
+    void path(std::string &out, const bool inValue)
+    {
+        if (!enter())
+        {
+            return;
+        }
+        char tag = next();
+        switch (tag)
+        {
+        case 'C':
+            // crate root
+            optBase62('s');
+            out += ident();
+            break;
+        case 'N':
+        {
+            char ns = next();
+            path(out, inValue);
+            uint64_t disambiguator = optBase62('s');
+            std::string name = ident();
+            if (isUpper(ns))
+            {
+                // closures and shims are numbered
+                out += "::{";
+                out += (ns == 'C') ? "closure" : (ns == 'S') ? "shim" : std::string(1, ns);
+                if (name.size() != 0)
+                {
+                    out += ":" + name;
+                }
+                out += "#" + std::to_string(disambiguator) + "}";
+            }
+            else if (name.size() != 0)
+            {
+                out += "::" + name;
+            }
+            break;
+        }
+        case 'M':
+            // <T>
+            optBase62('s');
+            implPath();
+            out += "<";
+            type(out);
+            out += ">";
+            break;
+        case 'X':
+            // <T as Trait>
+            optBase62('s');
+            implPath();
+            out += "<";
+            type(out);
+            out += " as ";
+            path(out, false);
+            out += ">";
+            break;
+        case 'Y':
+            out += "<";
+            type(out);
+            out += " as ";
+            path(out, false);
+            out += ">";
+            break;
+        case 'I':
+            path(out, inValue);
+            out += inValue ? "::<" : "<";
+            for (bool first = true; !_failed && !eat('E'); first = false)
+            {
+                if (!first)
+                {
+                    out += ", ";
+                }
+                genericArg(out);
+            }
+            out += ">";
+            break;
+        case 'B':
+            backref([&]() { path(out, inValue); });
+            break;
+        default:
+            _failed = true;
+            break;
+        }
+        _depth--;
+    }
+
+    // the path of an impl is not printed, its self type and trait are
+    void implPath()
+    {
+        std::string ignored;
+        path(ignored, false);
+    }
+
+    void genericArg(std::string &out)
+    {
+        if (eat('L'))
+        {
+            lifetime(out, base62());
+        }
+        else if (eat('K'))
+        {
+            constValue(out);
+        }
+        else
+        {
+            type(out);
+        }
+    }
+
+    void lifetime(std::string &out, const uint64_t idx)
+    {
+        if ((idx == 0) || (_boundLifetimes < idx))
+        {
+            out += "'_";
+            return;
+        }
+        uint64_t depth = _boundLifetimes - idx;
+        out += (depth < 26) ? std::string("'") + (char)('a' + depth) : "'_" + std::to_string(depth);
+    }
+
+    // "G" <base-62-number>, lifetimes bound by the following fn or dyn type
+    uint64_t binder(std::string &out)
+    {
+        uint64_t count = optBase62('G');
+        if (count == 0)
+        {
+            return 0;
+        }
+        out += "for<";
+        for (uint64_t i = 0; i < count; i++)
+        {
+            if (i != 0)
+            {
+                out += ", ";
+            }
+            _boundLifetimes++;
+            lifetime(out, 1);
+        }
+        out += "> ";
+        return count;
+    }
+
+    static const char *basicType(const char tag)
+    {
+        switch (tag)
+        {
+        case 'a': return "i8";
+        case 'b': return "bool";
+        case 'c': return "char";
+        case 'd': return "f64";
+        case 'e': return "str";
+        case 'f': return "f32";
+        case 'h': return "u8";
+        case 'i': return "isize";
+        case 'j': return "usize";
+        case 'l': return "i32";
+        case 'm': return "u32";
+        case 'n': return "i128";
+        case 'o': return "u128";
+        case 's': return "i16";
+        case 't': return "u16";
+        case 'u': return "()";
+        case 'v': return "...";
+        case 'x': return "i64";
+        case 'y': return "u64";
+        case 'z': return "!";
+        case 'p': return "_";
+        default: return nullptr;
+        }
+    }
+
+    void type(std::string &out)
+    {
+        if (!enter())
+        {
+            return;
+        }
+        char tag = peek();
+        const char *basic = basicType(tag);
+        if (basic != nullptr)
+        {
+            _pos++;
+            out += basic;
+            _depth--;
+            return;
+        }
+        _pos++;
+        switch (tag)
+        {
+        case 'R':
+        case 'Q':
+            out += "&";
+            if (eat('L'))
+            {
+                uint64_t idx = base62();
+                if (idx != 0)
+                {
+                    lifetime(out, idx);
+                    out += " ";
+                }
+            }
+            out += (tag == 'Q') ? "mut " : "";
+            type(out);
+            break;
+        case 'P':
+            out += "*const ";
+            type(out);
+            break;
+        case 'O':
+            out += "*mut ";
+            type(out);
+            break;
+        case 'A':
+            out += "[";
+            type(out);
+            out += "; ";
+            constValue(out);
+            out += "]";
+            break;
+        case 'S':
+            out += "[";
+            type(out);
+            out += "]";
+            break;
+        case 'T':
+        {
+            out += "(";
+            size_t count = 0;
+            for (; !_failed && !eat('E'); count++)
+            {
+                if (count != 0)
+                {
+                    out += ", ";
+                }
+                type(out);
+            }
+            out += (count == 1) ? ",)" : ")";
+            break;
+        }
+        case 'F':
+            fnSig(out);
+            break;
+        case 'D':
+            dynType(out);
+            break;
+        case 'B':
+            backref([&]() { type(out); });
+            break;
+        default:
+            // a path naming an ADT
+            _pos--;
+            path(out, false);
+            break;
+        }
+        _depth--;
+    }
+
+    // <fn-sig> = [<binder>] ["U"] ["K" <abi>] {<type>} "E" <type>
+    void fnSig(std::string &out)
+    {
+        uint64_t bound = binder(out);
+        if (eat('U'))
+        {
+            out += "unsafe ";
+        }
+        if (eat('K'))
+        {
+            out += "extern \"";
+            out += eat('C') ? "C" : ident();
+            out += "\" ";
+        }
+        out += "fn(";
+        for (bool first = true; !_failed && !eat('E'); first = false)
+        {
+            if (!first)
+            {
+                out += ", ";
+            }
+            type(out);
+        }
+        out += ")";
+        if (eat('u'))
+        {
+            // -> () is not printed
+        }
+        else
+        {
+            out += " -> ";
+            type(out);
+        }
+        _boundLifetimes -= bound;
+    }
+
+    // <dyn-bounds> = [<binder>] {<dyn-trait>} "E", followed by a lifetime
+    void dynType(std::string &out)
+    {
+        out += "dyn ";
+        uint64_t bound = binder(out);
+        for (bool first = true; !_failed && !eat('E'); first = false)
+        {
+            if (!first)
+            {
+                out += " + ";
+            }
+            path(out, false);
+            // <dyn-trait-assoc-binding> = "p" <undisambiguated-identifier> <type>
+            for (bool firstBinding = true; !_failed && eat('p'); firstBinding = false)
+            {
+                out += firstBinding ? "<" : ", ";
+                out += ident() + " = ";
+                type(out);
+                if (peek() != 'p')
+                {
+                    out += ">";
+                }
+            }
+        }
+        _boundLifetimes -= bound;
+        if (eat('L'))
+        {
+            uint64_t idx = base62();
+            if (idx != 0)
+            {
+                out += " + ";
+                lifetime(out, idx);
+            }
+        }
+    }
+
+    // <const> = <type> <const-data> | "p" | <backref>
+    void constValue(std::string &out)
+    {
+        if (!enter())
+        {
+            return;
+        }
+        if (eat('p'))
+        {
+            out += "_";
+        }
+        else if (eat('B'))
+        {
+            backref([&]() { constValue(out); });
+        }
+        else
+        {
+            char tag = next();
+            bool negative = eat('n');
+            uint64_t val = 0;
+            std::string hex;
+            while (!_failed && !eat('_'))
+            {
+                char c = next();
+                hex += c;
+                val = (val << 4) | (isDigit(c) ? c - '0' : (c - 'a' + 10));
+            }
+            if (tag == 'b')
+            {
+                out += (val != 0) ? "true" : "false";
+            }
+            else if ((tag == 'c') && (val < 0x80) && (0x20 <= val))
+            {
+                out += "'" + std::string(1, (char)val) + "'";
+            }
+            else if ((hex.size() <= 16) && (basicType(tag) != nullptr))
+            {
+                out += (negative ? "-" : "") + std::to_string(val);
+            }
+            else
+            {
+                out += "0x" + hex;
+            }
+        }
+        _depth--;
+    }
+
+private:
+    const std::string &_sym;
+    size_t _pos;
+    size_t _begin;              // position after "_R", origin of back references
+    uint32_t _depth;
+    uint64_t _boundLifetimes;
+    bool _failed;
+};
+
+const std::string &Demangler::Demangle(const std::string &name)
+{
+    DemanglerShard &shard = s_shards[std::hash<std::string>()(name) & (DEMANGLER_SHARD_COUNT - 1)];
+    {
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        auto it = shard.NameMap.find(name);
+        if (it != shard.NameMap.end())
+        {
+            return it->second;
+        }
+    }
+
+    // demangled without the lock, a thread demangling the same name at the same time keeps the first result
+    std::string demangled = demangle(name);
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+    return shard.NameMap.emplace(name, std::move(demangled)).first->second;
+}
+
+std::vector<const std::string *> Demangler::DemangleAll(const std::vector<std::string> &names, const unsigned threadCount)
+{
+    std::vector<const std::string *> results(names.size(), nullptr);
+    size_t chunkCount = (names.size() + DEMANGLER_CHUNK_NAMES - 1) / DEMANGLER_CHUNK_NAMES;
+    Parallel::For(chunkCount, threadCount, [&](const size_t idx)
+    {
+        size_t end = std::min((idx + 1) * DEMANGLER_CHUNK_NAMES, names.size());
+        for (size_t i = idx * DEMANGLER_CHUNK_NAMES; i < end; i++)
+        {
+            results[i] = &Demangle(names[i]);
+        }
+    });
+    return results;
+}
+
+size_t Demangler::CachedCount()
+{
+    size_t count = 0;
+    for (size_t i = 0; i < DEMANGLER_SHARD_COUNT; i++)
+    {
+        std::lock_guard<std::mutex> lock(s_shards[i].Mutex);
+        count += s_shards[i].NameMap.size();
+    }
+    return count;
+}
+
+std::string Demangler::DemangleItanium(const std::string &name)
+{
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if ((status != 0) || (demangled == nullptr))
+    {
+        return name;
+    }
+    std::string result = demangled;
+    std::free(demangled);
+    return result;
+}
+
+bool Demangler::DemangleRustLegacy(const std::string &name, std::string &demangled)
+{
+    // "_ZN" {<length> <component>} "17h" <16 hex digits> "E", components escape punctuation as $..$
+    static const std::pair<const char *, const char *> escapes[] = {
+        {"$SP$", "@"}, {"$BP$", "*"}, {"$RF$", "&"}, {"$LT$", "<"}, {"$GT$", ">"}, {"$LP$", "("}, {"$RP$", ")"}, {"$C$", ","},
+    };
+    if (name.compare(0, 3, "_ZN") != 0)
+    {
+        return false;
+    }
+    std::vector<std::string> components;
+    size_t pos = 3;
+    while ((pos < name.size()) && (name[pos] != 'E'))
+    {
+        char *end = nullptr;
+        unsigned long len = std::strtoul(name.c_str() + pos, &end, 10);
+        pos = end - name.c_str();
+        if ((len == 0) || (name.size() - pos < len))
+        {
+            return false;
+        }
+        components.push_back(name.substr(pos, len));
+        pos += len;
+    }
+    // the last component is the hash, without it the name is C++
+    if ((components.size() < 2) || (components.back().size() != 17) || (components.back()[0] != 'h') ||
+        (components.back().find_first_not_of("0123456789abcdef", 1) != std::string::npos))
+    {
+        return false;
+    }
+    components.pop_back();
+
+    demangled.clear();
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        const std::string &component = components[i];
+        if (i != 0)
+        {
+            demangled += "::";
+        }
+        size_t cpos = (component.compare(0, 2, "_$") == 0) ? 1 : 0;
+        while (cpos < component.size())
+        {
+            if (component.compare(cpos, 2, "..") == 0)
+            {
+                demangled += "::";
+                cpos += 2;
+                continue;
+            }
+            if (component[cpos] != '$')
+            {
+                demangled += component[cpos++];
+                continue;
+            }
+            bool escaped = false;
+            for (size_t j = 0; (j < sizeof(escapes) / sizeof(escapes[0])) && !escaped; j++)
+            {
+                if (component.compare(cpos, std::strlen(escapes[j].first), escapes[j].first) == 0)
+                {
+                    demangled += escapes[j].second;
+                    cpos += std::strlen(escapes[j].first);
+                    escaped = true;
+                }
+            }
+            if (!escaped && (component.compare(cpos, 2, "$u") == 0))
+            {
+                // $u7e$: code point in hex
+                size_t close = component.find('$', cpos + 2);
+                if (close != std::string::npos)
+                {
+                    demangled += (char)std::strtoul(component.substr(cpos + 2, close - cpos - 2).c_str(), nullptr, 16);
+                    cpos = close + 1;
+                    escaped = true;
+                }
+            }
+            if (!escaped)
+            {
+                demangled += component[cpos++];
+            }
+        }
+    }
+    return true;
+}
+
+bool Demangler::DemangleRustV0(const std::string &name, std::string &demangled)
+{
+    std::string out;
+    RustV0Parser parser(name);
+    if (!parser.Parse(out))
+    {
+        return false;
+    }
+    demangled = out;
+    return true;
+}
+
+std::string Demangler::demangle(const std::string &name)
+{
+    std::string demangled;
+    if (DemangleRustV0(name, demangled) || DemangleRustLegacy(name, demangled))
+    {
+        return demangled;
+    }
+    if (name.compare(0, 2, "_Z") == 0)
+    {
+        return DemangleItanium(name);
+    }
+    return name;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Itanium C++ and Rust (legacy and v0 "_R") demangling with a process wide cache
+// Names are demangled when they are first asked for, so only names reaching the output cost anything.
+// The cache is an intern table of DEMANGLER_SHARD_COUNT shards, each with its own lock, so threads
+// demangling different names rarely wait. A cached name is never moved, the references stay valid.
+class Demangler
+{
+public:
+    // name itself when it is not mangled or can not be demangled
+    static const std::string &Demangle(const std::string &name);
+    // names demangled in parallel chunks, result[i] is Demangle(names[i])
+    static std::vector<const std::string *> DemangleAll(const std::vector<std::string> &names, const unsigned threadCount);
+    static size_t CachedCount();
+
+    static std::string DemangleItanium(const std::string &name);
+    static bool DemangleRustLegacy(const std::string &name, std::string &demangled);
+    static bool DemangleRustV0(const std::string &name, std::string &demangled);
+
+private:
+    static std::string demangle(const std::string &name);
+};
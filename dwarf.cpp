@@ -1,17 +1,22 @@
 #include <cassert>
+#include <algorithm>
+#include <unordered_map>
 #include "elf_parser.h"
 #include "dwarf.h"
 #include "binutil.h"
 #include "logger.h"
 #include "common.h"
+#include "stats.h"
+#include "parallel.h"
+#include "line_index.h"
 
-std::map<uint64_t, DwarfArangeInfo> Dwarf::ReadAranges(const uint8_t* bin, const uint64_t size, const Elf64_Shdr &arrangesShdr)
+DwarfArangeMap Dwarf::ReadAranges(const uint8_t* bin, const uint64_t size, const Elf64_Shdr &arrangesShdr)
 {
     Logger::TLog("ReadAranges In...");
     uint64_t offset = arrangesShdr.sh_offset; 
     uint64_t sectionEnd  = arrangesShdr.sh_offset + arrangesShdr.sh_size;
 
-    std::map<uint64_t, DwarfArangeInfo> arrangesMap;
+    DwarfArangeMap arrangesMap;
     while (offset < sectionEnd)
     {
         uint64_t headerTop  = offset;
@@ -112,1558 +117,1919 @@ std::map<uint64_t, DwarfArangeInfo> Dwarf::ReadAranges(const uint8_t* bin, const
         {
             offset += nextHdrTop - offset;
         }
-        arrangesMap[arangeInfo.Header.DebugInfoOffset] = arangeInfo;
+        arrangesMap.Append(arangeInfo.Header.DebugInfoOffset, std::move(arangeInfo));
     }
+    arrangesMap.Seal();
 
     Logger::TLog("ReadAranges Out...");
     return arrangesMap;
 }
 
-std::vector<Abbrev> Dwarf::ReadAbbrevTbl(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgAbbrevShdr, const uint64_t dbgAbbrevOffset)
+std::vector<DwarfCuRange> Dwarf::GetCuRanges(const DwarfArangeMap &offsetArangeMap, const std::vector<uint64_t> &cuOffsets)
 {
-    std::vector<Abbrev> abbrevTbl;
-    uint64_t offset     = dbgAbbrevOffset;
-    uint64_t secEndPos  = dbgAbbrevShdr.sh_offset + dbgAbbrevShdr.sh_size;
-
-    // for debug
-    std::map<uint64_t, std::string> attrNameMap = getAttrNameMap();
-    while(offset < secEndPos)
+    // cuOffsets are the unit offsets in .debug_info in offset order, CuIdx is an index of them
+    std::vector<DwarfCuRange> cuRanges;
+    for (auto it = offsetArangeMap.begin(); it != offsetArangeMap.end(); it++)
     {
-        Abbrev abbrev;
-        uint32_t len;
-        abbrev.Id = ReaduLEB128(&bin[offset], secEndPos - offset, len);
-        offset += len;
-        if (abbrev.Id == 0)
+        auto cuIt = std::lower_bound(cuOffsets.begin(), cuOffsets.end(), it->first);
+        if ((cuIt == cuOffsets.end()) || (*cuIt != it->first))
         {
-            // Abbreviations Tables end with an entry consisting of a 0 byte for the abbreviation code.
-            break;
+            Logger::DLog("no unit at debug_info offset:0x%x", it->first);
+            continue;
         }
 
-        abbrev.Tag = ReaduLEB128(&bin[offset], secEndPos - offset, len);
-        offset += len;
-        uint8_t hasChildren = bin[offset];
-        offset++;
+        for (auto segIt = it->second.Segments.begin(); segIt != it->second.Segments.end(); segIt++)
+        {
+            DwarfCuRange range;
+            range.Start = segIt->Address;
+            range.End   = segIt->Address + segIt->Length;
+            range.CuIdx = cuIt - cuOffsets.begin();
+            cuRanges.push_back(range);
+        }
+    }
 
-        abbrev.HasChildren = (hasChildren == DW_CHILDREN_yes);
+    std::sort(cuRanges.begin(), cuRanges.end(), [](const DwarfCuRange &a, const DwarfCuRange &b)
+    {
+        return a.Start < b.Start;
+    });
+    return cuRanges;
+}
 
-        // Read Attributes
+bool Dwarf::FindCuIdx(const std::vector<DwarfCuRange> &cuRanges, const uint64_t addr, uint32_t &cuIdx)
+{
+    // first range which starts after addr
+    auto it = std::upper_bound(cuRanges.begin(), cuRanges.end(), addr, [](const uint64_t a, const DwarfCuRange &range)
+    {
+        return a < range.Start;
+    });
+    if (it == cuRanges.begin())
+    {
+        return false;
+    }
+
+    it--;
+    if (it->End <= addr)
+    {
+        return false;
+    }
+
+    cuIdx = it->CuIdx;
+    return true;
+}
+
+// DW_AT_ranges (sec_offset) of a DIE
+// rangesShdr is .debug_rnglists for DWARF 5 units and .debug_ranges before,
+// baseAddr is DW_AT_low_pc of the unit. Entries using .debug_addr (DW_RLE_*x) are not supported.
+bool Dwarf::ReadRanges(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &rangesShdr, const DwarfCuHdr &cuh, const uint64_t rangesOffset, const uint64_t baseAddr, std::vector<DwarfRange> &ranges)
+{
+    uint64_t offset = rangesShdr.sh_offset + rangesOffset;
+    uint64_t end = rangesShdr.sh_offset + rangesShdr.sh_size;
+    if ((size < end) || (end <= offset) || ((cuh.AddressSize != 4) && (cuh.AddressSize != 8)))
+    {
+        return false;
+    }
+
+    auto readAddr = [&](uint64_t &addr) -> bool
+    {
+        if (end - offset < cuh.AddressSize)
+        {
+            return false;
+        }
+        addr = (cuh.AddressSize == 8) ? BinUtil::FromLeToUInt64(&bin[offset]) : BinUtil::FromLeToUInt32(&bin[offset]);
+        offset += cuh.AddressSize;
+        return true;
+    };
+
+    uint64_t base = baseAddr;
+    if (cuh.Version < 5)
+    {
+        // pairs of addresses, a pair with the largest start address selects the base
+        uint64_t maxAddr = (cuh.AddressSize == 8) ? UINT64_MAX : UINT32_MAX;
         while (true)
         {
-            uint64_t attrCode = 0;
-            uint64_t formCode = 0;
-            uint64_t Const = 0;
-            attrCode = ReaduLEB128(&bin[offset], secEndPos - offset, len);
-            offset += len;
+            uint64_t start = 0;
+            uint64_t stop = 0;
+            if (!readAddr(start) || !readAddr(stop))
+            {
+                return false;
+            }
+            if ((start == 0) && (stop == 0))
+            {
+                return true;
+            }
+            if (start == maxAddr)
+            {
+                base = stop;
+                continue;
+            }
+            if (start < stop)
+            {
+                ranges.push_back({base + start, base + stop});
+            }
+        }
+    }
 
-            formCode = ReaduLEB128(&bin[offset], secEndPos - offset, len);
+    uint32_t len;
+    while (offset < end)
+    {
+        uint8_t kind = bin[offset++];
+        uint64_t start = 0;
+        uint64_t stop = 0;
+        switch (kind)
+        {
+        case DW_RLE_end_of_list:
+            return true;
+        case DW_RLE_offset_pair:
+            start = base + ReaduLEB128(&bin[offset], end - offset, len);
             offset += len;
-            if ((attrCode == 0) && (formCode == 0))
+            stop = base + ReaduLEB128(&bin[offset], end - offset, len);
+            offset += len;
+            break;
+        case DW_RLE_base_address:
+            if (!readAddr(base))
             {
-                break;
+                return false;
             }
+            continue;
+        case DW_RLE_start_end:
+            if (!readAddr(start) || !readAddr(stop))
+            {
+                return false;
+            }
+            break;
+        case DW_RLE_start_length:
+            if (!readAddr(start))
+            {
+                return false;
+            }
+            stop = start + ReaduLEB128(&bin[offset], end - offset, len);
+            offset += len;
+            break;
+        default:
+            // DW_RLE_base_addressx, DW_RLE_startx_endx, DW_RLE_startx_length
+            Logger::DLog("range list entry kind:%d at 0x%x is not supported", kind, offset - 1);
+            return false;
+        }
+        if (start < stop)
+        {
+            ranges.push_back({start, stop});
+        }
+    }
+    return false;
+}
 
-            // DWARF5 or later, FORM special case
-            if (formCode == DW_FORM_implicit_const)
+// address ranges of a DIE, DW_AT_low_pc / DW_AT_high_pc or DW_AT_ranges
+bool Dwarf::ReadDieRanges(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &rangesShdr, const DwarfCuHdr &cuh, const DwarfDie &die, const uint64_t baseAddr, std::vector<DwarfRange> &ranges)
+{
+    const DwarfAttrValue *lowVal = die.Find(DW_AT_low_pc);
+    const DwarfAttrValue *highVal = die.Find(DW_AT_high_pc);
+    const DwarfAttrValue *rangesVal = die.Find(DW_AT_ranges);
+    if ((lowVal != nullptr) && (lowVal->Class == DWARF_VALUE_ADDRESS) && (highVal != nullptr))
+    {
+        // DWARF 4 and later: a constant high_pc is the size
+        uint64_t lowPc = lowVal->UData;
+        uint64_t highPc = (highVal->Class == DWARF_VALUE_ADDRESS) ? highVal->UData : lowPc + highVal->UData;
+        if (lowPc < highPc)
+        {
+            ranges.push_back({lowPc, highPc});
+        }
+        return true;
+    }
+    if ((rangesVal != nullptr) && (rangesVal->Class == DWARF_VALUE_SEC_OFFSET))
+    {
+        return ReadRanges(bin, size, rangesShdr, cuh, rangesVal->UData, baseAddr, ranges);
+    }
+    return true;
+}
+
+// range of a concrete subprogram DIE, for Dwarf::LinkFragments
+struct DwarfFragmentRange
+{
+    uint64_t Low;
+    uint64_t EntryLow;          // first range of the DIE, where the function is entered
+    uint64_t OriginOffset;      // DW_AT_abstract_origin, the DIE itself when it has none
+};
+
+uint32_t Dwarf::LinkFragments(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, ElfFunctionTable &elfFuncTable, const unsigned threadCount)
+{
+    // a .cold fragment is a range of the DIE of its parent, a .part / .constprop / .isra clone
+    // has its own DIE whose abstract origin is the one of its parent
+    Logger::TLog("Dwarf::LinkFragments In...");
+    std::vector<DwarfCuEntry> cuEntries = ReadCuHeaders(bin, size, dbgInfoShdr);
+    std::vector<std::vector<DwarfFragmentRange>> unitRanges(cuEntries.size());
+    Parallel::For(cuEntries.size(), threadCount, [&](const size_t idx)
+    {
+        const DwarfCuEntry &cuEntry = cuEntries[idx];
+        const Elf64_Shdr &rangesShdr = (5 <= cuEntry.Header.Version) ? dbgRngListsShdr : dbgRangesShdr;
+        uint64_t baseAddr = 0;
+        std::vector<DwarfRange> ranges;
+        DwarfDieReader reader(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, cuEntry);
+        DwarfDie die;
+        while (reader.Next(die))
+        {
+            if (die.Tag == DW_TAG_compile_unit)
             {
-                Const = ReaduLEB128(&bin[offset], secEndPos - offset, len);
-                offset += len;
+                const DwarfAttrValue *lowVal = die.Find(DW_AT_low_pc);
+                baseAddr = ((lowVal != nullptr) && (lowVal->Class == DWARF_VALUE_ADDRESS)) ? lowVal->UData : 0;
+                continue;
+            }
+            if (die.Tag != DW_TAG_subprogram)
+            {
+                continue;
+            }
+            ranges.clear();
+            ReadDieRanges(bin, size, rangesShdr, cuEntry.Header, die, baseAddr, ranges);
+            if (ranges.size() == 0)
+            {
+                continue;
+            }
+            const DwarfAttrValue *originVal = die.Find(DW_AT_abstract_origin);
+            uint64_t originOffset = ((originVal != nullptr) && (originVal->Class == DWARF_VALUE_REFERENCE)) ? originVal->UData : die.Offset;
+            for (auto it = ranges.begin(); it != ranges.end(); it++)
+            {
+                unitRanges[idx].push_back(DwarfFragmentRange{it->Low, ranges[0].Low, originOffset});
             }
+        }
+    });
+    FlatMap<uint64_t, DwarfFragmentRange> addrRangeMap;
+    for (auto it = unitRanges.begin(); it != unitRanges.end(); it++)
+    {
+        for (auto rangeIt = it->begin(); rangeIt != it->end(); rangeIt++)
+        {
+            addrRangeMap.Append(rangeIt->Low, *rangeIt);
+        }
+    }
+    addrRangeMap.Seal();
 
-            AbbrevAttr attr = AbbrevAttr{attrCode, formCode, Const};
-            Logger::DLog("attr:%s", attrNameMap[attr.Attr]);
+    // functions which are not fragments by abstract origin, ELF_FUNC_IDX_NONE: several
+    std::vector<ElfFunctionInfo> &elfFuncInfos = elfFuncTable.ElfFuncInfos;
+    std::unordered_map<uint64_t, uint32_t> originFuncIdxMap;
+    std::string baseName;
+    for (uint32_t fIdx = 0; fIdx < elfFuncInfos.size(); fIdx++)
+    {
+        auto rangeIt = addrRangeMap.find(elfFuncInfos[fIdx].Addr);
+        if ((elfFuncInfos[fIdx].Size == 0) || (rangeIt == addrRangeMap.end()) || Elf64::GetFragmentBase(elfFuncInfos[fIdx].Name, baseName))
+        {
+            continue;
+        }
+        auto result = originFuncIdxMap.insert(std::make_pair(rangeIt->second.OriginOffset, fIdx));
+        if (!result.second && (result.first->second != ELF_FUNC_IDX_NONE) && (elfFuncInfos[result.first->second].Addr != elfFuncInfos[fIdx].Addr))
+        {
+            result.first->second = ELF_FUNC_IDX_NONE;
+        }
+    }
 
-            abbrev.Attrs.push_back(attr);
+    uint32_t linkedCount = 0;
+    for (uint32_t fIdx = 0; fIdx < elfFuncInfos.size(); fIdx++)
+    {
+        ElfFunctionInfo &elfFuncInfo = elfFuncInfos[fIdx];
+        if ((elfFuncInfo.Size == 0) || (elfFuncInfo.ParentIdx != ELF_FUNC_IDX_NONE) || !Elf64::GetFragmentBase(elfFuncInfo.Name, baseName))
+        {
+            continue;
+        }
+        auto rangeIt = addrRangeMap.find(elfFuncInfo.Addr);
+        if (rangeIt == addrRangeMap.end())
+        {
+            continue;
+        }
+        uint32_t parentIdx = ELF_FUNC_IDX_NONE;
+        if (rangeIt->second.EntryLow != elfFuncInfo.Addr)
+        {
+            auto funcIt = elfFuncTable.AddrFuncIdxMap.find(rangeIt->second.EntryLow);
+            if (funcIt != elfFuncTable.AddrFuncIdxMap.end())
+            {
+                parentIdx = funcIt->second;
+            }
+        }
+        else
+        {
+            auto funcIt = originFuncIdxMap.find(rangeIt->second.OriginOffset);
+            if (funcIt != originFuncIdxMap.end())
+            {
+                parentIdx = funcIt->second;
+            }
+        }
+        if ((parentIdx != ELF_FUNC_IDX_NONE) && (parentIdx != fIdx))
+        {
+            elfFuncInfo.ParentIdx = parentIdx;
+            linkedCount++;
         }
-        abbrevTbl.push_back(abbrev);
     }
+    Elf64::ResolveFragmentRoots(elfFuncTable);
+    Logger::DLog("fragments linked by debug info:%d", linkedCount);
+    Logger::TLog("Dwarf::LinkFragments Out...");
+    return linkedCount;
+}
 
+std::vector<Abbrev> Dwarf::ReadAbbrevTbl(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgAbbrevShdr, const uint64_t dbgAbbrevOffset)
+{
+    DwarfAbbrevTable table(nullptr);
+    table.Read(bin, size, dbgAbbrevShdr, dbgAbbrevOffset);
+
+    std::vector<Abbrev> abbrevTbl;
+    for (auto it = table.Entries().begin(); it != table.Entries().end(); it++)
+    {
+        Abbrev abbrev;
+        abbrev.Id = it->Id;
+        abbrev.Tag = it->Tag;
+        abbrev.HasChildren = it->HasChildren;
+        const AbbrevAttr *attrs = table.GetAttrs(*it);
+        abbrev.Attrs.assign(attrs, attrs + it->AttrCount);
+        abbrevTbl.push_back(abbrev);
+    }
     return abbrevTbl;
 }
 
-std::vector<DwarfCuDebugInfo> Dwarf::ReadDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, std::map<uint64_t, DwarfArangeInfo> &offsetArangeMap, std::map<uint64_t, DwarfLineInfoHdr> &offsetLineInfoMap)
+std::vector<DwarfCuEntry> Dwarf::ReadCuHeaders(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr)
 {
-    Logger::TLog("ReadDebugInfo In...");
+    Logger::TLog("ReadCuHeaders In...");
 
+    // only unit headers are read here, DIEs are decoded by ReadCuDebugInfo
+    std::vector<DwarfCuEntry> cuEntries;
     uint64_t offset     = dbgInfoShdr.sh_offset;
     uint64_t dbgInfoEnd = dbgInfoShdr.sh_offset + dbgInfoShdr.sh_size;
+    while (offset < dbgInfoEnd)
+    {
+        DwarfCuEntry cuEntry;
+        cuEntry.Offset = offset - dbgInfoShdr.sh_offset;
+        cuEntry.Header = readCompilationUnitHeader(bin, size, offset);
+        cuEntries.push_back(cuEntry);
+        offset += getUnitSize(cuEntry.Header);
+    }
+
+    Logger::TLog("ReadCuHeaders Out...");
+    return cuEntries;
+}
+
+std::vector<DwarfCuDebugInfo> Dwarf::ReadDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, DwarfArangeMap &offsetArangeMap, DwarfLineInfoMap &offsetLineInfoMap, FileTable &fileTable)
+{
+    Logger::TLog("ReadDebugInfo In...");
+
     std::vector<DwarfCuDebugInfo> dbgInfos;
+    DwarfDieIndex dieIndex;
+    Arena arena;
+    std::vector<std::vector<DwarfDieFixup>> cuFixups;
+    std::vector<DwarfCuEntry> cuEntries = ReadCuHeaders(bin, size, dbgInfoShdr);
+    for (auto it = cuEntries.begin(); it != cuEntries.end(); it++)
+    {
+        if (offsetArangeMap.find(it->Offset) == offsetArangeMap.end())
+        {
+            // unit without code (e.g. abstract DIEs of LTO), still scanned since its DIEs may be referenced
+            Logger::DLog("no arange for unit offset:0x%x", it->Offset);
+        }
+
+        // records of the previous unit are not needed any more
+        arena.Reset();
+        std::vector<DwarfDieFixup> fixups;
+        DwarfCuDebugInfo cuDbgInfo = readCuDebugInfo(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, *it, offsetLineInfoMap, dieIndex, fixups, arena);
+        cuDbgInfo.FileId = fileTable.Intern(cuDbgInfo.CompileDir, cuDbgInfo.FileName);
+        dbgInfos.push_back(cuDbgInfo);
+        cuFixups.push_back(fixups);
+    }
+
+    // every unit is scanned, so forward and cross unit references can be resolved now
+    dieIndex.Seal();
+    for (size_t i = 0; i < dbgInfos.size(); i++)
+    {
+        dieIndex.ResolveFixups(cuFixups[i], dbgInfos[i]);
+    }
+
+    Logger::TLog("ReadDebugInfo Out...");
+    return dbgInfos;
+}
+
+DwarfCuDebugInfo Dwarf::ReadCuDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry, DwarfLineInfoMap &offsetLineInfoMap, DwarfDieIndex &dieIndex)
+{
+    // references are resolved against this unit and the units already added to dieIndex
+    // units decoded by several threads do not share an arena
+    static thread_local Arena arena;
+    arena.Reset();
+    std::vector<DwarfDieFixup> fixups;
+    DwarfCuDebugInfo cuDbgInfo = readCuDebugInfo(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, cuEntry, offsetLineInfoMap, dieIndex, fixups, arena);
+    dieIndex.Seal();
+    dieIndex.ResolveFixups(fixups, cuDbgInfo);
+    return cuDbgInfo;
+}
+
+DwarfCuDebugInfo Dwarf::readCuDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry, DwarfLineInfoMap &offsetLineInfoMap, DwarfDieIndex &dieIndex, std::vector<DwarfDieFixup> &fixups, Arena &arena)
+{
+    uint64_t dbgInfoEnd = dbgInfoShdr.sh_offset + dbgInfoShdr.sh_size;
+    uint64_t cuTop      = dbgInfoShdr.sh_offset + cuEntry.Offset;
+    const DwarfCuHdr &cuh = cuEntry.Header;
     uint64_t count = 0;
+    uint64_t attrCount = 0;
     uint64_t cuLineInfoOffset  = 0;
 
-    std::map<uint64_t, DwarfFuncInfo> cppTmpFuncMap;
     uint8_t *pDbgStrSec = (uint8_t *)&bin[dbgStrShdr.sh_offset];
     uint64_t dbgStrSecSize = dbgStrShdr.sh_size;
 
     uint8_t *pDbgLineStrSec = (uint8_t *)&bin[dbgLineStrShdr.sh_offset];
     uint64_t dbgLineStrSecSize = dbgLineStrShdr.sh_size;
 
-    std::map<uint64_t,std::string> tagNameMap   = getTagNameMap();
-    std::map<uint64_t,std::string> attrNameMap  = getAttrNameMap();
-    std::map<uint64_t, std::string> langNameMap = getLangNameMap();
-    while (offset < dbgInfoEnd)
+    // built once, only looked up for logging
+    static const std::map<uint64_t, std::string> tagNameMap = getTagNameMap();
+    static const std::map<uint64_t, std::string> attrNameMap = getAttrNameMap();
+    static const std::map<uint64_t, std::string> langNameMap = getLangNameMap();
+
+    Logger::DLog("******** cu header info ********");
+    Logger::DLog("size: 0x%x\n", cuh.UnitLength);
+    Logger::DLog("version: %d\n", cuh.Version);
+    Logger::DLog("debug_abbrev_offset: %d\n", cuh.DebugAbbrevOffset);
+    Logger::DLog("address_size: %d\n", cuh.AddressSize);
+    DwarfCuDebugInfo cuDbgInfo;
+    cuDbgInfo.Offset = cuEntry.Offset;
+    cuDbgInfo.HasLineInfo = false;
+    cuDbgInfo.FileId = 0;
+
+    // compilation unit header
+    uint64_t dbgAbbrevOffset = cuh.DebugAbbrevOffset + dbgAbbrevShdr.sh_offset;
+    DwarfAbbrevTable abbrevTbl(&arena);
+    abbrevTbl.Read(bin, size, dbgAbbrevShdr, dbgAbbrevOffset);
+    uint64_t cuEnd  = cuTop + getUnitSize(cuh);
+    uint64_t offset = cuTop + cuh.HeaderSize;
+
+    uint32_t len;
+    while (offset < cuEnd)
     {
-        uint64_t cuTop = offset;
-        uint64_t dbgInfoOffset = offset - dbgInfoShdr.sh_offset;
-        if (offsetArangeMap.find(dbgInfoOffset) == offsetArangeMap.end())
+        uint64_t entryOffset = offset - dbgInfoShdr.sh_offset;
+        uint64_t id = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
+        if (id == 0)
         {
-            std::string msg = StringHelper::strprintf("offsetArangeMap.find(offset) == offsetArangeMap.end()");
-            Logger::ELog(msg);
-            assert(false);
-            break;
+            offset++;
+            continue;
         }
 
-        DwarfArangeInfo &curArrangeInfo = offsetArangeMap[dbgInfoOffset];
-        DwarfCuHdr cuh = readCompilationUnitHeader(bin, size, offset);
-        Logger::DLog("******** cu header info ********");
-        Logger::DLog("size: 0x%x\n", cuh.UnitLength);
-        Logger::DLog("version: %d\n", cuh.Version);
-        Logger::DLog("debug_abbrev_offset: %d\n", cuh.DebugAbbrevOffset);
-        Logger::DLog("address_size: %d\n", cuh.AddressSize);
-        DwarfCuDebugInfo cuDbgInfo;
-
-        // compilation unit header
-        uint64_t dbgAbbrevOffset = cuh.DebugAbbrevOffset + dbgAbbrevShdr.sh_offset;
-        std::vector<Abbrev> abbrevTbl = Dwarf::ReadAbbrevTbl(bin, size, dbgAbbrevShdr, dbgAbbrevOffset);
-        std::map<uint64_t, Abbrev> abbrevMap;
-        for (auto it = abbrevTbl.begin(); it != abbrevTbl.end(); it++)
-        {
-            abbrevMap[it->Id] = *it;
-        }
-        uint64_t cuEnd = (cuh.UnitLength + 4);
-        if (cuh.DwarfFormat == DWARF_64BIT_FORMAT)
+        const DwarfAbbrevEntry *pAbbrev = abbrevTbl.Find(id);
+        if (pAbbrev == nullptr)
         {
-            cuEnd = offset + uint64_t(cuh.UnitLength + 8);
+            Logger::ELog("unknown abbrev code:%d at 0x%x", id, entryOffset);
+            break;
         }
-        cuEnd += cuTop;
-        offset += 11;
-
-        uint32_t len;
-        while (offset < cuEnd)
+        const DwarfAbbrevEntry &abbrev = *pAbbrev;
+        const AbbrevAttr *attrs = abbrevTbl.GetAttrs(abbrev);
+        offset += len;
+        attrCount += abbrev.AttrCount;
+        DwarfFuncInfo dwarfFuncInfo;
+        dwarfFuncInfo.Name = "";
+        dwarfFuncInfo.LinkageName = "";
+        dwarfFuncInfo.Addr = 0;
+        dwarfFuncInfo.Size = 0;
+        DwarfDieRecord dieRecord;
+        dieRecord.Offset = entryOffset;
+        dieRecord.RefOffset = 0;
+        dieRecord.Name = nullptr;
+        dieRecord.LinkageName = nullptr;
+        for (uint32_t attrIdx = 0; attrIdx < abbrev.AttrCount; attrIdx++)
         {
-            uint64_t entryOffset = offset - dbgInfoShdr.sh_offset;
-            uint64_t id = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
-            if (id == 0)
+            const AbbrevAttr &attr = attrs[attrIdx];
+            const char *attrName = getName(attrNameMap, attr.Attr);
+            Logger::DLog("[%6x] %s", entryOffset, attrName);
+            switch (attr.Form)
             {
-                offset++;
-                continue;
-            }
-
-            Abbrev &abbrev = abbrevMap[id];
-            offset += len;
-            DwarfFuncInfo dwarfFuncInfo;
-            for (auto it = abbrev.Attrs.begin(); it != abbrev.Attrs.end(); it++)
+            case DW_FORM_addr:
             {
-                AbbrevAttr attr = *it;
-                std::string attrName = attrNameMap[attr.Attr];
-                Logger::DLog("[%6x] %s", entryOffset, attrName);
-                switch (attr.Form)
+                // TODO addr
+                uint64_t funcaddr = 0;
+                if (cuh.AddressSize == 2)
                 {
-                case DW_FORM_addr:
+                    uint16_t addr = BinUtil::FromLeToUInt16(&bin[offset]);
+                    funcaddr = addr;
+                    Logger::TLog("Attr: %s value:0x%04x\n", attrName, addr);
+                }
+                else if (cuh.AddressSize == 4)
                 {
-                    // TODO addr
-                    uint64_t funcaddr = 0;
-                    if (cuh.AddressSize == 2)
-                    {
-                        uint16_t addr = BinUtil::FromLeToUInt16(&bin[offset]);
-                        funcaddr = addr;
-                        Logger::TLog("Attr: %s value:0x%04x\n", attrName, addr);
-                    }
-                    else if (cuh.AddressSize == 4)
-                    {
-                        uint32_t addr = BinUtil::FromLeToUInt32(&bin[offset]);
-                        funcaddr = addr;
-                        Logger::TLog("Attr: %s value:0x%08x\n", attrName, addr);
-                    }
-                    else if (cuh.AddressSize == 8)
-                    {
-                        uint64_t addr = BinUtil::FromLeToUInt64(&bin[offset]);
-                        funcaddr = addr;
-                        Logger::TLog("Attr: %s value:0x%016x\n", attrName, addr);
-                    }
-
-                    // DW_AT_low_pc  is function start address,
-                    // DW_AT_high_pc is function end address,
-                    if (attr.Attr == DW_AT_low_pc)
-                    {
-                        dwarfFuncInfo.Addr = funcaddr;
-                    }
-                    offset += cuh.AddressSize;
+                    uint32_t addr = BinUtil::FromLeToUInt32(&bin[offset]);
+                    funcaddr = addr;
+                    Logger::TLog("Attr: %s value:0x%08x\n", attrName, addr);
                 }
-                break;
-
-                case DW_FORM_block2:
+                else if (cuh.AddressSize == 8)
                 {
-                    uint16_t blk2 = BinUtil::FromLeToUInt16(&bin[offset]);
-                    offset += 2;
-                    offset += blk2;
-                    Logger::DLog("Attr: %s value:0x%016x\n", attrName, blk2);
+                    uint64_t addr = BinUtil::FromLeToUInt64(&bin[offset]);
+                    funcaddr = addr;
+                    Logger::TLog("Attr: %s value:0x%016x\n", attrName, addr);
                 }
-                break;
-                case DW_FORM_block4:
+
+                // DW_AT_low_pc  is function start address,
+                // DW_AT_high_pc is function end address,
+                if (attr.Attr == DW_AT_low_pc)
                 {
-                    uint32_t blk4 = BinUtil::FromLeToUInt32(&bin[offset]);
-                    offset += 4;
-                    offset += blk4;
-                    Logger::DLog("Attr: %s value:0x%016x\n", attrName, blk4);
+                    dwarfFuncInfo.Addr = funcaddr;
                 }
-                break;
-                case DW_FORM_strp:
+                offset += cuh.AddressSize;
+            }
+            break;
+
+            case DW_FORM_block2:
+            {
+                uint16_t blk2 = BinUtil::FromLeToUInt16(&bin[offset]);
+                offset += 2;
+                offset += blk2;
+                Logger::DLog("Attr: %s value:0x%016x\n", attrName, blk2);
+            }
+            break;
+            case DW_FORM_block4:
+            {
+                uint32_t blk4 = BinUtil::FromLeToUInt32(&bin[offset]);
+                offset += 4;
+                offset += blk4;
+                Logger::DLog("Attr: %s value:0x%016x\n", attrName, blk4);
+            }
+            break;
+            case DW_FORM_strp:
+            {
+                uint32_t dbgStrOffset = BinUtil::FromLeToUInt32(&bin[offset]);
+                offset += 4;
+                const char *pStr = (dbgStrOffset < dbgStrSecSize) ? (const char *)&pDbgStrSec[dbgStrOffset] : nullptr;
+                Logger::DLog("%s: %s\n", attrName, (pStr != nullptr) ? pStr : "");
+                if (abbrev.Tag == DW_TAG_compile_unit)
                 {
-                    uint32_t dbgStrOffset = BinUtil::FromLeToUInt32(&bin[offset]);
-                    offset += 4;
                     std::string str = BinUtil::GetString(pDbgStrSec, dbgStrSecSize, dbgStrOffset);
-                    Logger::DLog("%s: %s\n", attrName, str);
-                    if (abbrev.Tag == DW_TAG_compile_unit)
+                    if (attr.Attr == DW_AT_name)
                     {
-                        if (attr.Attr == DW_AT_name)
+                        // for Rust
+                        if (cuDbgInfo.IsRust())
                         {
-                            // for Rust
-                            if (cuDbgInfo.IsRust())
+                            auto idx = str.find_last_of("@");
+                            if (idx != std::string::npos)
                             {
-                                auto idx = str.find_last_of("@");
-                                if (idx != std::string::npos)
-                                {
-                                    str = str.substr(0, idx);
-                                }
+                                str = str.substr(0, idx);
                             }
-                            cuDbgInfo.FileName = str;
-                        }
-                        else if (attr.Attr == DW_AT_comp_dir)
-                        {
-                            cuDbgInfo.CompileDir = str;
-                        }
-                        else if (attr.Attr == DW_AT_producer)
-                        {
-                            cuDbgInfo.Producer = str;
-                        }
-                        else
-                        {
-                            std::cerr << "not name!" << std::endl;
-                            assert(false);
                         }
+                        cuDbgInfo.FileName = str;
                     }
-                    if (abbrev.Tag == DW_TAG_subprogram)
+                    else if (attr.Attr == DW_AT_comp_dir)
                     {
-                        if (attr.Attr == DW_AT_name)
-                        {
-                            dwarfFuncInfo.Name = str;
-                        }
-                        else if (attr.Attr == DW_AT_linkage_name)
-                        {
-                            dwarfFuncInfo.LinkageName = str;
-                        }
-                        else if (attr.Attr == DW_AT_MIPS_linkage_name)
-                        {
-                            // arm-none-eabi-gcc
-                            dwarfFuncInfo.Name = str;
-                        }
-                        else
-                        {
-                            std::cerr << "not name!" << std::endl;
-                            assert(false);
-                        }
+                        cuDbgInfo.CompileDir = str;
                     }
-                }
-                break;
-                case DW_FORM_data1:
-                {
-                    // TODO check value
-                    // P207 TOOD DW_FORM_implicit_const
-                    uint8_t tmp = bin[offset];
-                    offset++;
-                    if (attr.Attr == DW_AT_decl_file)
+                    else if (attr.Attr == DW_AT_producer)
                     {
-                        DwarfLineInfoHdr &lineInfoHdr = offsetLineInfoMap[cuLineInfoOffset];
-                        std::string fileName = lineInfoHdr.Files[tmp-1].Name;
-                        Logger::TLog("Attr: %s filename:%s\n", attrName, fileName);
+                        cuDbgInfo.Producer = str;
                     }
                     else
                     {
-                        Logger::TLog("Attr: %s value:0x%02x\n", attrName, tmp);
+                        std::cerr << "not name!" << std::endl;
+                        assert(false);
                     }
                 }
-                break;
-                case DW_FORM_data2:
+                if ((abbrev.Tag == DW_TAG_subprogram) && (pStr != nullptr))
                 {
-                    // TODO check value
-                    uint16_t val = BinUtil::FromLeToUInt16(&bin[offset]);
-                    Logger::TLog("Attr: %s value:0x%04x\n", attrName, val);
-                    if (attr.Attr == DW_AT_high_pc)
+                    if (attr.Attr == DW_AT_name)
                     {
-                        dwarfFuncInfo.Size = val;
+                        dwarfFuncInfo.Name = pStr;
+                        dieRecord.Name = pStr;
                     }
-                    if (attr.Attr == DW_AT_language)
+                    else if (attr.Attr == DW_AT_linkage_name)
                     {
-                        std::string lang = "unknown language";
-                        if (langNameMap.find(val) != langNameMap.end())
-                        {
-                            lang = langNameMap[val];
-                        }
+                        dwarfFuncInfo.LinkageName = pStr;
+                        dieRecord.LinkageName = pStr;
                     }
-                    offset += 2;
-                }
-                break;
-                case DW_FORM_data4:
-                {
-                    // TODO check value
-                    uint32_t val = BinUtil::FromLeToUInt32(&bin[offset]);
-                    Logger::TLog("Attr: %s value:0x%08x\n", attrName, val);
-                    if (attr.Attr == DW_AT_high_pc)
+                    else if (attr.Attr == DW_AT_MIPS_linkage_name)
                     {
-                        dwarfFuncInfo.Size = val;
+                        // arm-none-eabi-gcc
+                        dwarfFuncInfo.Name = pStr;
+                        dieRecord.Name = pStr;
                     }
-                    offset += 4;
-                }
-                break;
-                case DW_FORM_data8:
-                {
-                    // TODO check value
-                    uint32_t val = BinUtil::FromLeToUInt64(&bin[offset]);
-                    if (attr.Attr == DW_AT_high_pc)
+                    else
                     {
-                        dwarfFuncInfo.Size = val;
+                        std::cerr << "not name!" << std::endl;
+                        assert(false);
                     }
-                    Logger::TLog("Attr: %s value:0x%016x\n", attrName, val);
-                    offset += 8;
                 }
-                break;
-                case DW_FORM_string:
+            }
+            break;
+            case DW_FORM_data1:
+            {
+                // TODO check value
+                // P207 TOOD DW_FORM_implicit_const
+                uint8_t tmp = bin[offset];
+                offset++;
+                auto lineInfoIt = (attr.Attr == DW_AT_decl_file) ? offsetLineInfoMap.find(cuLineInfoOffset) : offsetLineInfoMap.end();
+                if ((lineInfoIt != offsetLineInfoMap.end()) && (0 < tmp) && (tmp <= lineInfoIt->second.Files.size()))
+                {
+                    Logger::TLog("Attr: %s filename:%s\n", attrName, lineInfoIt->second.Files[tmp-1].Name.c_str());
+                }
+                else
+                {
+                    Logger::TLog("Attr: %s value:0x%02x\n", attrName, tmp);
+                }
+            }
+            break;
+            case DW_FORM_data2:
+            {
+                // TODO check value
+                uint16_t val = BinUtil::FromLeToUInt16(&bin[offset]);
+                Logger::TLog("Attr: %s value:0x%04x\n", attrName, val);
+                if (attr.Attr == DW_AT_high_pc)
+                {
+                    dwarfFuncInfo.Size = val;
+                }
+                if (attr.Attr == DW_AT_language)
+                {
+                    const char *lang = getName(langNameMap, val);
+                    Logger::TLog("language: %s", (lang[0] != '\0') ? lang : "unknown language");
+                }
+                offset += 2;
+            }
+            break;
+            case DW_FORM_data4:
+            {
+                // TODO check value
+                uint32_t val = BinUtil::FromLeToUInt32(&bin[offset]);
+                Logger::TLog("Attr: %s value:0x%08x\n", attrName, val);
+                if (attr.Attr == DW_AT_high_pc)
                 {
-                    std::string str = BinUtil::GetString(bin, dbgInfoEnd, offset);
-                    offset += str.size() + 1;
-                    Logger::DLog("str: %s \n", str);
-                    if (abbrev.Tag == DW_TAG_subprogram)
+                    dwarfFuncInfo.Size = val;
+                }
+                offset += 4;
+            }
+            break;
+            case DW_FORM_data8:
+            {
+                // TODO check value
+                uint32_t val = BinUtil::FromLeToUInt64(&bin[offset]);
+                if (attr.Attr == DW_AT_high_pc)
+                {
+                    dwarfFuncInfo.Size = val;
+                }
+                Logger::TLog("Attr: %s value:0x%016x\n", attrName, val);
+                offset += 8;
+            }
+            break;
+            case DW_FORM_string:
+            {
+                const char *pStr = (const char *)&bin[offset];
+                offset += strnlen(pStr, dbgInfoEnd - offset) + 1;
+                Logger::DLog("str: %s \n", pStr);
+                if (abbrev.Tag == DW_TAG_subprogram)
+                {
+                    if (attr.Attr == DW_AT_name)
                     {
-                        if (attr.Attr == DW_AT_name)
-                        {
-                            dwarfFuncInfo.Name = str;
-                        }
-                        else if (attr.Attr == DW_AT_linkage_name)
-                        {
-                            dwarfFuncInfo.LinkageName = str;
-                        }
-                        else
-                        {
-                            std::cerr << "not name!" << std::endl;
-                            assert(false);
-                        }
+                        dwarfFuncInfo.Name = pStr;
+                        dieRecord.Name = pStr;
+                    }
+                    else if (attr.Attr == DW_AT_linkage_name)
+                    {
+                        dwarfFuncInfo.LinkageName = pStr;
+                        dieRecord.LinkageName = pStr;
+                    }
+                    else
+                    {
+                        std::cerr << "not name!" << std::endl;
+                        assert(false);
                     }
                 }
-                break;
-                case DW_FORM_block: // LEB128
+            }
+            break;
+            case DW_FORM_block: // LEB128
+            {
+                // TODO use Block info
+                ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                offset += len;
+            }
+            break;
+            case DW_FORM_block1: // 1byte(0～255)
+            {
+                // TODO use Block info
+                uint8_t blockLen = bin[offset];
+                offset += 1;
+                Logger::TLog("Block1: len:%d\n", blockLen, blockLen);
+                offset += blockLen;
+            }
+            break;
+            case DW_FORM_flag: // 1byte
+            {
+                uint8_t flagVal = bin[offset];
+                offset += 1;
+                Logger::TLog("flag: val:%d\n", flagVal);
+            }
+            break;
+            case DW_FORM_sdata:
+            {
+                // TODO use constant
+                ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                offset += len;
+            }
+            break;
+            case DW_FORM_udata:
+            {
+                // TODO use constant
+                ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                offset += len;
+            }
+            break;
+            case DW_FORM_ref1:
+            case DW_FORM_ref2:
+            case DW_FORM_ref4:
+            case DW_FORM_ref8:
+            case DW_FORM_ref_udata:
+            case DW_FORM_ref_addr:
+            {
+                uint64_t refOffset = readDieReference(bin, dbgInfoEnd, cuEntry, attr.Form, offset);
+                Logger::TLog("Attr: %s value:0x%04x\n", attrName, refOffset);
+                if ((attr.Attr == DW_AT_specification) || (attr.Attr == DW_AT_abstract_origin))
                 {
-                    // TODO use Block info
-                    ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                    offset += len;
+                    // the referenced DIE may not be scanned yet, the name is taken after the scan
+                    dieRecord.RefOffset = refOffset;
                 }
-                break;
-                case DW_FORM_block1: // 1byte(0～255)
+                else if (attr.Attr == DW_AT_sibling)
                 {
-                    // TODO use Block info
-                    uint8_t blockLen = bin[offset];
-                    offset += 1;
-                    Logger::TLog("Block1: len:%d\n", blockLen, blockLen);
-                    offset += blockLen;
+                    // TODO
                 }
-                break;
-                case DW_FORM_flag: // 1byte
+                else if (attr.Attr == DW_AT_type)
                 {
-                    uint8_t flagVal = bin[offset];
-                    offset += 1;
-                    Logger::TLog("flag: val:%d\n", flagVal);
+                    // TODO
+                }
+            }
+            break;
+            case DW_FORM_sec_offset:
+            {
+                switch (attr.Attr)
+                {
+                case DW_AT_stmt_list:
+                {
+                    // DW_AT_stmt_list is a section offset to the line number information
+                    // for this compilation unit
+                    uint64_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+                    cuLineInfoOffset = tmp;
+                    cuDbgInfo.HasLineInfo = true;
+                    offset += 4;
+                    Logger::TLog("%s: 0x%02x\n", attrName, cuLineInfoOffset);
                 }
                 break;
-                case DW_FORM_sdata:
+                case DW_AT_ranges:
                 {
-                    // TODO use constant
-                    ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                    offset += len;
+                    // A beginning address offset.
+                    // A range list entry consists of:
+                    // 1. A beginning address offset.
+                    //    This address offset has the size of an address and is relative to the applicable base address of the compilation unit referencing this range list.
+                    //    It marks the beginning of an address range.
+                    // 2. An ending address offset.
+                    //    This address offset again has the size of an address and is relative to the applicable base address of the compilation unit referencing this range list.
+                    //    It marks the first address past the end of the address range.
+                    //    The ending address must be greater than or equal to the beginning address.
+
+                    // P162 rangelistptr
+                    // This is an offset into the .debug_loc section (DW_FORM_sec_offset).
+                    // It consists of an offset from the beginning of the .debug_loc section to the first byte of the data making up the location list for the compilation unit.
+                    // It is relocatable in a relocatable object file, and relocated in an executable or shared object.
+                    // In the 32-bit DWARF format, this offset is a 4-byte unsigned value; in the 64-bit DWARF format, it is an 8-byte unsigned value (see Section 7.4).
+                    // TODO for 64bit impl
+                    uint64_t loclistptr;
+                    if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
+                    {
+                        uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+                        loclistptr = tmp;
+                        offset += 4;
+                    } else {
+                        loclistptr = BinUtil::FromLeToUInt64(&bin[offset]);
+                        offset += 8;
+                    }
+                    Logger::TLog("loclistptr:%x", loclistptr);
                 }
                 break;
-                case DW_FORM_udata:
+
+                case DW_AT_location:
                 {
-                    // TODO use constant
-                    ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                    offset += len;
+                    Logger::TLog("%x:%s\n", abbrev.Tag, getName(tagNameMap, abbrev.Tag));
+                    uint64_t loclistptr;
+                    if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
+                    {
+                        uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+                        loclistptr = tmp;
+                        offset += 4;
+                    }
+                    else
+                    {
+                        loclistptr = BinUtil::FromLeToUInt64(&bin[offset]);
+                        offset += 8;
+                    }
+                    Logger::TLog("loclistptr:%x", loclistptr);
+                    // GNU extensions
                 }
                 break;
-                case DW_FORM_ref1:
+                case GNU_locviews:
                 {
-                    uint8_t val = bin[offset];
-                    uint64_t refval = cuTop + val;
-                    Logger::TLog("Attr: %s value:0x%02x\n", attrName, refval);
-                    offset += 1;
+                    // TODO
+                    Logger::TLog("%x:%s\n", abbrev.Tag, getName(tagNameMap, abbrev.Tag));
+                    uint64_t loclistptr;
+                    if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
+                    {
+                        uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+                        loclistptr = tmp;
+                        offset += 4;
+                    } else {
+                        loclistptr = BinUtil::FromLeToUInt64(&bin[offset]);
+                        offset += 8;
+                    }
+                    Logger::TLog("loclistptr:%x", loclistptr);
                 }
                 break;
-                case DW_FORM_ref2:
+                default:
                 {
-                    uint16_t val = BinUtil::FromLeToUInt16(&bin[offset]);
-                    uint64_t refval = cuTop + val;
-                    Logger::TLog("Attr: %s value:0x%04x\n", attrName, refval);
-                    offset += 2;
+                    std::string msg = StringHelper::strprintf("unexpected attr:%d(%x)", attr.Attr, attr.Attr);
+                    Logger::DLog(msg);
+                    assert(false);
                 }
                 break;
-                case DW_FORM_ref4:
+                }
+            }
+            break;
+            case DW_FORM_exprloc:
+            {
+                Logger::TLog("attr:%x,%s", attr.Attr, attrName);
+                // following size
+                uint64_t length = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                offset += len;
+                uint64_t exprEnd = offset + length;
+                for (uint32_t i = 0; i < length; i++)
                 {
-                    uint32_t val = BinUtil::FromLeToUInt32(&bin[offset]);
-                    uint64_t refval = cuTop + val;
-                    uint64_t funcOffset =  refval - dbgInfoShdr.sh_offset;
-                    Logger::TLog("Attr: %s value:0x%04x\n", attrName, funcOffset);
-                    if (attr.Attr == DW_AT_specification)
+                    // dwarf exp OP Code
+                    uint8_t ins = bin[offset];
+                    i++;
+                    offset += 1;
+                    if ((DW_OP_lo_user <= ins) && (ins <= DW_OP_hi_user))
                     {
-                        if (cppTmpFuncMap.find(funcOffset) != cppTmpFuncMap.end())
-                        {
-                            // take function reference
-                            dwarfFuncInfo = cppTmpFuncMap[funcOffset];
-                        }
-                        else
-                        {
-                            Logger::DLog("ref func not found");
-                        } 
+                        // TODO skip extensions
+                        offset += length - i;
+                        i += length - i;
+                        continue;
                     }
-                    else if (attr.Attr == DW_AT_sibling)
+
+                    switch (ins)
+                    {
+                    case DW_OP_addr:
+                    {
+                        // size target specific
+                        uint64_t addr = BinUtil::FromLeToUInt64(&bin[offset]);
+                        Logger::TLog("DW_OP_addr:%x", addr);
+                        offset += cuh.AddressSize;
+                        i += cuh.AddressSize;
+                    }
+                    break;
+
+                    case DW_OP_deref:
+                    break;
+
+                    case DW_OP_const1u:
                     {
-                        // TODO
+                        uint8_t const1u = bin[offset];
+                        Logger::TLog("DW_OP_const1u:%x", const1u);
+                        offset++;
+                        i++;
                     }
-                    else if (attr.Attr == DW_AT_type)
+                    break;
+
+                    case DW_OP_const1s:
                     {
-                        // TODO
+                        int8_t const1s = (int8_t)bin[offset];
+                        Logger::TLog("DW_OP_const1s :%d", const1s);
+                        offset++;
+                        i++;
                     }
-                    else
+                    break;
+
+                    case DW_OP_const2u:
                     {
-                        // TODO
+                        uint16_t const2u = BinUtil::FromLeToUInt16(&bin[offset]);
+                        Logger::TLog("DW_OP_const2u :%d", const2u);
+                        offset += 2;
+                        i += 2;
                     }
-                    /*
-                        if attr.Attr == DW_AT_frame_base {
-                            fmt.Println("!!!!!!!!!!!!!")
-                        }
-                    */
-                    offset += 4;
-                }
-                break;
-                case DW_FORM_sec_offset:
-                {
-                    switch (attr.Attr)
-                    {
-                    case DW_AT_stmt_list:
+                    break;
+
+                    case DW_OP_const2s:
                     {
-                        // DW_AT_stmt_list is a section offset to the line number information
-                        // for this compilation unit
-                        uint64_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                        cuLineInfoOffset = tmp;
-                        offset += 4;
-                        Logger::TLog("%s: 0x%02x\n", attrName, cuLineInfoOffset);
+                        int16_t const2s = BinUtil::FromLeToInt16(&bin[offset]);
+                        Logger::TLog("DW_OP_const2s :%d", const2s);
+                        offset += 2;
+                        i += 2;
                     }
                     break;
-                    case DW_AT_ranges:
+
+                    case DW_OP_const4u:
                     {
-                        // A beginning address offset.
-                        // A range list entry consists of:
-                        // 1. A beginning address offset.
-                        //    This address offset has the size of an address and is relative to the applicable base address of the compilation unit referencing this range list.
-                        //    It marks the beginning of an address range.
-                        // 2. An ending address offset.
-                        //    This address offset again has the size of an address and is relative to the applicable base address of the compilation unit referencing this range list.
-                        //    It marks the first address past the end of the address range.
-                        //    The ending address must be greater than or equal to the beginning address.
-
-                        // P162 rangelistptr
-                        // This is an offset into the .debug_loc section (DW_FORM_sec_offset).
-                        // It consists of an offset from the beginning of the .debug_loc section to the first byte of the data making up the location list for the compilation unit.
-                        // It is relocatable in a relocatable object file, and relocated in an executable or shared object.
-                        // In the 32-bit DWARF format, this offset is a 4-byte unsigned value; in the 64-bit DWARF format, it is an 8-byte unsigned value (see Section 7.4).
-                        // TODO for 64bit impl
-                        uint64_t loclistptr;
-                        if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
-                        {
-                            uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                            loclistptr = tmp;
-                            offset += 4;
-                        } else {
-                            loclistptr = BinUtil::FromLeToUInt64(&bin[offset]);
-                            offset += 8;
-                        }
-                        Logger::TLog("loclistptr:%x", loclistptr);
+                        uint32_t const4u = BinUtil::FromLeToUInt32(&bin[offset]);
+                        Logger::TLog("DW_OP_const4u :%d", const4u);
+                        offset += 4;
+                        i += 4;
                     }
                     break;
 
-                    case DW_AT_location:
+                    case DW_OP_const4s:
                     {
-                        Logger::TLog("%x:%s\n", abbrev.Tag, tagNameMap[abbrev.Tag]);
-                        uint64_t loclistptr;
-                        if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
-                        {
-                            uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                            loclistptr = tmp;
-                            offset += 4;
-                        }
-                        else
-                        {
-                            loclistptr = BinUtil::FromLeToUInt64(&bin[offset]);
-                            offset += 8;
-                        }
-                        Logger::TLog("loclistptr:%x", loclistptr);
-                        // GNU extensions
+                        int32_t const4s = BinUtil::FromLeToInt32(&bin[offset]);
+                        Logger::TLog("DW_OP_const4s :%d", const4s);
+                        offset += 4;
+                        i += 4;
                     }
                     break;
-                    case GNU_locviews:
+                    
+                    case DW_OP_const8u:
                     {
-                        // TODO
-                        Logger::TLog("%x:%s\n", abbrev.Tag, tagNameMap[abbrev.Tag]);
-                        uint64_t loclistptr;
-                        if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
-                        {
-                            uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                            loclistptr = tmp;
-                            offset += 4;
-                        } else {
-                            loclistptr = BinUtil::FromLeToUInt64(&bin[offset]);
-                            offset += 8;
-                        }
-                        Logger::TLog("loclistptr:%x", loclistptr);
+                        uint64_t const8u = BinUtil::FromLeToUInt64(&bin[offset]);
+                        Logger::TLog("DW_OP_const8u :%d", const8u);
+                        offset += 8;
+                        i += 8;
                     }
                     break;
-                    default:
+                    
+                    case DW_OP_const8s:
                     {
-                        std::string msg = StringHelper::strprintf("unexpected attr:%d(%x)", attr.Attr, attr.Attr);
-                        Logger::DLog(msg);
-                        assert(false);
+                        int64_t const8s = BinUtil::FromLeToInt64(&bin[offset]);
+                        Logger::TLog("DW_OP_const8s :%d", const8s);
+                        offset += 8;
+                        i += 8;
                     }
                     break;
+                    case DW_OP_constu:
+                    {
+                        int64_t constu = ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                        offset += len;
+                        i += len;
+                        Logger::TLog("DW_OP_constu:%d\n", constu);
                     }
-                }
-                break;
-                case DW_FORM_exprloc:
-                {
-                    Logger::TLog("attr:%x,%s", attr.Attr, attrNameMap[attr.Attr]);
-                    // following size
-                    uint64_t length = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                    offset += len;
-                    for (uint32_t i = 0; i < length; i++)
+                    break;
+
+                    case DW_OP_consts:
                     {
-                        // dwarf exp OP Code
-                        uint8_t ins = bin[offset];
-                        i++;
-                        offset += 1;
-                        if ((DW_OP_lo_user <= ins) && (ins <= DW_OP_hi_user))
-                        {
-                            // TODO skip extensions
-                            offset += length - i;
-                            i += length - i;
-                            continue;
-                        }
+                        int64_t consts = ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                        offset += len;
+                        i += len;
+                        Logger::TLog("DW_OP_consts:%d\n", consts);
+                    }
+                    break;
 
-                        switch (ins)
-                        {
-                        case DW_OP_addr:
-                        {
-                            // size target specific
-                            uint64_t addr = BinUtil::FromLeToUInt64(&bin[offset]);
-                            Logger::TLog("DW_OP_addr:%x", addr);
-                            offset += curArrangeInfo.Header.AddressSize;
-                            i += curArrangeInfo.Header.AddressSize;
-                        }
+                    case DW_OP_drop:
                         break;
-
-                        case DW_OP_deref:
+                    case DW_OP_over:
                         break;
-
-                        case DW_OP_const1u:
-                        {
-                            uint8_t const1u = bin[offset];
-                            Logger::TLog("DW_OP_const1u:%x", const1u);
-                            offset++;
-                            i++;
-                        }
+                    case DW_OP_swap:
                         break;
-
-                        case DW_OP_const1s:
-                        {
-                            int8_t const1s = (int8_t)bin[offset];
-                            Logger::TLog("DW_OP_const1s :%d", const1s);
-                            offset++;
-                            i++;
-                        }
+                    case DW_OP_abs:
                         break;
-
-                        case DW_OP_const2u:
-                        {
-                            uint16_t const2u = BinUtil::FromLeToUInt16(&bin[offset]);
-                            Logger::TLog("DW_OP_const2u :%d", const2u);
-                            offset += 2;
-                            i += 2;
-                        }
+                    case DW_OP_and:
                         break;
-
-                        case DW_OP_const2s:
-                        {
-                            int16_t const2s = BinUtil::FromLeToInt16(&bin[offset]);
-                            Logger::TLog("DW_OP_const2s :%d", const2s);
-                            offset += 2;
-                            i += 2;
-                        }
+                    case DW_OP_div:
                         break;
-
-                        case DW_OP_const4u:
-                        {
-                            uint32_t const4u = BinUtil::FromLeToUInt32(&bin[offset]);
-                            Logger::TLog("DW_OP_const4u :%d", const4u);
-                            offset += 4;
-                            i += 4;
-                        }
+                    case DW_OP_minus:
                         break;
-
-                        case DW_OP_const4s:
-                        {
-                            int32_t const4s = BinUtil::FromLeToInt32(&bin[offset]);
-                            Logger::TLog("DW_OP_const4s :%d", const4s);
-                            offset += 4;
-                            i += 4;
-                        }
+                    case DW_OP_mod:
                         break;
-                        
-                        case DW_OP_const8u:
-                        {
-                            uint64_t const8u = BinUtil::FromLeToUInt64(&bin[offset]);
-                            Logger::TLog("DW_OP_const8u :%d", const8u);
-                            offset += 8;
-                            i += 8;
-                        }
+                    case DW_OP_mul:
                         break;
-                        
-                        case DW_OP_const8s:
-                        {
-                            int64_t const8s = BinUtil::FromLeToInt64(&bin[offset]);
-                            Logger::TLog("DW_OP_const8s :%d", const8s);
-                            offset += 8;
-                            i += 8;
-                        }
+                    case DW_OP_neg:
                         break;
-                        case DW_OP_constu:
-                        {
-                            int64_t constu = ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                            offset += len;
-                            i += len;
-                            Logger::TLog("DW_OP_constu:%d\n", constu);
-                        }
+                    case DW_OP_not:
                         break;
-
-                        case DW_OP_consts:
-                        {
-                            int64_t consts = ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                            offset += len;
-                            i += len;
-                            Logger::TLog("DW_OP_consts:%d\n", consts);
-                        }
+                    case DW_OP_or:
                         break;
-
-                        case DW_OP_drop:
-                            break;
-                        case DW_OP_over:
-                            break;
-                        case DW_OP_swap:
-                            break;
-                        case DW_OP_abs:
-                            break;
-                        case DW_OP_and:
-                            break;
-                        case DW_OP_div:
-                            break;
-                        case DW_OP_minus:
-                            break;
-                        case DW_OP_mod:
-                            break;
-                        case DW_OP_mul:
-                            break;
-                        case DW_OP_neg:
-                            break;
-                        case DW_OP_not:
-                            break;
-                        case DW_OP_or:
-                            break;
-                        case DW_OP_plus:
-                            break;
-                        case DW_OP_plus_uconst:
-                        {
-                            uint64_t operand = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                            offset += len;
-                            i += len;
-                            Logger::TLog("\toperand:%d\n", operand);
-                        }
+                    case DW_OP_plus:
                         break;
+                    case DW_OP_plus_uconst:
+                    {
+                        uint64_t operand = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                        offset += len;
+                        i += len;
+                        Logger::TLog("\toperand:%d\n", operand);
+                    }
+                    break;
 
-                        case DW_OP_shl:
-                            break;
-                        case DW_OP_shr:
-                            break;
-                        case DW_OP_shra:
-                            break;
-                        case DW_OP_xor:
-                            break;
-                        case DW_OP_skip: // 0x2f
-                        {
-                            int16_t operand = BinUtil::FromLeToInt16(&bin[offset]);
-                            offset += 2;
-                            i += 2;
-                            Logger::TLog("\toperand:%d\n", operand);
-                        }
+                    case DW_OP_shl:
+                        break;
+                    case DW_OP_shr:
+                        break;
+                    case DW_OP_shra:
                         break;
+                    case DW_OP_xor:
+                        break;
+                    case DW_OP_skip: // 0x2f
+                    {
+                        int16_t operand = BinUtil::FromLeToInt16(&bin[offset]);
+                        offset += 2;
+                        i += 2;
+                        Logger::TLog("\toperand:%d\n", operand);
+                    }
+                    break;
 
-                        case DW_OP_bra: //  0x28
-                        {
-                            int16_t operand = BinUtil::FromLeToInt16(&bin[offset]);
-                            offset += 2;
-                            i += 2;
-                            Logger::TLog("\toperand:%d\n", operand);
-                        }
+                    case DW_OP_bra: //  0x28
+                    {
+                        int16_t operand = BinUtil::FromLeToInt16(&bin[offset]);
+                        offset += 2;
+                        i += 2;
+                        Logger::TLog("\toperand:%d\n", operand);
+                    }
+                    break;
+                    case DW_OP_eq: // = 0x29
                         break;
-                        case DW_OP_eq: // = 0x29
-                            break;
-                        case DW_OP_ge: // = 0x2a
-                            break;
-                        case DW_OP_gt: // = 0x2b
-                            break;
-                        case DW_OP_le: // = 0x2c
-                            break;
-                        case DW_OP_lt: // = 0x2d
-                            break;
-                        case DW_OP_ne: // = 0x2e
-                            break;
-                        case DW_OP_fbreg:
-                        {
-                            int64_t operand = ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                            offset += len;
-                            i += len;
-                            Logger::TLog("\toperand:%d\n", operand);
-                        }
+                    case DW_OP_ge: // = 0x2a
                         break;
-                        case DW_OP_call_frame_cfa:
-                            // no operand
-                            break;
-                        case DW_OP_lit0:
-                        case DW_OP_lit1:
-                        case DW_OP_lit2:
-                        case DW_OP_lit3:
-                        case DW_OP_lit4:
-                        case DW_OP_lit5:
-                        case DW_OP_lit6:
-                        case DW_OP_lit7:
-                        case DW_OP_lit8:
-                        case DW_OP_lit9:
-                        case DW_OP_lit10:
-                        case DW_OP_lit11:
-                        case DW_OP_lit12:
-                        case DW_OP_lit13:
-                        case DW_OP_lit14:
-                        case DW_OP_lit15:
-                        case DW_OP_lit16:
-                        case DW_OP_lit17:
-                        case DW_OP_lit18:
-                        case DW_OP_lit19:
-                        case DW_OP_lit20:
-                        case DW_OP_lit21:
-                        case DW_OP_lit22:
-                        case DW_OP_lit23:
-                        case DW_OP_lit24:
-                        case DW_OP_lit25:
-                        case DW_OP_lit26:
-                        case DW_OP_lit27:
-                        case DW_OP_lit28:
-                        case DW_OP_lit29:
-                        case DW_OP_lit30:
-                        case DW_OP_lit31:
-                            // TODO lit
-                            break;
-                        case DW_OP_reg0:
-                        case DW_OP_reg1:
-                        case DW_OP_reg2:
-                        case DW_OP_reg3:
-                        case DW_OP_reg4:
-                        case DW_OP_reg5:
-                        case DW_OP_reg6:
-                        case DW_OP_reg7:
-                        case DW_OP_reg8:
-                        case DW_OP_reg9:
-                        case DW_OP_reg10:
-                        case DW_OP_reg11:
-                        case DW_OP_reg12:
-                        case DW_OP_reg13:
-                        case DW_OP_reg14:
-                        case DW_OP_reg15:
-                        case DW_OP_reg16:
-                        case DW_OP_reg17:
-                        case DW_OP_reg18:
-                        case DW_OP_reg19:
-                        case DW_OP_reg20:
-                        case DW_OP_reg21:
-                        case DW_OP_reg22:
-                        case DW_OP_reg23:
-                        case DW_OP_reg24:
-                        case DW_OP_reg25:
-                        case DW_OP_reg26:
-                        case DW_OP_reg27:
-                        case DW_OP_reg28:
-                        case DW_OP_reg29:
-                        case DW_OP_reg30:
-                        case DW_OP_reg31:
-                            // TODO reg0 ~ reg31
-                            break;
-                        case DW_OP_breg0:
-                        case DW_OP_breg1:
-                        case DW_OP_breg2:
-                        case DW_OP_breg3:
-                        case DW_OP_breg4:
-                        case DW_OP_breg5:
-                        case DW_OP_breg6:
-                        case DW_OP_breg7:
-                        case DW_OP_breg8:
-                        case DW_OP_breg9:
-                        case DW_OP_breg10:
-                        case DW_OP_breg11:
-                        case DW_OP_breg12:
-                        case DW_OP_breg13:
-                        case DW_OP_breg14:
-                        case DW_OP_breg15:
-                        case DW_OP_breg16:
-                        case DW_OP_breg17:
-                        case DW_OP_breg18:
-                        case DW_OP_breg19:
-                        case DW_OP_breg20:
-                        case DW_OP_breg21:
-                        case DW_OP_breg22:
-                        case DW_OP_breg23:
-                        case DW_OP_breg24:
-                        case DW_OP_breg25:
-                        case DW_OP_breg26:
-                        case DW_OP_breg27:
-                        case DW_OP_breg28:
-                        case DW_OP_breg29:
-                        case DW_OP_breg30:
-                        case DW_OP_breg31:
-                        {
-                            // The single operand of the DW_OP_bregn operations provides a signed LEB128 offset
-                            // from the specified register.
-                            ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                            offset += len;
-                            i += len;
-                        }
+                    case DW_OP_gt: // = 0x2b
                         break;
-                        case DW_OP_deref_size:
-                        {
-                            offset++;
-                            i += 1;
-                        }
+                    case DW_OP_le: // = 0x2c
                         break;
-                        case DW_OP_implicit_value:
-                        {
-                            uint64_t length = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
-                            offset += len;
-                            offset += length;
-                            i += size;
-                            i += length;
-                        }
+                    case DW_OP_lt: // = 0x2d
                         break;
-                        case DW_OP_stack_value:
-                            // TODO
-                            break;
-                        default:
-                        {
-                            std::string msg = StringHelper::strprintf("TODO Not decoded op 0x%02x\n", ins);
-                            Logger::DLog(msg);
-                            assert(false);
-                        }
+                    case DW_OP_ne: // = 0x2e
                         break;
-                        } // switch (ins)
+                    case DW_OP_fbreg:
+                    {
+                        int64_t operand = ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                        offset += len;
+                        i += len;
+                        Logger::TLog("\toperand:%d\n", operand);
                     }
-                }
-                break;
-                case DW_FORM_flag_present:
-                {
-                    // flag exist
-                    Logger::TLog("Attr: %s flag exists\n", attrName);
-                }
-                break;
-                case DW_FORM_line_strp:
-                {
-                    uint64_t strOffset = 0;
-                    if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
+                    break;
+                    case DW_OP_call_frame_cfa:
+                        // no operand
+                        break;
+                    case DW_OP_lit0:
+                    case DW_OP_lit1:
+                    case DW_OP_lit2:
+                    case DW_OP_lit3:
+                    case DW_OP_lit4:
+                    case DW_OP_lit5:
+                    case DW_OP_lit6:
+                    case DW_OP_lit7:
+                    case DW_OP_lit8:
+                    case DW_OP_lit9:
+                    case DW_OP_lit10:
+                    case DW_OP_lit11:
+                    case DW_OP_lit12:
+                    case DW_OP_lit13:
+                    case DW_OP_lit14:
+                    case DW_OP_lit15:
+                    case DW_OP_lit16:
+                    case DW_OP_lit17:
+                    case DW_OP_lit18:
+                    case DW_OP_lit19:
+                    case DW_OP_lit20:
+                    case DW_OP_lit21:
+                    case DW_OP_lit22:
+                    case DW_OP_lit23:
+                    case DW_OP_lit24:
+                    case DW_OP_lit25:
+                    case DW_OP_lit26:
+                    case DW_OP_lit27:
+                    case DW_OP_lit28:
+                    case DW_OP_lit29:
+                    case DW_OP_lit30:
+                    case DW_OP_lit31:
+                        // TODO lit
+                        break;
+                    case DW_OP_reg0:
+                    case DW_OP_reg1:
+                    case DW_OP_reg2:
+                    case DW_OP_reg3:
+                    case DW_OP_reg4:
+                    case DW_OP_reg5:
+                    case DW_OP_reg6:
+                    case DW_OP_reg7:
+                    case DW_OP_reg8:
+                    case DW_OP_reg9:
+                    case DW_OP_reg10:
+                    case DW_OP_reg11:
+                    case DW_OP_reg12:
+                    case DW_OP_reg13:
+                    case DW_OP_reg14:
+                    case DW_OP_reg15:
+                    case DW_OP_reg16:
+                    case DW_OP_reg17:
+                    case DW_OP_reg18:
+                    case DW_OP_reg19:
+                    case DW_OP_reg20:
+                    case DW_OP_reg21:
+                    case DW_OP_reg22:
+                    case DW_OP_reg23:
+                    case DW_OP_reg24:
+                    case DW_OP_reg25:
+                    case DW_OP_reg26:
+                    case DW_OP_reg27:
+                    case DW_OP_reg28:
+                    case DW_OP_reg29:
+                    case DW_OP_reg30:
+                    case DW_OP_reg31:
+                        // TODO reg0 ~ reg31
+                        break;
+                    case DW_OP_breg0:
+                    case DW_OP_breg1:
+                    case DW_OP_breg2:
+                    case DW_OP_breg3:
+                    case DW_OP_breg4:
+                    case DW_OP_breg5:
+                    case DW_OP_breg6:
+                    case DW_OP_breg7:
+                    case DW_OP_breg8:
+                    case DW_OP_breg9:
+                    case DW_OP_breg10:
+                    case DW_OP_breg11:
+                    case DW_OP_breg12:
+                    case DW_OP_breg13:
+                    case DW_OP_breg14:
+                    case DW_OP_breg15:
+                    case DW_OP_breg16:
+                    case DW_OP_breg17:
+                    case DW_OP_breg18:
+                    case DW_OP_breg19:
+                    case DW_OP_breg20:
+                    case DW_OP_breg21:
+                    case DW_OP_breg22:
+                    case DW_OP_breg23:
+                    case DW_OP_breg24:
+                    case DW_OP_breg25:
+                    case DW_OP_breg26:
+                    case DW_OP_breg27:
+                    case DW_OP_breg28:
+                    case DW_OP_breg29:
+                    case DW_OP_breg30:
+                    case DW_OP_breg31:
                     {
-                        // 4byte
-                        uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                        offset += 4;
-                        strOffset = tmp;
+                        // The single operand of the DW_OP_bregn operations provides a signed LEB128 offset
+                        // from the specified register.
+                        ReadsLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                        offset += len;
+                        i += len;
                     }
-                    else
+                    break;
+                    case DW_OP_deref_size:
                     {
-                        // 8byte
-                        uint64_t tmp = BinUtil::FromLeToUInt64(&bin[offset]);
-                        offset += 8;
-                        strOffset = tmp;
+                        offset++;
+                        i += 1;
                     }
-                    
-                    std::string name = BinUtil::GetString(pDbgLineStrSec, dbgLineStrSecSize, strOffset);
-                    if (abbrev.Tag == DW_TAG_compile_unit)
+                    break;
+                    case DW_OP_implicit_value:
+                    {
+                        uint64_t length = ReaduLEB128(&bin[offset], dbgInfoEnd - offset, len);
+                        offset += len;
+                        offset += length;
+                        i += size;
+                        i += length;
+                    }
+                    break;
+                    case DW_OP_stack_value:
+                        // TODO
+                        break;
+                    default:
+                    {
+                        // TODO not decoded op, skip the rest of the expression
+                        std::string msg = StringHelper::strprintf("TODO Not decoded op 0x%02x\n", ins);
+                        Logger::DLog(msg);
+                        i = length;
+                    }
+                    break;
+                    } // switch (ins)
+                }
+                // the expression always ends at exprEnd regardless of the decoded operands
+                offset = exprEnd;
+            }
+            break;
+            case DW_FORM_flag_present:
+            {
+                // flag exist
+                Logger::TLog("Attr: %s flag exists\n", attrName);
+            }
+            break;
+            case DW_FORM_line_strp:
+            {
+                uint64_t strOffset = 0;
+                if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
+                {
+                    // 4byte
+                    uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+                    offset += 4;
+                    strOffset = tmp;
+                }
+                else
+                {
+                    // 8byte
+                    uint64_t tmp = BinUtil::FromLeToUInt64(&bin[offset]);
+                    offset += 8;
+                    strOffset = tmp;
+                }
+                
+                std::string name = BinUtil::GetString(pDbgLineStrSec, dbgLineStrSecSize, strOffset);
+                if (abbrev.Tag == DW_TAG_compile_unit)
+                {
+                    if (attr.Attr == DW_AT_name)
                     {
-                        if (attr.Attr == DW_AT_name)
+                        // for Rust
+                        if (cuDbgInfo.IsRust())
                         {
-                            // for Rust
-                            if (cuDbgInfo.IsRust())
+                            auto idx = name.find_last_of("@");
+                            if (idx != std::string::npos)
                             {
-                                auto idx = name.find_last_of("@");
-                                if (idx != std::string::npos)
-                                {
-                                    name = name.substr(0, idx);
-                                }
+                                name = name.substr(0, idx);
                             }
-                            cuDbgInfo.FileName = name;
-                        }
-                        else if (attr.Attr == DW_AT_comp_dir)
-                        {
-                            cuDbgInfo.CompileDir = name;
-                        }
-                        else
-                        {
-                            assert(false);
                         }
+                        cuDbgInfo.FileName = name;
                     }
-                }
-                break;
-                case DW_FORM_implicit_const:
-                    if (attr.Attr == DW_AT_decl_file)
+                    else if (attr.Attr == DW_AT_comp_dir)
                     {
-                        DwarfLineInfoHdr lineInfoHdr = offsetLineInfoMap[cuLineInfoOffset];
-                        std::string fileName = lineInfoHdr.Files[attr.Const].Name;
-                        Logger::TLog("Attr: %s filename:%s\n", attrName, fileName);
+                        cuDbgInfo.CompileDir = name;
                     }
                     else
                     {
-                        Logger::TLog("Attr: %s value:0x%02x\n", attrName, attr.Const);
+                        assert(false);
                     }
-                    break;
-                default:
-                {
-                    std::string msg = StringHelper::strprintf("Unknown Form:0x%x\n", attr.Form);
-                    Logger::DLog(msg);
-                    assert(false);
-                }
-                break;
-
                 }
             }
-            if (abbrev.Tag == DW_TAG_subprogram)
-            {
-                if (dwarfFuncInfo.Name == "")
+            break;
+            case DW_FORM_implicit_const:
                 {
-                    if (cuDbgInfo.Funcs.find(dwarfFuncInfo.Addr) != cuDbgInfo.Funcs.end())
+                    auto lineInfoIt = (attr.Attr == DW_AT_decl_file) ? offsetLineInfoMap.find(cuLineInfoOffset) : offsetLineInfoMap.end();
+                    if ((lineInfoIt != offsetLineInfoMap.end()) && (attr.Const < lineInfoIt->second.Files.size()))
                     {
-                        DwarfFuncInfo &dbgFunc = cuDbgInfo.Funcs[dwarfFuncInfo.Addr];
-                        Logger::TLog("name:%s, addr:0x%X already registed\n", dbgFunc.Name, dwarfFuncInfo.Addr);
+                        Logger::TLog("Attr: %s filename:%s\n", attrName, lineInfoIt->second.Files[attr.Const].Name.c_str());
                     }
                     else
                     {
-                        // TODO For Rust
-                        cppTmpFuncMap[entryOffset] = dwarfFuncInfo;
-                        Logger::DLog("addr:0x:%x function not found\n", dwarfFuncInfo.Addr);
-                        count++;
-                        // TODO Comment out For Rust
-                        //os.Exit(2)
-                        continue;
+                        Logger::TLog("Attr: %s value:0x%02x\n", attrName, attr.Const);
                     }
                 }
-                if (dwarfFuncInfo.Addr != 0)
+                break;
+            default:
+            {
+                std::string msg = StringHelper::strprintf("Unknown Form:0x%x\n", attr.Form);
+                Logger::DLog(msg);
+                assert(false);
+            }
+            break;
+
+            }
+        }
+        if (abbrev.Tag == DW_TAG_subprogram)
+        {
+            // every subprogram can be referenced by DW_AT_specification / DW_AT_abstract_origin
+            dieIndex.Add(dieRecord);
+            if (dwarfFuncInfo.Addr == 0)
+            {
+                // skip if addr not set(must be library function or c++ function decl)
+                count++;
+                continue;
+            }
+            if ((dwarfFuncInfo.Name[0] == '\0') || (dwarfFuncInfo.LinkageName[0] == '\0'))
+            {
+                if (dieRecord.RefOffset != 0)
                 {
-                    // skip if addr not set(must be library function)
-                    Logger::TLog("name:%s, linkageName:%s addr:0x%X\n", dwarfFuncInfo.Name, dwarfFuncInfo.LinkageName, dwarfFuncInfo.Addr);
-                    cuDbgInfo.Funcs[dwarfFuncInfo.Addr] = dwarfFuncInfo;
+                    DwarfDieFixup fixup;
+                    fixup.RefOffset = dieRecord.RefOffset;
+                    fixup.FuncAddr = dwarfFuncInfo.Addr;
+                    fixups.push_back(fixup);
                 }
-                else
+                else if (dwarfFuncInfo.Name[0] == '\0')
                 {
-                    // addr not fixed, maybe c++ function delc, add tmpFuncs
-                    cppTmpFuncMap[entryOffset] = dwarfFuncInfo;
+                    // TODO For Rust
+                    Logger::DLog("addr:0x:%x function not found\n", dwarfFuncInfo.Addr);
+                    count++;
+                    continue;
                 }
             }
-            count++;
+            Logger::TLog("name:%s, linkageName:%s addr:0x%X\n", dwarfFuncInfo.Name, dwarfFuncInfo.LinkageName, dwarfFuncInfo.Addr);
+            cuDbgInfo.Funcs.Append(dwarfFuncInfo.Addr, dwarfFuncInfo);
         }
-        dbgInfos.push_back(cuDbgInfo);
+        count++;
     }
 
-    
-    Logger::TLog("ReadDebugInfo Out...");
-    return dbgInfos;
+    // a function registered twice keeps the later DIE unless it has no name
+    cuDbgInfo.Funcs.Seal([](const DwarfFuncInfo &kept, const DwarfFuncInfo &appended)
+    {
+        return appended.Name[0] != '\0';
+    });
+    cuDbgInfo.LineInfoOffset = cuLineInfoOffset;
+    Stats::Count(STATS_COUNTER_CU, 1);
+    Stats::Count(STATS_COUNTER_DIE, count);
+    Stats::Count(STATS_COUNTER_ATTR, attrCount);
+    return cuDbgInfo;
 }
 
-std::map<uint64_t, DwarfLineInfoHdr> Dwarf::ReadLineInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, ElfFunctionTable &elfFuncTable)
+DwarfLineInfoMap Dwarf::ReadLineInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, ElfFunctionTable &elfFuncTable, unsigned threadCount, SourceLineIndex *lineIndex)
 {
     Logger::TLog("ReadLineInfo In...");
-    std::map<uint64_t, DwarfLineInfoHdr> offsetLineInfoHdrMap;
+    DwarfLineInfoMap offsetLineInfoHdrMap;
+
+    // serial pass: unit_length is enough to find where the next program starts
+    std::vector<uint64_t> hdrOffsets;
     uint64_t hdrOffset  = debugLineShdr.sh_offset;
     uint64_t sectionEnd = debugLineShdr.sh_offset + debugLineShdr.sh_size;
-    while (hdrOffset < sectionEnd)
+    while (hdrOffset + 4 <= sectionEnd)
     {
-        uint64_t offset = hdrOffset;
-        DwarfLineInfoHdr lineInfoHdr;
-        // unit_length initial length(4 or 8 bytes)
-        uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-        offset += 4;
-        if (tmp < 0xffffff00)
+        hdrOffsets.push_back(hdrOffset);
+        uint64_t unitLength = BinUtil::FromLeToUInt32(&bin[hdrOffset]);
+        hdrOffset += 4;
+        if (0xffffff00 <= unitLength)
         {
-            // 32-bit DWARF Format
-            lineInfoHdr.UnitLength = (uint64_t)tmp;
-            lineInfoHdr.DwarfFormat = DWARF_32BIT_FORMAT;
+            // 64-bit DWARF Format
+            unitLength = BinUtil::FromLeToUInt64(&bin[hdrOffset]);
+            hdrOffset += 8;
         }
-        else
+        hdrOffset += unitLength;
+    }
+
+    // programs are decoded concurrently into row buffers of their own, then merged in section order
+    // so that the function table is filled as a serial decode would fill it.
+    // Only a batch of programs is held at once, rows of the whole section may not fit in memory.
+    if (threadCount == 0)
+    {
+        threadCount = Parallel::DefaultThreadCount();
+    }
+    const size_t batchSize = (size_t)threadCount * 8;
+    std::vector<DwarfLineInfoHdr> lineInfoHdrs;
+    std::vector<std::vector<DwarfLineRow>> unitRows;
+    std::vector<uint32_t> funcIdxs;
+    offsetLineInfoHdrMap.reserve(hdrOffsets.size());
+    for (size_t batchTop = 0; batchTop < hdrOffsets.size(); batchTop += batchSize)
+    {
+        size_t count = std::min(batchSize, hdrOffsets.size() - batchTop);
+        lineInfoHdrs.resize(count);
+        unitRows.resize(count);
+        Parallel::For(count, threadCount, [&](const size_t idx)
         {
-            // 64-bit DWARF Format
-            lineInfoHdr.UnitLength = BinUtil::FromLeToUInt64(&bin[offset]);
-            lineInfoHdr.DwarfFormat = DWARF_64BIT_FORMAT;
-            offset += 8;
+            unitRows[idx].clear();
+            lineInfoHdrs[idx] = readLineInfoUnit(bin, size, debugLineShdr, debugLineStrShdr, hdrOffsets[batchTop + idx], unitRows[idx]);
+        });
+
+        for (size_t idx = 0; idx < count; idx++)
+        {
+            addLineRows(lineInfoHdrs[idx], unitRows[idx], elfFuncTable, lineIndex, funcIdxs);
+            offsetLineInfoHdrMap.Append(hdrOffsets[batchTop + idx] - debugLineShdr.sh_offset, std::move(lineInfoHdrs[idx]));
         }
+    }
+
+    // units are read in offset order, so sealing only checks for duplicates
+    offsetLineInfoHdrMap.Seal();
+    sealLineAddrs(elfFuncTable, funcIdxs);
+    Logger::TLog("ReadLineInfo Out...");
+    return offsetLineInfoHdrMap;
+}
+
+DwarfLineInfoHdr Dwarf::ReadLineInfoAt(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, const uint64_t lineInfoOffset, ElfFunctionTable &elfFuncTable)
+{
+    // lineInfoOffset is the DW_AT_stmt_list value of a compilation unit
+    std::vector<DwarfLineRow> rows;
+    DwarfLineInfoHdr lineInfoHdr = readLineInfoUnit(bin, size, debugLineShdr, debugLineStrShdr, debugLineShdr.sh_offset + lineInfoOffset, rows);
+    // only the functions this unit has rows in are sealed again
+    std::vector<uint32_t> funcIdxs;
+    addLineRows(lineInfoHdr, rows, elfFuncTable, nullptr, funcIdxs);
+    sealLineAddrs(elfFuncTable, funcIdxs);
+    return lineInfoHdr;
+}
 
-        // version uhalf
-        lineInfoHdr.Version = BinUtil::FromLeToUInt16(&bin[offset]);
-        offset += 2;
+DwarfLineInfoHdr Dwarf::readLineInfoUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, const uint64_t hdrOffset, std::vector<DwarfLineRow> &rows)
+{
+    uint64_t sectionEnd = debugLineShdr.sh_offset + debugLineShdr.sh_size;
 
-        if (5 <= lineInfoHdr.Version)
-        {
-            // DWARF Version 5 or later
-            lineInfoHdr.AddressSize = bin[offset];
-            offset += 1;
-            lineInfoHdr.SegmentSelectorSize = bin[offset];
-            offset += 1;
-        }
+    uint64_t offset = hdrOffset;
+    DwarfLineInfoHdr lineInfoHdr;
+    // unit_length initial length(4 or 8 bytes)
+    uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+    offset += 4;
+    if (tmp < 0xffffff00)
+    {
+        // 32-bit DWARF Format
+        lineInfoHdr.UnitLength = (uint64_t)tmp;
+        lineInfoHdr.DwarfFormat = DWARF_32BIT_FORMAT;
+    }
+    else
+    {
+        // 64-bit DWARF Format
+        lineInfoHdr.UnitLength = BinUtil::FromLeToUInt64(&bin[offset]);
+        lineInfoHdr.DwarfFormat = DWARF_64BIT_FORMAT;
+        offset += 8;
+    }
 
-        // header_length 32bit-DWARF/64bit-DWARF
-        lineInfoHdr.HeaderLength = BinUtil::FromLeToUInt32(&bin[offset]);
-        offset += 4;
+    // version uhalf
+    lineInfoHdr.Version = BinUtil::FromLeToUInt16(&bin[offset]);
+    offset += 2;
 
-        // minimum_instruction_length ubyte
-        lineInfoHdr.MinInstLength = bin[offset];
+    if (5 <= lineInfoHdr.Version)
+    {
+        // DWARF Version 5 or later
+        lineInfoHdr.AddressSize = bin[offset];
+        offset += 1;
+        lineInfoHdr.SegmentSelectorSize = bin[offset];
         offset += 1;
+    }
 
-        // maximum_operations_per_instruction ubyte
-        if (4 <= lineInfoHdr.Version) {
-            lineInfoHdr.MaxInstLength = bin[offset];
-            offset += 1;
-        }
+    // header_length 32bit-DWARF/64bit-DWARF
+    lineInfoHdr.HeaderLength = BinUtil::FromLeToUInt32(&bin[offset]);
+    offset += 4;
 
-        // default_is_stmt ubyte
-        lineInfoHdr.DefaultIsStmt = bin[offset];
-        offset += 1;
+    // minimum_instruction_length ubyte
+    lineInfoHdr.MinInstLength = bin[offset];
+    offset += 1;
 
-        // line_base (sbyte)
-        lineInfoHdr.LineBase = (int8_t)(bin[offset]);
+    // maximum_operations_per_instruction ubyte
+    if (4 <= lineInfoHdr.Version) {
+        lineInfoHdr.MaxInstLength = bin[offset];
         offset += 1;
+    }
 
-        // line_range ubyte
-        lineInfoHdr.LineRange = bin[offset];
-        offset += 1;
+    // default_is_stmt ubyte
+    lineInfoHdr.DefaultIsStmt = bin[offset];
+    offset += 1;
 
-        // opcode_base ubyte
-        // The number assigned to the first special opcode.
-        lineInfoHdr.OpcodeBase = bin[offset];
-        offset += 1;
+    // line_base (sbyte)
+    lineInfoHdr.LineBase = (int8_t)(bin[offset]);
+    offset += 1;
 
-        // standard_opcode_lengths array of ubyte
-        // This array specifies the number of LEB128 operands for each of the standard opcodes.
-        // The first element of the array corresponds to the opcode whose value is 1, and
-        // the last element corresponds to the opcode whose value is opcode_base - 1.
+    // line_range ubyte
+    lineInfoHdr.LineRange = bin[offset];
+    offset += 1;
 
-        // TODO 要確認 vector 初期化
-        lineInfoHdr.StdOpcodeLengths.clear();
-        for (uint32_t i = 0; i < (uint32_t)lineInfoHdr.OpcodeBase-1; i++)
-        {
-            lineInfoHdr.StdOpcodeLengths.push_back(bin[offset]);
-            offset++;
-        }
+    // opcode_base ubyte
+    // The number assigned to the first special opcode.
+    lineInfoHdr.OpcodeBase = bin[offset];
+    offset += 1;
 
-        if (5 <= lineInfoHdr.Version)
-        {
-            // DWARF Version 5 or later
-            lineInfoHdr.IncludeDirs.clear();
+    // standard_opcode_lengths array of ubyte
+    // This array specifies the number of LEB128 operands for each of the standard opcodes.
+    // The first element of the array corresponds to the opcode whose value is 1, and
+    // the last element corresponds to the opcode whose value is opcode_base - 1.
 
-            // directories
-            lineInfoHdr.DirectoryEntryFormatCount = bin[offset];
-            offset++;
+    // TODO 要確認 vector 初期化
+    lineInfoHdr.StdOpcodeLengths.clear();
+    for (uint32_t i = 0; i < (uint32_t)lineInfoHdr.OpcodeBase-1; i++)
+    {
+        lineInfoHdr.StdOpcodeLengths.push_back(bin[offset]);
+        offset++;
+    }
 
-            // P156
-            uint32_t len = 0;
-            for (uint32_t i = 0; i < lineInfoHdr.DirectoryEntryFormatCount; i++)
-            {
-                EntryFormat entryFmt;
-                entryFmt.TypeCode = ReaduLEB128(&bin[offset], sectionEnd-offset, len);
-                offset += len;
-                entryFmt.FormCode  = ReaduLEB128(&bin[offset], sectionEnd-offset, len);
-                offset += len;
-                lineInfoHdr.DirectoryEntryFormats.push_back(entryFmt);
-            }
+    if (5 <= lineInfoHdr.Version)
+    {
+        // DWARF Version 5 or later
+        lineInfoHdr.IncludeDirs.clear();
+
+        // directories
+        lineInfoHdr.DirectoryEntryFormatCount = bin[offset];
+        offset++;
 
-            lineInfoHdr.DirectoriesCount = ReaduLEB128(&bin[offset], sectionEnd-offset, len);
+        // P156
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < lineInfoHdr.DirectoryEntryFormatCount; i++)
+        {
+            EntryFormat entryFmt;
+            entryFmt.TypeCode = ReaduLEB128(&bin[offset], sectionEnd-offset, len);
+            offset += len;
+            entryFmt.FormCode  = ReaduLEB128(&bin[offset], sectionEnd-offset, len);
             offset += len;
+            lineInfoHdr.DirectoryEntryFormats.push_back(entryFmt);
+        }
+
+        lineInfoHdr.DirectoriesCount = ReaduLEB128(&bin[offset], sectionEnd-offset, len);
+        offset += len;
 
-            for (uint32_t i = 0; i < lineInfoHdr.DirectoriesCount; i++)
+        for (uint32_t i = 0; i < lineInfoHdr.DirectoriesCount; i++)
+        {
+            for (uint32_t j = 0; j < lineInfoHdr.DirectoryEntryFormatCount; j++)
             {
-                for (uint32_t j = 0; j < lineInfoHdr.DirectoryEntryFormatCount; j++)
+                uint64_t typeCode = lineInfoHdr.DirectoryEntryFormats[j].TypeCode;
+                uint64_t formCode = lineInfoHdr.DirectoryEntryFormats[j].FormCode;
+                switch (typeCode)
                 {
-                    uint64_t typeCode = lineInfoHdr.DirectoryEntryFormats[j].TypeCode;
-                    uint64_t formCode = lineInfoHdr.DirectoryEntryFormats[j].FormCode;
-                    switch (typeCode)
+                case DW_LNCT_path:
                     {
-                    case DW_LNCT_path:
+                        std::string dirName = "";
+                        if (formCode == DW_FORM_line_strp)
                         {
-                            std::string dirName = "";
-                            if (formCode == DW_FORM_line_strp)
+                            // offset in the .debug_str, size follows Dwarf format(4 or 8)
+                            uint64_t strOffset = 0;
+                            if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
+                            {
+                                // 4byte
+                                tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+                                offset += 4;
+                                strOffset = tmp;
+                            }
+                            else
                             {
-                                // offset in the .debug_str, size follows Dwarf format(4 or 8)
-                                uint64_t strOffset = 0;
-                                if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
-                                {
-                                    // 4byte
-                                    tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                                    offset += 4;
-                                    strOffset = tmp;
-                                }
-                                else
-                                {
-                                    // 8byte
-                                    tmp = BinUtil::FromLeToUInt64(&bin[offset]);
-                                    offset += 8;
-                                    strOffset = tmp;
-                                }
-                                uint64_t strSecEndPos = debugLineStrShdr.sh_offset + debugLineStrShdr.sh_size;
-                                dirName = BinUtil::GetString(&bin[debugLineStrShdr.sh_offset], strSecEndPos, strOffset);
+                                // 8byte
+                                tmp = BinUtil::FromLeToUInt64(&bin[offset]);
+                                offset += 8;
+                                strOffset = tmp;
                             }
-                            lineInfoHdr.IncludeDirs.push_back(dirName);
+                            uint64_t strSecEndPos = debugLineStrShdr.sh_offset + debugLineStrShdr.sh_size;
+                            dirName = BinUtil::GetString(&bin[debugLineStrShdr.sh_offset], strSecEndPos, strOffset);
                         }
-                        break;
-                    default:
-                        // TODO unexpected
-                        assert(false);
+                        lineInfoHdr.IncludeDirs.push_back(dirName);
                     }
+                    break;
+                default:
+                    // TODO unexpected
+                    assert(false);
                 }
             }
+        }
 
-            // file names
-            lineInfoHdr.FileNameEntryFormatCount = bin[offset];
-            offset++;
-
-            for (uint32_t i = 0; i < lineInfoHdr.FileNameEntryFormatCount; i++)
-             {
-                EntryFormat entryFmt;
-                entryFmt.TypeCode = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
-                offset += len;
-                entryFmt.FormCode = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
-                offset += len;
-                lineInfoHdr.FileNameEntryFormats.push_back(entryFmt);
-            }
+        // file names
+        lineInfoHdr.FileNameEntryFormatCount = bin[offset];
+        offset++;
 
-            lineInfoHdr.FileNamesCount = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
+        for (uint32_t i = 0; i < lineInfoHdr.FileNameEntryFormatCount; i++)
+         {
+            EntryFormat entryFmt;
+            entryFmt.TypeCode = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
+            offset += len;
+            entryFmt.FormCode = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
             offset += len;
+            lineInfoHdr.FileNameEntryFormats.push_back(entryFmt);
+        }
+
+        lineInfoHdr.FileNamesCount = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
+        offset += len;
 
-            for (uint32_t i = 0; i < lineInfoHdr.FileNamesCount; i++)
+        for (uint32_t i = 0; i < lineInfoHdr.FileNamesCount; i++)
+        {
+            FileNameInfo fileNameInfo;
+            uint64_t fileIdx = 0;
+            for (uint32_t j = 0; j < lineInfoHdr.FileNameEntryFormatCount; j++)
             {
-                FileNameInfo fileNameInfo;
-                uint64_t fileIdx = 0;
-                for (uint32_t j = 0; j < lineInfoHdr.FileNameEntryFormatCount; j++)
+                uint64_t typeCode = lineInfoHdr.FileNameEntryFormats[j].TypeCode;
+                uint64_t formCode = lineInfoHdr.FileNameEntryFormats[j].FormCode;
+                switch (typeCode)
                 {
-                    uint64_t typeCode = lineInfoHdr.FileNameEntryFormats[j].TypeCode;
-                    uint64_t formCode = lineInfoHdr.FileNameEntryFormats[j].FormCode;
-                    switch (typeCode)
+                    case DW_LNCT_path:
                     {
-                        case DW_LNCT_path:
+                        if (formCode == DW_FORM_line_strp)
                         {
-                            if (formCode == DW_FORM_line_strp)
+                            // offset in the .debug_str, size follows Dwarf format(4 or 8)
+                            uint64_t strOffset = 0;
+                            if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
                             {
-                                // offset in the .debug_str, size follows Dwarf format(4 or 8)
-                                uint64_t strOffset = 0;
-                                if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
-                                {
-                                    // 4byte
-                                    tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                                    offset += 4;
-                                    strOffset = tmp;
-                                }
-                                else
-                                {
-                                    // 8byte
-                                    tmp = BinUtil::FromLeToUInt64(&bin[offset]);
-                                    offset += 8;
-                                    strOffset = tmp;
-                                }
-                                uint64_t strSecEndPos = debugLineStrShdr.sh_offset + debugLineStrShdr.sh_size;
-                                fileNameInfo.Name = BinUtil::GetString(&bin[debugLineStrShdr.sh_offset], strSecEndPos, strOffset);
+                                // 4byte
+                                tmp = BinUtil::FromLeToUInt32(&bin[offset]);
+                                offset += 4;
+                                strOffset = tmp;
                             }
                             else
                             {
-                                // TODO unexpected
-                                assert(false);
+                                // 8byte
+                                tmp = BinUtil::FromLeToUInt64(&bin[offset]);
+                                offset += 8;
+                                strOffset = tmp;
                             }
+                            uint64_t strSecEndPos = debugLineStrShdr.sh_offset + debugLineStrShdr.sh_size;
+                            fileNameInfo.Name = BinUtil::GetString(&bin[debugLineStrShdr.sh_offset], strSecEndPos, strOffset);
                         }
-                        break;
+                        else
+                        {
+                            // TODO unexpected
+                            assert(false);
+                        }
+                    }
+                    break;
 
-                        case DW_LNCT_directory_index:
+                    case DW_LNCT_directory_index:
+                    {
+                        switch (formCode)
                         {
-                            switch (formCode)
+                            case DW_FORM_data1:
                             {
-                                case DW_FORM_data1:
-                                {
-                                    fileIdx = bin[offset];
-                                    offset++;
-                                }
-                                break;
-
-                                case DW_FORM_data2:
-                                {
-                                    tmp = BinUtil::FromLeToUInt16(&bin[offset]);
-                                    fileIdx += tmp;
-                                    offset += 2;
-                                }
-                                break;
+                                fileIdx = bin[offset];
+                                offset++;
+                            }
+                            break;
 
-                                case DW_FORM_udata:
-                                {
-                                    fileIdx = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
-                                    offset += len;
-                                }
-                                break;
+                            case DW_FORM_data2:
+                            {
+                                tmp = BinUtil::FromLeToUInt16(&bin[offset]);
+                                fileIdx += tmp;
+                                offset += 2;
+                            }
+                            break;
 
-                                default:
-                                    // TODO unexpected
-                                    assert(false);
-                                    break;
+                            case DW_FORM_udata:
+                            {
+                                fileIdx = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
+                                offset += len;
                             }
-                            fileNameInfo.DirIdx = fileIdx;
+                            break;
+
+                            default:
+                                // TODO unexpected
+                                assert(false);
+                                break;
                         }
-                        break;
-                    default:
-                        // TODO unexpected
-                        assert(false);
+                        fileNameInfo.DirIdx = fileIdx;
                     }
+                    break;
+                default:
+                    // TODO unexpected
+                    assert(false);
                 }
-                // TODO save fileIdx info
-                lineInfoHdr.Files.push_back(fileNameInfo);
-            }
-
-            uint64_t endOffset = hdrOffset + lineInfoHdr.UnitLength;
-            if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
-            {
-                endOffset += 4;
-            }
-            else
-            {
-                endOffset += 8;
             }
+            // TODO save fileIdx info
+            lineInfoHdr.Files.push_back(fileNameInfo);
+        }
 
-            std::string fileName = lineInfoHdr.Files[0].Name;
-            if (0 < (endOffset - offset))
-            {
-                readLineNumberProgram(bin, size, fileName, lineInfoHdr, offset, endOffset, elfFuncTable);
-            }
+        uint64_t endOffset = hdrOffset + lineInfoHdr.UnitLength;
+        if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
+        {
+            endOffset += 4;
         }
         else
         {
-            // include_directories
-            while (true)
+            endOffset += 8;
+        }
+
+        std::string fileName = lineInfoHdr.Files[0].Name;
+        if (0 < (endOffset - offset))
+        {
+            readLineNumberProgram(bin, size, fileName, lineInfoHdr, offset, endOffset, rows);
+        }
+    }
+    else
+    {
+        // include_directories
+        while (true)
+        {
+            std::string dirName = BinUtil::GetString(&bin[offset], sectionEnd - offset, 0);
+            uint32_t sLen = dirName.size();
+            if (sLen == 0)
             {
-                std::string dirName = BinUtil::GetString(&bin[offset], sectionEnd - offset, 0);
-                uint32_t sLen = dirName.size();
-                if (sLen == 0)
-                {
-                    offset++;
-                    break;
-                }
-                offset += sLen + 1;
-                lineInfoHdr.IncludeDirs.push_back(dirName);
+                offset++;
+                break;
             }
+            offset += sLen + 1;
+            lineInfoHdr.IncludeDirs.push_back(dirName);
+        }
 
-            // file_names
-            while(true)
+        // file_names
+        while(true)
+        {
+            FileNameInfo fileNameInfo;
+
+            // name
+            fileNameInfo.Name = BinUtil::GetString(&bin[offset], sectionEnd - offset, 0);
+            uint32_t sLen = fileNameInfo.Name.size();
+            if (sLen == 0)
             {
-                FileNameInfo fileNameInfo;
+                offset++;
+                break;
+            }
+            offset += (uint64_t)(sLen + 1);
 
-                // name
-                fileNameInfo.Name = BinUtil::GetString(&bin[offset], sectionEnd - offset, 0);
-                uint32_t sLen = fileNameInfo.Name.size();
-                if (sLen == 0)
-                {
-                    offset++;
-                    break;
-                }
-                offset += (uint64_t)(sLen + 1);
+            // directory Idx
+            uint32_t len;
+            fileNameInfo.DirIdx = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
+            offset += len;
 
-                // directory Idx
-                uint32_t len;
-                fileNameInfo.DirIdx = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
-                offset += len;
+            // last modified
+            fileNameInfo.LastModified = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
+            offset += len;
 
-                // last modified
-                fileNameInfo.LastModified = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
-                offset += len;
+            // file size
+            fileNameInfo.Size = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
+            offset += len;
 
-                // file size
-                fileNameInfo.Size = ReaduLEB128(&bin[offset], sectionEnd - offset, len);
-                offset += len;
+            lineInfoHdr.Files.push_back(fileNameInfo);
+        }
 
-                lineInfoHdr.Files.push_back(fileNameInfo);
-            }
+        uint64_t endOffset = hdrOffset + lineInfoHdr.UnitLength;
+        if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
+        {
+            endOffset += 4;
+        } else {
+            endOffset += 8;
+        }
 
-            uint64_t endOffset = hdrOffset + lineInfoHdr.UnitLength;
-            if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
-            {
-                endOffset += 4;
-            } else {
-                endOffset += 8;
-            }
+        std::string fileName = lineInfoHdr.Files[0].Name;
+        if (0 < (endOffset - offset))
+        {
+            readLineNumberProgram(bin, size, fileName, lineInfoHdr, offset, endOffset, rows);
+        }
+    }
 
-            std::string fileName = lineInfoHdr.Files[0].Name;
-            if (0 < (endOffset - offset))
-            {
-                readLineNumberProgram(bin, size, fileName, lineInfoHdr, offset, endOffset, elfFuncTable);
-            }
+    return lineInfoHdr;
+}
+// LEB128 of the line number program, p is moved past the value
+static inline uint64_t readULEB128(const uint8_t *&p, const uint8_t *end)
+{
+    uint64_t val = 0;
+    uint32_t shift = 0;
+    while (p < end)
+    {
+        uint8_t byte = *p++;
+        if (shift < 64)
+        {
+            val |= (uint64_t)(byte & 0x7F) << shift;
+        }
+        shift += 7;
+        if ((byte & 0x80) == 0)
+        {
+            break;
         }
+    }
+    return val;
+}
 
-        uint32_t lineInfoHdrOffset = hdrOffset - debugLineShdr.sh_offset;
-        offsetLineInfoHdrMap[lineInfoHdrOffset] = lineInfoHdr;
-        hdrOffset += lineInfoHdr.UnitLength;
-        if (lineInfoHdr.DwarfFormat == DWARF_32BIT_FORMAT)
+static inline int64_t readSLEB128(const uint8_t *&p, const uint8_t *end)
+{
+    uint64_t val = 0;
+    uint32_t shift = 0;
+    uint8_t byte = 0;
+    while (p < end)
+    {
+        byte = *p++;
+        if (shift < 64)
         {
-            hdrOffset += 4;
+            val |= (uint64_t)(byte & 0x7F) << shift;
         }
-        else
+        shift += 7;
+        if ((byte & 0x80) == 0)
         {
-            hdrOffset += 8;
+            break;
         }
     }
-    return offsetLineInfoHdrMap;
+    if ((shift < 64) && ((byte & 0x40) != 0))
+    {
+        // negative value
+        val |= ~(uint64_t)0 << shift;
+    }
+    return (int64_t)val;
+}
+
+// appends a row of the current registers, then resets the registers a row resets (DWARF 5 6.2.5.1)
+// viewAddr is the address of the previous row, rows at the same address get increasing views.
+// Rows which are not is_stmt are kept too, the last row at an address is what the address executes.
+static inline void appendLineRow(LineNumberStateMachine &lnsm, uint64_t &viewAddr, std::vector<DwarfLineRow> &rows)
+{
+    lnsm.View = (lnsm.Address == viewAddr) ? lnsm.View + 1 : 0;
+    viewAddr = lnsm.Address;
+    DwarfLineRow row;
+    row.Address = lnsm.Address;
+    row.Line = (uint32_t)lnsm.Line;
+    row.File = (uint32_t)lnsm.File;
+    row.Discriminator = (uint32_t)lnsm.Discriminator;
+    row.Column = (lnsm.Column < LINE_COLUMN_MAX) ? (uint16_t)lnsm.Column : LINE_COLUMN_MAX;
+    row.View = (lnsm.View < LINE_VIEW_MAX) ? (uint8_t)lnsm.View : LINE_VIEW_MAX;
+    row.Flags = lnsm.IsStmt ? LINE_FLAG_IS_STMT : 0;
+    row.Flags |= lnsm.BasicBlock ? LINE_FLAG_BASIC_BLOCK : 0;
+    row.Flags |= lnsm.PrologueEnd ? LINE_FLAG_PROLOGUE_END : 0;
+    row.Flags |= lnsm.EpilogueBegin ? LINE_FLAG_EPILOGUE_BEGIN : 0;
+    rows.push_back(row);
+    lnsm.BasicBlock = false;
+    lnsm.PrologueEnd = false;
+    lnsm.EpilogueBegin = false;
+    lnsm.Discriminator = 0;
+}
+
+void Dwarf::buildLineOpTable(const DwarfLineInfoHdr &lineInfoHdr, DwarfLineOpTable &opTable)
+{
+    // See Dwarf3.pdf 6.2.5.1 Special Opcodes
+    // opcode = (desired line increment - line_base) + (line_range * address advance) + opcode_base
+    // address increment = (adjusted opcode / line_range) * minimim_instruction_length
+    // line increment = line_base + (adjusted opcode % line_range)
+    for (uint32_t opcode = 0; opcode < 256; opcode++)
+    {
+        DwarfLineOp &op = opTable.Ops[opcode];
+        op.AddrAdvance = 0;
+        op.LineAdvance = 0;
+        op.EmitsRow = false;
+        if ((opcode < lineInfoHdr.OpcodeBase) || (lineInfoHdr.LineRange == 0))
+        {
+            continue;
+        }
+        uint32_t adjOpcode = opcode - lineInfoHdr.OpcodeBase;
+        op.AddrAdvance = (adjOpcode / lineInfoHdr.LineRange) * lineInfoHdr.MinInstLength;
+        op.LineAdvance = lineInfoHdr.LineBase + (int32_t)(adjOpcode % lineInfoHdr.LineRange);
+        op.EmitsRow = true;
+    }
+
+    // DW_LNS_const_add_pc advances the address as special opcode 255 does, without a row
+    opTable.ConstAddPc = opTable.Ops[255].AddrAdvance;
+    if (lineInfoHdr.LineRange == 0)
+    {
+        Logger::DLog("line_range is 0, special opcodes are ignored");
+    }
 }
-// DW_LNS name map
 
-void Dwarf::readLineNumberProgram(const uint8_t *bin, const uint64_t size, const std::string &fileName, const DwarfLineInfoHdr &lineInfoHdr, const uint64_t lnpStart, const uint64_t lnpEnd, ElfFunctionTable &elfFuncTable)
+void Dwarf::readLineNumberProgram(const uint8_t *bin, const uint64_t size, const std::string &fileName, const DwarfLineInfoHdr &lineInfoHdr, const uint64_t lnpStart, const uint64_t lnpEnd, std::vector<DwarfLineRow> &rows)
 {
-    uint8_t *lnpIns = (uint8_t *)(&bin[lnpStart]);
-    const uint64_t length  = lnpEnd - lnpStart;
-    uint64_t offset = 0;
-    uint64_t curFuncAddr = 0;
+    const uint8_t *p = &bin[lnpStart];
+    const uint8_t *end = &bin[(lnpEnd < size) ? lnpEnd : size];
+    uint64_t viewAddr = UINT64_MAX;
     LineNumberStateMachine lnsm(lineInfoHdr.DefaultIsStmt);
 
-    // for debug map
-    std::map<uint8_t, std::string> dwLnsNameMap;
-    dwLnsNameMap[DW_LNS_copy]               =   "DW_LNS_copy";
-    dwLnsNameMap[DW_LNS_advance_pc]         =   "DW_LNS_advance_pc";
-    dwLnsNameMap[DW_LNS_advance_line]       =   "DW_LNS_advance_line";
-    dwLnsNameMap[DW_LNS_set_file]           =   "DW_LNS_set_file";
-    dwLnsNameMap[DW_LNS_set_column]         =   "DW_LNS_set_column";
-    dwLnsNameMap[DW_LNS_negate_stmt]        =   "DW_LNS_negate_stmt";
-    dwLnsNameMap[DW_LNS_set_basic_block]    =   "DW_LNS_set_basic_block";
-    dwLnsNameMap[DW_LNS_const_add_pc]       =   "DW_LNS_const_add_pc";
-    dwLnsNameMap[DW_LNS_fixed_advance_pc]   =   "DW_LNS_fixed_advance_pc";
-    dwLnsNameMap[DW_LNS_set_prologue_end]   =   "DW_LNS_set_prologue_end";
-    dwLnsNameMap[DW_LNS_set_epilogue_begin] =   "DW_LNS_set_epilogue_begin";
-    dwLnsNameMap[DW_LNS_set_isa]            =   "DW_LNS_set_isa";
+    DwarfLineOpTable opTable;
+    buildLineOpTable(lineInfoHdr, opTable);
 
     bool endOfSeq = false;
-    while (offset < length)
-     {
+    uint64_t rowCount = 0;
+    while (p < end)
+    {
+        uint8_t opcode = *p++;
+        const DwarfLineOp &op = opTable.Ops[opcode];
         endOfSeq = false;
-
-        // read opecode
-        uint8_t opcode = lnpIns[offset];
-
-        // for debug
-        uint64_t opOffset = lnpStart + offset;
-        if (dwLnsNameMap.find(opcode) != dwLnsNameMap.end())
-        {
-            std::string dwLnsName = dwLnsNameMap[opcode];
-            Logger::TLog("[%6x] opcode: %d(0x%x), %s", opOffset, opcode, opcode, dwLnsName);
-        }
-        else
+        if (op.EmitsRow)
         {
-            Logger::TLog("[%6x] opcode: %d(0x%x)", opOffset, opcode, opcode);
+            rowCount++;
+            lnsm.Address += op.AddrAdvance;
+            lnsm.Line += op.LineAdvance;
+            appendLineRow(lnsm, viewAddr, rows);
+            continue;
         }
 
-        offset++;
-        uint32_t len = 0;
         switch (opcode)
         {
         case 0x00: // extended opcodes
             {
-                uint64_t tmp = ReaduLEB128(&lnpIns[offset], lnpEnd - offset, len);
-                offset += len;
-                uint8_t extendedOpcode = lnpIns[offset];
-                offset++;
+                uint64_t extLen = readULEB128(p, end);
+                if ((extLen == 0) || ((uint64_t)(end - p) < extLen))
+                {
+                    Logger::ELog("broken extended opcode at 0x%x", (p - bin));
+                    p = end;
+                    break;
+                }
+                const uint8_t *next = p + extLen;
+                uint8_t extendedOpcode = *p++;
                 switch (extendedOpcode)
                 {
                 case DW_LNE_end_sequence:
+                    rowCount++;
+                    // the end row closes the last row of the sequence, addresses from it on have no line
+                    appendLineRow(lnsm, viewAddr, rows);
+                    rows.back().Flags = LINE_FLAG_END_SEQUENCE;
                     lnsm = LineNumberStateMachine(lineInfoHdr.DefaultIsStmt);
-                    //offset += length
-                    // break parse loop
+                    viewAddr = UINT64_MAX;
                     endOfSeq = true;
                     break;
                 case DW_LNE_set_address:
+                    if (extLen - 1 == 8)
                     {
-                        uint64_t addrSize = tmp - 1;
-                        if (addrSize == 8)
-                        {
-                            uint64_t address = BinUtil::FromLeToUInt64(&lnpIns[offset]);
-                            lnsm.Address = address;
-                            curFuncAddr = address;
-                        }
-                        else
-                        {
-                            uint32_t address = BinUtil::FromLeToUInt32(&lnpIns[offset]);
-                            lnsm.Address = address;
-                            curFuncAddr = address;
-                        }
-                        offset += tmp - 1;
+                        lnsm.Address = BinUtil::FromLeToUInt64(p);
                     }
-                    break;
-                case DW_LNE_define_file:
+                    else
                     {
-                        // TODO
-                        offset += tmp - 1;
+                        lnsm.Address = BinUtil::FromLeToUInt32(p);
                     }
                     break;
                 case DW_LNE_set_discriminator:
-                    {
-                        // TODO
-                        // Bug. gcc version 9.3.0 (Ubuntu 9.3.0-17ubuntu1~20.04)
-                        // DW_LNE_set_discriminator is defined DWARF4, but section header's DWARF version is 3...
-                        uint64_t discriminator = ReaduLEB128(&lnpIns[offset], lnpEnd - offset, len);
-                        lnsm.Discriminator = discriminator;
-                        offset += len;
-                    }
-                    break;
-                case DW_LNE_lo_user:
-                    // TODO
-                    offset += tmp - 1;
-                    break;
-                case DW_LNE_hi_user:
-                    // TODO
-                    offset += tmp - 1;
+                    // Bug. gcc version 9.3.0 (Ubuntu 9.3.0-17ubuntu1~20.04)
+                    // DW_LNE_set_discriminator is defined DWARF4, but section header's DWARF version is 3...
+                    lnsm.Discriminator = readULEB128(p, next);
                     break;
                 default:
-                    {
-                        std::string msg = StringHelper::strprintf("Unexpected extended opcode:%d(0x%x)", extendedOpcode, extendedOpcode);
-                        std::cerr << msg << std::endl;
-                        assert(false);
-                    }
+                    // DW_LNE_define_file and vendor extensions, skipped by their length
                     break;
                 }
+                p = next;
             }
             break;
         case DW_LNS_copy:
-            {
-                if (lnsm.IsStmt)
-                {
-                    addFuncAddrLineInfo(lineInfoHdr, lnsm, curFuncAddr, elfFuncTable);
-                }
-                lnsm.BasicBlock = false;
-                lnsm.PrologueEnd = false;
-                lnsm.EpilogueBegin = false;
-            }
+            rowCount++;
+            appendLineRow(lnsm, viewAddr, rows);
             break;
         case DW_LNS_advance_pc:
-            {
-                uint64_t addrInc = ReaduLEB128(&lnpIns[offset], lnpEnd - offset, len);
-                lnsm.Address += addrInc * (uint64_t)lineInfoHdr.MinInstLength;
-                offset += len;
-            }
+            lnsm.Address += readULEB128(p, end) * lineInfoHdr.MinInstLength;
             break;
         case DW_LNS_advance_line:
-            {
-                int64_t lineInc = ReadsLEB128(&lnpIns[offset], lnpEnd - offset, len);
-                lnsm.Line = (uint64_t)lnsm.Line + lineInc;
-                offset += len;
-            }
+            lnsm.Line += readSLEB128(p, end);
             break;
         case DW_LNS_set_file:
-            {
-                uint64_t fileIdx = ReaduLEB128(&lnpIns[offset], lnpEnd - offset, len);
-                lnsm.File = fileIdx;
-                offset += len;
-            }
+            lnsm.File = readULEB128(p, end);
             break;
         case DW_LNS_set_column:
-            // column set
-            {
-                uint64_t coperand = ReaduLEB128(&lnpIns[offset], lnpEnd - offset, len);
-                lnsm.Column = coperand;
-                offset += len;
-            }
+            lnsm.Column = readULEB128(p, end);
             break;
         case DW_LNS_negate_stmt:
-            {
-                // no operand
-                lnsm.IsStmt = !(lnsm.IsStmt);
-            }
+            lnsm.IsStmt = !lnsm.IsStmt;
             break;
         case DW_LNS_set_basic_block:
-            {
-                // no operand
-                lnsm.BasicBlock = true;
-            }
+            lnsm.BasicBlock = true;
             break;
         case DW_LNS_const_add_pc:
-            {
-                // no operand
-                // increment addres is same as special opcode.
-                uint8_t adjOpcode = opcode - lineInfoHdr.OpcodeBase;
-                uint64_t addrInc = (adjOpcode / lineInfoHdr.LineRange) * lineInfoHdr.MinInstLength;
-                lnsm.Address = lnsm.Address + addrInc;
-            }
+            lnsm.Address += opTable.ConstAddPc;
             break;
         case DW_LNS_fixed_advance_pc:
+            // The DW_LNS_fixed_advance_pc opcode takes a single uhalf (unencoded) operand
+            // and adds it to the address register of the state machine and sets the op_index register to 0.
+            if (end - p < 2)
             {
-                // The DW_LNS_fixed_advance_pc opcode takes a single uhalf (unencoded) operand
-                // and adds it to the address register of the state machine and sets the op_index register to 0.
-                uint16_t address = BinUtil::FromLeToUInt16(&lnpIns[offset]);
-                lnsm.Address = lnsm.Address + address;
-                lnsm.OpIndex = 0;
-                offset += 2;
+                p = end;
+                break;
             }
+            lnsm.Address += BinUtil::FromLeToUInt16(p);
+            lnsm.OpIndex = 0;
+            p += 2;
             break;
         case DW_LNS_set_prologue_end:
-            {
-                lnsm.PrologueEnd = true;
-            }
+            lnsm.PrologueEnd = true;
             break;
         case DW_LNS_set_epilogue_begin:
-            {
-                lnsm.EpilogueBegin = true;
-            }
+            lnsm.EpilogueBegin = true;
             break;
         case DW_LNS_set_isa:
-            {
-                // read and skip value
-                ReadsLEB128(&lnpIns[offset], lnpEnd - offset, len);
-                offset += len;
-            }
+            lnsm.Isa = readULEB128(p, end);
             break;
         default:
             {
-                // special opcode
-                // no operand
-                // See Dwarf3.pdf 6.2.5.1 Special Opcodes
-                // opcode = (desired line increment - line_base) + (line_range * address advance) + opcode_base
-                // address increment = (adjusted opcode / line_range) * minimim_instruction_length
-                // line increment = line_base + (adjusted opcode % line_range)
-                uint8_t adjOpcode = opcode - lineInfoHdr.OpcodeBase;
-                uint64_t addrInc = (adjOpcode / lineInfoHdr.LineRange) * lineInfoHdr.MinInstLength;
-                int64_t lineInc = lineInfoHdr.LineBase + (adjOpcode % lineInfoHdr.LineRange);
-                lnsm.Line = lnsm.Line + lineInc;
-
-                // check function
-                uint64_t addr = lnsm.Address + addrInc;
-                lnsm.Address = addr;
-                lnsm.BasicBlock = false;
-                lnsm.PrologueEnd = false;
-                lnsm.EpilogueBegin = false;
-                curFuncAddr = lnsm.Address;
-                if (lnsm.IsStmt)
+                // standard opcode of a later version, its operands are ULEB128 as many as standard_opcode_lengths says
+                uint8_t operandCount = (opcode <= lineInfoHdr.StdOpcodeLengths.size()) ? lineInfoHdr.StdOpcodeLengths[opcode - 1] : 0;
+                for (uint8_t i = 0; i < operandCount; i++)
                 {
-                    addFuncAddrLineInfo(lineInfoHdr, lnsm, curFuncAddr, elfFuncTable);
+                    readULEB128(p, end);
                 }
-                Logger::DLog("special opcode:0x%02X, address inc:%d, line inc:%d", opcode, addrInc, lineInc);
             }
+            break;
         }
     }
 
@@ -1673,57 +2039,152 @@ void Dwarf::readLineNumberProgram(const uint8_t *bin, const uint64_t size, const
         assert(false);
     }
 
-    Logger::TLog("ReadLineInfo Out...");
-    return;
+    Stats::Count(STATS_COUNTER_LINE_ROW, rowCount);
 }
 
-void Dwarf::addFuncAddrLineInfo(const DwarfLineInfoHdr &lineInfoHdr, LineNumberStateMachine lnsm, const uint64_t funcAddr, ElfFunctionTable &elfFuncInfos)
+void Dwarf::addLineRows(const DwarfLineInfoHdr &lineInfoHdr, const std::vector<DwarfLineRow> &rows, ElfFunctionTable &elfFuncInfos, SourceLineIndex *lineIndex, std::vector<uint32_t> &funcIdxs)
 {
-    FileNameInfo file = lineInfoHdr.Files[lnsm.File-1];
-    if (elfFuncInfos.AddrFuncIdxMap.find(funcAddr) == elfFuncInfos.AddrFuncIdxMap.end())
+    // file entries of this program are interned once, rows only carry the id
+    std::vector<uint32_t> fileIds(lineInfoHdr.Files.size(), UINT32_MAX);
+    auto getFileId = [&](const uint64_t fileIdx) -> uint32_t
     {
-        // TDOO: must Fix this
-        Logger::DLog("function not exist in %s, funcAddr:0x%x\n", elfFuncInfos.Path, funcAddr);
-        return;
-    }
-    uint32_t funcIdx = elfFuncInfos.AddrFuncIdxMap[funcAddr];
-    ElfFunctionInfo &elfFuncInfo = elfFuncInfos.ElfFuncInfos[funcIdx];
-    elfFuncInfo.SrcDirName = "";
-    elfFuncInfo.SrcFileName = file.Name;
-    LineAddrInfo lineAddr;
-    lineAddr.Line = lnsm.Line;
-    lineAddr.Addr = lnsm.Address;
-    lineAddr.IsStmt = lnsm.IsStmt;
+        // DWARF 5 file indexes are 0-based, DWARF 4 ones start at 1 and 0 is no file
+        uint64_t entryIdx = fileIdx;
+        if (lineInfoHdr.Version < 5)
+        {
+            if (fileIdx == 0)
+            {
+                return 0;
+            }
+            entryIdx = fileIdx - 1;
+        }
+        if (lineInfoHdr.Files.size() <= entryIdx)
+        {
+            return 0;
+        }
+        uint32_t &fileId = fileIds[entryIdx];
+        if (fileId == UINT32_MAX)
+        {
+            // DWARF 5 directory 0 is the compilation directory, DWARF 4 has no entry for it
+            const FileNameInfo &file = lineInfoHdr.Files[entryIdx];
+            // a directory index out of the table is broken DWARF, the file has no directory then
+            std::string dirName;
+            if (5 <= lineInfoHdr.Version)
+            {
+                if (file.DirIdx < lineInfoHdr.IncludeDirs.size())
+                {
+                    dirName = lineInfoHdr.IncludeDirs[file.DirIdx];
+                }
+            }
+            else if ((0 < file.DirIdx) && (file.DirIdx <= lineInfoHdr.IncludeDirs.size()))
+            {
+                // TODO find src path of DirIdx 0...
+                dirName = lineInfoHdr.IncludeDirs[file.DirIdx - 1];
+            }
+            fileId = elfFuncInfos.Files.Intern(dirName, file.Name);
+        }
+        return fileId;
+    };
 
-    if (5 <= lineInfoHdr.Version)
+    auto toLineAddr = [&](const DwarfLineRow &row)
     {
-        // get src file info
-        lineAddr.SrcDirName = lineInfoHdr.IncludeDirs[file.DirIdx];
-        elfFuncInfo.SrcDirName = lineInfoHdr.IncludeDirs[file.DirIdx];
-        elfFuncInfo.LineAddrs[lnsm.Line] = lineAddr;
-
-        // update elf function info
-        elfFuncInfos.ElfFuncInfos[funcIdx] = elfFuncInfo;
-    }
-    else
+        LineAddrInfo lineAddr;
+        lineAddr.Line = row.Line;
+        lineAddr.Addr = row.Address;
+        lineAddr.FileId = ((row.Flags & LINE_FLAG_END_SEQUENCE) != 0) ? 0 : getFileId(row.File);
+        lineAddr.Discriminator = row.Discriminator;
+        lineAddr.Column = row.Column;
+        lineAddr.View = row.View;
+        lineAddr.Flags = row.Flags;
+        return lineAddr;
+    };
+
+    // rows of a sequence are in address order, so each function gets the rows within its range as runs
+    size_t runTop = 0;
+    while (runTop < rows.size())
     {
-        if (file.DirIdx < 1)
+        if ((0 < runTop) && ((rows[runTop - 1].Flags & LINE_FLAG_END_SEQUENCE) == 0))
         {
-            // TODO find src path...
+            // functions starting between two rows of a sequence (.cold fragments laid out one after
+            // another) execute the earlier row up to their first own row
+            const DwarfLineRow &prevRow = rows[runTop - 1];
+            auto funcIt = elfFuncInfos.AddrFuncIdxMap.upper_bound(prevRow.Address);
+            for (; (funcIt != elfFuncInfos.AddrFuncIdxMap.end()) && (funcIt->first < rows[runTop].Address); funcIt++)
+            {
+                LineAddrInfo lineAddr = toLineAddr(prevRow);
+                lineAddr.Addr = funcIt->first;
+                lineAddr.View = 0;
+                lineAddr.Flags = 0;
+                elfFuncInfos.ElfFuncInfos[funcIt->second].AddrLines.Append(funcIt->first, lineAddr);
+                funcIdxs.push_back(funcIt->second);
+            }
         }
-        else
+
+        uint32_t funcIdx = 0;
+        if (!Elf64::FindFuncIdx(elfFuncInfos, rows[runTop].Address, funcIdx))
+        {
+            // padding between functions, or code without a symbol
+            if ((rows[runTop].Flags & LINE_FLAG_END_SEQUENCE) == 0)
+            {
+                Logger::DLog("function not exist in %s, addr:0x%x\n", elfFuncInfos.Path, rows[runTop].Address);
+            }
+            runTop++;
+            continue;
+        }
+
+        ElfFunctionInfo &elfFuncInfo = elfFuncInfos.ElfFuncInfos[funcIdx];
+        uint64_t funcEnd = elfFuncInfo.Addr + elfFuncInfo.Size;
+        funcIdxs.push_back(funcIdx);
+
+        size_t runEnd = runTop;
+        size_t lastRow = SIZE_MAX;
+        while ((runEnd < rows.size()) && (elfFuncInfo.Addr <= rows[runEnd].Address) && (rows[runEnd].Address < funcEnd))
         {
-            // implemented at libray
-            //lineAddr.IsLibrary = true
+            const DwarfLineRow &row = rows[runEnd];
+            LineAddrInfo lineAddr = toLineAddr(row);
+            elfFuncInfo.AddrLines.Append(row.Address, lineAddr);
+            if ((row.Flags & LINE_FLAG_END_SEQUENCE) == 0)
+            {
+                lastRow = runEnd;
+            }
+            if ((row.Flags & LINE_FLAG_IS_STMT) != 0)
+            {
+                // lines are looked up by their statements only
+                elfFuncInfo.LineAddrs.Append(row.Line, lineAddr);
+                if (lineIndex != nullptr)
+                {
+                    // every address of a line, LineAddrs keeps only the last one
+                    lineIndex->Add({lineAddr.FileId, row.Line, row.Address, funcIdx, row.Discriminator, (row.Flags & LINE_FLAG_PROLOGUE_END) != 0});
+                }
+            }
+            runEnd++;
+        }
 
-            // get src file info
-            lineAddr.SrcDirName = lineInfoHdr.IncludeDirs[file.DirIdx-1];
-            elfFuncInfo.SrcDirName = lineInfoHdr.IncludeDirs[file.DirIdx-1];
+        // source of the function is the one of its last row
+        if (lastRow != SIZE_MAX)
+        {
+            elfFuncInfo.SrcFileId = getFileId(rows[lastRow].File);
         }
-        elfFuncInfo.LineAddrs[lnsm.Line] = lineAddr;
+        runTop = runEnd;
+    }
+}
+
+void Dwarf::sealLineAddrs(ElfFunctionTable &elfFuncTable, std::vector<uint32_t> &funcIdxs)
+{
+    // a function has a run of rows in each sequence crossing it
+    std::sort(funcIdxs.begin(), funcIdxs.end());
+    funcIdxs.erase(std::unique(funcIdxs.begin(), funcIdxs.end()), funcIdxs.end());
 
-        // update elf function info
-        elfFuncInfos.ElfFuncInfos[funcIdx] = elfFuncInfo;
+    // rows are appended in address order, a line or an address seen again keeps its last row
+    for (uint32_t funcIdx : funcIdxs)
+    {
+        ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[funcIdx];
+        elfFuncInfo.LineAddrs.Seal();
+        // a row of another sequence at the address an end_sequence row closes is kept
+        elfFuncInfo.AddrLines.Seal([](const LineAddrInfo &kept, const LineAddrInfo &appended)
+        {
+            return ((appended.Flags & LINE_FLAG_END_SEQUENCE) == 0) || ((kept.Flags & LINE_FLAG_END_SEQUENCE) != 0);
+        });
     }
 }
 
@@ -1777,6 +2238,7 @@ DwarfCuHdr Dwarf::readCompilationUnitHeader(const uint8_t *bin, const uint64_t s
     // Read Compilation Unit Header
     // ================================================
     DwarfCuHdr cuh;
+    uint64_t hdrTop = offset;
     uint32_t tmp = BinUtil::FromLeToUInt32(&bin[offset]);
     offset += 4;
     if (tmp < 0xFFFFFF00)
@@ -1795,11 +2257,14 @@ DwarfCuHdr Dwarf::readCompilationUnitHeader(const uint8_t *bin, const uint64_t s
 
     cuh.Version = BinUtil::FromLeToUInt16(&bin[offset]);
     offset += 2;
+
+    // debug_abbrev_offset size follows Dwarf format(4 or 8)
+    uint32_t abbrevOffsetSize = (cuh.DwarfFormat == DWARF_32BIT_FORMAT) ? 4 : 8;
     if (cuh.Version < 5)
     {
         // debug_abbrev_offset
         cuh.DebugAbbrevOffset = BinUtil::FromLeToUInt32(&bin[offset]);
-        offset += 4;
+        offset += abbrevOffsetSize;
 
         // address_size
         cuh.AddressSize = bin[offset];
@@ -1817,12 +2282,15 @@ DwarfCuHdr Dwarf::readCompilationUnitHeader(const uint8_t *bin, const uint64_t s
 
         // debug_abbrev_offset
         cuh.DebugAbbrevOffset = BinUtil::FromLeToUInt32(&bin[offset]);
-        offset += 4;
+        offset += abbrevOffsetSize;
 
         switch (cuh.UnitType)
         {
             case DW_UT_compile:
             case DW_UT_partial:
+                // no additional fields
+                break;
+
             case DW_UT_skeleton:
             case DW_UT_split_compile:
             {
@@ -1836,16 +2304,16 @@ DwarfCuHdr Dwarf::readCompilationUnitHeader(const uint8_t *bin, const uint64_t s
             {
                 cuh.TypeSignature = BinUtil::FromLeToUInt64(&bin[offset]);
                 offset += 8;
-                cuh.TypeSignature = BinUtil::FromLeToUInt64(&bin[offset]);
                 if (cuh.DwarfFormat == DWARF_32BIT_FORMAT)
                 {
                     tmp = BinUtil::FromLeToUInt32(&bin[offset]);
-                    offset += 8;
+                    offset += 4;
                     cuh.TypeOffset = tmp;
                 }
                 else
                 {
                     cuh.TypeOffset = BinUtil::FromLeToUInt64(&bin[offset]);
+                    offset += 8;
                 }
             }
             break;
@@ -1856,8 +2324,73 @@ DwarfCuHdr Dwarf::readCompilationUnitHeader(const uint8_t *bin, const uint64_t s
         }
     }
 
+    cuh.HeaderSize = offset - hdrTop;
     return cuh;
 }
+
+uint64_t Dwarf::getUnitSize(const DwarfCuHdr &cuh)
+{
+    // unit_length does not include the initial length field itself
+    if (cuh.DwarfFormat == DWARF_64BIT_FORMAT)
+    {
+        return cuh.UnitLength + 12;
+    }
+    return cuh.UnitLength + 4;
+}
+
+uint64_t Dwarf::readDieReference(const uint8_t *bin, const uint64_t end, const DwarfCuEntry &cuEntry, const uint64_t form, uint64_t &offset)
+{
+    // returns the referenced DIE as an offset in .debug_info
+    uint32_t len;
+    uint64_t val = 0;
+    switch (form)
+    {
+    case DW_FORM_ref1:
+        val = bin[offset];
+        offset += 1;
+        break;
+    case DW_FORM_ref2:
+        val = BinUtil::FromLeToUInt16(&bin[offset]);
+        offset += 2;
+        break;
+    case DW_FORM_ref4:
+        val = BinUtil::FromLeToUInt32(&bin[offset]);
+        offset += 4;
+        break;
+    case DW_FORM_ref8:
+        val = BinUtil::FromLeToUInt64(&bin[offset]);
+        offset += 8;
+        break;
+    case DW_FORM_ref_udata:
+        val = ReaduLEB128(&bin[offset], end - offset, len);
+        offset += len;
+        break;
+    case DW_FORM_ref_addr:
+        // offset from the top of .debug_info, the size is the address size in DWARF2
+        if (cuEntry.Header.Version <= 2)
+        {
+            val = (cuEntry.Header.AddressSize == 4) ? BinUtil::FromLeToUInt32(&bin[offset]) : BinUtil::FromLeToUInt64(&bin[offset]);
+            offset += cuEntry.Header.AddressSize;
+        }
+        else if (cuEntry.Header.DwarfFormat == DWARF_32BIT_FORMAT)
+        {
+            val = BinUtil::FromLeToUInt32(&bin[offset]);
+            offset += 4;
+        }
+        else
+        {
+            val = BinUtil::FromLeToUInt64(&bin[offset]);
+            offset += 8;
+        }
+        return val;
+    default:
+        break;
+    }
+
+    // the other forms are relative to the top of the unit
+    return cuEntry.Offset + val;
+}
+
 std::map<uint64_t, std::string> Dwarf::getTagNameMap()
 {
     std::map<uint64_t, std::string> tagNameMap;
@@ -2026,6 +2559,12 @@ std::map<uint64_t,std::string> Dwarf::getAttrNameMap()
     return attrNameMap;
 }
 
+const char *Dwarf::getName(const std::map<uint64_t, std::string> &nameMap, const uint64_t key)
+{
+    auto it = nameMap.find(key);
+    return (it != nameMap.end()) ? it->second.c_str() : "";
+}
+
 std::map<uint64_t, std::string> Dwarf::getLangNameMap()
 {
     std::map<uint64_t, std::string> langNameMap;
@@ -2068,3 +2607,516 @@ std::map<uint64_t, std::string> Dwarf::getLangNameMap()
 	langNameMap[DW_LANG_BLISS]          = "BLISS";
     return langNameMap;
 }
+
+DwarfDieIndex::DwarfDieIndex() :
+    _sortedCount(0)
+{
+}
+
+void DwarfDieIndex::Add(const DwarfDieRecord &record)
+{
+    _records.push_back(record);
+}
+
+void DwarfDieIndex::Seal()
+{
+    if (_sortedCount == _records.size())
+    {
+        return;
+    }
+
+    // DIEs of a unit are added in offset order, but units may be added in any order (lazy mode)
+    auto lessOffset = [](const DwarfDieRecord &a, const DwarfDieRecord &b)
+    {
+        return a.Offset < b.Offset;
+    };
+    auto mid = _records.begin() + _sortedCount;
+    if (!std::is_sorted(mid, _records.end(), lessOffset))
+    {
+        std::sort(mid, _records.end(), lessOffset);
+    }
+    std::inplace_merge(_records.begin(), mid, _records.end(), lessOffset);
+
+    // a unit decoded again after eviction adds the same DIEs twice
+    auto last = std::unique(_records.begin(), _records.end(), [](const DwarfDieRecord &a, const DwarfDieRecord &b)
+    {
+        return a.Offset == b.Offset;
+    });
+    _records.erase(last, _records.end());
+    _sortedCount = _records.size();
+}
+
+void DwarfDieIndex::Remove(const uint64_t begin, const uint64_t end)
+{
+    Seal();
+    auto lessOffset = [](const DwarfDieRecord &record, const uint64_t offset)
+    {
+        return record.Offset < offset;
+    };
+    auto first = std::lower_bound(_records.begin(), _records.end(), begin, lessOffset);
+    auto last = std::lower_bound(first, _records.end(), end, lessOffset);
+    _records.erase(first, last);
+    _sortedCount = _records.size();
+}
+
+const DwarfDieRecord *DwarfDieIndex::Find(const uint64_t dieOffset) const
+{
+    auto end = _records.begin() + _sortedCount;
+    auto it = std::lower_bound(_records.begin(), end, dieOffset, [](const DwarfDieRecord &record, const uint64_t offset)
+    {
+        return record.Offset < offset;
+    });
+    if ((it == end) || (it->Offset != dieOffset))
+    {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+bool DwarfDieIndex::ResolveName(const uint64_t dieOffset, const char *&name, const char *&linkageName) const
+{
+    // follow DW_AT_abstract_origin -> DW_AT_specification -> declaration
+    // the depth is limited in case of a broken reference loop
+    const int maxDepth = 8;
+    uint64_t refOffset = dieOffset;
+    for (int depth = 0; (depth < maxDepth) && (refOffset != 0); depth++)
+    {
+        const DwarfDieRecord *record = Find(refOffset);
+        if (record == nullptr)
+        {
+            break;
+        }
+        if ((name[0] == '\0') && (record->Name != nullptr))
+        {
+            name = record->Name;
+        }
+        if ((linkageName[0] == '\0') && (record->LinkageName != nullptr))
+        {
+            linkageName = record->LinkageName;
+        }
+        if ((name[0] != '\0') && (linkageName[0] != '\0'))
+        {
+            break;
+        }
+        refOffset = record->RefOffset;
+    }
+    return (name[0] != '\0');
+}
+
+void DwarfDieIndex::ResolveFixups(const std::vector<DwarfDieFixup> &fixups, DwarfCuDebugInfo &cuDbgInfo) const
+{
+    for (auto it = fixups.begin(); it != fixups.end(); it++)
+    {
+        auto funcIt = cuDbgInfo.Funcs.find(it->FuncAddr);
+        if (funcIt == cuDbgInfo.Funcs.end())
+        {
+            continue;
+        }
+
+        DwarfFuncInfo &dwarfFuncInfo = funcIt->second;
+        if (!ResolveName(it->RefOffset, dwarfFuncInfo.Name, dwarfFuncInfo.LinkageName))
+        {
+            // referenced DIE is in a unit not decoded yet
+            Logger::DLog("ref func not found offset:0x%x", it->RefOffset);
+            cuDbgInfo.Funcs.erase(funcIt);
+            continue;
+        }
+        Logger::TLog("resolved name:%s, linkageName:%s addr:0x%X\n", dwarfFuncInfo.Name, dwarfFuncInfo.LinkageName, dwarfFuncInfo.Addr);
+    }
+}
+
+size_t DwarfDieIndex::Size() const
+{
+    return _records.size();
+}
+
+DwarfAbbrevTable::DwarfAbbrevTable(Arena *arena) :
+    _entries(ArenaAllocator<DwarfAbbrevEntry>(arena)),
+    _attrs(ArenaAllocator<AbbrevAttr>(arena)),
+    _idxs(ArenaAllocator<int32_t>(arena))
+{
+}
+
+void DwarfAbbrevTable::Read(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgAbbrevShdr, const uint64_t dbgAbbrevOffset)
+{
+    uint64_t offset     = dbgAbbrevOffset;
+    uint64_t secEndPos  = dbgAbbrevShdr.sh_offset + dbgAbbrevShdr.sh_size;
+    while (offset < secEndPos)
+    {
+        DwarfAbbrevEntry entry;
+        uint32_t len;
+        entry.Id = Dwarf::ReaduLEB128(&bin[offset], secEndPos - offset, len);
+        offset += len;
+        if (entry.Id == 0)
+        {
+            // Abbreviations Tables end with an entry consisting of a 0 byte for the abbreviation code.
+            break;
+        }
+
+        entry.Tag = Dwarf::ReaduLEB128(&bin[offset], secEndPos - offset, len);
+        offset += len;
+        entry.HasChildren = (bin[offset] == DW_CHILDREN_yes);
+        offset++;
+        entry.AttrIdx = _attrs.size();
+
+        // Read Attributes
+        while (offset < secEndPos)
+        {
+            AbbrevAttr attr;
+            attr.Attr = Dwarf::ReaduLEB128(&bin[offset], secEndPos - offset, len);
+            offset += len;
+            attr.Form = Dwarf::ReaduLEB128(&bin[offset], secEndPos - offset, len);
+            offset += len;
+            attr.Const = 0;
+            if ((attr.Attr == 0) && (attr.Form == 0))
+            {
+                break;
+            }
+
+            // DWARF5 or later, FORM special case
+            if (attr.Form == DW_FORM_implicit_const)
+            {
+                attr.Const = Dwarf::ReaduLEB128(&bin[offset], secEndPos - offset, len);
+                offset += len;
+            }
+            _attrs.push_back(attr);
+        }
+        entry.AttrCount = _attrs.size() - entry.AttrIdx;
+
+        // codes out of range are searched linearly
+        if (entry.Id < 0x10000)
+        {
+            if (_idxs.size() <= entry.Id)
+            {
+                _idxs.resize(entry.Id + 1, -1);
+            }
+            _idxs[entry.Id] = _entries.size();
+        }
+        _entries.push_back(entry);
+    }
+
+    Stats::Count(STATS_COUNTER_ABBREV_TBL, 1);
+}
+
+const DwarfAbbrevEntry *DwarfAbbrevTable::Find(const uint64_t id) const
+{
+    if (id < _idxs.size())
+    {
+        return (0 <= _idxs[id]) ? &_entries[_idxs[id]] : nullptr;
+    }
+    for (auto it = _entries.begin(); it != _entries.end(); it++)
+    {
+        if (it->Id == id)
+        {
+            return &(*it);
+        }
+    }
+    return nullptr;
+}
+
+const AbbrevAttr *DwarfAbbrevTable::GetAttrs(const DwarfAbbrevEntry &entry) const
+{
+    return _attrs.data() + entry.AttrIdx;
+}
+
+const ArenaVector<DwarfAbbrevEntry> &DwarfAbbrevTable::Entries() const
+{
+    return _entries;
+}
+
+DwarfDieReader::DwarfDieReader(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry) :
+    _bin(bin),
+    _size(size),
+    _dbgInfoShdr(dbgInfoShdr),
+    _dbgStrShdr(dbgStrShdr),
+    _dbgLineStrShdr(dbgLineStrShdr),
+    _cuEntry(cuEntry),
+    _arena(16 * 1024),
+    _abbrevTbl(&_arena),
+    _depth(0),
+    _failed(false)
+{
+    uint64_t cuTop = dbgInfoShdr.sh_offset + cuEntry.Offset;
+    _offset = cuTop + cuEntry.Header.HeaderSize;
+    _end    = cuTop + cuEntry.Header.UnitLength + ((cuEntry.Header.DwarfFormat == DWARF_64BIT_FORMAT) ? 12 : 4);
+    if (dbgInfoShdr.sh_offset + dbgInfoShdr.sh_size < _end)
+    {
+        _end = dbgInfoShdr.sh_offset + dbgInfoShdr.sh_size;
+    }
+
+    _abbrevTbl.Read(bin, size, dbgAbbrevShdr, dbgAbbrevShdr.sh_offset + cuEntry.Header.DebugAbbrevOffset);
+}
+
+bool DwarfDieReader::Next(DwarfDie &die)
+{
+    uint32_t len;
+    while (!_failed && (_offset < _end))
+    {
+        uint64_t dieOffset = _offset - _dbgInfoShdr.sh_offset;
+        uint64_t id = Dwarf::ReaduLEB128(&_bin[_offset], _end - _offset, len);
+        _offset += len;
+        if (id == 0)
+        {
+            // end of siblings
+            if (0 < _depth)
+            {
+                _depth--;
+            }
+            continue;
+        }
+
+        const DwarfAbbrevEntry *abbrev = _abbrevTbl.Find(id);
+        if (abbrev == nullptr)
+        {
+            Logger::DLog("unknown abbrev code:%d at 0x%x", id, dieOffset);
+            _failed = true;
+            return false;
+        }
+
+        die.Offset = dieOffset;
+        die.Tag = abbrev->Tag;
+        die.HasChildren = abbrev->HasChildren;
+        die.Depth = _depth;
+        die.Attrs.clear();
+        const AbbrevAttr *attrs = _abbrevTbl.GetAttrs(*abbrev);
+        for (uint32_t i = 0; i < abbrev->AttrCount; i++)
+        {
+            DwarfAttrValue value;
+            if (!readAttrValue(attrs[i].Form, attrs[i], value))
+            {
+                Logger::DLog("unknown form:0x%x at 0x%x", attrs[i].Form, dieOffset);
+                _failed = true;
+                return false;
+            }
+            die.Attrs.push_back(std::make_pair(attrs[i].Attr, value));
+        }
+
+        if (abbrev->HasChildren)
+        {
+            _depth++;
+        }
+        return true;
+    }
+    return false;
+}
+
+uint64_t DwarfDieReader::Position() const
+{
+    return _offset - _dbgInfoShdr.sh_offset;
+}
+
+bool DwarfDieReader::Failed() const
+{
+    return _failed;
+}
+
+bool DwarfDieReader::readAttrValue(uint64_t form, const AbbrevAttr &attr, DwarfAttrValue &value)
+{
+    const DwarfCuHdr &cuh = _cuEntry.Header;
+    uint32_t len;
+    value.Class = DWARF_VALUE_NONE;
+    value.IsSigned = false;
+    value.UData = 0;
+    value.SData = 0;
+    value.Str = nullptr;
+    value.Block = nullptr;
+    value.BlockLen = 0;
+
+    switch (form)
+    {
+    case DW_FORM_addr:
+        value.Class = DWARF_VALUE_ADDRESS;
+        value.UData = (cuh.AddressSize == 4) ? BinUtil::FromLeToUInt32(&_bin[_offset]) : BinUtil::FromLeToUInt64(&_bin[_offset]);
+        _offset += cuh.AddressSize;
+        return true;
+    case DW_FORM_data1:
+    case DW_FORM_ref1:
+    case DW_FORM_flag:
+    case DW_FORM_strx1:
+    case DW_FORM_addrx1:
+        value.UData = _bin[_offset];
+        _offset += 1;
+        break;
+    case DW_FORM_data2:
+    case DW_FORM_ref2:
+    case DW_FORM_strx2:
+    case DW_FORM_addrx2:
+        value.UData = BinUtil::FromLeToUInt16(&_bin[_offset]);
+        _offset += 2;
+        break;
+    case DW_FORM_strx3:
+    case DW_FORM_addrx3:
+        value.UData = _bin[_offset] + ((uint64_t)_bin[_offset + 1] << 8) + ((uint64_t)_bin[_offset + 2] << 16);
+        _offset += 3;
+        break;
+    case DW_FORM_data4:
+    case DW_FORM_ref4:
+    case DW_FORM_ref_sup4:
+    case DW_FORM_strx4:
+    case DW_FORM_addrx4:
+        value.UData = BinUtil::FromLeToUInt32(&_bin[_offset]);
+        _offset += 4;
+        break;
+    case DW_FORM_data8:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_sig8:
+    case DW_FORM_ref_sup8:
+        value.UData = BinUtil::FromLeToUInt64(&_bin[_offset]);
+        _offset += 8;
+        break;
+    case DW_FORM_data16:
+        value.Class = DWARF_VALUE_BLOCK;
+        value.Block = &_bin[_offset];
+        value.BlockLen = 16;
+        _offset += 16;
+        return true;
+    case DW_FORM_sdata:
+        value.Class = DWARF_VALUE_CONSTANT;
+        value.IsSigned = true;
+        value.SData = Dwarf::ReadsLEB128(&_bin[_offset], _end - _offset, len);
+        value.UData = (uint64_t)value.SData;
+        _offset += len;
+        return true;
+    case DW_FORM_implicit_const:
+        value.Class = DWARF_VALUE_CONSTANT;
+        value.IsSigned = true;
+        value.SData = (int64_t)attr.Const;
+        value.UData = attr.Const;
+        return true;
+    case DW_FORM_udata:
+    case DW_FORM_ref_udata:
+    case DW_FORM_strx:
+    case DW_FORM_addrx:
+    case DW_FORM_loclistx:
+    case DW_FORM_rnglistx:
+        value.UData = Dwarf::ReaduLEB128(&_bin[_offset], _end - _offset, len);
+        _offset += len;
+        break;
+    case DW_FORM_string:
+        value.Class = DWARF_VALUE_STRING;
+        value.Str = (const char *)&_bin[_offset];
+        while ((_offset < _end) && (_bin[_offset] != 0))
+        {
+            _offset++;
+        }
+        _offset++;
+        return true;
+    case DW_FORM_strp:
+        value.Class = DWARF_VALUE_STRING;
+        value.Str = getString(_dbgStrShdr, readOffset());
+        return true;
+    case DW_FORM_line_strp:
+        value.Class = DWARF_VALUE_STRING;
+        value.Str = getString(_dbgLineStrShdr, readOffset());
+        return true;
+    case DW_FORM_ref_addr:
+        value.Class = DWARF_VALUE_REFERENCE;
+        if (cuh.Version <= 2)
+        {
+            value.UData = (cuh.AddressSize == 4) ? BinUtil::FromLeToUInt32(&_bin[_offset]) : BinUtil::FromLeToUInt64(&_bin[_offset]);
+            _offset += cuh.AddressSize;
+        }
+        else
+        {
+            value.UData = readOffset();
+        }
+        return true;
+    case DW_FORM_sec_offset:
+    case DW_FORM_strp_sup:
+        value.Class = DWARF_VALUE_SEC_OFFSET;
+        value.UData = readOffset();
+        return true;
+    case DW_FORM_block1:
+        value.BlockLen = _bin[_offset];
+        _offset += 1;
+        break;
+    case DW_FORM_block2:
+        value.BlockLen = BinUtil::FromLeToUInt16(&_bin[_offset]);
+        _offset += 2;
+        break;
+    case DW_FORM_block4:
+        value.BlockLen = BinUtil::FromLeToUInt32(&_bin[_offset]);
+        _offset += 4;
+        break;
+    case DW_FORM_block:
+    case DW_FORM_exprloc:
+        value.BlockLen = Dwarf::ReaduLEB128(&_bin[_offset], _end - _offset, len);
+        _offset += len;
+        break;
+    case DW_FORM_flag_present:
+        value.Class = DWARF_VALUE_FLAG;
+        value.UData = 1;
+        return true;
+    case DW_FORM_indirect:
+    {
+        uint64_t indirectForm = Dwarf::ReaduLEB128(&_bin[_offset], _end - _offset, len);
+        _offset += len;
+        return readAttrValue(indirectForm, attr, value);
+    }
+    default:
+        return false;
+    }
+
+    switch (form)
+    {
+    case DW_FORM_data1:
+    case DW_FORM_data2:
+    case DW_FORM_data4:
+    case DW_FORM_data8:
+    case DW_FORM_udata:
+        value.Class = DWARF_VALUE_CONSTANT;
+        break;
+    case DW_FORM_flag:
+        value.Class = DWARF_VALUE_FLAG;
+        break;
+    case DW_FORM_ref1:
+    case DW_FORM_ref2:
+    case DW_FORM_ref4:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_udata:
+        // relative to the top of the unit
+        value.Class = DWARF_VALUE_REFERENCE;
+        value.UData += _cuEntry.Offset;
+        break;
+    case DW_FORM_block1:
+    case DW_FORM_block2:
+    case DW_FORM_block4:
+    case DW_FORM_block:
+    case DW_FORM_exprloc:
+        value.Class = DWARF_VALUE_BLOCK;
+        value.Block = &_bin[_offset];
+        _offset += value.BlockLen;
+        break;
+    default:
+        // strx / addrx / loclistx / rnglistx / ref_sig8 / ref_sup: tables which are not read
+        value.Class = DWARF_VALUE_NONE;
+        break;
+    }
+    return true;
+}
+
+const char *DwarfDieReader::getString(const Elf64_Shdr &strShdr, const uint64_t strOffset) const
+{
+    if ((strShdr.sh_size <= strOffset) || (_size < strShdr.sh_offset + strShdr.sh_size))
+    {
+        return nullptr;
+    }
+    return (const char *)&_bin[strShdr.sh_offset + strOffset];
+}
+
+uint64_t DwarfDieReader::readOffset()
+{
+    // section offset, 4 or 8 bytes by DWARF format
+    uint64_t val;
+    if (_cuEntry.Header.DwarfFormat == DWARF_64BIT_FORMAT)
+    {
+        val = BinUtil::FromLeToUInt64(&_bin[_offset]);
+        _offset += 8;
+    }
+    else
+    {
+        val = BinUtil::FromLeToUInt32(&_bin[_offset]);
+        _offset += 4;
+    }
+    return val;
+}
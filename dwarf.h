@@ -7,6 +7,10 @@
 #include <filesystem>
 
 #include "common.h"
+#include "arena.h"
+#include "flat_map.h"
+
+class SourceLineIndex;
 
 const uint32_t DWARF_32BIT_FORMAT = 0x01;
 const uint32_t DWARF_64BIT_FORMAT = 0x02;
@@ -323,6 +327,19 @@ enum
 	DW_CHILDREN_yes = 0x01,
 };
 
+// DWARF5 7.25 Range List Entries (.debug_rnglists)
+enum
+{
+    DW_RLE_end_of_list      = 0x00,
+    DW_RLE_base_addressx    = 0x01,
+    DW_RLE_startx_endx      = 0x02,
+    DW_RLE_startx_length    = 0x03,
+    DW_RLE_offset_pair      = 0x04,
+    DW_RLE_base_address     = 0x05,
+    DW_RLE_start_end        = 0x06,
+    DW_RLE_start_length     = 0x07,
+};
+
 // ============================================================================
 // DW_OP
 // ============================================================================
@@ -538,8 +555,17 @@ typedef struct
 	uint64_t UnitID;
 	uint64_t TypeSignature;
 	uint64_t TypeOffset;
+	uint8_t HeaderSize;         // offset of the first DIE from the unit top
 } DwarfCuHdr;
 
+// Location of a unit in .debug_info
+// only headers are read eagerly, DIEs are decoded on demand
+struct DwarfCuEntry
+{
+    uint64_t Offset;            // offset of the unit header in .debug_info
+    DwarfCuHdr Header;
+};
+
 // Line Number Program Header
 // see 6.2.4 The Line Number Program Header
 struct FileNameInfo
@@ -583,11 +609,15 @@ struct DwarfLineInfoHdr
     std::vector<FileNameInfo> Files;
 };
 
+// key: offset of unit in .debug_line (DW_AT_stmt_list)
+typedef FlatMap<uint64_t, DwarfLineInfoHdr> DwarfLineInfoMap;
+
+// Names point into the mapped .debug_str / .debug_info, "" when the DIE has none
 struct DwarfFuncInfo
 {
     std::string SrcFilePath;
-    std::string Name;
-    std::string LinkageName;
+    const char *Name;
+    const char *LinkageName;
     uint64_t Addr;
     uint32_t Size;
 };
@@ -607,11 +637,15 @@ public:
     };
 
 public:
+    uint64_t Offset;            // offset of the unit header in .debug_info
+    uint64_t LineInfoOffset;    // DW_AT_stmt_list, offset in .debug_line
+    bool HasLineInfo;           // DW_AT_stmt_list exists
     std::string FileName;
     std::string Producer;
     std::string Language;
     std::string CompileDir;
-    std::map<uint64_t, DwarfFuncInfo> Funcs;
+    uint32_t FileId;            // (CompileDir, FileName) in the file table, 0: not interned
+    FlatMap<uint64_t, DwarfFuncInfo> Funcs;    // key: function address
 };
 
 struct DwarfSegmentInfo
@@ -645,6 +679,33 @@ struct Abbrev
     std::vector<AbbrevAttr> Attrs;
 };
 
+// Abbreviation of DwarfAbbrevTable, its attributes are AttrCount entries from AttrIdx
+struct DwarfAbbrevEntry
+{
+    uint64_t Id;
+    uint64_t Tag;
+    bool HasChildren;
+    uint32_t AttrIdx;
+    uint32_t AttrCount;
+};
+
+// Abbreviation table of one unit in flat arrays allocated from an Arena
+// abbrev codes are usually 1, 2, 3... so they are looked up by index instead of std::map
+class DwarfAbbrevTable
+{
+public:
+    DwarfAbbrevTable(Arena *arena);
+    void Read(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgAbbrevShdr, const uint64_t dbgAbbrevOffset);
+    const DwarfAbbrevEntry *Find(const uint64_t id) const;
+    const AbbrevAttr *GetAttrs(const DwarfAbbrevEntry &entry) const;
+    const ArenaVector<DwarfAbbrevEntry> &Entries() const;
+
+private:
+    ArenaVector<DwarfAbbrevEntry> _entries;
+    ArenaVector<AbbrevAttr> _attrs;
+    ArenaVector<int32_t> _idxs;             // key: abbrev code, value: Index of _entries, -1: none
+};
+
 struct LineNumberStateMachine
 {
 public:
@@ -657,7 +718,10 @@ public:
         BasicBlock(false),
         EndSequence(false),
         PrologueEnd(false),
-        Isa(0)
+        EpilogueBegin(false),
+        Isa(0),
+        Discriminator(0),
+        View(0)
     {
         IsStmt = (defaultIsStmt == 1);
     };
@@ -674,6 +738,40 @@ public:
     bool EpilogueBegin;     // A boolean indicating that the current address is one (of possibly many) where execution should be suspended for an exit breakpoint of a function.
     uint64_t Isa;           // An unsigned integer whose value encodes the applicable instruction set architecture for the current instruction.
     uint64_t Discriminator; // An unsigned integer identifying the block to which the current instruction belongs.
+    uint64_t View;          // Rows already appended at the current address (DWARF 5 6.2.5.1, location views).
+};
+
+// Effect of one opcode on the line number state machine, precomputed per line table header
+struct DwarfLineOp
+{
+    uint32_t AddrAdvance;   // bytes, operation advance x minimum_instruction_length
+    int32_t LineAdvance;
+    bool EmitsRow;          // special opcode, standard and extended opcodes are decoded one by one
+};
+
+struct DwarfLineOpTable
+{
+    DwarfLineOp Ops[256];   // Index: opcode
+    uint64_t ConstAddPc;    // address advance of DW_LNS_const_add_pc (special opcode 255)
+};
+
+// Row of the line number matrix, kept until the rows of its program are added to the functions
+struct DwarfLineRow
+{
+    uint64_t Address;
+    uint32_t Line;
+    uint32_t File;          // file index of the line table header
+    uint32_t Discriminator;
+    uint16_t Column;
+    uint8_t View;
+    uint8_t Flags;          // LINE_FLAG_*
+};
+
+// address range of DW_AT_ranges, [Low, High)
+struct DwarfRange
+{
+    uint64_t Low;
+    uint64_t High;
 };
 
 struct DwarfArangeInfo
@@ -682,21 +780,162 @@ struct DwarfArangeInfo
     std::vector<DwarfSegmentInfo> Segments;
 };
 
+// key: offset of unit in .debug_info
+typedef FlatMap<uint64_t, DwarfArangeInfo> DwarfArangeMap;
+
+// Address range of a compilation unit (from .debug_aranges)
+struct DwarfCuRange
+{
+    uint64_t Start;
+    uint64_t End;
+    uint32_t CuIdx;
+};
+
+// Class of a decoded attribute value
+enum
+{
+    DWARF_VALUE_NONE        = 0x00,     // value is skipped (e.g. index into a table not supported)
+    DWARF_VALUE_ADDRESS     = 0x01,     // UData
+    DWARF_VALUE_CONSTANT    = 0x02,     // UData (SData for sdata / implicit_const)
+    DWARF_VALUE_STRING      = 0x03,     // Str
+    DWARF_VALUE_REFERENCE   = 0x04,     // UData, offset of the referenced DIE in .debug_info
+    DWARF_VALUE_BLOCK       = 0x05,     // Block, BlockLen (block / exprloc)
+    DWARF_VALUE_FLAG        = 0x06,     // UData
+    DWARF_VALUE_SEC_OFFSET  = 0x07,     // UData
+};
+
+struct DwarfAttrValue
+{
+    uint8_t Class;
+    bool IsSigned;              // SData is valid
+    uint64_t UData;
+    int64_t SData;
+    const char *Str;            // points into the mapped file
+    const uint8_t *Block;
+    uint64_t BlockLen;
+};
+
+// DIE with every attribute decoded
+struct DwarfDie
+{
+    uint64_t Offset;            // offset of the DIE in .debug_info
+    uint64_t Tag;
+    bool HasChildren;
+    uint32_t Depth;             // 0: unit DIE
+    std::vector<std::pair<uint64_t, DwarfAttrValue>> Attrs;     // first: DW_AT_*
+
+    const DwarfAttrValue *Find(const uint64_t attr) const
+    {
+        for (auto it = Attrs.begin(); it != Attrs.end(); it++)
+        {
+            if (it->first == attr)
+            {
+                return &it->second;
+            }
+        }
+        return nullptr;
+    };
+};
+
+// Sequential reader of the DIEs of one unit
+// Unlike ReadCuDebugInfo, every form is decoded into DwarfAttrValue and nothing is logged,
+// so this is the reader to use when only some tags are interesting.
+class DwarfDieReader
+{
+public:
+    DwarfDieReader(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry);
+    bool Next(DwarfDie &die);
+    uint64_t Position() const;
+    bool Failed() const;
+
+private:
+    bool readAttrValue(uint64_t form, const AbbrevAttr &attr, DwarfAttrValue &value);
+    const char *getString(const Elf64_Shdr &strShdr, const uint64_t strOffset) const;
+    uint64_t readOffset();
+
+private:
+    const uint8_t *_bin;
+    uint64_t _size;
+    Elf64_Shdr _dbgInfoShdr;
+    Elf64_Shdr _dbgStrShdr;
+    Elf64_Shdr _dbgLineStrShdr;
+    DwarfCuEntry _cuEntry;
+    Arena _arena;                           // abbrev table of the unit
+    DwarfAbbrevTable _abbrevTbl;
+    uint64_t _offset;                       // position in the file
+    uint64_t _end;
+    uint32_t _depth;
+    bool _failed;
+};
+
+// Subprogram DIE which may be referenced by DW_AT_specification / DW_AT_abstract_origin
+// Names point into the mapped .debug_str / .debug_info, so no string is copied.
+struct DwarfDieRecord
+{
+    uint64_t Offset;            // offset of the DIE in .debug_info
+    uint64_t RefOffset;         // DW_AT_specification / DW_AT_abstract_origin of this DIE, 0: none
+    const char *Name;           // nullptr: no DW_AT_name
+    const char *LinkageName;    // nullptr: no DW_AT_linkage_name
+};
+
+// Function whose name is taken from another DIE once every unit is scanned
+struct DwarfDieFixup
+{
+    uint64_t RefOffset;         // referenced DIE, offset in .debug_info
+    uint64_t FuncAddr;          // key of DwarfCuDebugInfo::Funcs
+};
+
+// DIE offset index shared across compilation units
+// Records are appended while units are scanned and sorted by Seal(),
+// so references to DIEs which appear later or in another unit are resolved after the scan.
+class DwarfDieIndex
+{
+public:
+    DwarfDieIndex();
+    void Add(const DwarfDieRecord &record);
+    void Seal();
+    // drop the DIEs in [begin, end) of .debug_info, the records of an evicted unit
+    void Remove(const uint64_t begin, const uint64_t end);
+    const DwarfDieRecord *Find(const uint64_t dieOffset) const;
+    bool ResolveName(const uint64_t dieOffset, const char *&name, const char *&linkageName) const;
+    void ResolveFixups(const std::vector<DwarfDieFixup> &fixups, DwarfCuDebugInfo &cuDbgInfo) const;
+    size_t Size() const;
+
+private:
+    std::vector<DwarfDieRecord> _records;   // sorted by Offset up to _sortedCount
+    size_t _sortedCount;
+};
+
 class Dwarf
 {
 public:
     static uint64_t ReaduLEB128(const uint8_t *bin, const uint64_t size, uint32_t &len);
     static int64_t ReadsLEB128(const uint8_t *bin, const uint64_t size, uint32_t &len);
-    static std::map<uint64_t, DwarfArangeInfo> ReadAranges(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &arrangesShdr);
+    static DwarfArangeMap ReadAranges(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &arrangesShdr);
+    static std::vector<DwarfCuRange> GetCuRanges(const DwarfArangeMap &offsetArangeMap, const std::vector<uint64_t> &cuOffsets);
+    static bool FindCuIdx(const std::vector<DwarfCuRange> &cuRanges, const uint64_t addr, uint32_t &cuIdx);
     static std::vector<Abbrev> ReadAbbrevTbl(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgAbbrevShdr, const uint64_t dbgAbbrevOffset);
+    static bool ReadRanges(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &rangesShdr, const DwarfCuHdr &cuh, const uint64_t rangesOffset, const uint64_t baseAddr, std::vector<DwarfRange> &ranges);
+    static bool ReadDieRanges(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &rangesShdr, const DwarfCuHdr &cuh, const DwarfDie &die, const uint64_t baseAddr, std::vector<DwarfRange> &ranges);
+    static uint32_t LinkFragments(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, ElfFunctionTable &elfFuncTable, const unsigned threadCount);
 
-    static std::map<uint64_t, DwarfLineInfoHdr> ReadLineInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, ElfFunctionTable &elfFuncTable);
-    static std::vector<DwarfCuDebugInfo> ReadDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, std::map<uint64_t, DwarfArangeInfo> &offsetArangeMap, std::map<uint64_t, DwarfLineInfoHdr> &offsetLineInfoMap);
+    static DwarfLineInfoMap ReadLineInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, ElfFunctionTable &elfFuncTable, unsigned threadCount = 0, SourceLineIndex *lineIndex = nullptr);
+    static DwarfLineInfoHdr ReadLineInfoAt(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, const uint64_t lineInfoOffset, ElfFunctionTable &elfFuncTable);
+    static std::vector<DwarfCuDebugInfo> ReadDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, DwarfArangeMap &offsetArangeMap, DwarfLineInfoMap &offsetLineInfoMap, FileTable &fileTable);
+    static std::vector<DwarfCuEntry> ReadCuHeaders(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr);
+    static DwarfCuDebugInfo ReadCuDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry, DwarfLineInfoMap &offsetLineInfoMap, DwarfDieIndex &dieIndex);
 private:
-	static void readLineNumberProgram(const uint8_t *bin, const uint64_t size, const std::string &fileName, const DwarfLineInfoHdr &lineInfoHdr, const uint64_t lnpStart, const uint64_t lnpEnd, ElfFunctionTable &elfFuncTable);
-    static void addFuncAddrLineInfo(const DwarfLineInfoHdr &lineInfoHdr, LineNumberStateMachine lnsm, const uint64_t funcAddr, ElfFunctionTable &elfFuncTable);
+    static DwarfLineInfoHdr readLineInfoUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &debugLineShdr, const Elf64_Shdr &debugLineStrShdr, const uint64_t hdrOffset, std::vector<DwarfLineRow> &rows);
+    static DwarfCuDebugInfo readCuDebugInfo(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry, DwarfLineInfoMap &offsetLineInfoMap, DwarfDieIndex &dieIndex, std::vector<DwarfDieFixup> &fixups, Arena &arena);
+    static uint64_t readDieReference(const uint8_t *bin, const uint64_t end, const DwarfCuEntry &cuEntry, const uint64_t form, uint64_t &offset);
+	static void readLineNumberProgram(const uint8_t *bin, const uint64_t size, const std::string &fileName, const DwarfLineInfoHdr &lineInfoHdr, const uint64_t lnpStart, const uint64_t lnpEnd, std::vector<DwarfLineRow> &rows);
+    static void buildLineOpTable(const DwarfLineInfoHdr &lineInfoHdr, DwarfLineOpTable &opTable);
+    static void addLineRows(const DwarfLineInfoHdr &lineInfoHdr, const std::vector<DwarfLineRow> &rows, ElfFunctionTable &elfFuncTable, SourceLineIndex *lineIndex, std::vector<uint32_t> &funcIdxs);
+    static void sealLineAddrs(ElfFunctionTable &elfFuncTable, std::vector<uint32_t> &funcIdxs);
     static DwarfCuHdr readCompilationUnitHeader(const uint8_t *bin, const uint64_t size, uint64_t offset);
+    static uint64_t getUnitSize(const DwarfCuHdr &cuh);
     static std::map<uint64_t, std::string> getTagNameMap();
     static std::map<uint64_t, std::string> getAttrNameMap();
     static std::map<uint64_t, std::string> getLangNameMap();
+    static const char *getName(const std::map<uint64_t, std::string> &nameMap, const uint64_t key);
 };
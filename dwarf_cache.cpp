@@ -0,0 +1,230 @@
+#include <algorithm>
+#include "dwarf_cache.h"
+#include "logger.h"
+
+DwarfCuCache::DwarfCuCache(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfArangeMap &offsetArangeMap, ElfFunctionTable &elfFuncTable, const size_t capacity) :
+    _bin(bin),
+    _size(size),
+    _dbgInfoShdr(dbgInfoShdr),
+    _dbgStrShdr(dbgStrShdr),
+    _dbgLineShdr(dbgLineShdr),
+    _dbgLineStrShdr(dbgLineStrShdr),
+    _dbgAbbrevShdr(dbgAbbrevShdr),
+    _elfFuncTable(elfFuncTable),
+    _capacity(capacity),
+    _memoryBudget(0),
+    _memoryUsage(0),
+    _evictedCount(0)
+{
+    if (_capacity == 0)
+    {
+        _capacity = 1;
+    }
+
+    // units are read in offset order
+    _cuEntries = Dwarf::ReadCuHeaders(bin, size, dbgInfoShdr);
+    std::vector<uint64_t> cuOffsets;
+    for (auto it = _cuEntries.begin(); it != _cuEntries.end(); it++)
+    {
+        cuOffsets.push_back(it->Offset);
+    }
+    _cuRanges = Dwarf::GetCuRanges(offsetArangeMap, cuOffsets);
+}
+
+void DwarfCuCache::SetMemoryBudget(const uint64_t memoryBudget)
+{
+    _memoryBudget = memoryBudget;
+    while ((_memoryBudget != 0) && (_memoryBudget < _memoryUsage) && !_lruList.empty())
+    {
+        evict();
+    }
+}
+
+bool DwarfCuCache::FindCuIdx(const uint64_t addr, uint32_t &cuIdx) const
+{
+    return Dwarf::FindCuIdx(_cuRanges, addr, cuIdx);
+}
+
+const DwarfCuCacheEntry &DwarfCuCache::GetCu(const uint32_t cuIdx)
+{
+    auto it = _decodedCus.find(cuIdx);
+    if (it != _decodedCus.end())
+    {
+        // move to the front of LRU list
+        _lruList.splice(_lruList.begin(), _lruList, it->second.LruPos);
+        return it->second;
+    }
+
+    while (_capacity <= _decodedCus.size())
+    {
+        evict();
+    }
+
+    decodeCu(cuIdx);
+
+    // keep the unit just decoded even if it alone is over the budget
+    while ((_memoryBudget != 0) && (_memoryBudget < _memoryUsage) && (1 < _lruList.size()))
+    {
+        evict();
+    }
+    return _decodedCus[cuIdx];
+}
+
+const std::vector<DwarfCuEntry> &DwarfCuCache::CuEntries() const
+{
+    return _cuEntries;
+}
+
+size_t DwarfCuCache::DecodedCount() const
+{
+    return _decodedCus.size();
+}
+
+uint64_t DwarfCuCache::MemoryUsage() const
+{
+    return _memoryUsage;
+}
+
+uint64_t DwarfCuCache::EvictedCount() const
+{
+    return _evictedCount;
+}
+
+void DwarfCuCache::decodeCu(const uint32_t cuIdx)
+{
+    Logger::TLog("decodeCu In... cuIdx:%d", cuIdx);
+    const DwarfCuEntry &cuEntry = _cuEntries[cuIdx];
+    DwarfCuCacheEntry &cacheEntry = _decodedCus[cuIdx];
+
+    // line number information is not decoded yet, so no line info header is given here
+    DwarfLineInfoMap offsetLineInfoMap;
+    size_t dieCount = _dieIndex.Size();
+    cacheEntry.DebugInfo = Dwarf::ReadCuDebugInfo(_bin, _size, _dbgInfoShdr, _dbgStrShdr, _dbgLineStrShdr, _dbgAbbrevShdr, cuEntry, offsetLineInfoMap, _dieIndex);
+    cacheEntry.DebugInfo.FileId = _elfFuncTable.Files.Intern(cacheEntry.DebugInfo.CompileDir, cacheEntry.DebugInfo.FileName);
+    if (cacheEntry.DebugInfo.HasLineInfo)
+    {
+        cacheEntry.LineInfoHdr = Dwarf::ReadLineInfoAt(_bin, _size, _dbgLineShdr, _dbgLineStrShdr, cacheEntry.DebugInfo.LineInfoOffset, _elfFuncTable);
+    }
+
+    cacheEntry.FuncIdxs = getCuFuncIdxs(cuIdx);
+    cacheEntry.MemorySize = estimateSize(cacheEntry.DebugInfo) + estimateSize(cacheEntry.LineInfoHdr);
+    cacheEntry.MemorySize += (_dieIndex.Size() - dieCount) * sizeof(DwarfDieRecord);
+    for (auto it = cacheEntry.FuncIdxs.begin(); it != cacheEntry.FuncIdxs.end(); it++)
+    {
+        cacheEntry.MemorySize += estimateSize(_elfFuncTable.ElfFuncInfos[*it]);
+    }
+    _memoryUsage += cacheEntry.MemorySize;
+
+    _lruList.push_front(cuIdx);
+    cacheEntry.LruPos = _lruList.begin();
+    Logger::TLog("decodeCu Out...");
+}
+
+void DwarfCuCache::evict()
+{
+    if (_lruList.empty())
+    {
+        return;
+    }
+
+    uint32_t cuIdx = _lruList.back();
+    _lruList.pop_back();
+
+    // line rows are decoded again from the mapped file when the unit is touched next time
+    DwarfCuCacheEntry &cacheEntry = _decodedCus[cuIdx];
+    for (auto it = cacheEntry.FuncIdxs.begin(); it != cacheEntry.FuncIdxs.end(); it++)
+    {
+        FlatMap<uint64_t, LineAddrInfo>().swap(_elfFuncTable.ElfFuncInfos[*it].LineAddrs);
+        FlatMap<uint64_t, LineAddrInfo>().swap(_elfFuncTable.ElfFuncInfos[*it].AddrLines);
+    }
+    // names already resolved point into the mapped file, only later references to the unit need its DIEs
+    _dieIndex.Remove(_cuEntries[cuIdx].Offset, getCuEnd(cuIdx));
+    _memoryUsage -= cacheEntry.MemorySize;
+    _decodedCus.erase(cuIdx);
+    _evictedCount++;
+    Logger::TLog("evict cuIdx:%d", cuIdx);
+}
+
+std::vector<uint32_t> DwarfCuCache::getCuFuncIdxs(const uint32_t cuIdx) const
+{
+    std::vector<uint32_t> funcIdxs;
+    const FlatMap<uint64_t, uint32_t> &addrFuncIdxMap = _elfFuncTable.AddrFuncIdxMap;
+    for (auto rangeIt = _cuRanges.begin(); rangeIt != _cuRanges.end(); rangeIt++)
+    {
+        if (rangeIt->CuIdx != cuIdx)
+        {
+            continue;
+        }
+
+        auto it = addrFuncIdxMap.lower_bound(rangeIt->Start);
+        while ((it != addrFuncIdxMap.end()) && (it->first < rangeIt->End))
+        {
+            const ElfFunctionInfo &elfFuncInfo = _elfFuncTable.ElfFuncInfos[it->second];
+            funcIdxs.push_back(it->second);
+
+            // skip to the next function
+            it = addrFuncIdxMap.lower_bound(elfFuncInfo.Addr + elfFuncInfo.Size);
+        }
+    }
+    return funcIdxs;
+}
+
+uint64_t DwarfCuCache::getCuEnd(const uint32_t cuIdx) const
+{
+    // units are read in offset order, a unit ends where the next one starts
+    if (cuIdx + 1 < _cuEntries.size())
+    {
+        return _cuEntries[cuIdx + 1].Offset;
+    }
+    return _dbgInfoShdr.sh_size;
+}
+
+uint64_t DwarfCuCache::estimateSize(const std::string &str)
+{
+    // short strings are stored inside std::string itself
+    if (str.capacity() <= 15)
+    {
+        return sizeof(std::string);
+    }
+    return sizeof(std::string) + str.capacity() + 1;
+}
+
+uint64_t DwarfCuCache::estimateSize(const DwarfCuDebugInfo &cuDbgInfo)
+{
+    uint64_t memSize = sizeof(DwarfCuDebugInfo);
+    memSize += estimateSize(cuDbgInfo.FileName) + estimateSize(cuDbgInfo.Producer);
+    memSize += estimateSize(cuDbgInfo.Language) + estimateSize(cuDbgInfo.CompileDir);
+    memSize += cuDbgInfo.Funcs.capacity() * sizeof(*cuDbgInfo.Funcs.begin());
+    for (auto it = cuDbgInfo.Funcs.begin(); it != cuDbgInfo.Funcs.end(); it++)
+    {
+        // names point into the mapped file
+        memSize += estimateSize(it->second.SrcFilePath);
+    }
+    return memSize;
+}
+
+uint64_t DwarfCuCache::estimateSize(const DwarfLineInfoHdr &lineInfoHdr)
+{
+    uint64_t memSize = sizeof(DwarfLineInfoHdr);
+    memSize += lineInfoHdr.StdOpcodeLengths.capacity();
+    memSize += (lineInfoHdr.DirectoryEntryFormats.capacity() + lineInfoHdr.FileNameEntryFormats.capacity()) * sizeof(EntryFormat);
+    for (auto it = lineInfoHdr.Directories.begin(); it != lineInfoHdr.Directories.end(); it++)
+    {
+        memSize += estimateSize(*it);
+    }
+    for (auto it = lineInfoHdr.IncludeDirs.begin(); it != lineInfoHdr.IncludeDirs.end(); it++)
+    {
+        memSize += estimateSize(*it);
+    }
+    for (auto it = lineInfoHdr.Files.begin(); it != lineInfoHdr.Files.end(); it++)
+    {
+        memSize += sizeof(FileNameInfo) + estimateSize(it->Name) - sizeof(std::string);
+    }
+    return memSize;
+}
+
+uint64_t DwarfCuCache::estimateSize(const ElfFunctionInfo &elfFuncInfo)
+{
+    // only line rows are counted, the function table and the file table are always resident
+    return (elfFuncInfo.LineAddrs.capacity() + elfFuncInfo.AddrLines.capacity()) * sizeof(*elfFuncInfo.LineAddrs.begin());
+}
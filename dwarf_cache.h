@@ -0,0 +1,67 @@
+#pragma once
+#include <stdint.h>
+#include <elf.h>
+#include <list>
+#include <map>
+#include <vector>
+
+#include "elf_parser.h"
+#include "dwarf.h"
+
+// Decoded compilation unit held by DwarfCuCache
+struct DwarfCuCacheEntry
+{
+    DwarfCuDebugInfo DebugInfo;
+    DwarfLineInfoHdr LineInfoHdr;
+    std::vector<uint32_t> FuncIdxs;         // Index of ElfFuncInfos whose LineAddrs are filled by this unit
+    uint64_t MemorySize;                    // estimated bytes of decoded structures
+    std::list<uint32_t>::iterator LruPos;
+};
+
+// Lazy decoder of compilation units
+// Unit headers are read when the cache is created, DIEs and the line number program
+// of a unit are decoded the first time a query touches the unit.
+// At most capacity units are kept decoded, the least recently used one is dropped first.
+// When a memory budget is set, least recently used units (and the line tables and DIE records
+// they filled) are also dropped while the estimated memory usage is over the budget.
+class DwarfCuCache
+{
+public:
+    DwarfCuCache(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfArangeMap &offsetArangeMap, ElfFunctionTable &elfFuncTable, const size_t capacity);
+    void SetMemoryBudget(const uint64_t memoryBudget);
+    bool FindCuIdx(const uint64_t addr, uint32_t &cuIdx) const;
+    const DwarfCuCacheEntry &GetCu(const uint32_t cuIdx);
+    const std::vector<DwarfCuEntry> &CuEntries() const;
+    size_t DecodedCount() const;
+    uint64_t MemoryUsage() const;
+    uint64_t EvictedCount() const;
+
+private:
+    void decodeCu(const uint32_t cuIdx);
+    void evict();
+    std::vector<uint32_t> getCuFuncIdxs(const uint32_t cuIdx) const;
+    uint64_t getCuEnd(const uint32_t cuIdx) const;
+    static uint64_t estimateSize(const std::string &str);
+    static uint64_t estimateSize(const DwarfCuDebugInfo &cuDbgInfo);
+    static uint64_t estimateSize(const DwarfLineInfoHdr &lineInfoHdr);
+    static uint64_t estimateSize(const ElfFunctionInfo &elfFuncInfo);
+
+private:
+    const uint8_t *_bin;
+    uint64_t _size;
+    Elf64_Shdr _dbgInfoShdr;
+    Elf64_Shdr _dbgStrShdr;
+    Elf64_Shdr _dbgLineShdr;
+    Elf64_Shdr _dbgLineStrShdr;
+    Elf64_Shdr _dbgAbbrevShdr;
+    ElfFunctionTable &_elfFuncTable;
+    size_t _capacity;
+    uint64_t _memoryBudget;                         // 0: no budget
+    uint64_t _memoryUsage;
+    uint64_t _evictedCount;
+    std::vector<DwarfCuEntry> _cuEntries;
+    std::vector<DwarfCuRange> _cuRanges;            // sorted by Start
+    std::list<uint32_t> _lruList;                   // front is the most recently used unit
+    std::map<uint32_t, DwarfCuCacheEntry> _decodedCus;  // key: Index of _cuEntries
+    DwarfDieIndex _dieIndex;                        // subprogram DIEs of the decoded units
+};
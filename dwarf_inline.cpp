@@ -0,0 +1,309 @@
+#include <algorithm>
+#include "dwarf_inline.h"
+#include "parallel.h"
+#include "logger.h"
+
+// depth of DW_AT_abstract_origin / DW_AT_specification chains, in case of a broken reference loop
+static const int INLINE_MAX_REF_DEPTH = 8;
+
+DwarfInlineTable::DwarfInlineTable()
+{
+}
+
+void DwarfInlineTable::Build(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const unsigned threadCount)
+{
+    Logger::TLog("DwarfInlineTable::Build In...");
+    std::vector<DwarfCuEntry> cuEntries = Dwarf::ReadCuHeaders(bin, size, dbgInfoShdr);
+
+    // units do not share anything while being read
+    std::vector<DwarfInlineUnit> units(cuEntries.size());
+    Parallel::For(cuEntries.size(), threadCount, [&](const size_t idx)
+    {
+        units[idx] = ReadUnit(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, dbgRangesShdr, dbgRngListsShdr, cuEntries[idx]);
+    });
+    AddUnits(units);
+    Logger::TLog("DwarfInlineTable::Build Out...");
+}
+
+DwarfInlineUnit DwarfInlineTable::ReadUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const DwarfCuEntry &cuEntry)
+{
+    DwarfInlineUnit unit;
+    unit.Offset = cuEntry.Offset;
+    const Elf64_Shdr &rangesShdr = (5 <= cuEntry.Header.Version) ? dbgRngListsShdr : dbgRangesShdr;
+
+    // scopes[depth]: innermost site and concrete subprogram around the children at depth + 1
+    struct Scope
+    {
+        uint32_t SiteIdx;
+        uint64_t FuncOffset;
+    };
+    std::vector<Scope> scopes;
+    uint64_t baseAddr = 0;
+    std::vector<DwarfRange> ranges;
+    DwarfDieReader reader(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, cuEntry);
+    DwarfDie die;
+    while (reader.Next(die))
+    {
+        if (scopes.size() <= die.Depth)
+        {
+            scopes.resize(die.Depth + 1);
+        }
+        Scope parent = (0 < die.Depth) ? scopes[die.Depth - 1] : Scope{INLINE_SITE_NONE, 0};
+        scopes[die.Depth] = parent;
+
+        if ((die.Tag != DW_TAG_compile_unit) && (die.Tag != DW_TAG_subprogram) && (die.Tag != DW_TAG_inlined_subroutine))
+        {
+            continue;
+        }
+
+        ranges.clear();
+        if (!Dwarf::ReadDieRanges(bin, size, rangesShdr, cuEntry.Header, die, baseAddr, ranges))
+        {
+            Logger::DLog("ranges of DIE at 0x%x are read partially", die.Offset);
+        }
+
+        if (die.Tag == DW_TAG_compile_unit)
+        {
+            // base address of the range lists of the unit
+            const DwarfAttrValue *lowVal = die.Find(DW_AT_low_pc);
+            baseAddr = ((lowVal != nullptr) && (lowVal->Class == DWARF_VALUE_ADDRESS)) ? lowVal->UData : 0;
+            continue;
+        }
+
+        if (die.Tag == DW_TAG_subprogram)
+        {
+            DwarfDieRecord record;
+            record.Offset = die.Offset;
+            record.RefOffset = 0;
+            record.Name = nullptr;
+            record.LinkageName = nullptr;
+            for (auto it = die.Attrs.begin(); it != die.Attrs.end(); it++)
+            {
+                switch (it->first)
+                {
+                case DW_AT_name:
+                    record.Name = it->second.Str;
+                    break;
+                case DW_AT_linkage_name:
+                case DW_AT_MIPS_linkage_name:
+                    record.LinkageName = it->second.Str;
+                    break;
+                case DW_AT_specification:
+                case DW_AT_abstract_origin:
+                    if (it->second.Class == DWARF_VALUE_REFERENCE)
+                    {
+                        record.RefOffset = it->second.UData;
+                    }
+                    break;
+                case DW_AT_decl_line:
+                    if (it->second.Class == DWARF_VALUE_CONSTANT)
+                    {
+                        unit.DeclLines.push_back(std::make_pair(die.Offset, (uint32_t)it->second.UData));
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+            unit.Subprograms.push_back(record);
+
+            if (ranges.size() != 0)
+            {
+                // concrete function, a function split into hot and cold parts has a range for each
+                for (auto it = ranges.begin(); it != ranges.end(); it++)
+                {
+                    unit.Funcs.push_back(std::make_pair(it->Low, die.Offset));
+                }
+                scopes[die.Depth] = Scope{INLINE_SITE_NONE, die.Offset};
+            }
+            continue;
+        }
+
+        // DW_TAG_inlined_subroutine
+        DwarfInlineSite site;
+        site.Offset = die.Offset;
+        site.OriginOffset = 0;
+        site.FuncOffset = parent.FuncOffset;
+        site.ParentIdx = parent.SiteIdx;
+        site.Depth = (parent.SiteIdx == INLINE_SITE_NONE) ? 1 : unit.Sites[parent.SiteIdx].Depth + 1;
+        site.CallLine = 0;
+        site.CallDiscriminator = 0;
+        site.Size = 0;
+        const DwarfAttrValue *originVal = die.Find(DW_AT_abstract_origin);
+        const DwarfAttrValue *callLineVal = die.Find(DW_AT_call_line);
+        const DwarfAttrValue *discVal = die.Find(GNU_discriminator);
+        if ((originVal != nullptr) && (originVal->Class == DWARF_VALUE_REFERENCE))
+        {
+            site.OriginOffset = originVal->UData;
+        }
+        if ((callLineVal != nullptr) && (callLineVal->Class == DWARF_VALUE_CONSTANT))
+        {
+            site.CallLine = callLineVal->UData;
+        }
+        if ((discVal != nullptr) && (discVal->Class == DWARF_VALUE_CONSTANT))
+        {
+            site.CallDiscriminator = discVal->UData;
+        }
+
+        uint32_t siteIdx = unit.Sites.size();
+        for (auto it = ranges.begin(); it != ranges.end(); it++)
+        {
+            site.Size += it->High - it->Low;
+            unit.Ranges.push_back({it->Low, it->High, siteIdx, site.Depth});
+        }
+        unit.Sites.push_back(site);
+        scopes[die.Depth] = Scope{siteIdx, parent.FuncOffset};
+    }
+
+    if (reader.Failed())
+    {
+        Logger::DLog("inline unit at 0x%x is read partially", cuEntry.Offset);
+    }
+    return unit;
+}
+
+void DwarfInlineTable::AddUnits(const std::vector<DwarfInlineUnit> &units)
+{
+    std::vector<DwarfInlineRange> ranges;
+    for (auto unitIt = units.begin(); unitIt != units.end(); unitIt++)
+    {
+        uint32_t siteTop = _sites.size();
+        for (auto it = unitIt->Sites.begin(); it != unitIt->Sites.end(); it++)
+        {
+            DwarfInlineSite site = *it;
+            if (site.ParentIdx != INLINE_SITE_NONE)
+            {
+                site.ParentIdx += siteTop;
+            }
+            _sites.push_back(site);
+        }
+        for (auto it = unitIt->Ranges.begin(); it != unitIt->Ranges.end(); it++)
+        {
+            DwarfInlineRange range = *it;
+            range.SiteIdx += siteTop;
+            ranges.push_back(range);
+        }
+        for (auto it = unitIt->Subprograms.begin(); it != unitIt->Subprograms.end(); it++)
+        {
+            _dieIndex.Add(*it);
+        }
+        for (auto it = unitIt->DeclLines.begin(); it != unitIt->DeclLines.end(); it++)
+        {
+            _declLineMap.Append(it->first, it->second);
+        }
+        for (auto it = unitIt->Funcs.begin(); it != unitIt->Funcs.end(); it++)
+        {
+            _funcOffsetMap.Append(it->first, it->second);
+        }
+    }
+    _dieIndex.Seal();
+    _declLineMap.Seal();
+    _funcOffsetMap.Seal();
+
+    // ranges of a site nest in the ranges of its parent, so a sweep in address order
+    // (outer sites first at the same address) cuts them into segments of the innermost site
+    std::sort(ranges.begin(), ranges.end(), [](const DwarfInlineRange &a, const DwarfInlineRange &b)
+    {
+        return (a.Low != b.Low) ? (a.Low < b.Low) : (a.Depth < b.Depth);
+    });
+    std::vector<Segment> openSites;     // End: end of the open range
+    uint64_t pos = 0;
+    auto emit = [&](const uint64_t end, const uint32_t siteIdx)
+    {
+        if (pos < end)
+        {
+            _segments.Append(pos, Segment{end, siteIdx});
+            pos = end;
+        }
+    };
+    for (auto it = ranges.begin(); it != ranges.end(); it++)
+    {
+        while ((openSites.size() != 0) && (openSites.back().End <= it->Low))
+        {
+            emit(openSites.back().End, openSites.back().SiteIdx);
+            openSites.pop_back();
+        }
+        if (openSites.size() != 0)
+        {
+            emit(it->Low, openSites.back().SiteIdx);
+        }
+        pos = std::max(pos, it->Low);
+
+        // a range sticking out of its parent (broken DWARF) is cut at the end of the parent
+        uint64_t end = it->High;
+        if ((openSites.size() != 0) && (openSites.back().End < end))
+        {
+            end = openSites.back().End;
+        }
+        openSites.push_back(Segment{end, it->SiteIdx});
+    }
+    while (openSites.size() != 0)
+    {
+        emit(openSites.back().End, openSites.back().SiteIdx);
+        openSites.pop_back();
+    }
+    _segments.Seal();
+}
+
+uint32_t DwarfInlineTable::FindSite(const uint64_t addr) const
+{
+    // innermost site whose code contains addr, INLINE_SITE_NONE: code of the function itself
+    auto it = _segments.upper_bound(addr);
+    if (it == _segments.begin())
+    {
+        return INLINE_SITE_NONE;
+    }
+    it--;
+    return (addr < it->second.End) ? it->second.SiteIdx : INLINE_SITE_NONE;
+}
+
+const DwarfInlineSite &DwarfInlineTable::GetSite(const uint32_t siteIdx) const
+{
+    return _sites[siteIdx];
+}
+
+const std::vector<DwarfInlineSite> &DwarfInlineTable::Sites() const
+{
+    return _sites;
+}
+
+bool DwarfInlineTable::FindFunc(const uint64_t addr, uint64_t &dieOffset) const
+{
+    auto it = _funcOffsetMap.find(addr);
+    if (it == _funcOffsetMap.end())
+    {
+        return false;
+    }
+    dieOffset = it->second;
+    return true;
+}
+
+std::string DwarfInlineTable::GetName(const uint64_t dieOffset) const
+{
+    // the linkage name identifies the function, C functions have only DW_AT_name
+    const char *name = "";
+    const char *linkageName = "";
+    _dieIndex.ResolveName(dieOffset, name, linkageName);
+    return (linkageName[0] != '\0') ? linkageName : name;
+}
+
+uint32_t DwarfInlineTable::GetDeclLine(const uint64_t dieOffset) const
+{
+    // a concrete or out-of-line copy takes the line of its abstract origin / declaration
+    uint64_t refOffset = dieOffset;
+    for (int depth = 0; (depth < INLINE_MAX_REF_DEPTH) && (refOffset != 0); depth++)
+    {
+        auto it = _declLineMap.find(refOffset);
+        if (it != _declLineMap.end())
+        {
+            return it->second;
+        }
+        const DwarfDieRecord *record = _dieIndex.Find(refOffset);
+        if (record == nullptr)
+        {
+            break;
+        }
+        refOffset = record->RefOffset;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <elf.h>
+#include <string>
+#include <vector>
+
+#include "elf_parser.h"
+#include "dwarf.h"
+#include "flat_map.h"
+
+// ParentIdx of a site inlined directly into the concrete function
+const uint32_t INLINE_SITE_NONE = UINT32_MAX;
+
+// DW_TAG_inlined_subroutine, a copy of the body of OriginOffset
+struct DwarfInlineSite
+{
+    uint64_t Offset;            // offset of the DIE in .debug_info
+    uint64_t OriginOffset;      // DW_AT_abstract_origin
+    uint64_t FuncOffset;        // concrete subprogram DIE the copy is in, 0: unknown
+    uint32_t ParentIdx;         // enclosing site, INLINE_SITE_NONE: inlined into the concrete function
+    uint32_t Depth;             // 1: inlined into the concrete function
+    uint32_t CallLine;          // DW_AT_call_line, in the source of the parent
+    uint32_t CallDiscriminator; // DW_AT_GNU_discriminator
+    uint64_t Size;              // bytes of all its ranges
+};
+
+// address range of a site
+struct DwarfInlineRange
+{
+    uint64_t Low;
+    uint64_t High;
+    uint32_t SiteIdx;
+    uint32_t Depth;
+};
+
+// Inline DIEs of one unit, indexes are relative to the unit until AddUnits
+struct DwarfInlineUnit
+{
+    uint64_t Offset;                                    // offset of the unit in .debug_info
+    std::vector<DwarfDieRecord> Subprograms;            // names and references of every subprogram DIE
+    std::vector<std::pair<uint64_t, uint32_t>> DeclLines;   // first: subprogram DIE, second: DW_AT_decl_line
+    std::vector<std::pair<uint64_t, uint64_t>> Funcs;       // first: range start of a concrete subprogram, second: its DIE
+    std::vector<DwarfInlineSite> Sites;
+    std::vector<DwarfInlineRange> Ranges;
+};
+
+// Inline tree of the whole binary
+// Units are read independently by ReadUnit (so they can be read in any thread) and merged by AddUnits,
+// which flattens the nested ranges into segments owned by the innermost site, so the inline stack
+// of an address is one binary search followed by ParentIdx.
+class DwarfInlineTable
+{
+public:
+    DwarfInlineTable();
+    void Build(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const unsigned threadCount);
+    static DwarfInlineUnit ReadUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const DwarfCuEntry &cuEntry);
+    void AddUnits(const std::vector<DwarfInlineUnit> &units);
+    uint32_t FindSite(const uint64_t addr) const;
+    const DwarfInlineSite &GetSite(const uint32_t siteIdx) const;
+    const std::vector<DwarfInlineSite> &Sites() const;
+    bool FindFunc(const uint64_t addr, uint64_t &dieOffset) const;
+    std::string GetName(const uint64_t dieOffset) const;
+    uint32_t GetDeclLine(const uint64_t dieOffset) const;
+
+private:
+    struct Segment
+    {
+        uint64_t End;
+        uint32_t SiteIdx;
+    };
+
+private:
+    std::vector<DwarfInlineSite> _sites;
+    FlatMap<uint64_t, Segment> _segments;           // key: start address, innermost site of [key, End)
+    FlatMap<uint64_t, uint64_t> _funcOffsetMap;     // key: range start of a concrete subprogram, value: its DIE
+    FlatMap<uint64_t, uint32_t> _declLineMap;       // key: subprogram DIE, value: DW_AT_decl_line
+    DwarfDieIndex _dieIndex;
+};
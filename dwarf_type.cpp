@@ -0,0 +1,722 @@
+#include <algorithm>
+#include "dwarf_type.h"
+#include "logger.h"
+#include "common.h"
+
+// marks a type DIE whose node is being built
+static const uint32_t TYPE_ID_IN_PROGRESS = UINT32_MAX;
+
+// depth of nested type names / sizes, deeper types are printed as "..."
+static const int TYPE_MAX_DEPTH = 16;
+
+DwarfTypeGraph::DwarfTypeGraph() :
+    _dieCount(0)
+{
+    // id 0 is void
+    DwarfType voidType;
+    voidType.Kind = DWARF_TYPE_VOID;
+    voidType.Name = "void";
+    voidType.ByteSize = 0;
+    voidType.Encoding = 0;
+    voidType.TargetId = 0;
+    voidType.Declaration = false;
+    _types.push_back(voidType);
+    _keyTypeIdMap["V"] = 0;
+}
+
+DwarfTypeUnit DwarfTypeGraph::ReadUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry)
+{
+    DwarfTypeUnit unit;
+    unit.Records = std::make_shared<Arena>();
+    Arena *arena = unit.Records.get();
+    unit.Types = ArenaVector<DwarfRawType>(ArenaAllocator<DwarfRawType>(arena));
+    unit.Offset = cuEntry.Offset;
+    unit.DieCount = 0;
+
+    // parentIdxs[depth]: Index of unit.Types owning the children at depth + 1, -1: not a type
+    std::vector<int64_t> parentIdxs;
+    DwarfDieReader reader(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, cuEntry);
+    DwarfDie die;
+    while (reader.Next(die))
+    {
+        unit.DieCount++;
+        if (parentIdxs.size() <= die.Depth)
+        {
+            parentIdxs.resize(die.Depth + 1);
+        }
+        parentIdxs[die.Depth] = -1;
+        int64_t parentIdx = (0 < die.Depth) ? parentIdxs[die.Depth - 1] : -1;
+
+        DwarfTypeKind kind = getKind(die.Tag);
+        if ((kind != DWARF_TYPE_VOID) || (die.Tag == DW_TAG_unspecified_type))
+        {
+            DwarfRawType rawType;
+            rawType.Offset = die.Offset;
+            rawType.Kind = (die.Tag == DW_TAG_unspecified_type) ? DWARF_TYPE_BASE : kind;
+            rawType.Tag = die.Tag;
+            rawType.Name = nullptr;
+            rawType.ByteSize = 0;
+            rawType.Encoding = 0;
+            rawType.TargetOffset = 0;
+            rawType.Declaration = false;
+            rawType.Dims = ArenaVector<uint64_t>(ArenaAllocator<uint64_t>(arena));
+            rawType.Members = ArenaVector<DwarfRawMember>(ArenaAllocator<DwarfRawMember>(arena));
+            rawType.Enumerators = ArenaVector<DwarfRawEnumerator>(ArenaAllocator<DwarfRawEnumerator>(arena));
+            if ((kind == DWARF_TYPE_POINTER) || (kind == DWARF_TYPE_REFERENCE) || (kind == DWARF_TYPE_RVALUE_REF))
+            {
+                rawType.ByteSize = cuEntry.Header.AddressSize;
+            }
+            for (auto it = die.Attrs.begin(); it != die.Attrs.end(); it++)
+            {
+                switch (it->first)
+                {
+                case DW_AT_name:
+                    rawType.Name = it->second.Str;
+                    break;
+                case DW_AT_byte_size:
+                    if (it->second.Class == DWARF_VALUE_CONSTANT)
+                    {
+                        rawType.ByteSize = it->second.UData;
+                    }
+                    break;
+                case DW_AT_encoding:
+                    rawType.Encoding = it->second.UData;
+                    break;
+                case DW_AT_type:
+                    if (it->second.Class == DWARF_VALUE_REFERENCE)
+                    {
+                        rawType.TargetOffset = it->second.UData;
+                    }
+                    break;
+                case DW_AT_declaration:
+                    rawType.Declaration = (it->second.UData != 0);
+                    break;
+                default:
+                    break;
+                }
+            }
+            unit.Types.push_back(std::move(rawType));
+            parentIdxs[die.Depth] = unit.Types.size() - 1;
+            continue;
+        }
+
+        if (parentIdx < 0)
+        {
+            continue;
+        }
+
+        // children of a type
+        DwarfRawType &parent = unit.Types[parentIdx];
+        if (((die.Tag == DW_TAG_member) || (die.Tag == DW_TAG_inheritance)) && ((parent.Kind == DWARF_TYPE_STRUCT) || (parent.Kind == DWARF_TYPE_CLASS) || (parent.Kind == DWARF_TYPE_UNION)))
+        {
+            // static data members (DWARF4) have no location
+            if ((die.Find(DW_AT_declaration) != nullptr) || (die.Find(DW_AT_external) != nullptr))
+            {
+                continue;
+            }
+
+            DwarfRawMember member;
+            member.Name = nullptr;
+            member.TypeOffset = 0;
+            member.Offset = 0;
+            member.BitSize = 0;
+            member.BitOffset = 0;
+            member.IsBase = (die.Tag == DW_TAG_inheritance);
+            uint64_t byteSize = 0;
+            int64_t dwarf2BitOffset = -1;
+            int64_t dataBitOffset = -1;
+            for (auto it = die.Attrs.begin(); it != die.Attrs.end(); it++)
+            {
+                switch (it->first)
+                {
+                case DW_AT_name:
+                    member.Name = it->second.Str;
+                    break;
+                case DW_AT_type:
+                    if (it->second.Class == DWARF_VALUE_REFERENCE)
+                    {
+                        member.TypeOffset = it->second.UData;
+                    }
+                    break;
+                case DW_AT_data_member_location:
+                    if (it->second.Class == DWARF_VALUE_CONSTANT)
+                    {
+                        member.Offset = it->second.UData;
+                    }
+                    else if ((it->second.Class == DWARF_VALUE_BLOCK) && (1 < it->second.BlockLen) && (it->second.Block[0] == DW_OP_plus_uconst))
+                    {
+                        // DWARF2 style location expression
+                        uint32_t len;
+                        member.Offset = Dwarf::ReaduLEB128(&it->second.Block[1], it->second.BlockLen - 1, len);
+                    }
+                    break;
+                case DW_AT_byte_size:
+                    byteSize = it->second.UData;
+                    break;
+                case DW_AT_bit_size:
+                    member.BitSize = it->second.UData;
+                    break;
+                case DW_AT_bit_offset:
+                    dwarf2BitOffset = it->second.IsSigned ? it->second.SData : (int64_t)it->second.UData;
+                    break;
+                case DW_AT_data_bit_offset:
+                    dataBitOffset = it->second.UData;
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            if (dataBitOffset >= 0)
+            {
+                // DWARF4: bit offset from the top of the containing type
+                member.Offset = dataBitOffset / 8;
+                member.BitOffset = dataBitOffset % 8;
+            }
+            else if ((dwarf2BitOffset >= 0) && (member.BitSize != 0) && (byteSize != 0))
+            {
+                // DWARF2: bit offset from the most significant bit of the storage unit (little endian)
+                int64_t bitPos = (int64_t)(byteSize * 8) - dwarf2BitOffset - member.BitSize;
+                if (bitPos >= 0)
+                {
+                    member.Offset += bitPos / 8;
+                    member.BitOffset = bitPos % 8;
+                }
+            }
+            parent.Members.push_back(member);
+        }
+        else if ((die.Tag == DW_TAG_subrange_type) && (parent.Kind == DWARF_TYPE_ARRAY))
+        {
+            uint64_t count = 0;
+            const DwarfAttrValue *countVal = die.Find(DW_AT_count);
+            const DwarfAttrValue *upperVal = die.Find(DW_AT_upper_bound);
+            if ((countVal != nullptr) && (countVal->Class == DWARF_VALUE_CONSTANT))
+            {
+                count = countVal->UData;
+            }
+            else if ((upperVal != nullptr) && (upperVal->Class == DWARF_VALUE_CONSTANT) && !(upperVal->IsSigned && (upperVal->SData < 0)))
+            {
+                count = upperVal->UData + 1;
+            }
+            parent.Dims.push_back(count);
+        }
+        else if ((die.Tag == DW_TAG_enumerator) && (parent.Kind == DWARF_TYPE_ENUM))
+        {
+            DwarfRawEnumerator enumerator;
+            enumerator.Name = nullptr;
+            enumerator.Value = 0;
+            const DwarfAttrValue *nameVal = die.Find(DW_AT_name);
+            const DwarfAttrValue *constVal = die.Find(DW_AT_const_value);
+            if ((nameVal != nullptr) && (nameVal->Str != nullptr))
+            {
+                enumerator.Name = nameVal->Str;
+            }
+            if (constVal != nullptr)
+            {
+                enumerator.Value = constVal->IsSigned ? constVal->SData : (int64_t)constVal->UData;
+            }
+            parent.Enumerators.push_back(enumerator);
+        }
+        else if ((die.Tag == DW_TAG_formal_parameter) && (parent.Kind == DWARF_TYPE_FUNCTION))
+        {
+            DwarfRawMember param;
+            param.Name = nullptr;
+            param.TypeOffset = 0;
+            param.Offset = 0;
+            param.BitSize = 0;
+            param.BitOffset = 0;
+            param.IsBase = false;
+            const DwarfAttrValue *typeVal = die.Find(DW_AT_type);
+            if ((typeVal != nullptr) && (typeVal->Class == DWARF_VALUE_REFERENCE))
+            {
+                param.TypeOffset = typeVal->UData;
+            }
+            parent.Members.push_back(param);
+        }
+    }
+
+    if (reader.Failed())
+    {
+        Logger::DLog("type unit at 0x%x is read partially", cuEntry.Offset);
+    }
+    return unit;
+}
+
+void DwarfTypeGraph::AddUnits(const std::vector<DwarfTypeUnit> &units)
+{
+    // references may point forward or into another unit (ref_addr), so every unit is looked up
+    std::vector<const DwarfTypeUnit *> sortedUnits;
+    for (auto it = units.begin(); it != units.end(); it++)
+    {
+        sortedUnits.push_back(&(*it));
+        _dieCount += it->DieCount;
+    }
+    std::sort(sortedUnits.begin(), sortedUnits.end(), [](const DwarfTypeUnit *a, const DwarfTypeUnit *b)
+    {
+        return a->Offset < b->Offset;
+    });
+
+    // a unit often has only the declaration of a struct defined in another unit,
+    // declarations are replaced by the definition when only one definition has that name
+    _nameDefOffsetMap.clear();
+    std::map<std::string, const DwarfRawType *> nameDefMap;
+    for (auto unitIt = sortedUnits.begin(); unitIt != sortedUnits.end(); unitIt++)
+    {
+        for (auto it = (*unitIt)->Types.begin(); it != (*unitIt)->Types.end(); it++)
+        {
+            if ((it->Name == nullptr) || it->Declaration || ((it->Kind != DWARF_TYPE_STRUCT) && (it->Kind != DWARF_TYPE_CLASS) && (it->Kind != DWARF_TYPE_UNION) && (it->Kind != DWARF_TYPE_ENUM)))
+            {
+                continue;
+            }
+
+            std::string name = StringHelper::strprintf("%d|%s", it->Kind, it->Name);
+            auto defIt = nameDefMap.find(name);
+            if (defIt == nameDefMap.end())
+            {
+                nameDefMap[name] = &(*it);
+                _nameDefOffsetMap[name] = it->Offset;
+            }
+            else if ((defIt->second != nullptr) && ((defIt->second->ByteSize != it->ByteSize) || (defIt->second->Members.size() != it->Members.size())))
+            {
+                // different types with the same name (e.g. in different namespaces)
+                defIt->second = nullptr;
+                _nameDefOffsetMap.erase(name);
+            }
+        }
+    }
+
+    for (auto unitIt = sortedUnits.begin(); unitIt != sortedUnits.end(); unitIt++)
+    {
+        for (auto it = (*unitIt)->Types.begin(); it != (*unitIt)->Types.end(); it++)
+        {
+            internRaw(sortedUnits, it->Offset);
+        }
+    }
+}
+
+bool DwarfTypeGraph::FindTypeId(const uint64_t dieOffset, uint32_t &typeId) const
+{
+    auto it = _offsetTypeIdMap.find(dieOffset);
+    if ((it == _offsetTypeIdMap.end()) || (it->second == TYPE_ID_IN_PROGRESS))
+    {
+        return false;
+    }
+    typeId = it->second;
+    return true;
+}
+
+const DwarfType &DwarfTypeGraph::GetType(const uint32_t typeId) const
+{
+    return _types[typeId];
+}
+
+std::string DwarfTypeGraph::GetTypeName(const uint32_t typeId) const
+{
+    return getTypeName(typeId, 0);
+}
+
+uint64_t DwarfTypeGraph::GetTypeSize(const uint32_t typeId) const
+{
+    return getTypeSize(typeId, 0);
+}
+
+size_t DwarfTypeGraph::TypeCount() const
+{
+    return _types.size();
+}
+
+uint64_t DwarfTypeGraph::TypeDieCount() const
+{
+    return _offsetTypeIdMap.size();
+}
+
+uint64_t DwarfTypeGraph::DieCount() const
+{
+    return _dieCount;
+}
+
+uint32_t DwarfTypeGraph::internRaw(const std::vector<const DwarfTypeUnit *> &units, const uint64_t dieOffset)
+{
+    if (dieOffset == 0)
+    {
+        return 0;
+    }
+
+    auto idIt = _offsetTypeIdMap.find(dieOffset);
+    if (idIt != _offsetTypeIdMap.end())
+    {
+        if (idIt->second == TYPE_ID_IN_PROGRESS)
+        {
+            // only a broken graph comes here, struct ids are fixed before their members
+            Logger::DLog("type loop at 0x%x", dieOffset);
+            return 0;
+        }
+        return idIt->second;
+    }
+
+    const DwarfRawType *raw = findRaw(units, dieOffset);
+    if (raw == nullptr)
+    {
+        Logger::DLog("type DIE not found at 0x%x", dieOffset);
+        return 0;
+    }
+    _offsetTypeIdMap[dieOffset] = TYPE_ID_IN_PROGRESS;
+
+    if (raw->Declaration && (raw->Name != nullptr))
+    {
+        auto defIt = _nameDefOffsetMap.find(StringHelper::strprintf("%d|%s", raw->Kind, raw->Name));
+        if (defIt != _nameDefOffsetMap.end())
+        {
+            uint32_t typeId = internRaw(units, defIt->second);
+            _offsetTypeIdMap[dieOffset] = typeId;
+            return typeId;
+        }
+    }
+
+    DwarfType type;
+    type.Kind = raw->Kind;
+    type.Name = (raw->Name != nullptr) ? raw->Name : "";
+    type.ByteSize = raw->ByteSize;
+    type.Encoding = raw->Encoding;
+    type.TargetId = 0;
+    type.Declaration = raw->Declaration;
+    type.Dims.assign(raw->Dims.begin(), raw->Dims.end());
+
+    std::string key;
+    uint32_t typeId = 0;
+    switch (raw->Kind)
+    {
+    case DWARF_TYPE_STRUCT:
+    case DWARF_TYPE_CLASS:
+    case DWARF_TYPE_UNION:
+    {
+        key = StringHelper::strprintf("S|%d|%s|%ld|%d|", raw->Kind, type.Name, raw->ByteSize, raw->Declaration);
+        for (auto it = raw->Members.begin(); it != raw->Members.end(); it++)
+        {
+            DwarfTypeMember member;
+            member.Name = (it->Name != nullptr) ? it->Name : "";
+            member.TypeId = 0;
+            member.Offset = it->Offset;
+            member.BitSize = it->BitSize;
+            member.BitOffset = it->BitOffset;
+            member.IsBase = it->IsBase;
+            type.Members.push_back(member);
+            key += StringHelper::strprintf("%s@%ld:%d:%d:%d:", member.Name, member.Offset, member.BitSize, member.BitOffset, member.IsBase);
+            key += getShallowKey(units, it->TypeOffset, 2) + ";";
+        }
+
+        size_t typeCount = _types.size();
+        typeId = intern(key, type);
+        _offsetTypeIdMap[dieOffset] = typeId;
+        if (typeCount < _types.size())
+        {
+            // new node, member types may refer back to this struct
+            for (uint32_t i = 0; i < raw->Members.size(); i++)
+            {
+                uint32_t memberTypeId = internRaw(units, raw->Members[i].TypeOffset);
+                _types[typeId].Members[i].TypeId = memberTypeId;
+            }
+        }
+        return typeId;
+    }
+    case DWARF_TYPE_ENUM:
+        type.TargetId = internRaw(units, raw->TargetOffset);
+        key = StringHelper::strprintf("E|%s|%ld|%d|%d|", type.Name, raw->ByteSize, raw->Declaration, type.TargetId);
+        for (auto it = raw->Enumerators.begin(); it != raw->Enumerators.end(); it++)
+        {
+            DwarfTypeEnumerator enumerator;
+            enumerator.Name = (it->Name != nullptr) ? it->Name : "";
+            enumerator.Value = it->Value;
+            type.Enumerators.push_back(enumerator);
+            key += StringHelper::strprintf("%s=%ld,", enumerator.Name, enumerator.Value);
+        }
+        break;
+    case DWARF_TYPE_ARRAY:
+        type.TargetId = internRaw(units, raw->TargetOffset);
+        key = StringHelper::strprintf("A|%d|", type.TargetId);
+        for (auto it = raw->Dims.begin(); it != raw->Dims.end(); it++)
+        {
+            key += StringHelper::strprintf("%ld,", *it);
+        }
+        break;
+    case DWARF_TYPE_FUNCTION:
+        type.TargetId = internRaw(units, raw->TargetOffset);
+        key = StringHelper::strprintf("F|%d|", type.TargetId);
+        for (auto it = raw->Members.begin(); it != raw->Members.end(); it++)
+        {
+            DwarfTypeMember param;
+            param.TypeId = internRaw(units, it->TypeOffset);
+            param.Offset = 0;
+            param.BitSize = 0;
+            param.BitOffset = 0;
+            param.IsBase = false;
+            type.Members.push_back(param);
+            key += StringHelper::strprintf("%d,", param.TypeId);
+        }
+        break;
+    default:
+        // base, modifiers, typedef and other types are identified by name, size and target
+        type.TargetId = internRaw(units, raw->TargetOffset);
+        key = StringHelper::strprintf("T|%d|%ld|%s|%ld|%d|%d", raw->Kind, raw->Tag, type.Name, raw->ByteSize, raw->Encoding, type.TargetId);
+        break;
+    }
+
+    typeId = intern(key, type);
+    _offsetTypeIdMap[dieOffset] = typeId;
+    return typeId;
+}
+
+uint32_t DwarfTypeGraph::intern(const std::string &key, const DwarfType &type)
+{
+    auto it = _keyTypeIdMap.find(key);
+    if (it != _keyTypeIdMap.end())
+    {
+        return it->second;
+    }
+
+    uint32_t typeId = _types.size();
+    _types.push_back(type);
+    _keyTypeIdMap[key] = typeId;
+    return typeId;
+}
+
+std::string DwarfTypeGraph::getShallowKey(const std::vector<const DwarfTypeUnit *> &units, const uint64_t dieOffset, const int depth) const
+{
+    // description of a member type which does not need its type id
+    if (dieOffset == 0)
+    {
+        return "V";
+    }
+    const DwarfRawType *raw = findRaw(units, dieOffset);
+    if (raw == nullptr)
+    {
+        return "?";
+    }
+    if (raw->Declaration && (raw->Name != nullptr))
+    {
+        auto defIt = _nameDefOffsetMap.find(StringHelper::strprintf("%d|%s", raw->Kind, raw->Name));
+        if (defIt != _nameDefOffsetMap.end())
+        {
+            raw = findRaw(units, defIt->second);
+        }
+    }
+
+    std::string key = StringHelper::strprintf("%d:%s:%ld", raw->Kind, (raw->Name != nullptr) ? raw->Name : "", raw->ByteSize);
+    if (depth <= 0)
+    {
+        return key;
+    }
+
+    for (auto it = raw->Dims.begin(); it != raw->Dims.end(); it++)
+    {
+        key += StringHelper::strprintf("[%ld]", *it);
+    }
+    if ((raw->Name == nullptr) && ((raw->Kind == DWARF_TYPE_STRUCT) || (raw->Kind == DWARF_TYPE_CLASS) || (raw->Kind == DWARF_TYPE_UNION)))
+    {
+        // anonymous struct / union is told apart by its members
+        key += "{";
+        for (auto it = raw->Members.begin(); it != raw->Members.end(); it++)
+        {
+            key += StringHelper::strprintf("%s@%ld:", (it->Name != nullptr) ? it->Name : "", it->Offset);
+            key += getShallowKey(units, it->TypeOffset, depth - 1) + ";";
+        }
+        key += "}";
+    }
+    else if (raw->TargetOffset != 0)
+    {
+        key += "(" + getShallowKey(units, raw->TargetOffset, depth - 1) + ")";
+    }
+    return key;
+}
+
+std::string DwarfTypeGraph::getTypeName(const uint32_t typeId, const int depth) const
+{
+    if ((_types.size() <= typeId) || (TYPE_MAX_DEPTH < depth))
+    {
+        return "...";
+    }
+
+    const DwarfType &type = _types[typeId];
+    std::string name = type.Name;
+    switch (type.Kind)
+    {
+    case DWARF_TYPE_STRUCT:
+        return "struct " + ((name.size() != 0) ? name : "{...}");
+    case DWARF_TYPE_CLASS:
+        return "class " + ((name.size() != 0) ? name : "{...}");
+    case DWARF_TYPE_UNION:
+        return "union " + ((name.size() != 0) ? name : "{...}");
+    case DWARF_TYPE_ENUM:
+        return "enum " + ((name.size() != 0) ? name : "{...}");
+    case DWARF_TYPE_POINTER:
+        if (_types[type.TargetId].Kind == DWARF_TYPE_FUNCTION)
+        {
+            // function pointer
+            const DwarfType &funcType = _types[type.TargetId];
+            std::string params;
+            for (auto it = funcType.Members.begin(); it != funcType.Members.end(); it++)
+            {
+                params += ((params.size() != 0) ? ", " : "") + getTypeName(it->TypeId, depth + 1);
+            }
+            return getTypeName(funcType.TargetId, depth + 1) + " (*)(" + params + ")";
+        }
+        return getTypeName(type.TargetId, depth + 1) + " *";
+    case DWARF_TYPE_REFERENCE:
+        return getTypeName(type.TargetId, depth + 1) + " &";
+    case DWARF_TYPE_RVALUE_REF:
+        return getTypeName(type.TargetId, depth + 1) + " &&";
+    case DWARF_TYPE_CONST:
+        if (_types[type.TargetId].Kind == DWARF_TYPE_POINTER)
+        {
+            return getTypeName(type.TargetId, depth + 1) + " const";
+        }
+        return "const " + getTypeName(type.TargetId, depth + 1);
+    case DWARF_TYPE_VOLATILE:
+        if (_types[type.TargetId].Kind == DWARF_TYPE_POINTER)
+        {
+            return getTypeName(type.TargetId, depth + 1) + " volatile";
+        }
+        return "volatile " + getTypeName(type.TargetId, depth + 1);
+    case DWARF_TYPE_ARRAY:
+    {
+        name = getTypeName(type.TargetId, depth + 1);
+        for (auto it = type.Dims.begin(); it != type.Dims.end(); it++)
+        {
+            name += (*it != 0) ? StringHelper::strprintf("[%ld]", *it) : "[]";
+        }
+        return name;
+    }
+    case DWARF_TYPE_FUNCTION:
+    {
+        std::string params;
+        for (auto it = type.Members.begin(); it != type.Members.end(); it++)
+        {
+            params += ((params.size() != 0) ? ", " : "") + getTypeName(it->TypeId, depth + 1);
+        }
+        return getTypeName(type.TargetId, depth + 1) + " (" + params + ")";
+    }
+    case DWARF_TYPE_OTHER:
+        if ((name.size() == 0) && (type.TargetId != 0))
+        {
+            // e.g. restrict
+            return getTypeName(type.TargetId, depth + 1);
+        }
+        break;
+    default:
+        break;
+    }
+    return name;
+}
+
+uint64_t DwarfTypeGraph::getTypeSize(const uint32_t typeId, const int depth) const
+{
+    if ((_types.size() <= typeId) || (TYPE_MAX_DEPTH < depth))
+    {
+        return 0;
+    }
+
+    const DwarfType &type = _types[typeId];
+    switch (type.Kind)
+    {
+    case DWARF_TYPE_CONST:
+    case DWARF_TYPE_VOLATILE:
+    case DWARF_TYPE_TYPEDEF:
+        return getTypeSize(type.TargetId, depth + 1);
+    case DWARF_TYPE_ARRAY:
+    {
+        if (type.ByteSize != 0)
+        {
+            return type.ByteSize;
+        }
+        uint64_t size = getTypeSize(type.TargetId, depth + 1);
+        for (auto it = type.Dims.begin(); it != type.Dims.end(); it++)
+        {
+            size *= *it;
+        }
+        return size;
+    }
+    case DWARF_TYPE_FUNCTION:
+    case DWARF_TYPE_VOID:
+        return 0;
+    case DWARF_TYPE_OTHER:
+        if ((type.ByteSize == 0) && (type.TargetId != 0))
+        {
+            return getTypeSize(type.TargetId, depth + 1);
+        }
+        break;
+    default:
+        break;
+    }
+    return type.ByteSize;
+}
+
+const DwarfRawType *DwarfTypeGraph::findRaw(const std::vector<const DwarfTypeUnit *> &units, const uint64_t dieOffset)
+{
+    // unit which starts at or before dieOffset
+    auto unitIt = std::upper_bound(units.begin(), units.end(), dieOffset, [](const uint64_t offset, const DwarfTypeUnit *unit)
+    {
+        return offset < unit->Offset;
+    });
+    if (unitIt == units.begin())
+    {
+        return nullptr;
+    }
+    unitIt--;
+
+    const ArenaVector<DwarfRawType> &types = (*unitIt)->Types;
+    auto it = std::lower_bound(types.begin(), types.end(), dieOffset, [](const DwarfRawType &raw, const uint64_t offset)
+    {
+        return raw.Offset < offset;
+    });
+    if ((it == types.end()) || (it->Offset != dieOffset))
+    {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+DwarfTypeKind DwarfTypeGraph::getKind(const uint64_t tag)
+{
+    switch (tag)
+    {
+    case DW_TAG_base_type:
+        return DWARF_TYPE_BASE;
+    case DW_TAG_pointer_type:
+        return DWARF_TYPE_POINTER;
+    case DW_TAG_reference_type:
+        return DWARF_TYPE_REFERENCE;
+    case DW_TAG_rvalue_reference_type:
+        return DWARF_TYPE_RVALUE_REF;
+    case DW_TAG_const_type:
+        return DWARF_TYPE_CONST;
+    case DW_TAG_volatile_type:
+        return DWARF_TYPE_VOLATILE;
+    case DW_TAG_typedef:
+        return DWARF_TYPE_TYPEDEF;
+    case DW_TAG_structure_type:
+        return DWARF_TYPE_STRUCT;
+    case DW_TAG_class_type:
+        return DWARF_TYPE_CLASS;
+    case DW_TAG_union_type:
+        return DWARF_TYPE_UNION;
+    case DW_TAG_enumeration_type:
+        return DWARF_TYPE_ENUM;
+    case DW_TAG_array_type:
+        return DWARF_TYPE_ARRAY;
+    case DW_TAG_subroutine_type:
+        return DWARF_TYPE_FUNCTION;
+    case DW_TAG_ptr_to_member_type:
+    case DW_TAG_restrict_type:
+    case DW_TAG_packed_type:
+    case DW_TAG_shared_type:
+    case DW_TAG_string_type:
+    case DW_TAG_set_type:
+    case DW_TAG_file_type:
+    case DW_TAG_interface_type:
+    case DW_TAG_template_alias:
+        return DWARF_TYPE_OTHER;
+    default:
+        break;
+    }
+    return DWARF_TYPE_VOID;
+}
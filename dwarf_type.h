@@ -0,0 +1,142 @@
+#pragma once
+#include <stdint.h>
+#include <elf.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+#include "elf_parser.h"
+#include "dwarf.h"
+
+// Kind of a type node
+enum DwarfTypeKind
+{
+    DWARF_TYPE_VOID         = 0x00,     // no DW_AT_type, also used for unresolved references
+    DWARF_TYPE_BASE         = 0x01,
+    DWARF_TYPE_POINTER      = 0x02,
+    DWARF_TYPE_REFERENCE    = 0x03,
+    DWARF_TYPE_RVALUE_REF   = 0x04,
+    DWARF_TYPE_CONST        = 0x05,
+    DWARF_TYPE_VOLATILE     = 0x06,
+    DWARF_TYPE_TYPEDEF      = 0x07,
+    DWARF_TYPE_STRUCT       = 0x08,
+    DWARF_TYPE_CLASS        = 0x09,
+    DWARF_TYPE_UNION        = 0x0a,
+    DWARF_TYPE_ENUM         = 0x0b,
+    DWARF_TYPE_ARRAY        = 0x0c,
+    DWARF_TYPE_FUNCTION     = 0x0d,     // DW_TAG_subroutine_type
+    DWARF_TYPE_OTHER        = 0x0e,     // any other type tag, kept by name only
+};
+
+// Member of struct / class / union, or parameter of a function type
+struct DwarfTypeMember
+{
+    std::string Name;
+    uint32_t TypeId;
+    uint64_t Offset;            // DW_AT_data_member_location
+    uint32_t BitSize;           // 0: not a bit field
+    uint32_t BitOffset;         // bit position from Offset
+    bool IsBase;                // DW_TAG_inheritance
+};
+
+struct DwarfTypeEnumerator
+{
+    std::string Name;
+    int64_t Value;
+};
+
+// Node of the type graph
+// Structurally identical types of different units are stored once.
+struct DwarfType
+{
+    DwarfTypeKind Kind;
+    std::string Name;
+    uint64_t ByteSize;
+    uint32_t Encoding;                          // DW_AT_encoding, base type only
+    uint32_t TargetId;                          // pointee, modified, aliased, element or return type
+    bool Declaration;                           // incomplete type (DW_AT_declaration)
+    std::vector<uint64_t> Dims;                 // array only, 0: unknown bound
+    std::vector<DwarfTypeMember> Members;       // struct / class / union members, function parameters
+    std::vector<DwarfTypeEnumerator> Enumerators;
+};
+
+// Type DIE of one unit before deduplication
+// Names point into the mapped file and references are offsets in .debug_info.
+struct DwarfRawMember
+{
+    const char *Name;
+    uint64_t TypeOffset;        // 0: no DW_AT_type
+    uint64_t Offset;
+    uint32_t BitSize;
+    uint32_t BitOffset;
+    bool IsBase;
+};
+
+struct DwarfRawEnumerator
+{
+    const char *Name;
+    int64_t Value;
+};
+
+// Dims / Members / Enumerators are allocated from the arena of the unit
+struct DwarfRawType
+{
+    uint64_t Offset;
+    DwarfTypeKind Kind;
+    uint64_t Tag;
+    const char *Name;
+    uint64_t ByteSize;
+    uint32_t Encoding;
+    uint64_t TargetOffset;      // 0: no DW_AT_type
+    bool Declaration;
+    ArenaVector<uint64_t> Dims;
+    ArenaVector<DwarfRawMember> Members;
+    ArenaVector<DwarfRawEnumerator> Enumerators;
+};
+
+// Every record of a unit is freed at once with its arena
+struct DwarfTypeUnit
+{
+    std::shared_ptr<Arena> Records;             // owns Types and what they point to
+    uint64_t Offset;                            // offset of the unit in .debug_info
+    uint64_t DieCount;                          // all DIEs of the unit
+    ArenaVector<DwarfRawType> Types;            // sorted by Offset
+};
+
+// Type graph of the whole binary
+// Units are read independently by ReadUnit (which does not touch the graph, so it can run in any thread)
+// and merged by AddUnits, where each type is hash-consed on a key built from its structure.
+// A struct key uses the names, offsets and a shallow description of member types instead of
+// member type ids, so a self-referencing struct gets its id before its members are resolved.
+class DwarfTypeGraph
+{
+public:
+    DwarfTypeGraph();
+    static DwarfTypeUnit ReadUnit(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const DwarfCuEntry &cuEntry);
+    void AddUnits(const std::vector<DwarfTypeUnit> &units);
+    bool FindTypeId(const uint64_t dieOffset, uint32_t &typeId) const;
+    const DwarfType &GetType(const uint32_t typeId) const;
+    std::string GetTypeName(const uint32_t typeId) const;
+    uint64_t GetTypeSize(const uint32_t typeId) const;
+    size_t TypeCount() const;
+    uint64_t TypeDieCount() const;
+    uint64_t DieCount() const;
+
+private:
+    uint32_t internRaw(const std::vector<const DwarfTypeUnit *> &units, const uint64_t dieOffset);
+    uint32_t intern(const std::string &key, const DwarfType &type);
+    std::string getShallowKey(const std::vector<const DwarfTypeUnit *> &units, const uint64_t dieOffset, const int depth) const;
+    std::string getTypeName(const uint32_t typeId, const int depth) const;
+    uint64_t getTypeSize(const uint32_t typeId, const int depth) const;
+    static const DwarfRawType *findRaw(const std::vector<const DwarfTypeUnit *> &units, const uint64_t dieOffset);
+    static DwarfTypeKind getKind(const uint64_t tag);
+
+private:
+    std::vector<DwarfType> _types;                              // Index is type id, 0 is void
+    std::unordered_map<std::string, uint32_t> _keyTypeIdMap;    // hash-consing table
+    std::unordered_map<uint64_t, uint32_t> _offsetTypeIdMap;    // key: offset of type DIE in .debug_info
+    std::map<std::string, uint64_t> _nameDefOffsetMap;          // key: kind and name, value: offset of the only definition
+    uint64_t _dieCount;
+};
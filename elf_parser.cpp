@@ -3,6 +3,8 @@
 #include <fstream>
 #include <iostream>
 #include <cstring>
+#include <unordered_map>
+#include <algorithm>
 #include <elf.h>
 #include "binutil.h"
 #include "elf_parser.h"
@@ -239,12 +241,13 @@ bool Elf64::GetElfFuncInfos(const uint8_t *bin, const uint64_t size, const std::
             ElfFunctionInfo f;
             Logger::DLog("strTabShdr.sh_offset:[%ld], sym.st_name:[%ld], sym.st_value:[%ld], sym.st_size:[%ld], sym.st_shndx:[%d]", strTabShdr.sh_offset, sym.st_name, sym.st_value, sym.st_size, sym.st_shndx);
             f.Name = GetStrFromStrTbl(&bin[strTabShdr.sh_offset], strTabShdr.sh_size, sym.st_name);
+            f.SrcFileId = 0;
             f.Addr = sym.st_value;
             f.Size = sym.st_size;
+            f.ParentIdx = ELF_FUNC_IDX_NONE;
 
             Elf64_Shdr symShdr = shdrs[sym.st_shndx];
             f.SecName = GetSectionName(bin, size, secStrShdr, symShdr.sh_name);
-            f.LineAddrs = std::map<uint64_t, LineAddrInfo>();
             elfFuncInfos.push_back(f);
         }
     }
@@ -253,6 +256,206 @@ bool Elf64::GetElfFuncInfos(const uint8_t *bin, const uint64_t size, const std::
     return true;
 }
 
+void Elf64::BuildAddrFuncIdxMap(ElfFunctionTable &elfFuncTable)
+{
+    // one entry per function instead of per byte, FindFuncIdx() looks for the range holding an address
+    FlatMap<uint64_t, uint32_t> &addrFuncIdxMap = elfFuncTable.AddrFuncIdxMap;
+    addrFuncIdxMap.clear();
+    addrFuncIdxMap.reserve(elfFuncTable.ElfFuncInfos.size());
+    for (uint32_t fIdx = 0; fIdx < elfFuncTable.ElfFuncInfos.size(); fIdx++)
+    {
+        if (elfFuncTable.ElfFuncInfos[fIdx].Size != 0)
+        {
+            addrFuncIdxMap.Append(elfFuncTable.ElfFuncInfos[fIdx].Addr, fIdx);
+        }
+    }
+
+    // aliases at the same address: the later symbol wins unless it is shorter
+    const std::vector<ElfFunctionInfo> &elfFuncInfos = elfFuncTable.ElfFuncInfos;
+    addrFuncIdxMap.Seal([&elfFuncInfos](const uint32_t kept, const uint32_t appended)
+    {
+        return elfFuncInfos[kept].Size <= elfFuncInfos[appended].Size;
+    });
+}
+
+bool Elf64::FindFuncIdx(const ElfFunctionTable &elfFuncTable, const uint64_t addr, uint32_t &funcIdx)
+{
+    // last function which starts at or before addr
+    auto it = elfFuncTable.AddrFuncIdxMap.upper_bound(addr);
+    if (it == elfFuncTable.AddrFuncIdxMap.begin())
+    {
+        return false;
+    }
+
+    it--;
+    const ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[it->second];
+    if (elfFuncInfo.Addr + elfFuncInfo.Size <= addr)
+    {
+        return false;
+    }
+
+    funcIdx = it->second;
+    return true;
+}
+
+const LineAddrInfo *Elf64::FindLineAddr(const ElfFunctionInfo &elfFuncInfo, const uint64_t addr)
+{
+    if (elfFuncInfo.AddrLines.empty())
+    {
+        return nullptr;
+    }
+
+    // row at or before addr, an address before the first row or after the end of a sequence has no line
+    auto it = elfFuncInfo.AddrLines.upper_bound(addr);
+    if (it == elfFuncInfo.AddrLines.begin())
+    {
+        return nullptr;
+    }
+    it--;
+    if ((it->second.Flags & LINE_FLAG_END_SEQUENCE) != 0)
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+std::vector<bool> Elf64::FindAliases(const ElfFunctionTable &elfFuncTable)
+{
+    // symbols sharing one body (C1/C2 constructors, D1/D2 destructors, identical code folding) have the same address and size,
+    // the one of the lowest index is kept and the others are aliases, so bytes are counted once
+    const std::vector<ElfFunctionInfo> &elfFuncInfos = elfFuncTable.ElfFuncInfos;
+    std::vector<uint32_t> funcIdxs(elfFuncInfos.size());
+    for (uint32_t fIdx = 0; fIdx < elfFuncInfos.size(); fIdx++)
+    {
+        funcIdxs[fIdx] = fIdx;
+    }
+    std::sort(funcIdxs.begin(), funcIdxs.end(), [&elfFuncInfos](const uint32_t a, const uint32_t b)
+    {
+        if (elfFuncInfos[a].Addr != elfFuncInfos[b].Addr)
+        {
+            return elfFuncInfos[a].Addr < elfFuncInfos[b].Addr;
+        }
+        return (elfFuncInfos[a].Size != elfFuncInfos[b].Size) ? (elfFuncInfos[a].Size < elfFuncInfos[b].Size) : (a < b);
+    });
+
+    std::vector<bool> isAliases(elfFuncInfos.size(), false);
+    for (size_t i = 1; i < funcIdxs.size(); i++)
+    {
+        const ElfFunctionInfo &prev = elfFuncInfos[funcIdxs[i - 1]];
+        const ElfFunctionInfo &cur = elfFuncInfos[funcIdxs[i]];
+        isAliases[funcIdxs[i]] = (prev.Addr == cur.Addr) && (prev.Size == cur.Size);
+    }
+    return isAliases;
+}
+
+bool Elf64::GetFragmentBase(const std::string &name, std::string &baseName)
+{
+    // GCC names split and cloned functions <name>.cold, <name>.part.<n>, <name>.constprop.<n> and <name>.isra.<n>,
+    // a fragment of a clone adds another suffix, "foo.part.0.cold"
+    static const char *cloneKinds[] = {"part", "constprop", "isra", "cold"};
+    size_t dotPos = name.rfind('.');
+    if ((dotPos == std::string::npos) || (dotPos == 0))
+    {
+        return false;
+    }
+    if (name.compare(dotPos + 1, std::string::npos, "cold") == 0)
+    {
+        baseName = name.substr(0, dotPos);
+        return true;
+    }
+    if ((dotPos + 1 == name.size()) || (name.find_first_not_of("0123456789", dotPos + 1) != std::string::npos))
+    {
+        return false;
+    }
+    size_t kindPos = name.rfind('.', dotPos - 1);
+    if ((kindPos == std::string::npos) || (kindPos == 0))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(cloneKinds) / sizeof(cloneKinds[0]); i++)
+    {
+        if (name.compare(kindPos + 1, dotPos - kindPos - 1, cloneKinds[i]) == 0)
+        {
+            baseName = name.substr(0, kindPos);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t Elf64::LinkFragments(ElfFunctionTable &elfFuncTable)
+{
+    // the parent of a fragment is the function named without its suffixes,
+    // local functions of the same name in several units are left to the debug info (Dwarf::LinkFragments)
+    std::vector<ElfFunctionInfo> &elfFuncInfos = elfFuncTable.ElfFuncInfos;
+    std::unordered_map<std::string, uint32_t> nameFuncIdxMap;     // value: ELF_FUNC_IDX_NONE when the name is ambiguous
+    for (uint32_t fIdx = 0; fIdx < elfFuncInfos.size(); fIdx++)
+    {
+        if (elfFuncInfos[fIdx].Size == 0)
+        {
+            continue;
+        }
+        auto result = nameFuncIdxMap.insert(std::make_pair(elfFuncInfos[fIdx].Name, fIdx));
+        if (!result.second && (result.first->second != ELF_FUNC_IDX_NONE) && (elfFuncInfos[result.first->second].Addr != elfFuncInfos[fIdx].Addr))
+        {
+            result.first->second = ELF_FUNC_IDX_NONE;
+        }
+    }
+
+    uint32_t linkedCount = 0;
+    uint32_t ambiguousCount = 0;
+    std::string name;
+    std::string baseName;
+    for (uint32_t fIdx = 0; fIdx < elfFuncInfos.size(); fIdx++)
+    {
+        ElfFunctionInfo &elfFuncInfo = elfFuncInfos[fIdx];
+        if (elfFuncInfo.Size == 0)
+        {
+            continue;
+        }
+        // nearest existing ancestor, the parent of "foo.part.0.cold" is "foo.part.0" if it was kept
+        name = elfFuncInfo.Name;
+        while (GetFragmentBase(name, baseName))
+        {
+            auto it = nameFuncIdxMap.find(baseName);
+            if (it == nameFuncIdxMap.end())
+            {
+                name = baseName;
+                continue;
+            }
+            if (it->second == ELF_FUNC_IDX_NONE)
+            {
+                ambiguousCount++;
+            }
+            else
+            {
+                elfFuncInfo.ParentIdx = it->second;
+                linkedCount++;
+            }
+            break;
+        }
+    }
+    ResolveFragmentRoots(elfFuncTable);
+    Logger::DLog("fragments: linked:%d, ambiguous:%d", linkedCount, ambiguousCount);
+    return ambiguousCount;
+}
+
+void Elf64::ResolveFragmentRoots(ElfFunctionTable &elfFuncTable)
+{
+    // fragments of fragments are attributed to the function they were all split from
+    const uint32_t maxDepth = 8;
+    std::vector<ElfFunctionInfo> &elfFuncInfos = elfFuncTable.ElfFuncInfos;
+    for (uint32_t fIdx = 0; fIdx < elfFuncInfos.size(); fIdx++)
+    {
+        uint32_t rootIdx = elfFuncInfos[fIdx].ParentIdx;
+        for (uint32_t depth = 0; (depth < maxDepth) && (rootIdx != ELF_FUNC_IDX_NONE) && (elfFuncInfos[rootIdx].ParentIdx != ELF_FUNC_IDX_NONE); depth++)
+        {
+            rootIdx = elfFuncInfos[rootIdx].ParentIdx;
+        }
+        elfFuncInfos[fIdx].ParentIdx = (rootIdx != fIdx) ? rootIdx : ELF_FUNC_IDX_NONE;
+    }
+}
+
 std::string Elf64::GetStrFromStrTbl(const uint8_t *strTab, const uint64_t strTabSize, const uint64_t offset)
 {
     std::string str = "";
@@ -260,7 +463,7 @@ std::string Elf64::GetStrFromStrTbl(const uint8_t *strTab, const uint64_t strTab
     Logger::DLog("GetStrFromStrTbl In offset=[%ld], strTabSize:[%ld]", offset, strTabSize);
     while(pos < strTabSize)
     {
-        if (pos == 0)
+        if (strTab[pos] == 0)
         {
             break;
         }
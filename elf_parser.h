@@ -3,6 +3,8 @@
 #include <vector>
 #include <map>
 #include <elf.h>
+#include "flat_map.h"
+#include "file_table.h"
 
 /* Special section indices.  */
 
@@ -54,22 +56,39 @@
 #define SHN_HIRESERVE   0xffff          /* End of reserved indices */
 #endif
 
+// LineAddrInfo::Flags, line number state machine registers of the row
+const uint8_t LINE_FLAG_IS_STMT         = 0x01;
+const uint8_t LINE_FLAG_BASIC_BLOCK     = 0x02;
+const uint8_t LINE_FLAG_PROLOGUE_END    = 0x04;
+const uint8_t LINE_FLAG_EPILOGUE_BEGIN  = 0x08;
+const uint8_t LINE_FLAG_END_SEQUENCE    = 0x10;    // first address after a sequence, no source line
+
+const uint16_t LINE_COLUMN_MAX  = UINT16_MAX;       // larger columns are saturated
+const uint8_t LINE_VIEW_MAX     = UINT8_MAX;        // larger views are saturated
+
+// one line table row, packed in 24 bytes
 typedef struct {
-    uint64_t Line;
     uint64_t Addr;
-    bool IsStmt;
-    std::string SrcDirName;
-    std::string SrcFileName;
+    uint32_t Line;
+    uint32_t FileId;                                // id in ElfFunctionTable::Files
+    uint32_t Discriminator;
+    uint16_t Column;
+    uint8_t View;                                   // rows before this one at the same address
+    uint8_t Flags;                                  // LINE_FLAG_*
 } LineAddrInfo;
 
+// ParentIdx of a function which is not a fragment
+const uint32_t ELF_FUNC_IDX_NONE = UINT32_MAX;
+
 typedef struct {
     std::string Name;
-    std::string SrcDirName;
-    std::string SrcFileName;
+    uint32_t SrcFileId;                             // file of the last line row, 0: no line info
     uint64_t Addr;
     uint64_t Size;
     std::string SecName;
-    std::map<uint64_t, LineAddrInfo> LineAddrs;
+    uint32_t ParentIdx;                             // function a .cold / .part.N / .constprop.N / .isra.N fragment was split from
+    FlatMap<uint64_t, LineAddrInfo> LineAddrs;      // key: line
+    FlatMap<uint64_t, LineAddrInfo> AddrLines;      // key: address, the last row at each address, end_sequence rows included
 } ElfFunctionInfo;
 
 // ElfFunctionInfo array and Map
@@ -77,7 +96,8 @@ typedef struct
 {
     std::string Path;                               // elf file path
     std::vector<ElfFunctionInfo> ElfFuncInfos;      // elf function infos
-    std::map<uint64_t, uint32_t> AddrFuncIdxMap;    // key: function address, value: Index of ElfFuncInfos
+    FlatMap<uint64_t, uint32_t> AddrFuncIdxMap;     // key: function start address, value: Index of ElfFuncInfos
+    FileTable Files;                                // source files of line rows and units
 } ElfFunctionTable;
 
 class Elf
@@ -99,6 +119,13 @@ public:
     static std::string GetSectionName(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &strShdr, uint64_t sh_name);
     static bool GetSymbolTbl(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &symTabShdr, std::vector<Elf64_Sym> &symTbl);
     static bool GetElfFuncInfos(const uint8_t *bin, const uint64_t size, const std::vector<Elf64_Shdr> &shdrs, const std::vector<Elf64_Sym> &symTbl, const Elf64_Shdr &secStrShdr, const Elf64_Shdr &strTabShdr, std::vector<ElfFunctionInfo> &elfFuncInfos);
+    static void BuildAddrFuncIdxMap(ElfFunctionTable &elfFuncTable);
+    static bool FindFuncIdx(const ElfFunctionTable &elfFuncTable, const uint64_t addr, uint32_t &funcIdx);
+    static const LineAddrInfo *FindLineAddr(const ElfFunctionInfo &elfFuncInfo, const uint64_t addr);
+    static std::vector<bool> FindAliases(const ElfFunctionTable &elfFuncTable);
+    static bool GetFragmentBase(const std::string &name, std::string &baseName);
+    static uint32_t LinkFragments(ElfFunctionTable &elfFuncTable);
+    static void ResolveFragmentRoots(ElfFunctionTable &elfFuncTable);
     static std::string GetStrFromStrTbl(const uint8_t *strTab, const uint64_t strTabSize, const uint64_t offset);
     static std::string GetClassStr(const Elf64_Ehdr &ehdr);
     static void ShowElf64Ehdr(const Elf64_Ehdr &ehdr);
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include "file_table.h"
+
+static std::string_view getBaseName(const std::string_view path)
+{
+    size_t pos = path.rfind('/');
+    return (pos == std::string_view::npos) ? path : path.substr(pos + 1);
+}
+
+FileTable::FileTable()
+{
+    // id 0 / Index 0: unknown file, empty string
+    internString("");
+    _files.push_back({0, 0});
+    _fileIdMap[0] = 0;
+}
+
+uint32_t FileTable::Intern(const std::string &dirName, const std::string &fileName)
+{
+    uint32_t dirIdx = internString(dirName);
+    uint32_t nameIdx = internString(fileName);
+    uint64_t key = ((uint64_t)dirIdx << 32) | nameIdx;
+    auto it = _fileIdMap.find(key);
+    if (it != _fileIdMap.end())
+    {
+        return it->second;
+    }
+
+    uint32_t fileId = _files.size();
+    _files.push_back({dirIdx, nameIdx});
+    _fileIdMap[key] = fileId;
+    _baseNameFileIdMap.emplace(getBaseName(_strs[nameIdx]), fileId);
+    return fileId;
+}
+
+const std::string &FileTable::GetDirName(const uint32_t fileId) const
+{
+    return _strs[_files[fileId].DirIdx];
+}
+
+const std::string &FileTable::GetFileName(const uint32_t fileId) const
+{
+    return _strs[_files[fileId].NameIdx];
+}
+
+std::string FileTable::GetPath(const uint32_t fileId) const
+{
+    const std::string &dirName = GetDirName(fileId);
+    if (dirName.size() == 0)
+    {
+        return GetFileName(fileId);
+    }
+    return dirName + "/" + GetFileName(fileId);
+}
+
+void FileTable::FindFiles(const std::string &path, std::vector<uint32_t> &fileIds) const
+{
+    // "foo.cc" or "src/foo.cc" matches "/work/src/foo.cc", but "o.cc" does not
+    auto range = _baseNameFileIdMap.equal_range(getBaseName(path));
+    for (auto it = range.first; it != range.second; it++)
+    {
+        std::string filePath = GetPath(it->second);
+        if ((filePath == path) ||
+            ((path.size() < filePath.size()) && (filePath.compare(filePath.size() - path.size(), path.size(), path) == 0) && (filePath[filePath.size() - path.size() - 1] == '/')))
+        {
+            fileIds.push_back(it->second);
+        }
+    }
+    std::sort(fileIds.begin(), fileIds.end());
+}
+
+size_t FileTable::Size() const
+{
+    return _files.size();
+}
+
+uint32_t FileTable::internString(const std::string &str)
+{
+    auto it = _strIdxMap.find(str);
+    if (it != _strIdxMap.end())
+    {
+        return it->second;
+    }
+
+    uint32_t strIdx = _strs.size();
+    _strs.push_back(str);
+    _strIdxMap[_strs.back()] = strIdx;
+    return strIdx;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Source files of every line program and unit, each (directory, name) pair is kept once
+// Line rows refer to a file by a 32-bit id, full paths are joined only for output.
+// Id 0 is the unknown file with an empty directory and name.
+// Not thread safe, files are interned when decoded rows are merged.
+class FileTable
+{
+public:
+    FileTable();
+    uint32_t Intern(const std::string &dirName, const std::string &fileName);
+    const std::string &GetDirName(const uint32_t fileId) const;
+    const std::string &GetFileName(const uint32_t fileId) const;
+    std::string GetPath(const uint32_t fileId) const;
+    void FindFiles(const std::string &path, std::vector<uint32_t> &fileIds) const;
+    size_t Size() const;
+
+private:
+    uint32_t internString(const std::string &str);
+
+private:
+    struct FileEntry
+    {
+        uint32_t DirIdx;        // Index of _strs
+        uint32_t NameIdx;       // Index of _strs
+    };
+    std::vector<FileEntry> _files;                              // Index: file id
+    std::deque<std::string> _strs;                              // deque, so views of the keys stay valid
+    std::unordered_map<std::string_view, uint32_t> _strIdxMap;  // value: Index of _strs
+    std::unordered_map<uint64_t, uint32_t> _fileIdMap;          // key: DirIdx << 32 | NameIdx, value: file id
+    std::unordered_multimap<std::string_view, uint32_t> _baseNameFileIdMap;    // key: last path component, value: file id
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Sorted vector of key / value pairs for tables built once and read afterwards
+// Entries are appended in any order and sorted once by Seal(), lookups are binary searches
+// on contiguous memory. As with std::map::operator[], an entry appended again with the same key
+// replaces the earlier one, Seal(replace) can keep the earlier one instead.
+// Lookups only see entries appended before the last Seal().
+template<typename K, typename V>
+class FlatMap
+{
+public:
+    typedef std::pair<K, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    FlatMap() :
+        _sortedCount(0)
+    {
+    }
+
+    void Append(const K &key, const V &value)
+    {
+        _entries.emplace_back(key, value);
+    }
+
+    void Append(const K &key, V &&value)
+    {
+        _entries.emplace_back(key, std::move(value));
+    }
+
+    void Seal()
+    {
+        Seal([](const V &, const V &) { return true; });
+    }
+
+    // replace(kept, appended): true if the entry appended later replaces the one kept
+    template<typename Replace>
+    void Seal(Replace replace)
+    {
+        if (_sortedCount == _entries.size())
+        {
+            return;
+        }
+
+        // stable, entries with the same key stay in the order they were appended
+        auto lessKey = [](const value_type &a, const value_type &b)
+        {
+            return a.first < b.first;
+        };
+        std::stable_sort(_entries.begin() + _sortedCount, _entries.end(), lessKey);
+        std::inplace_merge(_entries.begin(), _entries.begin() + _sortedCount, _entries.end(), lessKey);
+
+        size_t count = 0;
+        for (size_t i = 0; i < _entries.size(); i++)
+        {
+            if ((count != 0) && (_entries[count - 1].first == _entries[i].first))
+            {
+                if (replace(_entries[count - 1].second, _entries[i].second))
+                {
+                    _entries[count - 1].second = std::move(_entries[i].second);
+                }
+                continue;
+            }
+            if (count != i)
+            {
+                _entries[count] = std::move(_entries[i]);
+            }
+            count++;
+        }
+        _entries.erase(_entries.begin() + count, _entries.end());
+        _sortedCount = count;
+    }
+
+    iterator find(const K &key)
+    {
+        iterator it = lower_bound(key);
+        return ((it != end()) && (it->first == key)) ? it : end();
+    }
+
+    const_iterator find(const K &key) const
+    {
+        const_iterator it = lower_bound(key);
+        return ((it != end()) && (it->first == key)) ? it : end();
+    }
+
+    iterator lower_bound(const K &key)
+    {
+        return std::lower_bound(_entries.begin(), _entries.begin() + _sortedCount, key, lessThanKey);
+    }
+
+    const_iterator lower_bound(const K &key) const
+    {
+        return std::lower_bound(_entries.begin(), _entries.begin() + _sortedCount, key, lessThanKey);
+    }
+
+    iterator upper_bound(const K &key)
+    {
+        return std::upper_bound(_entries.begin(), _entries.begin() + _sortedCount, key, keyLessThan);
+    }
+
+    const_iterator upper_bound(const K &key) const
+    {
+        return std::upper_bound(_entries.begin(), _entries.begin() + _sortedCount, key, keyLessThan);
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        _sortedCount--;
+        return _entries.erase(pos);
+    }
+
+    iterator begin()
+    {
+        return _entries.begin();
+    }
+
+    iterator end()
+    {
+        return _entries.begin() + _sortedCount;
+    }
+
+    const_iterator begin() const
+    {
+        return _entries.begin();
+    }
+
+    const_iterator end() const
+    {
+        return _entries.begin() + _sortedCount;
+    }
+
+    size_t size() const
+    {
+        return _sortedCount;
+    }
+
+    bool empty() const
+    {
+        return _sortedCount == 0;
+    }
+
+    size_t capacity() const
+    {
+        return _entries.capacity();
+    }
+
+    void reserve(const size_t count)
+    {
+        _entries.reserve(count);
+    }
+
+    void clear()
+    {
+        _entries.clear();
+        _sortedCount = 0;
+    }
+
+    void swap(FlatMap &other)
+    {
+        _entries.swap(other._entries);
+        std::swap(_sortedCount, other._sortedCount);
+    }
+
+private:
+    static bool lessThanKey(const value_type &entry, const K &key)
+    {
+        return entry.first < key;
+    }
+
+    static bool keyLessThan(const K &key, const value_type &entry)
+    {
+        return key < entry.first;
+    }
+
+private:
+    std::vector<value_type> _entries;
+    size_t _sortedCount;        // entries [0, _sortedCount) are sorted and unique
+};
@@ -0,0 +1,217 @@
+#include <unordered_set>
+#include "function_order.h"
+#include "logger.h"
+
+// Index of a function without a caller or a cluster
+static const uint32_t ORDER_FUNC_NONE = UINT32_MAX;
+
+// clusters are not merged beyond a page, so the hot path of a call chain stays in one page
+static const uint64_t ORDER_MAX_CLUSTER_SIZE = 4096;
+
+// a callee this much colder than the cluster of its caller would dilute it
+static const double ORDER_MAX_DENSITY_RATIO = 8.0;
+
+FunctionOrder::FunctionOrder(const ElfFunctionTable &elfFuncTable) :
+    _elfFuncTable(elfFuncTable)
+{
+}
+
+bool FunctionOrder::ReadSamples(const std::string &path)
+{
+    return SampleReader::ReadSamples(path, [&](const std::vector<uint64_t> &stack, const uint64_t count)
+    {
+        uint32_t funcIdx = 0;
+        if (Elf64::FindFuncIdx(_elfFuncTable, stack[0], funcIdx))
+        {
+            _samples.Add(funcIdx, count);
+        }
+
+        // the call instruction is right before the return address
+        for (size_t i = 0; i + 1 < stack.size(); i++)
+        {
+            addCall(stack[i + 1] - 1, stack[i], count);
+        }
+    });
+}
+
+bool FunctionOrder::ReadBranches(const std::string &path)
+{
+    return SampleReader::ReadBranchStacks(path, [&](const std::vector<std::pair<uint64_t, uint64_t>> &stack)
+    {
+        for (auto it = stack.begin(); it != stack.end(); it++)
+        {
+            // a branch to the entry of a function is a call
+            if (_elfFuncTable.AddrFuncIdxMap.find(it->second) != _elfFuncTable.AddrFuncIdxMap.end())
+            {
+                addCall(it->first, it->second, 1);
+            }
+        }
+    });
+}
+
+void FunctionOrder::Build()
+{
+    _samples.Flush();
+    _calls.Flush();
+
+    size_t funcCount = _elfFuncTable.ElfFuncInfos.size();
+    std::vector<uint64_t> samples(funcCount, 0);
+    std::vector<bool> called(funcCount, false);
+    for (auto it = _samples.Counts().begin(); it != _samples.Counts().end(); it++)
+    {
+        samples[it->first] = it->second;
+    }
+
+    // most frequent caller of each function
+    std::vector<uint32_t> callers(funcCount, ORDER_FUNC_NONE);
+    std::vector<uint64_t> callerCounts(funcCount, 0);
+    for (auto it = _calls.Counts().begin(); it != _calls.Counts().end(); it++)
+    {
+        uint32_t caller = it->first.first;
+        uint32_t callee = it->first.second;
+        called[caller] = true;
+        called[callee] = true;
+        if (callerCounts[callee] < it->second)
+        {
+            callers[callee] = caller;
+            callerCounts[callee] = it->second;
+        }
+        if (_samples.Total() == 0)
+        {
+            // without PC samples, functions are as hot as they are called
+            samples[callee] += it->second;
+        }
+    }
+
+    // one cluster per function, hottest first
+    std::vector<uint32_t> funcIdxs;
+    for (uint32_t funcIdx = 0; funcIdx < funcCount; funcIdx++)
+    {
+        if ((samples[funcIdx] != 0) || called[funcIdx])
+        {
+            funcIdxs.push_back(funcIdx);
+        }
+    }
+    std::sort(funcIdxs.begin(), funcIdxs.end(), [&](const uint32_t a, const uint32_t b)
+    {
+        if (samples[a] != samples[b])
+        {
+            return (samples[b] < samples[a]);
+        }
+        return (_elfFuncTable.ElfFuncInfos[a].Addr < _elfFuncTable.ElfFuncInfos[b].Addr);
+    });
+
+    std::vector<Cluster> clusters;
+    std::vector<uint32_t> clusterIdxs(funcCount, ORDER_FUNC_NONE);
+    clusters.reserve(funcIdxs.size());
+    for (auto it = funcIdxs.begin(); it != funcIdxs.end(); it++)
+    {
+        clusterIdxs[*it] = clusters.size();
+        clusters.push_back({{*it}, samples[*it], std::max<uint64_t>(_elfFuncTable.ElfFuncInfos[*it].Size, 1)});
+    }
+
+    // append the cluster of each function to the cluster of its most frequent caller
+    for (auto it = funcIdxs.begin(); it != funcIdxs.end(); it++)
+    {
+        uint32_t caller = callers[*it];
+        if (caller == ORDER_FUNC_NONE)
+        {
+            continue;
+        }
+        uint32_t clusterIdx = clusterIdxs[*it];
+        uint32_t callerClusterIdx = clusterIdxs[caller];
+        if (clusterIdx == callerClusterIdx)
+        {
+            continue;
+        }
+
+        Cluster &cluster = clusters[clusterIdx];
+        Cluster &callerCluster = clusters[callerClusterIdx];
+        if (ORDER_MAX_CLUSTER_SIZE < cluster.Size + callerCluster.Size)
+        {
+            continue;
+        }
+        if ((double)cluster.Samples * callerCluster.Size * ORDER_MAX_DENSITY_RATIO < (double)callerCluster.Samples * cluster.Size)
+        {
+            continue;
+        }
+
+        for (auto funcIt = cluster.FuncIdxs.begin(); funcIt != cluster.FuncIdxs.end(); funcIt++)
+        {
+            clusterIdxs[*funcIt] = callerClusterIdx;
+            callerCluster.FuncIdxs.push_back(*funcIt);
+        }
+        callerCluster.Samples += cluster.Samples;
+        callerCluster.Size += cluster.Size;
+        cluster.FuncIdxs.clear();
+        cluster.FuncIdxs.shrink_to_fit();
+    }
+
+    _clusters.clear();
+    for (auto it = clusters.begin(); it != clusters.end(); it++)
+    {
+        if (it->FuncIdxs.size() != 0)
+        {
+            _clusters.push_back(std::move(*it));
+        }
+    }
+    std::stable_sort(_clusters.begin(), _clusters.end(), isDenser);
+
+    _order.clear();
+    for (auto it = _clusters.begin(); it != _clusters.end(); it++)
+    {
+        _order.insert(_order.end(), it->FuncIdxs.begin(), it->FuncIdxs.end());
+    }
+    Logger::DLog("ordered functions:%ld, clusters:%ld", _order.size(), _clusters.size());
+}
+
+void FunctionOrder::Write(std::ostream &os, const bool sections) const
+{
+    // local functions of different units may share a name, the linker takes each name once
+    std::unordered_set<std::string> names;
+    for (auto it = _order.begin(); it != _order.end(); it++)
+    {
+        const std::string &name = _elfFuncTable.ElfFuncInfos[*it].Name;
+        if ((name.size() == 0) || !names.insert(name).second)
+        {
+            continue;
+        }
+        if (sections)
+        {
+            os << ".text.";
+        }
+        os << name << "\n";
+    }
+}
+
+uint64_t FunctionOrder::SampleCount() const
+{
+    return _samples.Total();
+}
+
+uint64_t FunctionOrder::CallCount() const
+{
+    return _calls.Total();
+}
+
+size_t FunctionOrder::ClusterCount() const
+{
+    return _clusters.size();
+}
+
+void FunctionOrder::addCall(const uint64_t callerAddr, const uint64_t calleeAddr, const uint64_t count)
+{
+    uint32_t caller = 0;
+    uint32_t callee = 0;
+    if (!Elf64::FindFuncIdx(_elfFuncTable, callerAddr, caller) || !Elf64::FindFuncIdx(_elfFuncTable, calleeAddr, callee) || (caller == callee))
+    {
+        return;
+    }
+    _calls.Add(std::make_pair(caller, callee), count);
+}
+
+bool FunctionOrder::isDenser(const Cluster &a, const Cluster &b)
+{
+    // samples per byte, compared without dividing
+    return ((double)b.Samples * a.Size < (double)a.Samples * b.Size);
+}
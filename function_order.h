@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "elf_parser.h"
+#include "sample_reader.h"
+
+// Link order of hot functions (C3, Ottoni and Maher, CGO 2017)
+// Functions are visited from the hottest, and the cluster of each one is appended to the cluster
+// of its most frequent caller, so callees are placed right after their callers.
+// Clusters are placed by sample density, hottest bytes first.
+// Samples and calls are counted per function in sorted batches, so memory is bounded by
+// the functions and the call edges, not by the samples.
+class FunctionOrder
+{
+public:
+    explicit FunctionOrder(const ElfFunctionTable &elfFuncTable);
+    bool ReadSamples(const std::string &path);
+    bool ReadBranches(const std::string &path);
+    void Build();
+    // symbol names for --symbol-ordering-file, or .text.<name> sections for --section-ordering-file
+    void Write(std::ostream &os, const bool sections) const;
+    uint64_t SampleCount() const;
+    uint64_t CallCount() const;
+    size_t ClusterCount() const;
+
+private:
+    struct Cluster
+    {
+        std::vector<uint32_t> FuncIdxs;
+        uint64_t Samples;
+        uint64_t Size;
+    };
+    void addCall(const uint64_t callerAddr, const uint64_t calleeAddr, const uint64_t count);
+    static bool isDenser(const Cluster &a, const Cluster &b);
+
+private:
+    const ElfFunctionTable &_elfFuncTable;
+    SampleCounter<uint32_t> _samples;                           // key: Index of ElfFuncInfos
+    SampleCounter<std::pair<uint32_t, uint32_t>> _calls;        // key: caller, callee
+    std::vector<Cluster> _clusters;
+    std::vector<uint32_t> _order;                               // Index of ElfFuncInfos
+};
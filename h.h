@@ -0,0 +1,4 @@
+static inline int helper(int v)
+{
+    return v + 1;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <unordered_map>
+#include "inline_report.h"
+#include "demangler.h"
+#include "parallel.h"
+#include "logger.h"
+
+// sites counted by one task before the chunks are merged
+static const size_t INLINE_REPORT_CHUNK_SITES = 64 * 1024;
+
+InlineReport::InlineReport(const DwarfInlineTable &inlineTable, const ElfFunctionTable &elfFuncTable, const unsigned threadCount)
+    : _inlineTable(inlineTable), _elfFuncTable(elfFuncTable), _threadCount(threadCount)
+{
+}
+
+void InlineReport::Build()
+{
+    Logger::TLog("InlineReport::Build In...");
+    const std::vector<DwarfInlineSite> &sites = _inlineTable.Sites();
+
+    // count copies per (origin, function) DIE pair in chunks, then merge the much shorter chunk counts
+    size_t chunkCount = (sites.size() + INLINE_REPORT_CHUNK_SITES - 1) / INLINE_REPORT_CHUNK_SITES;
+    std::vector<std::vector<OriginCount>> chunkCounts(chunkCount);
+    Parallel::For(chunkCount, _threadCount, [&](const size_t idx)
+    {
+        size_t begin = idx * INLINE_REPORT_CHUNK_SITES;
+        size_t end = std::min(begin + INLINE_REPORT_CHUNK_SITES, sites.size());
+        std::vector<OriginCount> &counts = chunkCounts[idx];
+        counts.reserve(end - begin);
+        for (size_t i = begin; i < end; i++)
+        {
+            if (sites[i].OriginOffset != 0)
+            {
+                counts.push_back(OriginCount{sites[i].OriginOffset, sites[i].FuncOffset, 1, sites[i].Size});
+            }
+        }
+        reduce(counts);
+    });
+    std::vector<OriginCount> counts;
+    for (auto it = chunkCounts.begin(); it != chunkCounts.end(); it++)
+    {
+        counts.insert(counts.end(), it->begin(), it->end());
+        std::vector<OriginCount>().swap(*it);
+    }
+    reduce(counts);
+
+    // names are resolved once per DIE, an origin and a function DIE may be the same subprogram
+    std::vector<uint64_t> dieOffsets;
+    dieOffsets.reserve(counts.size() * 2);
+    for (auto it = counts.begin(); it != counts.end(); it++)
+    {
+        dieOffsets.push_back(it->OriginOffset);
+        dieOffsets.push_back(it->FuncOffset);
+    }
+    std::sort(dieOffsets.begin(), dieOffsets.end());
+    dieOffsets.erase(std::unique(dieOffsets.begin(), dieOffsets.end()), dieOffsets.end());
+    std::vector<std::string> dieNames(dieOffsets.size());
+    Parallel::For(dieOffsets.size(), _threadCount, [&](const size_t idx)
+    {
+        dieNames[idx] = (dieOffsets[idx] != 0) ? _inlineTable.GetName(dieOffsets[idx]) : "";
+    });
+
+    // DIEs of the same name are one function
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> nameIdxMap;
+    std::vector<uint32_t> dieNameIdxs(dieOffsets.size());
+    for (size_t i = 0; i < dieOffsets.size(); i++)
+    {
+        auto result = nameIdxMap.insert(std::make_pair(dieNames[i], (uint32_t)names.size()));
+        if (result.second)
+        {
+            names.push_back(dieNames[i]);
+        }
+        dieNameIdxs[i] = result.first->second;
+    }
+    auto getNameIdx = [&](const uint64_t dieOffset)
+    {
+        return dieNameIdxs[std::lower_bound(dieOffsets.begin(), dieOffsets.end(), dieOffset) - dieOffsets.begin()];
+    };
+    std::vector<OriginCount> nameCounts;
+    nameCounts.reserve(counts.size());
+    for (auto it = counts.begin(); it != counts.end(); it++)
+    {
+        nameCounts.push_back(OriginCount{getNameIdx(it->OriginOffset), getNameIdx(it->FuncOffset), it->Copies, it->Bytes});
+    }
+    std::vector<OriginCount>().swap(counts);
+    reduce(nameCounts);
+
+    std::vector<uint64_t> outOfLineBytes(names.size(), 0);
+    for (auto it = _elfFuncTable.ElfFuncInfos.begin(); it != _elfFuncTable.ElfFuncInfos.end(); it++)
+    {
+        auto nameIt = nameIdxMap.find(it->Name);
+        if (nameIt != nameIdxMap.end())
+        {
+            outOfLineBytes[nameIt->second] += it->Size;
+        }
+    }
+    std::vector<const std::string *> demangledNames = Demangler::DemangleAll(names, _threadCount);
+    static const std::string unknownName = "[unknown]";
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        if (names[i].size() == 0)
+        {
+            demangledNames[i] = &unknownName;
+        }
+    }
+
+    // nameCounts is sorted by callee, so the callers of a callee are contiguous
+    _callees.clear();
+    for (size_t i = 0; i < nameCounts.size(); i++)
+    {
+        const OriginCount &count = nameCounts[i];
+        if ((i == 0) || (nameCounts[i - 1].OriginOffset != count.OriginOffset))
+        {
+            _callees.push_back(InlineCallee{*demangledNames[count.OriginOffset], 0, 0, outOfLineBytes[count.OriginOffset], {}});
+        }
+        InlineCallee &callee = _callees.back();
+        callee.Copies += count.Copies;
+        callee.Bytes += count.Bytes;
+        callee.Callers.push_back(InlineCaller{*demangledNames[count.FuncOffset], count.Copies, count.Bytes});
+    }
+    auto byBytes = [](const uint64_t bytesA, const std::string &nameA, const uint64_t bytesB, const std::string &nameB)
+    {
+        return (bytesA != bytesB) ? (bytesB < bytesA) : (nameA < nameB);
+    };
+    Parallel::For(_callees.size(), _threadCount, [&](const size_t idx)
+    {
+        std::vector<InlineCaller> &callers = _callees[idx].Callers;
+        std::sort(callers.begin(), callers.end(), [&](const InlineCaller &a, const InlineCaller &b)
+        {
+            return byBytes(a.Bytes, a.Name, b.Bytes, b.Name);
+        });
+    });
+    std::sort(_callees.begin(), _callees.end(), [&](const InlineCallee &a, const InlineCallee &b)
+    {
+        return byBytes(a.Bytes, a.Name, b.Bytes, b.Name);
+    });
+    Logger::DLog("inline sites:%ld, callees:%ld", sites.size(), _callees.size());
+    Logger::TLog("InlineReport::Build Out...");
+}
+
+const std::vector<InlineCallee> &InlineReport::Callees() const
+{
+    return _callees;
+}
+
+void InlineReport::reduce(std::vector<OriginCount> &counts)
+{
+    // one entry per (OriginOffset, FuncOffset), sorted by them
+    std::sort(counts.begin(), counts.end(), [](const OriginCount &a, const OriginCount &b)
+    {
+        return (a.OriginOffset != b.OriginOffset) ? (a.OriginOffset < b.OriginOffset) : (a.FuncOffset < b.FuncOffset);
+    });
+    size_t outIdx = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        if ((outIdx != 0) && (counts[outIdx - 1].OriginOffset == counts[i].OriginOffset) && (counts[outIdx - 1].FuncOffset == counts[i].FuncOffset))
+        {
+            counts[outIdx - 1].Copies += counts[i].Copies;
+            counts[outIdx - 1].Bytes += counts[i].Bytes;
+            continue;
+        }
+        counts[outIdx++] = counts[i];
+    }
+    counts.resize(outIdx);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "elf_parser.h"
+#include "dwarf_inline.h"
+
+// inlined copies of a callee in one concrete function
+struct InlineCaller
+{
+    std::string Name;           // demangled, "[unknown]": the site is outside a concrete subprogram
+    uint32_t Copies;
+    uint64_t Bytes;
+};
+
+// every inlined copy of one function
+struct InlineCallee
+{
+    std::string Name;           // demangled
+    uint32_t Copies;
+    uint64_t Bytes;             // bytes of all copies, a copy includes the sites nested in it
+    uint64_t OutOfLineBytes;    // bytes of the symbols of the function, 0: no out-of-line copy
+    std::vector<InlineCaller> Callers;      // most bytes first
+};
+
+// Inlining report: where each function was inlined and what its copies cost
+// Sites are counted by abstract origin DIE and concrete function DIE in parallel chunks first,
+// so names are resolved once per DIE. Origins are then merged by name, since each unit including
+// a header has its own abstract instance of the inline functions of the header.
+class InlineReport
+{
+public:
+    InlineReport(const DwarfInlineTable &inlineTable, const ElfFunctionTable &elfFuncTable, const unsigned threadCount);
+    void Build();
+    // most bytes first
+    const std::vector<InlineCallee> &Callees() const;
+
+private:
+    // copies of one origin in one concrete function, offsets are name indexes once merged by name
+    struct OriginCount
+    {
+        uint64_t OriginOffset;
+        uint64_t FuncOffset;
+        uint32_t Copies;
+        uint64_t Bytes;
+    };
+    static void reduce(std::vector<OriginCount> &counts);
+
+private:
+    const DwarfInlineTable &_inlineTable;
+    const ElfFunctionTable &_elfFuncTable;
+    unsigned _threadCount;
+    std::vector<InlineCallee> _callees;
+};
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include "line_index.h"
+#include "logger.h"
+
+SourceLineIndex::SourceLineIndex() :
+    _elfFuncTable(nullptr)
+{
+}
+
+void SourceLineIndex::Add(const SourceLineEntry &entry)
+{
+    _entries.push_back(entry);
+}
+
+void SourceLineIndex::Seal(const ElfFunctionTable &elfFuncTable)
+{
+    _elfFuncTable = &elfFuncTable;
+
+    // rows at the same address are added in view order, the last one is what the address executes
+    _addrEntries = _entries;
+    std::stable_sort(_addrEntries.begin(), _addrEntries.end(), [](const SourceLineEntry &a, const SourceLineEntry &b)
+    {
+        return a.Addr < b.Addr;
+    });
+    size_t count = 0;
+    for (size_t i = 0; i < _addrEntries.size(); i++)
+    {
+        if ((count != 0) && (_addrEntries[count - 1].Addr == _addrEntries[i].Addr))
+        {
+            _addrEntries[count - 1] = _addrEntries[i];
+            continue;
+        }
+        _addrEntries[count++] = _addrEntries[i];
+    }
+    _addrEntries.resize(count);
+
+    // rows of each function in address order first, to find its entry and the end of its prologue
+    // rows at the same address stay in view order
+    std::stable_sort(_entries.begin(), _entries.end(), [](const SourceLineEntry &a, const SourceLineEntry &b)
+    {
+        return (a.FuncIdx != b.FuncIdx) ? (a.FuncIdx < b.FuncIdx) : (a.Addr < b.Addr);
+    });
+    size_t funcTop = 0;
+    while (funcTop < _entries.size())
+    {
+        size_t funcEnd = funcTop;
+        while ((funcEnd < _entries.size()) && (_entries[funcEnd].FuncIdx == _entries[funcTop].FuncIdx))
+        {
+            funcEnd++;
+        }
+
+        // prologue_end of the line table, otherwise the first row of another line after the entry
+        // (the same guess as gdb makes for compilers which do not emit prologue_end).
+        // Another line at the entry address means there is no prologue.
+        const SourceLineEntry &first = _entries[funcTop];
+        uint64_t bodyAddr = first.Addr;
+        bool found = false;
+        for (size_t i = funcTop; (i < funcEnd) && !found; i++)
+        {
+            if (_entries[i].PrologueEnd)
+            {
+                bodyAddr = _entries[i].Addr;
+                found = true;
+            }
+        }
+        for (size_t i = funcTop; (i < funcEnd) && !found; i++)
+        {
+            if (_entries[i].Line != first.Line)
+            {
+                bodyAddr = _entries[i].Addr;
+                found = true;
+            }
+        }
+        _funcFirstMap.Append(first.FuncIdx, first);
+        _funcBodyAddrMap.Append(first.FuncIdx, bodyAddr);
+        funcTop = funcEnd;
+    }
+    _funcFirstMap.Seal();
+    _funcBodyAddrMap.Seal();
+
+    std::sort(_entries.begin(), _entries.end(), [](const SourceLineEntry &a, const SourceLineEntry &b)
+    {
+        if (a.FileId != b.FileId)
+        {
+            return a.FileId < b.FileId;
+        }
+        return (a.Line != b.Line) ? (a.Line < b.Line) : (a.Addr < b.Addr);
+    });
+    _entries.erase(std::unique(_entries.begin(), _entries.end(), [](const SourceLineEntry &a, const SourceLineEntry &b)
+    {
+        return (a.FileId == b.FileId) && (a.Line == b.Line) && (a.Addr == b.Addr);
+    }), _entries.end());
+
+    _nameFuncIdxs.clear();
+    for (uint32_t funcIdx = 0; funcIdx < elfFuncTable.ElfFuncInfos.size(); funcIdx++)
+    {
+        _nameFuncIdxs.push_back(std::make_pair(elfFuncTable.ElfFuncInfos[funcIdx].Name, funcIdx));
+    }
+    std::sort(_nameFuncIdxs.begin(), _nameFuncIdxs.end());
+}
+
+bool SourceLineIndex::Resolve(const std::string &query, std::vector<SourceLineEntry> &entries) const
+{
+    entries.clear();
+    uint32_t num = 0;
+
+    // "file.cc:123", the file is matched by its path suffix
+    size_t pos = query.rfind(':');
+    if ((pos != std::string::npos) && parseNumber(query.substr(pos + 1), num))
+    {
+        std::vector<uint32_t> fileIds;
+        _elfFuncTable->Files.FindFiles(query.substr(0, pos), fileIds);
+        for (auto it = fileIds.begin(); it != fileIds.end(); it++)
+        {
+            FindLine(*it, num, entries);
+        }
+        return (entries.size() != 0);
+    }
+
+    // "func+line", line relative to the first line of the function
+    pos = query.rfind('+');
+    if ((pos != std::string::npos) && parseNumber(query.substr(pos + 1), num))
+    {
+        std::string funcName = query.substr(0, pos);
+        auto range = std::equal_range(_nameFuncIdxs.begin(), _nameFuncIdxs.end(), std::make_pair(funcName, (uint32_t)0), [](const std::pair<std::string, uint32_t> &a, const std::pair<std::string, uint32_t> &b)
+        {
+            return a.first < b.first;
+        });
+        for (auto it = range.first; it != range.second; it++)
+        {
+            FindFuncLine(it->second, num, entries);
+        }
+        return (entries.size() != 0);
+    }
+
+    Logger::ELog("query must be <file>:<line> or <func>+<line>: %s", query);
+    return false;
+}
+
+bool SourceLineIndex::FindLine(const uint32_t fileId, const uint32_t line, std::vector<SourceLineEntry> &entries) const
+{
+    // a line without code resolves to the next line which has some
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), std::make_pair(fileId, line), [](const SourceLineEntry &entry, const std::pair<uint32_t, uint32_t> &key)
+    {
+        return (entry.FileId != key.first) ? (entry.FileId < key.first) : (entry.Line < key.second);
+    });
+    if ((it == _entries.end()) || (it->FileId != fileId))
+    {
+        return false;
+    }
+
+    uint32_t foundLine = it->Line;
+    for (; (it != _entries.end()) && (it->FileId == fileId) && (it->Line == foundLine); it++)
+    {
+        addEntry(*it, entries);
+    }
+    return true;
+}
+
+bool SourceLineIndex::FindFuncLine(const uint32_t funcIdx, const uint32_t lineOffset, std::vector<SourceLineEntry> &entries) const
+{
+    auto firstIt = _funcFirstMap.find(funcIdx);
+    if (firstIt == _funcFirstMap.end())
+    {
+        return false;
+    }
+
+    const SourceLineEntry &first = firstIt->second;
+    if (lineOffset == 0)
+    {
+        addEntry(first, entries);
+        return true;
+    }
+
+    // only the addresses of this function, other functions may have code for the same line (e.g. inlined)
+    std::vector<SourceLineEntry> lineEntries;
+    if (!FindLine(first.FileId, first.Line + lineOffset, lineEntries))
+    {
+        return false;
+    }
+    bool found = false;
+    for (auto it = lineEntries.begin(); it != lineEntries.end(); it++)
+    {
+        if (it->FuncIdx == funcIdx)
+        {
+            entries.push_back(*it);
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool SourceLineIndex::FindAddr(const uint64_t addr, SourceLineEntry &entry) const
+{
+    // row at or before addr, in the function of addr
+    auto it = std::upper_bound(_addrEntries.begin(), _addrEntries.end(), addr, [](const uint64_t key, const SourceLineEntry &entry)
+    {
+        return key < entry.Addr;
+    });
+    if (it == _addrEntries.begin())
+    {
+        return false;
+    }
+    it--;
+
+    const ElfFunctionInfo &elfFuncInfo = _elfFuncTable->ElfFuncInfos[it->FuncIdx];
+    if (elfFuncInfo.Addr + elfFuncInfo.Size <= addr)
+    {
+        return false;
+    }
+    entry = *it;
+    return true;
+}
+
+void SourceLineIndex::FindAddrRange(const uint64_t begin, const uint64_t end, std::vector<SourceLineEntry> &entries) const
+{
+    // the row covering begin and every row starting up to end
+    SourceLineEntry entry;
+    if (FindAddr(begin, entry))
+    {
+        entries.push_back(entry);
+    }
+    auto it = std::upper_bound(_addrEntries.begin(), _addrEntries.end(), begin, [](const uint64_t key, const SourceLineEntry &entry)
+    {
+        return key < entry.Addr;
+    });
+    for (; (it != _addrEntries.end()) && (it->Addr <= end); it++)
+    {
+        entries.push_back(*it);
+    }
+}
+
+size_t SourceLineIndex::Size() const
+{
+    return _entries.size();
+}
+
+void SourceLineIndex::addEntry(const SourceLineEntry &entry, std::vector<SourceLineEntry> &entries) const
+{
+    // only the line of the function entry itself, inlined code at the entry address (optimized code) is not a prologue
+    SourceLineEntry result = entry;
+    auto firstIt = _funcFirstMap.find(entry.FuncIdx);
+    if ((firstIt != _funcFirstMap.end()) && (entry.Addr == firstIt->second.Addr) && (entry.FileId == firstIt->second.FileId) && (entry.Line == firstIt->second.Line))
+    {
+        auto bodyIt = _funcBodyAddrMap.find(entry.FuncIdx);
+        if (bodyIt != _funcBodyAddrMap.end())
+        {
+            result.Addr = bodyIt->second;
+        }
+    }
+
+    for (auto it = entries.begin(); it != entries.end(); it++)
+    {
+        if (it->Addr == result.Addr)
+        {
+            return;
+        }
+    }
+    entries.push_back(result);
+}
+
+bool SourceLineIndex::parseNumber(const std::string &str, uint32_t &val)
+{
+    if ((str.size() == 0) || (str.find_first_not_of("0123456789") != std::string::npos))
+    {
+        return false;
+    }
+    val = std::strtoul(str.c_str(), nullptr, 10);
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "elf_parser.h"
+#include "flat_map.h"
+
+// is_stmt row of a line table as kept by the reverse index
+struct SourceLineEntry
+{
+    uint32_t FileId;        // id in ElfFunctionTable::Files
+    uint32_t Line;
+    uint64_t Addr;
+    uint32_t FuncIdx;       // Index of ElfFuncInfos
+    uint32_t Discriminator;
+    bool PrologueEnd;       // DW_LNS_set_prologue_end was set for the row
+};
+
+// Reverse index from (file id, line) to every is_stmt address, for probe and breakpoint placement
+// Unlike ElfFunctionInfo::LineAddrs, every address of a line is kept. Entries are added while
+// line rows are merged and sorted once by Seal(). A line resolving to the entry of a function
+// gives the end of its prologue instead, so arguments are in place when the probe fires.
+// The rows are also kept in address order to map sampled addresses back to lines.
+class SourceLineIndex
+{
+public:
+    SourceLineIndex();
+    void Add(const SourceLineEntry &entry);
+    void Seal(const ElfFunctionTable &elfFuncTable);
+    bool Resolve(const std::string &query, std::vector<SourceLineEntry> &entries) const;
+    bool FindLine(const uint32_t fileId, const uint32_t line, std::vector<SourceLineEntry> &entries) const;
+    bool FindFuncLine(const uint32_t funcIdx, const uint32_t lineOffset, std::vector<SourceLineEntry> &entries) const;
+    bool FindAddr(const uint64_t addr, SourceLineEntry &entry) const;
+    void FindAddrRange(const uint64_t begin, const uint64_t end, std::vector<SourceLineEntry> &entries) const;
+    size_t Size() const;
+
+private:
+    void addEntry(const SourceLineEntry &entry, std::vector<SourceLineEntry> &entries) const;
+    static bool parseNumber(const std::string &str, uint32_t &val);
+
+private:
+    const ElfFunctionTable *_elfFuncTable;
+    std::vector<SourceLineEntry> _entries;                  // sorted by FileId, Line, Addr
+    std::vector<SourceLineEntry> _addrEntries;              // sorted by Addr, the last row of each address
+    FlatMap<uint32_t, SourceLineEntry> _funcFirstMap;      // key: FuncIdx, value: entry at the lowest address of the function
+    FlatMap<uint32_t, uint64_t> _funcBodyAddrMap;          // key: FuncIdx, value: first address after the prologue
+    std::vector<std::pair<std::string, uint32_t>> _nameFuncIdxs;   // function name and Index of ElfFuncInfos, sorted by name
+};
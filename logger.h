@@ -1,27 +1,41 @@
+#pragma once
 #include <string>
 #include <vector>
 #include <iostream>
 
+enum
+{
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_DEBUG = 1,
+    LOG_LEVEL_TRACE = 2,
+};
+
 class Logger
 {
 public:
+    static void SetLevel(int level)
+    {
+        _level = level;
+    }
+
 private:
-    template<typename T, typename std::enable_if<std::is_same<std::remove_cv_t<std::remove_reference_t<T>>, std::string>::value>::type* = nullptr>
-    static auto convert(T value)
+    static inline int _level = LOG_LEVEL_TRACE;
+
+    static const char *convert(const std::string &value)
     {
-        return std::forward<T>(value).c_str();
+        return value.c_str();
     }
 
-    template<typename T, typename std::enable_if<!std::is_same<std::remove_cv_t<std::remove_reference_t<T>>, std::string>::value>::type* = nullptr>
-    static auto convert(T value)
+    template<typename T>
+    static T convert(const T &value)
     {
-        return std::forward<T>(value);
+        return value;
     }
 
     template<typename ... Args>
-    static std::string strformat(const std::string &fmt, Args ... args)
+    static std::string strformat(const char *fmt, Args ... args)
     {
-        int len = std::snprintf(nullptr, 0, fmt.c_str(), std::forward<Args>(args) ...);
+        int len = std::snprintf(nullptr, 0, fmt, args ...);
         if (len < 0)
         {
             // 異常系(想定外)
@@ -29,30 +43,57 @@ private:
         }
         size_t bufSize = len + sizeof(char);
         std::vector<char> buf(bufSize);
-        std::snprintf(&buf[0], bufSize, fmt.c_str(), args ...);
+        std::snprintf(&buf[0], bufSize, fmt, args ...);
         return std::string(&buf[0], &buf[0] + len);
     }
 
 public:
+    // TLog and DLog take fmt as const char *, so a disabled level costs no allocation
     template<typename ... Args>
-    static void TLog(const std::string &fmt, Args ... args)
+    static void TLog(const char *fmt, const Args &... args)
     {
-        std::string log = strformat(fmt, convert(std::forward<Args>(args)) ...);
+        if (_level < LOG_LEVEL_TRACE)
+        {
+            return;
+        }
+        std::string log = strformat(fmt, convert(args) ...);
         std::cout << "TRACE\t" << log << std::endl;
     }
 
     template<typename ... Args>
-    static void DLog(const std::string &fmt, Args ... args)
+    static void TLog(const std::string &fmt, const Args &... args)
+    {
+        TLog(fmt.c_str(), args ...);
+    }
+
+    template<typename ... Args>
+    static void DLog(const char *fmt, const Args &... args)
     {
-        std::string log = strformat(fmt, convert(std::forward<Args>(args)) ...);
+        if (_level < LOG_LEVEL_DEBUG)
+        {
+            return;
+        }
+        std::string log = strformat(fmt, convert(args) ...);
         std::cout << "DEBUG\t" << log << std::endl;
     }
 
     template<typename ... Args>
-    static void ELog(const std::string &fmt, Args ... args)
+    static void DLog(const std::string &fmt, const Args &... args)
     {
-        std::string log = strformat(fmt, convert(std::forward<Args>(args)) ...);
+        DLog(fmt.c_str(), args ...);
+    }
+
+    template<typename ... Args>
+    static void ELog(const char *fmt, const Args &... args)
+    {
+        std::string log = strformat(fmt, convert(args) ...);
         std::cout << "ERROR\t" << log << std::endl;
     }
 
+    template<typename ... Args>
+    static void ELog(const std::string &fmt, const Args &... args)
+    {
+        ELog(fmt.c_str(), args ...);
+    }
+
 };
\ No newline at end of file
@@ -3,42 +3,831 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <cstdlib>
+#include <algorithm>
 #include <string>
 #include <map>
+#include <vector>
 #include <fstream>
 #include <iostream>
 #include <sys/stat.h>
 
 #include "elf_parser.h"
 #include "dwarf.h"
+#include "dwarf_cache.h"
+#include "dwarf_type.h"
+#include "struct_layout.h"
+#include "shared_index.h"
+#include "line_index.h"
+#include "dwarf_inline.h"
+#include "sample_profile.h"
+#include "sample_reader.h"
+#include "function_order.h"
+#include "code_footprint.h"
+#include "code_size.h"
+#include "build_diff.h"
+#include "inline_report.h"
+#include "template_bloat.h"
+#include "demangler.h"
+#include "parallel.h"
+#include "stats.h"
 #include "logger.h"
 
+struct Options
+{
+    std::string TargetPath;
+    bool Lazy;                          // decode compilation units on demand
+    size_t CacheSize;                   // max number of decoded units in lazy mode
+    uint64_t MaxMemory;                 // memory budget of decoded units in bytes, 0: no budget
+    std::string BuildIndexPath;         // shared index to build
+    std::string IndexPath;              // shared index to answer queries from
+    bool Types;                         // print the deduplicated type graph
+    bool Layout;                        // print struct layouts ranked by wasted bytes
+    std::string InstanceCountPath;      // "<type name> <count>" per line, weights wasted bytes
+    uint32_t CacheLineSize;
+    unsigned ThreadCount;               // 0: number of CPUs
+    bool ShowStats;                     // print time, memory and work of each phase as JSON
+    std::vector<uint64_t> Addrs;        // addresses to look up
+    bool Demangle;                      // demangle function names of --addr and --line
+    std::vector<std::string> Lines;     // source locations to resolve to addresses
+    std::string SamplesPath;            // "<address>[;<return address>...] [<count>]" per line
+    std::string BranchesPath;           // branch stack (LBR) per line, perf script -F brstack
+    uint64_t LoadBias;                  // subtracted from sampled addresses, runtime base of a PIE
+    std::string SampleProfilePath;      // AutoFDO text profile to write, "-": stdout
+    std::string OrderPath;              // link order of hot functions to write, "-": stdout
+    bool OrderSections;                 // .text.<name> section names instead of symbols
+    bool Footprint;                     // i-cache / iTLB footprint of the hot functions
+    bool Size;                          // code size by unit, source file, function and template
+    bool Inlines;                       // inlined copies by callee and caller
+    bool Templates;                     // template instantiations by family with identical code
+    bool Csv;                           // --size, --inlines and --templates reports as CSV
+    std::string DiffPath;               // new build compared with the target
+};
+
+static void showUsage()
+{
+    std::cout << "Usage) ./dwarf-viewer [options] <target path>" << std::endl;
+    std::cout << "  --addr <address>     show function and source line of address (can be repeated)" << std::endl;
+    std::cout << "  --line <location>    show addresses of a source location, file.cc:123 or func+line (can be repeated)" << std::endl;
+    std::cout << "  --demangle           demangle C++ and Rust function names of --addr and --line" << std::endl;
+    std::cout << "  --sample-profile <path> write an AutoFDO text profile (-fprofile-sample-use) of --samples and --lbr, - for stdout" << std::endl;
+    std::cout << "  --function-order <path> write a --symbol-ordering-file of hot functions from --samples and --lbr, - for stdout" << std::endl;
+    std::cout << "  --section-order <path>  write a --section-ordering-file (.text.<name>) instead" << std::endl;
+    std::cout << "  --samples <path>     sampled addresses, \"<address>[;<return address>...] [<count>]\" per line (e.g. perf script -F ip)" << std::endl;
+    std::cout << "  --lbr <path>         branch stacks, \"<from>/<to> ...\" per line (e.g. perf script -F brstack)" << std::endl;
+    std::cout << "  --load-bias <address> subtract from addresses of --samples and --lbr, the runtime base of a PIE or shared object" << std::endl;
+    std::cout << "                       (mmap address in perf script --show-mmap-events), not needed for non-PIE executables" << std::endl;
+    std::cout << "  --lazy               decode compilation units on demand" << std::endl;
+    std::cout << "  --cache-size <n>     max number of decoded compilation units in lazy mode (default 64)" << std::endl;
+    std::cout << "  --max-memory <size>  memory budget of decoded units and line tables, e.g. 512M (implies --lazy)" << std::endl;
+    std::cout << "  --build-index <path> write a read-only index shareable between processes, e.g. /dev/shm/foo.idx" << std::endl;
+    std::cout << "  --index <path>       answer queries from an index written by --build-index" << std::endl;
+    std::cout << "  --types              print types of all compilation units, identical types are shown once" << std::endl;
+    std::cout << "  --layout             print struct layouts with holes and cache line boundaries, most wasteful first" << std::endl;
+    std::cout << "  --instance-counts <path> weight wasted bytes by \"<type name> <count>\" lines of the file" << std::endl;
+    std::cout << "  --cacheline <n>      cache line size for --layout and --footprint (default 64)" << std::endl;
+    std::cout << "  --size               print .text bytes by unit, source file, function and template, and debug bytes by unit" << std::endl;
+    std::cout << "  --inlines            print inlined copies and their bytes by callee, with the functions they were inlined into" << std::endl;
+    std::cout << "  --templates          print template instantiations by family with their bytes and identical code" << std::endl;
+    std::cout << "  --csv                print --size, --inlines and --templates reports as CSV" << std::endl;
+    std::cout << "  --diff <new elf>     compare functions of the target (old build) and a new build by linkage name" << std::endl;
+    std::cout << "  --footprint          print cache lines and pages covered by the hot functions of --samples (every function without it)" << std::endl;
+    std::cout << "  --threads <n>        number of worker threads (default: number of CPUs)" << std::endl;
+    std::cout << "  --stats              print wall/CPU time, peak RSS, allocations and hardware counters of each phase as JSON to stderr" << std::endl;
+}
+
+// size with optional K/M/G suffix
+static uint64_t parseSize(const char *str)
+{
+    char *end = nullptr;
+    uint64_t val = std::strtoull(str, &end, 0);
+    switch (*end)
+    {
+    case 'k':
+    case 'K':
+        val <<= 10;
+        break;
+    case 'm':
+    case 'M':
+        val <<= 20;
+        break;
+    case 'g':
+    case 'G':
+        val <<= 30;
+        break;
+    default:
+        break;
+    }
+    return val;
+}
+
+static bool parseOptions(int argc, char **argv, Options &opts)
+{
+    opts.Lazy = false;
+    opts.CacheSize = 64;
+    opts.MaxMemory = 0;
+    opts.LoadBias = 0;
+    opts.Types = false;
+    opts.Layout = false;
+    opts.CacheLineSize = 64;
+    opts.ThreadCount = 0;
+    opts.ShowStats = false;
+    opts.Demangle = false;
+    opts.OrderSections = false;
+    opts.Footprint = false;
+    opts.Size = false;
+    opts.Inlines = false;
+    opts.Templates = false;
+    opts.Csv = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--lazy")
+        {
+            opts.Lazy = true;
+        }
+        else if (arg == "--types")
+        {
+            opts.Types = true;
+        }
+        else if (arg == "--stats")
+        {
+            opts.ShowStats = true;
+        }
+        else if (arg == "--demangle")
+        {
+            opts.Demangle = true;
+        }
+        else if (arg == "--size")
+        {
+            opts.Size = true;
+        }
+        else if (arg == "--inlines")
+        {
+            opts.Inlines = true;
+        }
+        else if (arg == "--templates")
+        {
+            opts.Templates = true;
+        }
+        else if (arg == "--csv")
+        {
+            opts.Csv = true;
+        }
+        else if ((arg == "--diff") && (i + 1 < argc))
+        {
+            i++;
+            opts.DiffPath = argv[i];
+        }
+        else if (arg == "--footprint")
+        {
+            opts.Footprint = true;
+        }
+        else if (arg == "--layout")
+        {
+            opts.Layout = true;
+        }
+        else if ((arg == "--instance-counts") && (i + 1 < argc))
+        {
+            i++;
+            opts.InstanceCountPath = argv[i];
+            opts.Layout = true;
+        }
+        else if ((arg == "--cacheline") && (i + 1 < argc))
+        {
+            i++;
+            opts.CacheLineSize = std::strtoul(argv[i], nullptr, 0);
+        }
+        else if ((arg == "--threads") && (i + 1 < argc))
+        {
+            i++;
+            opts.ThreadCount = std::strtoul(argv[i], nullptr, 0);
+        }
+        else if ((arg == "--addr") && (i + 1 < argc))
+        {
+            i++;
+            opts.Addrs.push_back(std::strtoull(argv[i], nullptr, 0));
+        }
+        else if ((arg == "--line") && (i + 1 < argc))
+        {
+            i++;
+            opts.Lines.push_back(argv[i]);
+        }
+        else if ((arg == "--sample-profile") && (i + 1 < argc))
+        {
+            i++;
+            opts.SampleProfilePath = argv[i];
+        }
+        else if (((arg == "--function-order") || (arg == "--section-order")) && (i + 1 < argc))
+        {
+            i++;
+            opts.OrderPath = argv[i];
+            opts.OrderSections = (arg == "--section-order");
+        }
+        else if ((arg == "--samples") && (i + 1 < argc))
+        {
+            i++;
+            opts.SamplesPath = argv[i];
+        }
+        else if ((arg == "--lbr") && (i + 1 < argc))
+        {
+            i++;
+            opts.BranchesPath = argv[i];
+        }
+        else if ((arg == "--load-bias") && (i + 1 < argc))
+        {
+            i++;
+            opts.LoadBias = std::strtoull(argv[i], nullptr, 0);
+        }
+        else if ((arg == "--cache-size") && (i + 1 < argc))
+        {
+            i++;
+            opts.CacheSize = std::strtoull(argv[i], nullptr, 0);
+        }
+        else if ((arg == "--max-memory") && (i + 1 < argc))
+        {
+            i++;
+            opts.MaxMemory = parseSize(argv[i]);
+            opts.Lazy = true;
+        }
+        else if ((arg == "--build-index") && (i + 1 < argc))
+        {
+            i++;
+            opts.BuildIndexPath = argv[i];
+        }
+        else if ((arg == "--index") && (i + 1 < argc))
+        {
+            i++;
+            opts.IndexPath = argv[i];
+        }
+        else if ((arg.size() != 0) && (arg[0] == '-'))
+        {
+            return false;
+        }
+        else
+        {
+            opts.TargetPath = arg;
+        }
+    }
+    return (opts.TargetPath.size() != 0);
+}
+
+// result of an address query
+struct AddrInfo
+{
+    bool HasFunc;
+    std::string FuncName;
+    std::string ParentName;     // function the fragment FuncName was split from, "": not a fragment
+    uint64_t FuncAddr;
+    bool HasLine;
+    std::string SrcDirName;
+    std::string SrcFileName;
+    uint64_t Line;
+    uint32_t Column;            // 0: no column
+    uint32_t Discriminator;
+    uint8_t View;
+    uint8_t LineFlags;          // LINE_FLAG_*
+    bool HasCu;
+    std::string CuFileName;
+};
+
+static AddrInfo getAddrInfo(const uint64_t addr, ElfFunctionTable &elfFuncTable, const DwarfCuDebugInfo *cuDbgInfo)
+{
+    AddrInfo addrInfo;
+    addrInfo.HasFunc = false;
+    addrInfo.HasLine = false;
+    addrInfo.HasCu = (cuDbgInfo != nullptr);
+    if (addrInfo.HasCu)
+    {
+        addrInfo.CuFileName = cuDbgInfo->FileName;
+    }
+
+    uint32_t funcIdx = 0;
+    if (!Elf64::FindFuncIdx(elfFuncTable, addr, funcIdx))
+    {
+        return addrInfo;
+    }
+
+    const ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[funcIdx];
+    addrInfo.HasFunc = true;
+    addrInfo.FuncName = elfFuncInfo.Name;
+    if (elfFuncInfo.ParentIdx != ELF_FUNC_IDX_NONE)
+    {
+        addrInfo.ParentName = elfFuncTable.ElfFuncInfos[elfFuncInfo.ParentIdx].Name;
+    }
+    addrInfo.FuncAddr = elfFuncInfo.Addr;
+
+    const LineAddrInfo *lineAddr = Elf64::FindLineAddr(elfFuncInfo, addr);
+    if (lineAddr != nullptr)
+    {
+        addrInfo.HasLine = true;
+        addrInfo.SrcDirName = elfFuncTable.Files.GetDirName(lineAddr->FileId);
+        addrInfo.SrcFileName = elfFuncTable.Files.GetFileName(lineAddr->FileId);
+        addrInfo.Line = lineAddr->Line;
+        addrInfo.Column = lineAddr->Column;
+        addrInfo.Discriminator = lineAddr->Discriminator;
+        addrInfo.View = lineAddr->View;
+        addrInfo.LineFlags = lineAddr->Flags;
+    }
+    return addrInfo;
+}
+
+static AddrInfo getAddrInfo(const uint64_t addr, const SharedIndex &index)
+{
+    AddrInfo addrInfo;
+    addrInfo.HasFunc = false;
+    addrInfo.HasLine = false;
+    addrInfo.HasCu = false;
+
+    const SharedIndexCu *cu = index.FindCu(addr);
+    if (cu != nullptr)
+    {
+        addrInfo.HasCu = true;
+        addrInfo.CuFileName = index.GetString(cu->FileNameOff);
+    }
+
+    const SharedIndexFunc *func = index.FindFunc(addr);
+    if (func == nullptr)
+    {
+        return addrInfo;
+    }
+    addrInfo.HasFunc = true;
+    addrInfo.FuncName = index.GetString(func->NameOff);
+    addrInfo.ParentName = index.GetString(func->ParentNameOff);
+    addrInfo.FuncAddr = func->Addr;
+
+    const SharedIndexLine *line = index.FindLine(*func, addr);
+    if (line != nullptr)
+    {
+        addrInfo.HasLine = true;
+        addrInfo.SrcDirName = index.GetString(line->SrcDirOff);
+        addrInfo.SrcFileName = index.GetString(line->SrcFileOff);
+        addrInfo.Line = line->Line;
+        addrInfo.Column = line->Column;
+        addrInfo.Discriminator = line->Discriminator;
+        addrInfo.View = line->View;
+        addrInfo.LineFlags = line->Flags;
+    }
+    return addrInfo;
+}
+
+static void showAddrInfo(const uint64_t addr, const AddrInfo &addrInfo, const bool demangle)
+{
+    std::string msg = StringHelper::strprintf("0x%016lx", addr);
+    if (!addrInfo.HasFunc)
+    {
+        std::cout << msg << " ??" << std::endl;
+        return;
+    }
+
+    msg += StringHelper::strprintf(" %s+0x%lx", demangle ? Demangler::Demangle(addrInfo.FuncName) : addrInfo.FuncName, addr - addrInfo.FuncAddr);
+    if (addrInfo.ParentName.size() != 0)
+    {
+        msg += StringHelper::strprintf(" (fragment of %s)", demangle ? Demangler::Demangle(addrInfo.ParentName) : addrInfo.ParentName);
+    }
+    if (addrInfo.HasLine)
+    {
+        msg += StringHelper::strprintf(" at %s/%s:%ld", addrInfo.SrcDirName, addrInfo.SrcFileName, addrInfo.Line);
+        if (addrInfo.Discriminator != 0)
+        {
+            // same as addr2line
+            msg += StringHelper::strprintf(" (discriminator %u)", addrInfo.Discriminator);
+        }
+    }
+    if (addrInfo.HasCu)
+    {
+        msg += StringHelper::strprintf(" (cu:%s)", addrInfo.CuFileName);
+    }
+    std::cout << msg << std::endl;
+}
+
+static void showLineEntries(const std::string &query, const std::vector<SourceLineEntry> &entries, const ElfFunctionTable &elfFuncTable, const bool demangle)
+{
+    for (auto it = entries.begin(); it != entries.end(); it++)
+    {
+        const ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[it->FuncIdx];
+        std::string msg = StringHelper::strprintf("%s -> 0x%016lx %s+0x%lx at %s/%s:%u", query.c_str(), it->Addr, demangle ? Demangler::Demangle(elfFuncInfo.Name).c_str() : elfFuncInfo.Name.c_str(), it->Addr - elfFuncInfo.Addr,
+            elfFuncTable.Files.GetDirName(it->FileId).c_str(), elfFuncTable.Files.GetFileName(it->FileId).c_str(), it->Line);
+        if (elfFuncInfo.ParentIdx != ELF_FUNC_IDX_NONE)
+        {
+            const std::string &parentName = elfFuncTable.ElfFuncInfos[elfFuncInfo.ParentIdx].Name;
+            msg += StringHelper::strprintf(" (fragment of %s)", demangle ? Demangler::Demangle(parentName) : parentName);
+        }
+        std::cout << msg << std::endl;
+    }
+}
+
+static void showTypes(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr)
+{
+    std::vector<DwarfCuEntry> cuEntries = Dwarf::ReadCuHeaders(bin, size, dbgInfoShdr);
+    std::vector<DwarfTypeUnit> typeUnits;
+    for (auto it = cuEntries.begin(); it != cuEntries.end(); it++)
+    {
+        typeUnits.push_back(DwarfTypeGraph::ReadUnit(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, *it));
+    }
+
+    DwarfTypeGraph typeGraph;
+    typeGraph.AddUnits(typeUnits);
+    for (uint32_t typeId = 1; typeId < typeGraph.TypeCount(); typeId++)
+    {
+        const DwarfType &type = typeGraph.GetType(typeId);
+        std::cout << StringHelper::strprintf("%6d %6ld %s", typeId, typeGraph.GetTypeSize(typeId), typeGraph.GetTypeName(typeId)) << std::endl;
+        for (auto it = type.Members.begin(); it != type.Members.end(); it++)
+        {
+            if ((type.Kind == DWARF_TYPE_FUNCTION) || (type.Kind == DWARF_TYPE_VOID))
+            {
+                break;
+            }
+            std::cout << StringHelper::strprintf("       %6ld   %s %s", it->Offset, typeGraph.GetTypeName(it->TypeId), it->Name) << std::endl;
+        }
+    }
+    std::cout << StringHelper::strprintf("units:%ld DIEs:%ld type DIEs:%ld unique types:%ld", cuEntries.size(), typeGraph.DieCount(), typeGraph.TypeDieCount(), typeGraph.TypeCount()) << std::endl;
+}
+
+static void showLayouts(const Options &opts, const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr)
+{
+    StructLayoutAnalyzer analyzer(opts.CacheLineSize, opts.ThreadCount);
+    if ((opts.InstanceCountPath.size() != 0) && !analyzer.ReadInstanceCounts(opts.InstanceCountPath))
+    {
+        std::exit(EXIT_FAILURE);
+    }
+    analyzer.Build(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr);
+
+    std::vector<StructLayout> layouts = analyzer.Analyze();
+    for (auto it = layouts.begin(); it != layouts.end(); it++)
+    {
+        for (auto lineIt = it->Lines.begin(); lineIt != it->Lines.end(); lineIt++)
+        {
+            std::cout << *lineIt << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << StringHelper::strprintf("%6s %8s %10s %12s %8s  %s", "rank", "wasted", "instances", "score", "size", "type") << std::endl;
+    for (size_t i = 0; i < layouts.size(); i++)
+    {
+        const StructLayout &layout = layouts[i];
+        if (layout.WastedBytes() == 0)
+        {
+            break;
+        }
+        std::cout << StringHelper::strprintf("%6ld %8ld %10ld %12ld %8ld  %s", i + 1, layout.WastedBytes(), layout.InstanceCount, layout.Score(), layout.Size, analyzer.TypeGraph().GetTypeName(layout.TypeId)) << std::endl;
+    }
+}
+
+static bool showFootprint(const Options &opts, const ElfFunctionTable &elfFuncTable)
+{
+    CodeFootprintAnalyzer analyzer(elfFuncTable, opts.CacheLineSize);
+    if ((opts.SamplesPath.size() != 0) && !analyzer.ReadSamples(opts.SamplesPath))
+    {
+        return false;
+    }
+    CodeFootprintReport report = analyzer.Analyze();
+
+    if (report.TotalSamples == 0)
+    {
+        std::cout << StringHelper::strprintf("functions: %d, hot: %d (no samples, every function with a size)", report.FuncCount, report.HotFuncCount) << std::endl;
+    }
+    else
+    {
+        std::cout << StringHelper::strprintf("functions: %d, hot: %d (%ld of %ld samples)", report.FuncCount, report.HotFuncCount, report.HotSamples, report.TotalSamples) << std::endl;
+    }
+    std::cout << StringHelper::strprintf("%-10s %12s %12s %12s %12s", "", "bytes", "cachelines", "4KiB pages", "2MiB pages") << std::endl;
+    const CodeFootprint &hot = report.Hot;
+    const CodeFootprint &packed = report.Packed;
+    std::cout << StringHelper::strprintf("%-10s %12ld %12ld %12ld %12ld", "linked", hot.Bytes, hot.CacheLines, hot.SmallPages, hot.HugePages) << std::endl;
+    std::cout << StringHelper::strprintf("%-10s %12ld %12ld %12ld %12ld", "reordered", packed.Bytes, packed.CacheLines, packed.SmallPages, packed.HugePages) << std::endl;
+    std::cout << StringHelper::strprintf("%-10s %12ld %12ld %12ld %12ld", "gain", (int64_t)(hot.Bytes - packed.Bytes), (int64_t)(hot.CacheLines - packed.CacheLines), (int64_t)(hot.SmallPages - packed.SmallPages), (int64_t)(hot.HugePages - packed.HugePages)) << std::endl;
+
+    // one iTLB entry per page, text remapped on huge pages keeps the linked layout
+    std::cout << StringHelper::strprintf("iTLB entries: linked %ld, huge page text %ld, reordered huge page text %ld", hot.SmallPages, hot.HugePages, packed.HugePages) << std::endl;
+
+    const size_t maxMisaligned = 20;
+    std::cout << StringHelper::strprintf("misaligned hot entries: %ld", report.Misaligned.size()) << std::endl;
+    for (size_t i = 0; (i < report.Misaligned.size()) && (i < maxMisaligned); i++)
+    {
+        const MisalignedEntry &entry = report.Misaligned[i];
+        const ElfFunctionInfo &funcInfo = elfFuncTable.ElfFuncInfos[entry.FuncIdx];
+        std::cout << StringHelper::strprintf("  %12ld 0x%016lx +%-3d %-8s %s", entry.Samples, funcInfo.Addr, entry.LineOffset, entry.Straddle ? "straddle" : "", funcInfo.Name) << std::endl;
+    }
+    return true;
+}
+
+static std::string quoteCsv(std::string name)
+{
+    // names hold commas, a quote in them is doubled
+    for (size_t pos = name.find('"'); pos != std::string::npos; pos = name.find('"', pos + 2))
+    {
+        name.insert(pos, "\"");
+    }
+    return "\"" + name + "\"";
+}
+
+static void showSizes(const Options &opts, const CodeSizeAnalyzer &analyzer)
+{
+    static const char *titles[CODE_SIZE_REPORT_COUNT] = {"unit", "file", "function", "template"};
+    const size_t maxRows = 20;
+    if (opts.Csv)
+    {
+        std::cout << "report,name,text_bytes,debug_bytes,functions" << std::endl;
+    }
+    for (uint32_t kind = 0; kind < CODE_SIZE_REPORT_COUNT; kind++)
+    {
+        const std::vector<CodeSizeEntry> &entries = analyzer.GetReport(kind);
+        if (opts.Csv)
+        {
+            // every row
+            for (auto it = entries.begin(); it != entries.end(); it++)
+            {
+                std::cout << StringHelper::strprintf("%s,%s,%ld,%ld,%d", titles[kind], quoteCsv(it->Name), it->TextBytes, it->DebugBytes, it->Count) << std::endl;
+            }
+            continue;
+        }
+
+        uint64_t totalText = 0;
+        uint64_t totalDebug = 0;
+        for (auto it = entries.begin(); it != entries.end(); it++)
+        {
+            totalText += it->TextBytes;
+            totalDebug += it->DebugBytes;
+        }
+        std::cout << StringHelper::strprintf("%12s %6s %12s %10s  %s", "text", "%", "debug", "functions", titles[kind]) << std::endl;
+        CodeSizeEntry other = {"[other]", 0, 0, 0};
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (maxRows <= i)
+            {
+                other.TextBytes += entries[i].TextBytes;
+                other.DebugBytes += entries[i].DebugBytes;
+                other.Count += entries[i].Count;
+                continue;
+            }
+            double ratio = (totalText != 0) ? entries[i].TextBytes * 100.0 / totalText : 0.0;
+            std::cout << StringHelper::strprintf("%12ld %5.1f%% %12ld %10d  %s", entries[i].TextBytes, ratio, entries[i].DebugBytes, entries[i].Count, entries[i].Name) << std::endl;
+        }
+        if (maxRows < entries.size())
+        {
+            double ratio = (totalText != 0) ? other.TextBytes * 100.0 / totalText : 0.0;
+            std::cout << StringHelper::strprintf("%12ld %5.1f%% %12ld %10d  %s", other.TextBytes, ratio, other.DebugBytes, other.Count, other.Name) << std::endl;
+        }
+        std::cout << StringHelper::strprintf("%12ld %6s %12ld %10s  %s", totalText, "", totalDebug, "", "total") << std::endl;
+        std::cout << std::endl;
+    }
+}
+
+static void showInlines(const Options &opts, const InlineReport &report)
+{
+    const std::vector<InlineCallee> &callees = report.Callees();
+    if (opts.Csv)
+    {
+        // one row per callee and caller
+        std::cout << "callee,caller,copies,bytes,out_of_line_bytes" << std::endl;
+        for (auto it = callees.begin(); it != callees.end(); it++)
+        {
+            std::string calleeName = quoteCsv(it->Name);
+            for (auto callerIt = it->Callers.begin(); callerIt != it->Callers.end(); callerIt++)
+            {
+                std::cout << StringHelper::strprintf("%s,%s,%d,%ld,%ld", calleeName, quoteCsv(callerIt->Name), callerIt->Copies, callerIt->Bytes, it->OutOfLineBytes) << std::endl;
+            }
+        }
+        return;
+    }
+
+    const size_t maxRows = 30;
+    const size_t maxCallers = 3;
+    std::cout << StringHelper::strprintf("%8s %12s %12s %8s  %s", "copies", "bytes", "out-of-line", "callers", "callee") << std::endl;
+    for (size_t i = 0; (i < callees.size()) && (i < maxRows); i++)
+    {
+        const InlineCallee &callee = callees[i];
+        std::cout << StringHelper::strprintf("%8d %12ld %12ld %8ld  %s", callee.Copies, callee.Bytes, callee.OutOfLineBytes, callee.Callers.size(), callee.Name) << std::endl;
+        for (size_t j = 0; (j < callee.Callers.size()) && (j < maxCallers); j++)
+        {
+            const InlineCaller &caller = callee.Callers[j];
+            std::cout << StringHelper::strprintf("%8d %12ld %12s %8s    in %s", caller.Copies, caller.Bytes, "", "", caller.Name) << std::endl;
+        }
+    }
+    std::cout << StringHelper::strprintf("callees: %ld", callees.size()) << std::endl;
+}
+
+static void showTemplates(const Options &opts, const TemplateBloatAnalyzer &analyzer)
+{
+    const std::vector<TemplateFamily> &families = analyzer.Families();
+    if (opts.Csv)
+    {
+        // one row per instantiation, identical_set numbers the sets of identical code in the family
+        std::cout << "family,function,bytes,identical_set" << std::endl;
+        for (auto it = families.begin(); it != families.end(); it++)
+        {
+            std::vector<uint32_t> setNos(it->Members.size(), 0);
+            for (size_t i = 0; i < it->Identical.size(); i++)
+            {
+                for (auto idxIt = it->Identical[i].begin(); idxIt != it->Identical[i].end(); idxIt++)
+                {
+                    setNos[*idxIt] = i + 1;
+                }
+            }
+            std::string familyName = quoteCsv(it->Name);
+            for (size_t i = 0; i < it->Members.size(); i++)
+            {
+                std::cout << StringHelper::strprintf("%s,%s,%ld,%d", familyName, quoteCsv(it->Members[i].Name), it->Members[i].Size, setNos[i]) << std::endl;
+            }
+        }
+        return;
+    }
+
+    const size_t maxRows = 20;
+    const size_t maxMembers = 3;
+    const size_t maxSets = 3;
+    uint64_t totalBytes = 0;
+    uint64_t totalFoldable = 0;
+    for (auto it = families.begin(); it != families.end(); it++)
+    {
+        totalBytes += it->Bytes;
+        totalFoldable += it->FoldableBytes;
+    }
+    std::cout << StringHelper::strprintf("%8s %12s %12s  %s", "count", "bytes", "foldable", "family") << std::endl;
+    for (size_t i = 0; (i < families.size()) && (i < maxRows); i++)
+    {
+        const TemplateFamily &family = families[i];
+        std::cout << StringHelper::strprintf("%8ld %12ld %12ld  %s", family.Members.size(), family.Bytes, family.FoldableBytes, family.Name) << std::endl;
+        for (size_t j = 0; (j < family.Members.size()) && (j < maxMembers); j++)
+        {
+            std::cout << StringHelper::strprintf("%8s %12ld %12s    %s", "", family.Members[j].Size, "", family.Members[j].Name) << std::endl;
+        }
+        for (size_t j = 0; (j < family.Identical.size()) && (j < maxSets); j++)
+        {
+            const std::vector<uint32_t> &set = family.Identical[j];
+            const TemplateMember &member = family.Members[set[0]];
+            std::cout << StringHelper::strprintf("%8s %12ld %12s    identical x%ld: %s", "", member.Size, "", set.size(), member.Name) << std::endl;
+        }
+    }
+    std::cout << StringHelper::strprintf("families: %ld, bytes: %ld, foldable: %ld", families.size(), totalBytes, totalFoldable) << std::endl;
+}
+
+static bool writeFunctionOrder(const Options &opts, const ElfFunctionTable &elfFuncTable)
+{
+    Stats::BeginPhase("read_samples");
+    FunctionOrder order(elfFuncTable);
+    if ((opts.SamplesPath.size() != 0) && !order.ReadSamples(opts.SamplesPath))
+    {
+        return false;
+    }
+    if ((opts.BranchesPath.size() != 0) && !order.ReadBranches(opts.BranchesPath))
+    {
+        return false;
+    }
+    Stats::EndPhase();
+
+    Stats::BeginPhase("function_order");
+    order.Build();
+    Logger::DLog("samples:%ld, calls:%ld, clusters:%ld", order.SampleCount(), order.CallCount(), order.ClusterCount());
+    if (opts.OrderPath == "-")
+    {
+        order.Write(std::cout, opts.OrderSections);
+    }
+    else
+    {
+        std::ofstream ofs(opts.OrderPath);
+        if (!ofs)
+        {
+            Logger::ELog("%s can not be opened", opts.OrderPath);
+            return false;
+        }
+        order.Write(ofs, opts.OrderSections);
+    }
+    Stats::EndPhase();
+    return true;
+}
+
+static bool writeSampleProfile(const Options &opts, const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr, const Elf64_Shdr &dbgRangesShdr, const Elf64_Shdr &dbgRngListsShdr, const ElfFunctionTable &elfFuncTable, const SourceLineIndex &lineIndex)
+{
+    Stats::BeginPhase("DwarfInlineTable");
+    DwarfInlineTable inlineTable;
+    inlineTable.Build(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, dbgRangesShdr, dbgRngListsShdr, opts.ThreadCount);
+    Stats::EndPhase();
+
+    Stats::BeginPhase("read_samples");
+    SampleProfile profile(elfFuncTable, lineIndex, inlineTable);
+    if ((opts.SamplesPath.size() != 0) && !profile.ReadSamples(opts.SamplesPath))
+    {
+        return false;
+    }
+    if ((opts.BranchesPath.size() != 0) && !profile.ReadBranches(opts.BranchesPath))
+    {
+        return false;
+    }
+    Stats::EndPhase();
+
+    Stats::BeginPhase("sample_profile");
+    profile.Build();
+    Logger::DLog("samples:%ld, branches:%ld, inline sites:%ld", profile.SampleCount(), profile.BranchCount(), inlineTable.Sites().size());
+    if (opts.SampleProfilePath == "-")
+    {
+        profile.Write(std::cout);
+    }
+    else
+    {
+        std::ofstream ofs(opts.SampleProfilePath);
+        if (!ofs)
+        {
+            Logger::ELog("%s can not be opened", opts.SampleProfilePath);
+            return false;
+        }
+        profile.Write(ofs);
+    }
+    Stats::EndPhase();
+    return true;
+}
+
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    Options opts;
+    if (!parseOptions(argc, argv, opts))
     {
-        std::cout << "Usage) ./dwarf-viewer <target path>" << std::endl;
+        showUsage();
         std::exit(EXIT_FAILURE);
     }
 
+    // logs go to stdout, so every report and query prints its results only
+    bool isReport = (opts.Addrs.size() != 0) || (opts.Lines.size() != 0) || opts.Types || opts.Layout || opts.ShowStats ||
+        (opts.DiffPath.size() != 0) || opts.Footprint || opts.Size || opts.Inlines || opts.Templates || opts.Csv ||
+        (opts.SampleProfilePath.size() != 0) || (opts.OrderPath.size() != 0) || (opts.IndexPath.size() != 0);
+    if (isReport)
+    {
+        Logger::SetLevel(LOG_LEVEL_ERROR);
+    }
+    if (opts.ShowStats)
+    {
+        Stats::Enable();
+        // reports exit where they finish, so the stats are written at exit
+        // stderr has nothing else, so it can be parsed as is
+        std::atexit([]()
+        {
+            std::cerr << Stats::ToJson() << std::endl;
+        });
+    }
+
+    if (opts.IndexPath.size() != 0)
+    {
+        // nothing is parsed, the index built by another process is mapped read-only
+        SharedIndex index;
+        if (!index.Open(opts.IndexPath, opts.TargetPath))
+        {
+            std::exit(EXIT_FAILURE);
+        }
+        for (auto it = opts.Addrs.begin(); it != opts.Addrs.end(); it++)
+        {
+            showAddrInfo(*it, getAddrInfo(*it, index), opts.Demangle);
+        }
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (opts.DiffPath.size() != 0)
+    {
+        // both builds are indexed at the same time, each with half of the threads
+        unsigned threadCount = (opts.ThreadCount != 0) ? opts.ThreadCount : Parallel::DefaultThreadCount();
+        unsigned buildThreadCount = std::max(threadCount / 2, 1u);
+        BuildIndex indexes[2];
+        const std::string paths[2] = {opts.TargetPath, opts.DiffPath};
+        bool loaded[2] = {false, false};
+        Stats::BeginPhase("BuildIndex");
+        Parallel::For(2, threadCount, [&](size_t idx)
+        {
+            loaded[idx] = indexes[idx].Load(paths[idx], buildThreadCount);
+        });
+        Stats::EndPhase();
+        if (!loaded[0] || !loaded[1])
+        {
+            std::exit(EXIT_FAILURE);
+        }
+
+        Stats::BeginPhase("build_diff");
+        BuildDiff diff(indexes[0], indexes[1]);
+        diff.Compare();
+        diff.Write(std::cout, 20);
+        Stats::EndPhase();
+        std::exit(EXIT_SUCCESS);
+    }
+
+    const char *targetPath = opts.TargetPath.c_str();
     struct stat st;
-    int ret = stat(argv[1], &st);
+    int ret = stat(targetPath, &st);
     if (ret < 0)
     {
-        std::string msg = StringHelper::strprintf("%s not exitst", argv[1]);
+        std::string msg = StringHelper::strprintf("%s not exitst", targetPath);
         std::cout << msg << std::endl;
         std::exit(EXIT_FAILURE);
     }
 
-    Logger::DLog("target:[%s]", argv[1]);
+    Logger::DLog("target:[%s]", targetPath);
     const uint64_t binSize = st.st_size;
-    int fd = open(argv[1], O_RDONLY);
+    int fd = open(targetPath, O_RDONLY);
     if(fd < 0)
     {
         std::exit(EXIT_FAILURE);
         return -1;
     }
 
+    Stats::BeginPhase("elf_scan");
     const uint8_t* pBin = (uint8_t *)mmap(NULL, binSize, PROT_READ, MAP_PRIVATE, fd, 0);
     if (!Elf::IsElf(pBin, binSize))
     {
@@ -86,6 +875,17 @@ int main(int argc, char **argv)
         offset += ehdr.e_phentsize;
     }
 
+    // sampled addresses outside the code of the target are reported, see --load-bias
+    std::vector<std::pair<uint64_t, uint64_t>> codeSegments;
+    for (auto it = phdrs.begin(); it != phdrs.end(); it++)
+    {
+        if ((it->p_type == PT_LOAD) && ((it->p_flags & PF_X) != 0))
+        {
+            codeSegments.push_back(std::make_pair(it->p_vaddr, it->p_vaddr + it->p_memsz));
+        }
+    }
+    SampleReader::SetAddressSpace(opts.LoadBias, codeSegments);
+
     std::map<std::string, uint32_t> sectionNameShdrIdxMap; // key: section name, value: section Idx
     Elf64_Shdr secStrSh = shdrs[ehdr.e_shstrndx];
     for (uint32_t i = 0; i < shdrs.size(); i++)
@@ -95,30 +895,64 @@ int main(int argc, char **argv)
         sectionNameShdrIdxMap[secName] = i;
     }
 
+    Stats::EndPhase();
+
     // read .symtab
+    Stats::BeginPhase("GetSymbolTbl");
     uint32_t shIdx = sectionNameShdrIdxMap[".symtab"];
     Elf64_Shdr &symTabShdr = shdrs[shIdx];
     std::vector<Elf64_Sym> symTbl;
     Elf64::GetSymbolTbl(pBin, binSize, symTabShdr, symTbl);
+    Stats::EndPhase();
 
     ElfFunctionTable elfFuncTable;
     // read .strtab
     shIdx = sectionNameShdrIdxMap[".strtab"];
     Elf64_Shdr &strTabShdr = shdrs[shIdx];
+    Stats::BeginPhase("GetElfFuncInfos");
     Elf64::GetElfFuncInfos(pBin, binSize, shdrs, symTbl, secStrSh, strTabShdr, elfFuncTable.ElfFuncInfos);
+    Stats::EndPhase();
 
     // make function addr <-> function Idx Map
-    std::map<uint64_t, int> addrFuncIdxMap;
-    for (uint32_t fIdx = 0; fIdx < elfFuncTable.ElfFuncInfos.size(); fIdx++)
+    Stats::BeginPhase("AddrFuncIdxMap");
+    Elf64::BuildAddrFuncIdxMap(elfFuncTable);
+    Stats::EndPhase();
+
+    // .cold / .part.N / .constprop.N fragments are linked to their parent once here, names shared by
+    // local functions of several units are resolved by the debug info below
+    Stats::BeginPhase("LinkFragments");
+    uint32_t ambiguousFragmentCount = Elf64::LinkFragments(elfFuncTable);
+    Stats::EndPhase();
+
+    if (opts.Footprint)
+    {
+        // functions are found by the symbol table, no debug info is needed
+        if (!showFootprint(opts, elfFuncTable))
+        {
+            std::exit(EXIT_FAILURE);
+        }
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (opts.Templates)
     {
-        ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[fIdx];
-        uint64_t offset = 0;
-        while (offset < elfFuncInfo.Size)
+        // linkage names and code bytes are in the symbol table and .text, no debug info is needed
+        Stats::BeginPhase("template_bloat");
+        TemplateBloatAnalyzer analyzer(elfFuncTable, opts.ThreadCount);
+        analyzer.Build(pBin, binSize, shdrs);
+        Stats::EndPhase();
+        showTemplates(opts, analyzer);
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (opts.OrderPath.size() != 0)
+    {
+        // functions are found by the symbol table, no debug info is needed
+        if (!writeFunctionOrder(opts, elfFuncTable))
         {
-            uint64_t funcAddr = elfFuncInfo.Addr + offset;
-            offset++;
-            elfFuncTable.AddrFuncIdxMap[funcAddr] = fIdx;
+            std::exit(EXIT_FAILURE);
         }
+        std::exit(EXIT_SUCCESS);
     }
 
     if (sectionNameShdrIdxMap.find(".debug_aranges") == sectionNameShdrIdxMap.end())
@@ -135,13 +969,6 @@ int main(int argc, char **argv)
         std::exit(EXIT_FAILURE);
     }
 
-    if (sectionNameShdrIdxMap.find(".debug_line_str") == sectionNameShdrIdxMap.end())
-    {
-        std::string msg = ".debug_line_str section not found. You need to set -g option for build.";
-        std::cerr << msg << std::endl;;
-        std::exit(EXIT_FAILURE);
-    }
-
     if (sectionNameShdrIdxMap.find(".debug_abbrev") == sectionNameShdrIdxMap.end())
     {
         std::string msg = ".debug_abbrev section not found. You need to set -g option for build.";
@@ -165,15 +992,19 @@ int main(int argc, char **argv)
 
     shIdx = sectionNameShdrIdxMap[".debug_aranges"];
     Elf64_Shdr &debugArangesShdr = shdrs[shIdx];
-    std::map<uint64_t, DwarfArangeInfo> arrangesMap = Dwarf::ReadAranges(pBin, binSize, debugArangesShdr);
+    Stats::BeginPhase("ReadAranges");
+    DwarfArangeMap arrangesMap = Dwarf::ReadAranges(pBin, binSize, debugArangesShdr);
+    Stats::EndPhase();
 
     shIdx = sectionNameShdrIdxMap[".debug_line"];
     Elf64_Shdr &dbgLineShdr = shdrs[shIdx];
 
-    shIdx = sectionNameShdrIdxMap[".debug_line_str"];
-    Elf64_Shdr &dbgLineStrShdr = shdrs[shIdx];
-
-    std::map<uint64_t, DwarfLineInfoHdr> offsetLineInfoMap = Dwarf::ReadLineInfo(pBin, binSize, dbgLineShdr, dbgLineStrShdr, elfFuncTable);
+    // DWARF 4 has no .debug_line_str, its line tables keep the strings inline
+    Elf64_Shdr dbgLineStrShdr = {};
+    if (sectionNameShdrIdxMap.find(".debug_line_str") != sectionNameShdrIdxMap.end())
+    {
+        dbgLineStrShdr = shdrs[sectionNameShdrIdxMap[".debug_line_str"]];
+    }
 
     shIdx = sectionNameShdrIdxMap[".debug_abbrev"];
     Elf64_Shdr &dbgAbbrevShdr = shdrs[shIdx];
@@ -184,7 +1015,173 @@ int main(int argc, char **argv)
     shIdx = sectionNameShdrIdxMap[".debug_str"];
     Elf64_Shdr &dbgStrShdr = shdrs[shIdx];
 
-    std::vector<DwarfCuDebugInfo> dbgInfos = Dwarf::ReadDebugInfo(pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, arrangesMap, offsetLineInfoMap);
+    if (opts.Layout)
+    {
+        Stats::BeginPhase("layout");
+        showLayouts(opts, pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr);
+        Stats::EndPhase();
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (opts.Types)
+    {
+        Stats::BeginPhase("types");
+        showTypes(pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr);
+        Stats::EndPhase();
+        std::exit(EXIT_SUCCESS);
+    }
+
+    // source locations and sampled addresses are looked up in every line table
+    bool needLineIndex = (opts.Lines.size() != 0) || (opts.SampleProfilePath.size() != 0) || opts.Size;
+    if (opts.Lazy && needLineIndex)
+    {
+        Logger::DLog("--line, --sample-profile and --size read every line table, --lazy is ignored");
+        opts.Lazy = false;
+    }
+    if (opts.Lazy && (opts.BuildIndexPath.size() != 0))
+    {
+        // the index holds every unit, so it is built from the eager tables
+        Logger::DLog("--build-index reads every unit, --lazy is ignored");
+        opts.Lazy = false;
+    }
+
+    if (opts.Lazy)
+    {
+        // only unit headers are read here, units are decoded when an address touches them
+        // with a memory budget, the number of decoded units is limited by the budget only
+        size_t cacheSize = (opts.MaxMemory != 0) ? SIZE_MAX : opts.CacheSize;
+        Stats::BeginPhase("DwarfCuCache");
+        DwarfCuCache cuCache(pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineShdr, dbgLineStrShdr, dbgAbbrevShdr, arrangesMap, elfFuncTable, cacheSize);
+        cuCache.SetMemoryBudget(opts.MaxMemory);
+        Stats::EndPhase();
+
+        Stats::BeginPhase("queries");
+        for (auto it = opts.Addrs.begin(); it != opts.Addrs.end(); it++)
+        {
+            uint32_t cuIdx = 0;
+            const DwarfCuDebugInfo *cuDbgInfo = nullptr;
+            if (cuCache.FindCuIdx(*it, cuIdx))
+            {
+                cuDbgInfo = &cuCache.GetCu(cuIdx).DebugInfo;
+            }
+            showAddrInfo(*it, getAddrInfo(*it, elfFuncTable, cuDbgInfo), opts.Demangle);
+        }
+        Stats::EndPhase();
+        Logger::DLog("decoded units:%ld/%ld, memory usage:%ld, evicted:%ld", cuCache.DecodedCount(), cuCache.CuEntries().size(), cuCache.MemoryUsage(), cuCache.EvictedCount());
+        std::exit(EXIT_SUCCESS);
+    }
+
+    // built only when source locations or samples are looked up
+    SourceLineIndex lineIndex;
+    Stats::BeginPhase("ReadLineInfo");
+    DwarfLineInfoMap offsetLineInfoMap = Dwarf::ReadLineInfo(pBin, binSize, dbgLineShdr, dbgLineStrShdr, elfFuncTable, opts.ThreadCount, needLineIndex ? &lineIndex : nullptr);
+    if (needLineIndex)
+    {
+        lineIndex.Seal(elfFuncTable);
+    }
+    Stats::EndPhase();
+
+    // .debug_ranges (DWARF 4) / .debug_rnglists (DWARF 5) hold the ranges of units and split inlined copies
+    Elf64_Shdr dbgRangesShdr = {};
+    Elf64_Shdr dbgRngListsShdr = {};
+    if (sectionNameShdrIdxMap.find(".debug_ranges") != sectionNameShdrIdxMap.end())
+    {
+        dbgRangesShdr = shdrs[sectionNameShdrIdxMap[".debug_ranges"]];
+    }
+    if (sectionNameShdrIdxMap.find(".debug_rnglists") != sectionNameShdrIdxMap.end())
+    {
+        dbgRngListsShdr = shdrs[sectionNameShdrIdxMap[".debug_rnglists"]];
+    }
+
+    if (ambiguousFragmentCount != 0)
+    {
+        Stats::BeginPhase("DwarfLinkFragments");
+        Dwarf::LinkFragments(pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, dbgRangesShdr, dbgRngListsShdr, elfFuncTable, opts.ThreadCount);
+        Stats::EndPhase();
+    }
+
+    if (opts.Inlines)
+    {
+        Stats::BeginPhase("DwarfInlineTable");
+        DwarfInlineTable inlineTable;
+        inlineTable.Build(pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, dbgRangesShdr, dbgRngListsShdr, opts.ThreadCount);
+        Stats::EndPhase();
+        Stats::BeginPhase("inline_report");
+        InlineReport report(inlineTable, elfFuncTable, opts.ThreadCount);
+        report.Build();
+        Stats::EndPhase();
+        showInlines(opts, report);
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (opts.Size)
+    {
+        Stats::BeginPhase("code_size");
+        CodeSizeAnalyzer analyzer(elfFuncTable, lineIndex, opts.ThreadCount);
+        analyzer.Build(pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, dbgLineShdr, dbgRangesShdr, dbgRngListsShdr, arrangesMap);
+        Stats::EndPhase();
+        showSizes(opts, analyzer);
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (opts.SampleProfilePath.size() != 0)
+    {
+        if (!writeSampleProfile(opts, pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, dbgRangesShdr, dbgRngListsShdr, elfFuncTable, lineIndex))
+        {
+            std::exit(EXIT_FAILURE);
+        }
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (opts.Lines.size() != 0)
+    {
+        Stats::BeginPhase("line_queries");
+        for (auto it = opts.Lines.begin(); it != opts.Lines.end(); it++)
+        {
+            std::vector<SourceLineEntry> entries;
+            if (!lineIndex.Resolve(*it, entries))
+            {
+                std::cout << *it << " ??" << std::endl;
+                continue;
+            }
+            showLineEntries(*it, entries, elfFuncTable, opts.Demangle);
+        }
+        Stats::EndPhase();
+    }
+
+    Stats::BeginPhase("ReadDebugInfo");
+    std::vector<DwarfCuDebugInfo> dbgInfos = Dwarf::ReadDebugInfo(pBin, binSize, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, arrangesMap, offsetLineInfoMap, elfFuncTable.Files);
+    Stats::EndPhase();
+
+    Stats::BeginPhase("queries");
+    // segments of every unit sorted once, each query is a binary search
+    std::vector<uint64_t> cuOffsets;
+    for (auto it = dbgInfos.begin(); it != dbgInfos.end(); it++)
+    {
+        cuOffsets.push_back(it->Offset);
+    }
+    std::vector<DwarfCuRange> cuRanges = Dwarf::GetCuRanges(arrangesMap, cuOffsets);
+    for (auto it = opts.Addrs.begin(); it != opts.Addrs.end(); it++)
+    {
+        const DwarfCuDebugInfo *cuDbgInfo = nullptr;
+        uint32_t cuIdx = 0;
+        if (Dwarf::FindCuIdx(cuRanges, *it, cuIdx))
+        {
+            cuDbgInfo = &dbgInfos[cuIdx];
+        }
+        showAddrInfo(*it, getAddrInfo(*it, elfFuncTable, cuDbgInfo), opts.Demangle);
+    }
+    Stats::EndPhase();
+
+    if (opts.BuildIndexPath.size() != 0)
+    {
+        Stats::BeginPhase("build_index");
+        if (!SharedIndex::Build(opts.BuildIndexPath, opts.TargetPath, elfFuncTable, dbgInfos, arrangesMap))
+        {
+            std::exit(EXIT_FAILURE);
+        }
+        Stats::EndPhase();
+    }
 
     std::cout << "dwarf-viewer end..." << std::endl;
     std::exit(EXIT_SUCCESS);
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class Parallel
+{
+public:
+    // number of worker threads to use when 0 is given
+    static unsigned DefaultThreadCount()
+    {
+        unsigned count = std::thread::hardware_concurrency();
+        return (count == 0) ? 1 : count;
+    }
+
+    // call func(idx) for idx in [0, count) on threadCount threads
+    // indexes are handed out one by one, so func should not depend on the order
+    template<typename Func>
+    static void For(const size_t count, unsigned threadCount, Func func)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = DefaultThreadCount();
+        }
+        if (count < threadCount)
+        {
+            threadCount = count;
+        }
+        if (threadCount <= 1)
+        {
+            for (size_t idx = 0; idx < count; idx++)
+            {
+                func(idx);
+            }
+            return;
+        }
+
+        std::atomic<size_t> nextIdx(0);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < threadCount; i++)
+        {
+            threads.push_back(std::thread([&]()
+            {
+                while (true)
+                {
+                    size_t idx = nextIdx.fetch_add(1);
+                    if (count <= idx)
+                    {
+                        break;
+                    }
+                    func(idx);
+                }
+            }));
+        }
+        for (auto it = threads.begin(); it != threads.end(); it++)
+        {
+            it->join();
+        }
+    }
+};
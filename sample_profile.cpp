@@ -0,0 +1,312 @@
+#include "sample_profile.h"
+#include "logger.h"
+#include "common.h"
+
+// NodeIdx of an address which could not be resolved
+static const uint32_t SAMPLE_NODE_NONE = UINT32_MAX;
+
+// a range longer than this between two branches is a broken branch stack
+static const uint64_t SAMPLE_MAX_RANGE = 64 * 1024;
+
+// line offsets are kept in 16 bits by the profile readers
+static inline uint32_t getLineOffset(const uint32_t line, const uint32_t startLine)
+{
+    return (line - startLine) & 0xffff;
+}
+
+SampleProfile::SampleProfile(const ElfFunctionTable &elfFuncTable, const SourceLineIndex &lineIndex, const DwarfInlineTable &inlineTable) :
+    _elfFuncTable(elfFuncTable),
+    _lineIndex(lineIndex),
+    _inlineTable(inlineTable)
+{
+}
+
+bool SampleProfile::ReadSamples(const std::string &path)
+{
+    // the call stack is not used, inline stacks come from DWARF
+    return SampleReader::ReadSamples(path, [&](const std::vector<uint64_t> &stack, const uint64_t count)
+    {
+        _samples.Add(stack[0], count);
+    });
+}
+
+bool SampleProfile::ReadBranches(const std::string &path)
+{
+    return SampleReader::ReadBranchStacks(path, [&](const std::vector<std::pair<uint64_t, uint64_t>> &stack)
+    {
+        for (size_t i = 0; i < stack.size(); i++)
+        {
+            _branches.Add(stack[i], 1);
+
+            // code from the target of the older branch runs straight to the source of the newer one
+            if ((i + 1 < stack.size()) && (stack[i + 1].second <= stack[i].first))
+            {
+                _ranges.Add(std::make_pair(stack[i + 1].second, stack[i].first), 1);
+            }
+        }
+    });
+}
+
+void SampleProfile::Build()
+{
+    _samples.Flush();
+    _branches.Flush();
+    _ranges.Flush();
+
+    Location loc;
+    if (_samples.Total() != 0)
+    {
+        for (auto it = _samples.Counts().begin(); it != _samples.Counts().end(); it++)
+        {
+            if (resolve(it->first, loc))
+            {
+                _nodes[loc.NodeIdx].BodySamples[loc.LineKey] += it->second;
+            }
+        }
+    }
+    else
+    {
+        // each line in a range runs once per time the range runs
+        std::vector<SourceLineEntry> rows;
+        std::vector<Location> locs;
+        for (auto it = _ranges.Counts().begin(); it != _ranges.Counts().end(); it++)
+        {
+            uint64_t begin = it->first.first;
+            uint64_t end = it->first.second;
+            uint32_t beginFuncIdx = 0;
+            uint32_t endFuncIdx = 0;
+            if ((SAMPLE_MAX_RANGE < end - begin) || !Elf64::FindFuncIdx(_elfFuncTable, begin, beginFuncIdx) || !Elf64::FindFuncIdx(_elfFuncTable, end, endFuncIdx) || (beginFuncIdx != endFuncIdx))
+            {
+                continue;
+            }
+
+            rows.clear();
+            locs.clear();
+            _lineIndex.FindAddrRange(begin, end, rows);
+            for (auto rowIt = rows.begin(); rowIt != rows.end(); rowIt++)
+            {
+                if (!resolve(std::max(rowIt->Addr, begin), loc))
+                {
+                    continue;
+                }
+                bool seen = false;
+                for (auto locIt = locs.begin(); (locIt != locs.end()) && !seen; locIt++)
+                {
+                    seen = (locIt->NodeIdx == loc.NodeIdx) && (locIt->LineKey == loc.LineKey);
+                }
+                if (!seen)
+                {
+                    locs.push_back(loc);
+                    _nodes[loc.NodeIdx].BodySamples[loc.LineKey] += it->second;
+                }
+            }
+        }
+    }
+
+    // a branch to the entry of another function is a call
+    for (auto it = _branches.Counts().begin(); it != _branches.Counts().end(); it++)
+    {
+        uint64_t from = it->first.first;
+        uint64_t to = it->first.second;
+        auto targetIt = _elfFuncTable.AddrFuncIdxMap.find(to);
+        uint32_t fromFuncIdx = 0;
+        if ((targetIt == _elfFuncTable.AddrFuncIdxMap.end()) || (Elf64::FindFuncIdx(_elfFuncTable, from, fromFuncIdx) && (fromFuncIdx == targetIt->second)))
+        {
+            continue;
+        }
+
+        uint32_t targetNodeIdx = getFuncNode(targetIt->second);
+        _nodes[targetNodeIdx].HeadSamples += it->second;
+        if (resolve(from, loc))
+        {
+            _nodes[loc.NodeIdx].CallTargets[loc.LineKey][_nodes[targetNodeIdx].Name] += it->second;
+        }
+    }
+}
+
+void SampleProfile::Write(std::ostream &os) const
+{
+    // hottest function first
+    std::vector<std::pair<uint64_t, uint32_t>> totalNodeIdxs;
+    for (auto it = _funcNodeMap.begin(); it != _funcNodeMap.end(); it++)
+    {
+        uint64_t total = getTotalSamples(it->second);
+        if ((total != 0) || (_nodes[it->second].HeadSamples != 0))
+        {
+            totalNodeIdxs.push_back(std::make_pair(total, it->second));
+        }
+    }
+    std::sort(totalNodeIdxs.begin(), totalNodeIdxs.end(), [&](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b)
+    {
+        return (a.first != b.first) ? (b.first < a.first) : (_nodes[a.second].Name < _nodes[b.second].Name);
+    });
+
+    for (auto it = totalNodeIdxs.begin(); it != totalNodeIdxs.end(); it++)
+    {
+        const SampleProfileNode &node = _nodes[it->second];
+        os << StringHelper::strprintf("%s:%lu:%lu", node.Name, it->first, node.HeadSamples) << "\n";
+        writeNode(os, it->second, 1);
+    }
+}
+
+uint64_t SampleProfile::SampleCount() const
+{
+    return _samples.Total();
+}
+
+uint64_t SampleProfile::BranchCount() const
+{
+    return _branches.Total();
+}
+
+bool SampleProfile::resolve(const uint64_t addr, Location &loc)
+{
+    auto cacheIt = _addrLocationMap.find(addr);
+    if (cacheIt != _addrLocationMap.end())
+    {
+        loc = cacheIt->second;
+        return (loc.NodeIdx != SAMPLE_NODE_NONE);
+    }
+
+    loc.NodeIdx = SAMPLE_NODE_NONE;
+    SourceLineEntry row;
+    if (_lineIndex.FindAddr(addr, row))
+    {
+        // inline stack from the outermost site, each site is a callsite of its parent
+        std::vector<uint32_t> siteIdxs;
+        for (uint32_t siteIdx = _inlineTable.FindSite(addr); siteIdx != INLINE_SITE_NONE; siteIdx = _inlineTable.GetSite(siteIdx).ParentIdx)
+        {
+            siteIdxs.push_back(siteIdx);
+        }
+
+        uint32_t nodeIdx = getFuncNode(row.FuncIdx);
+        for (auto it = siteIdxs.rbegin(); it != siteIdxs.rend(); it++)
+        {
+            const DwarfInlineSite &site = _inlineTable.GetSite(*it);
+            auto key = std::make_pair(std::make_pair(getLineOffset(site.CallLine, _nodes[nodeIdx].StartLine), site.CallDiscriminator), _inlineTable.GetName(site.OriginOffset));
+            auto childIt = _nodes[nodeIdx].Callsites.find(key);
+            if (childIt != _nodes[nodeIdx].Callsites.end())
+            {
+                nodeIdx = childIt->second;
+                continue;
+            }
+
+            SampleProfileNode child;
+            child.Name = key.second;
+            child.StartLine = _inlineTable.GetDeclLine(site.OriginOffset);
+            child.HeadSamples = 0;
+            uint32_t childIdx = _nodes.size();
+            _nodes.push_back(child);
+            _nodes[nodeIdx].Callsites[key] = childIdx;
+            nodeIdx = childIdx;
+        }
+        loc.NodeIdx = nodeIdx;
+        loc.LineKey = std::make_pair(getLineOffset(row.Line, _nodes[nodeIdx].StartLine), row.Discriminator);
+    }
+    _addrLocationMap[addr] = loc;
+    return (loc.NodeIdx != SAMPLE_NODE_NONE);
+}
+
+uint32_t SampleProfile::getFuncNode(const uint32_t funcIdx)
+{
+    auto it = _funcNodeMap.find(funcIdx);
+    if (it != _funcNodeMap.end())
+    {
+        return it->second;
+    }
+
+    SampleProfileNode node;
+    node.Name = _elfFuncTable.ElfFuncInfos[funcIdx].Name;
+    node.StartLine = getFuncStartLine(funcIdx);
+    node.HeadSamples = 0;
+    uint32_t nodeIdx = _nodes.size();
+    _nodes.push_back(node);
+    _funcNodeMap[funcIdx] = nodeIdx;
+    return nodeIdx;
+}
+
+uint32_t SampleProfile::getFuncStartLine(const uint32_t funcIdx) const
+{
+    // DW_AT_decl_line of the subprogram, or the line of the entry when it has none
+    const ElfFunctionInfo &elfFuncInfo = _elfFuncTable.ElfFuncInfos[funcIdx];
+    uint64_t dieOffset = 0;
+    if (_inlineTable.FindFunc(elfFuncInfo.Addr, dieOffset))
+    {
+        uint32_t declLine = _inlineTable.GetDeclLine(dieOffset);
+        if (declLine != 0)
+        {
+            return declLine;
+        }
+    }
+    SourceLineEntry row;
+    if (_lineIndex.FindAddr(elfFuncInfo.Addr, row))
+    {
+        return row.Line;
+    }
+    return 0;
+}
+
+uint64_t SampleProfile::getTotalSamples(const uint32_t nodeIdx) const
+{
+    const SampleProfileNode &node = _nodes[nodeIdx];
+    uint64_t total = 0;
+    for (auto it = node.BodySamples.begin(); it != node.BodySamples.end(); it++)
+    {
+        total += it->second;
+    }
+    for (auto it = node.Callsites.begin(); it != node.Callsites.end(); it++)
+    {
+        total += getTotalSamples(it->second);
+    }
+    return total;
+}
+
+void SampleProfile::writeNode(std::ostream &os, const uint32_t nodeIdx, const uint32_t depth) const
+{
+    const SampleProfileNode &node = _nodes[nodeIdx];
+    std::string indent(depth, ' ');
+    auto getLineKey = [](const std::pair<uint32_t, uint32_t> &key)
+    {
+        return (key.second == 0) ? StringHelper::strprintf("%u", key.first) : StringHelper::strprintf("%u.%u", key.first, key.second);
+    };
+
+    // lines with samples or calls, then inlined callsites
+    std::map<std::pair<uint32_t, uint32_t>, uint64_t> lines = node.BodySamples;
+    for (auto it = node.CallTargets.begin(); it != node.CallTargets.end(); it++)
+    {
+        lines.insert(std::make_pair(it->first, 0));
+    }
+    for (auto it = lines.begin(); it != lines.end(); it++)
+    {
+        std::string msg = StringHelper::strprintf("%s%s: %lu", indent, getLineKey(it->first), it->second);
+        auto targetIt = node.CallTargets.find(it->first);
+        if (targetIt != node.CallTargets.end())
+        {
+            std::vector<std::pair<uint64_t, std::string>> targets;
+            for (auto nameIt = targetIt->second.begin(); nameIt != targetIt->second.end(); nameIt++)
+            {
+                targets.push_back(std::make_pair(nameIt->second, nameIt->first));
+            }
+            std::sort(targets.begin(), targets.end(), [](const std::pair<uint64_t, std::string> &a, const std::pair<uint64_t, std::string> &b)
+            {
+                return (a.first != b.first) ? (b.first < a.first) : (a.second < b.second);
+            });
+            for (auto nameIt = targets.begin(); nameIt != targets.end(); nameIt++)
+            {
+                msg += StringHelper::strprintf(" %s:%lu", nameIt->second, nameIt->first);
+            }
+        }
+        os << msg << "\n";
+    }
+
+    for (auto it = node.Callsites.begin(); it != node.Callsites.end(); it++)
+    {
+        uint64_t total = getTotalSamples(it->second);
+        if (total == 0)
+        {
+            continue;
+        }
+        os << StringHelper::strprintf("%s%s: %s:%lu", indent, getLineKey(it->first.first), it->first.second, total) << "\n";
+        writeNode(os, it->second, depth + 1);
+    }
+}
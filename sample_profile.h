@@ -0,0 +1,67 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "elf_parser.h"
+#include "line_index.h"
+#include "dwarf_inline.h"
+#include "sample_reader.h"
+
+// Sample profile of a function or of an inlined copy
+// Keys are (line offset from the first line of the function, discriminator).
+struct SampleProfileNode
+{
+    std::string Name;
+    uint32_t StartLine;         // DW_AT_decl_line of the function
+    uint64_t HeadSamples;
+    std::map<std::pair<uint32_t, uint32_t>, uint64_t> BodySamples;
+    std::map<std::pair<uint32_t, uint32_t>, std::map<std::string, uint64_t>> CallTargets;
+    std::map<std::pair<std::pair<uint32_t, uint32_t>, std::string>, uint32_t> Callsites;    // value: Index of nodes
+};
+
+// AutoFDO sample profile generator (text format of -fprofile-sample-use)
+// PC samples give the body counts. Branch stacks (LBR) give call targets and entry counts,
+// and the body counts from the ranges executed between branches when no PC sample is given.
+// Samples are counted per address first, so each distinct address is resolved to its
+// function, inline stack and line once.
+class SampleProfile
+{
+public:
+    SampleProfile(const ElfFunctionTable &elfFuncTable, const SourceLineIndex &lineIndex, const DwarfInlineTable &inlineTable);
+    bool ReadSamples(const std::string &path);
+    bool ReadBranches(const std::string &path);
+    void Build();
+    void Write(std::ostream &os) const;
+    uint64_t SampleCount() const;
+    uint64_t BranchCount() const;
+
+private:
+    // function node and line of a resolved address
+    struct Location
+    {
+        uint32_t NodeIdx;
+        std::pair<uint32_t, uint32_t> LineKey;
+    };
+    bool resolve(const uint64_t addr, Location &loc);
+    uint32_t getFuncNode(const uint32_t funcIdx);
+    uint32_t getFuncStartLine(const uint32_t funcIdx) const;
+    uint64_t getTotalSamples(const uint32_t nodeIdx) const;
+    void writeNode(std::ostream &os, const uint32_t nodeIdx, const uint32_t depth) const;
+
+private:
+    const ElfFunctionTable &_elfFuncTable;
+    const SourceLineIndex &_lineIndex;
+    const DwarfInlineTable &_inlineTable;
+    SampleCounter<uint64_t> _samples;                                   // key: address
+    SampleCounter<std::pair<uint64_t, uint64_t>> _branches;             // key: from, to
+    SampleCounter<std::pair<uint64_t, uint64_t>> _ranges;               // key: first, last address executed
+    std::vector<SampleProfileNode> _nodes;
+    std::map<uint32_t, uint32_t> _funcNodeMap;                          // key: Index of ElfFuncInfos, value: Index of _nodes
+    std::unordered_map<uint64_t, Location> _addrLocationMap;            // resolved addresses
+};
@@ -0,0 +1,219 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include "sample_reader.h"
+#include "logger.h"
+
+static inline void skipSpaces(const char *&p, const char *end)
+{
+    while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r')))
+    {
+        p++;
+    }
+}
+
+// hex number with or without 0x, as printed by perf script
+static inline bool parseHex(const char *&p, const char *end, uint64_t &val)
+{
+    if ((end - p >= 2) && (p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X')))
+    {
+        p += 2;
+    }
+    const char *top = p;
+    val = 0;
+    while (p < end)
+    {
+        char c = *p;
+        if (('0' <= c) && (c <= '9'))
+        {
+            val = (val << 4) | (c - '0');
+        }
+        else if (('a' <= c) && (c <= 'f'))
+        {
+            val = (val << 4) | (c - 'a' + 10);
+        }
+        else if (('A' <= c) && (c <= 'F'))
+        {
+            val = (val << 4) | (c - 'A' + 10);
+        }
+        else
+        {
+            break;
+        }
+        p++;
+    }
+    return (top < p);
+}
+
+void SampleReader::SetAddressSpace(const uint64_t loadBias, const std::vector<std::pair<uint64_t, uint64_t>> &segments)
+{
+    _loadBias = loadBias;
+    _segments = segments;
+    std::sort(_segments.begin(), _segments.end());
+}
+
+bool SampleReader::ReadSamples(const std::string &path, const std::function<void(const std::vector<uint64_t> &stack, const uint64_t count)> &func)
+{
+    std::vector<uint64_t> stack;
+    uint64_t insideCount = 0;
+    uint64_t outsideCount = 0;
+    bool result = readLines(path, [&](const char *p, const char *end)
+    {
+        stack.clear();
+        skipSpaces(p, end);
+        if ((p == end) || (*p == '#'))
+        {
+            return;
+        }
+        uint64_t addr = 0;
+        while (parseHex(p, end, addr))
+        {
+            stack.push_back(addr - _loadBias);
+            if ((p == end) || (*p != ';'))
+            {
+                break;
+            }
+            p++;
+        }
+        if (stack.size() == 0)
+        {
+            return;
+        }
+        uint64_t count = 1;
+        skipSpaces(p, end);
+        if ((p < end) && ('0' <= *p) && (*p <= '9'))
+        {
+            count = std::strtoull(p, nullptr, 10);
+        }
+        if (isInSegments(stack[0]))
+        {
+            insideCount += count;
+        }
+        else
+        {
+            outsideCount += count;
+        }
+        func(stack, count);
+    });
+    return result && checkSegments(path, insideCount, outsideCount);
+}
+
+bool SampleReader::ReadBranchStacks(const std::string &path, const std::function<void(const std::vector<std::pair<uint64_t, uint64_t>> &stack)> &func)
+{
+    std::vector<std::pair<uint64_t, uint64_t>> stack;
+    uint64_t insideCount = 0;
+    uint64_t outsideCount = 0;
+    bool result = readLines(path, [&](const char *p, const char *end)
+    {
+        stack.clear();
+        while (p < end)
+        {
+            skipSpaces(p, end);
+            uint64_t from = 0;
+            uint64_t to = 0;
+            if ((p == end) || (*p == '#') || !parseHex(p, end, from) || (p == end) || (*p != '/'))
+            {
+                break;
+            }
+            p++;
+            if (!parseHex(p, end, to))
+            {
+                break;
+            }
+            while ((p < end) && (*p != ' ') && (*p != '\t'))
+            {
+                p++;
+            }
+            from -= _loadBias;
+            to -= _loadBias;
+            if (isInSegments(from))
+            {
+                insideCount++;
+            }
+            else
+            {
+                outsideCount++;
+            }
+            stack.push_back(std::make_pair(from, to));
+        }
+        if (stack.size() != 0)
+        {
+            func(stack);
+        }
+    });
+    return result && checkSegments(path, insideCount, outsideCount);
+}
+
+bool SampleReader::isInSegments(const uint64_t addr)
+{
+    if (_segments.size() == 0)
+    {
+        return true;
+    }
+    auto it = std::upper_bound(_segments.begin(), _segments.end(), std::make_pair(addr, UINT64_MAX));
+    return ((it != _segments.begin()) && (addr < std::prev(it)->second));
+}
+
+bool SampleReader::checkSegments(const std::string &path, const uint64_t insideCount, const uint64_t outsideCount)
+{
+    // samples of other objects (kernel, shared libraries) are expected, but none in the target is a wrong load bias
+    if ((insideCount == 0) && (outsideCount != 0))
+    {
+        Logger::ELog("%s: no address is in an executable PT_LOAD segment of the target, PIE and shared objects need --load-bias <runtime base> (perf script --show-mmap-events)", path);
+        return false;
+    }
+    Logger::DLog("%s: in the target:%ld, outside:%ld", path, insideCount, outsideCount);
+    return true;
+}
+
+bool SampleReader::readLines(const std::string &path, const std::function<void(const char *, const char *)> &func)
+{
+    // read in large blocks, sample files have hundreds of millions of lines
+    FILE *fp = std::fopen(path.c_str(), "r");
+    if (fp == nullptr)
+    {
+        Logger::ELog("%s can not be opened", path);
+        return false;
+    }
+
+    std::vector<char> buf(1 << 20);
+    size_t used = 0;
+    while (true)
+    {
+        size_t readSize = std::fread(&buf[used], 1, buf.size() - used, fp);
+        used += readSize;
+        const char *p = buf.data();
+        const char *end = buf.data() + used;
+        while (true)
+        {
+            const char *lf = (const char *)std::memchr(p, '\n', end - p);
+            if (lf == nullptr)
+            {
+                break;
+            }
+            func(p, lf);
+            p = lf + 1;
+        }
+
+        size_t rest = end - p;
+        if (readSize == 0)
+        {
+            if (rest != 0)
+            {
+                // last line without a line feed
+                func(p, end);
+            }
+            break;
+        }
+        std::memmove(buf.data(), p, rest);
+        used = rest;
+        if (used == buf.size())
+        {
+            // a line longer than the buffer
+            buf.resize(buf.size() * 2);
+        }
+    }
+    std::fclose(fp);
+    return true;
+}
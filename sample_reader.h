@@ -0,0 +1,122 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Counts of keys seen many times (sampled addresses, branches)
+// Keys are appended to a batch which is sorted, run-length encoded and merged into the counts
+// when it is full, so memory is bounded by the batch and the distinct keys, not by the samples.
+template<typename K>
+class SampleCounter
+{
+public:
+    explicit SampleCounter(const size_t batchSize = 1 << 20) :
+        _batchSize(batchSize),
+        _total(0)
+    {
+    }
+
+    void Add(const K &key, const uint64_t count)
+    {
+        _batch.emplace_back(key, count);
+        if (_batchSize <= _batch.size())
+        {
+            Flush();
+        }
+    }
+
+    void Flush()
+    {
+        if (_batch.size() == 0)
+        {
+            return;
+        }
+
+        std::sort(_batch.begin(), _batch.end(), lessKey);
+        size_t count = 0;
+        for (size_t i = 0; i < _batch.size(); i++)
+        {
+            _total += _batch[i].second;
+            if ((count != 0) && (_batch[count - 1].first == _batch[i].first))
+            {
+                _batch[count - 1].second += _batch[i].second;
+                continue;
+            }
+            _batch[count++] = _batch[i];
+        }
+        _batch.resize(count);
+
+        std::vector<std::pair<K, uint64_t>> merged;
+        merged.reserve(_counts.size() + _batch.size());
+        auto countIt = _counts.begin();
+        auto batchIt = _batch.begin();
+        while ((countIt != _counts.end()) || (batchIt != _batch.end()))
+        {
+            if ((batchIt == _batch.end()) || ((countIt != _counts.end()) && (countIt->first < batchIt->first)))
+            {
+                merged.push_back(*countIt++);
+            }
+            else if ((countIt == _counts.end()) || (batchIt->first < countIt->first))
+            {
+                merged.push_back(*batchIt++);
+            }
+            else
+            {
+                merged.emplace_back(countIt->first, countIt->second + batchIt->second);
+                countIt++;
+                batchIt++;
+            }
+        }
+        _counts.swap(merged);
+        _batch.clear();
+    }
+
+    // sorted by key, valid after Flush()
+    const std::vector<std::pair<K, uint64_t>> &Counts() const
+    {
+        return _counts;
+    }
+
+    uint64_t Total() const
+    {
+        return _total;
+    }
+
+private:
+    static bool lessKey(const std::pair<K, uint64_t> &a, const std::pair<K, uint64_t> &b)
+    {
+        return a.first < b.first;
+    }
+
+private:
+    size_t _batchSize;
+    uint64_t _total;
+    std::vector<std::pair<K, uint64_t>> _batch;
+    std::vector<std::pair<K, uint64_t>> _counts;
+};
+
+// Readers of sample files, one sample per line
+// Addresses are translated to file addresses by subtracting the load bias. perf script prints
+// runtime addresses, which differ from the file ones for PIE and shared objects.
+class SampleReader
+{
+public:
+    // segments: [begin, end) of the executable PT_LOAD segments, empty: every address is accepted
+    static void SetAddressSpace(const uint64_t loadBias, const std::vector<std::pair<uint64_t, uint64_t>> &segments);
+    // "<address>[;<return address>...] [<count>]" per line, the call stack innermost first (e.g. perf script -F ip)
+    static bool ReadSamples(const std::string &path, const std::function<void(const std::vector<uint64_t> &stack, const uint64_t count)> &func);
+    // one branch stack per line, "<from>/<to>[/<flags>...]" entries newest first (perf script -F brstack)
+    static bool ReadBranchStacks(const std::string &path, const std::function<void(const std::vector<std::pair<uint64_t, uint64_t>> &stack)> &func);
+
+private:
+    static bool readLines(const std::string &path, const std::function<void(const char *, const char *)> &func);
+    static bool isInSegments(const uint64_t addr);
+    static bool checkSegments(const std::string &path, const uint64_t insideCount, const uint64_t outsideCount);
+
+private:
+    static inline uint64_t _loadBias = 0;
+    static inline std::vector<std::pair<uint64_t, uint64_t>> _segments;
+};
@@ -0,0 +1,388 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include "shared_index.h"
+#include "logger.h"
+#include "common.h"
+
+// collects NUL terminated strings, same strings share one offset
+class SharedIndexStrTbl
+{
+public:
+    SharedIndexStrTbl()
+    {
+        // offset 0 is the empty string
+        _buf.push_back(0);
+        _strOffsetMap[""] = 0;
+    }
+
+    uint32_t Add(const std::string &str)
+    {
+        auto it = _strOffsetMap.find(str);
+        if (it != _strOffsetMap.end())
+        {
+            return it->second;
+        }
+        uint32_t strOff = _buf.size();
+        _buf.insert(_buf.end(), str.begin(), str.end());
+        _buf.push_back(0);
+        _strOffsetMap[str] = strOff;
+        return strOff;
+    }
+
+    const std::vector<char> &Buf() const
+    {
+        return _buf;
+    }
+
+private:
+    std::vector<char> _buf;
+    std::map<std::string, uint32_t> _strOffsetMap;
+};
+
+static uint64_t alignUp(const uint64_t val)
+{
+    return (val + 7) & ~(uint64_t)7;
+}
+
+// count entries of entrySize at offset are inside the mapping and aligned, without overflowing
+static bool isInMap(const uint64_t offset, const uint64_t count, const uint64_t entrySize, const uint64_t mapSize)
+{
+    if ((mapSize < offset) || ((offset % 8) != 0))
+    {
+        return false;
+    }
+    return count <= (mapSize - offset) / entrySize;
+}
+
+SharedIndex::SharedIndex() :
+    _hdr(nullptr),
+    _base(nullptr),
+    _mapSize(0)
+{
+}
+
+SharedIndex::~SharedIndex()
+{
+    if (_base != nullptr)
+    {
+        munmap((void *)_base, _mapSize);
+    }
+}
+
+bool SharedIndex::Build(const std::string &indexPath, const std::string &targetPath, const ElfFunctionTable &elfFuncTable, const std::vector<DwarfCuDebugInfo> &dbgInfos, const DwarfArangeMap &offsetArangeMap)
+{
+    Logger::TLog("SharedIndex::Build In...");
+    struct stat st;
+    if (stat(targetPath.c_str(), &st) < 0)
+    {
+        Logger::ELog("%s not exist", targetPath);
+        return false;
+    }
+
+    SharedIndexStrTbl strTbl;
+    std::vector<SharedIndexFunc> funcs;
+    std::vector<SharedIndexLine> lines;
+    std::vector<SharedIndexCu> cus;
+    std::vector<SharedIndexCuRange> cuRanges;
+    std::vector<SharedIndexDwarfFunc> dwarfFuncs;
+
+    // functions sorted by address, of aliases at one address the one FindFuncIdx() gives (and the line rows went to) is last,
+    // so FindFunc() finds the same function as the in-process lookup
+    std::vector<uint32_t> funcIdxs;
+    std::vector<bool> addrOwners(elfFuncTable.ElfFuncInfos.size(), false);
+    for (uint32_t fIdx = 0; fIdx < elfFuncTable.ElfFuncInfos.size(); fIdx++)
+    {
+        funcIdxs.push_back(fIdx);
+        uint32_t ownerIdx = 0;
+        addrOwners[fIdx] = Elf64::FindFuncIdx(elfFuncTable, elfFuncTable.ElfFuncInfos[fIdx].Addr, ownerIdx) && (ownerIdx == fIdx);
+    }
+    std::sort(funcIdxs.begin(), funcIdxs.end(), [&elfFuncTable, &addrOwners](const uint32_t a, const uint32_t b)
+    {
+        const ElfFunctionInfo &funcA = elfFuncTable.ElfFuncInfos[a];
+        const ElfFunctionInfo &funcB = elfFuncTable.ElfFuncInfos[b];
+        if (funcA.Addr != funcB.Addr)
+        {
+            return funcA.Addr < funcB.Addr;
+        }
+        return (addrOwners[a] != addrOwners[b]) ? addrOwners[b] : (a < b);
+    });
+
+    for (auto it = funcIdxs.begin(); it != funcIdxs.end(); it++)
+    {
+        const ElfFunctionInfo &elfFuncInfo = elfFuncTable.ElfFuncInfos[*it];
+        SharedIndexFunc func;
+        func.Addr       = elfFuncInfo.Addr;
+        func.Size       = elfFuncInfo.Size;
+        func.NameOff    = strTbl.Add(elfFuncInfo.Name);
+        func.SecNameOff = strTbl.Add(elfFuncInfo.SecName);
+        func.ParentNameOff = strTbl.Add((elfFuncInfo.ParentIdx != ELF_FUNC_IDX_NONE) ? elfFuncTable.ElfFuncInfos[elfFuncInfo.ParentIdx].Name : "");
+        func.Reserved   = 0;
+        func.SrcDirOff  = strTbl.Add(elfFuncTable.Files.GetDirName(elfFuncInfo.SrcFileId));
+        func.SrcFileOff = strTbl.Add(elfFuncTable.Files.GetFileName(elfFuncInfo.SrcFileId));
+        func.LineIdx    = lines.size();
+
+        for (auto lineIt = elfFuncInfo.AddrLines.begin(); lineIt != elfFuncInfo.AddrLines.end(); lineIt++)
+        {
+            SharedIndexLine line;
+            line.Addr      = lineIt->second.Addr;
+            line.Line      = lineIt->second.Line;
+            line.SrcDirOff = strTbl.Add(elfFuncTable.Files.GetDirName(lineIt->second.FileId));
+            line.SrcFileOff = strTbl.Add(elfFuncTable.Files.GetFileName(lineIt->second.FileId));
+            line.Discriminator = lineIt->second.Discriminator;
+            line.Column    = lineIt->second.Column;
+            line.View      = lineIt->second.View;
+            line.Flags     = lineIt->second.Flags;
+            line.Reserved  = 0;
+            lines.push_back(line);
+        }
+        func.LineCount = lines.size() - func.LineIdx;
+        funcs.push_back(func);
+    }
+
+    for (uint32_t cuIdx = 0; cuIdx < dbgInfos.size(); cuIdx++)
+    {
+        const DwarfCuDebugInfo &cuDbgInfo = dbgInfos[cuIdx];
+        SharedIndexCu cu;
+        cu.Offset        = cuDbgInfo.Offset;
+        cu.FileNameOff   = strTbl.Add(cuDbgInfo.FileName);
+        cu.ProducerOff   = strTbl.Add(cuDbgInfo.Producer);
+        cu.LanguageOff   = strTbl.Add(cuDbgInfo.Language);
+        cu.CompileDirOff = strTbl.Add(cuDbgInfo.CompileDir);
+        cus.push_back(cu);
+
+        for (auto it = cuDbgInfo.Funcs.begin(); it != cuDbgInfo.Funcs.end(); it++)
+        {
+            SharedIndexDwarfFunc dwarfFunc;
+            dwarfFunc.Addr           = it->second.Addr;
+            dwarfFunc.Size           = it->second.Size;
+            dwarfFunc.CuIdx          = cuIdx;
+            dwarfFunc.NameOff        = strTbl.Add(it->second.Name);
+            dwarfFunc.LinkageNameOff = strTbl.Add(it->second.LinkageName);
+            dwarfFuncs.push_back(dwarfFunc);
+        }
+    }
+    std::sort(dwarfFuncs.begin(), dwarfFuncs.end(), [](const SharedIndexDwarfFunc &a, const SharedIndexDwarfFunc &b)
+    {
+        return a.Addr < b.Addr;
+    });
+
+    // units are found by their .debug_aranges segments, functions described by DW_AT_ranges have no Addr/Size
+    std::vector<uint64_t> cuOffsets;
+    for (auto it = dbgInfos.begin(); it != dbgInfos.end(); it++)
+    {
+        cuOffsets.push_back(it->Offset);
+    }
+    std::vector<DwarfCuRange> dwarfCuRanges = Dwarf::GetCuRanges(offsetArangeMap, cuOffsets);
+    for (auto it = dwarfCuRanges.begin(); it != dwarfCuRanges.end(); it++)
+    {
+        cuRanges.push_back(SharedIndexCuRange{it->Start, it->End, it->CuIdx, 0});
+    }
+
+    // layout: header, functions, lines, units, unit ranges, dwarf functions, strings
+    SharedIndexHdr hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.Magic, SHARED_INDEX_MAGIC, sizeof(hdr.Magic));
+    hdr.Version         = SHARED_INDEX_VERSION;
+    hdr.TargetSize      = st.st_size;
+    hdr.TargetMtime     = st.st_mtime;
+    hdr.FuncCount       = funcs.size();
+    hdr.FuncOffset      = alignUp(sizeof(SharedIndexHdr));
+    hdr.LineCount       = lines.size();
+    hdr.LineOffset      = alignUp(hdr.FuncOffset + funcs.size() * sizeof(SharedIndexFunc));
+    hdr.CuCount         = cus.size();
+    hdr.CuOffset        = alignUp(hdr.LineOffset + lines.size() * sizeof(SharedIndexLine));
+    hdr.CuRangeCount    = cuRanges.size();
+    hdr.CuRangeOffset   = alignUp(hdr.CuOffset + cus.size() * sizeof(SharedIndexCu));
+    hdr.DwarfFuncCount  = dwarfFuncs.size();
+    hdr.DwarfFuncOffset = alignUp(hdr.CuRangeOffset + cuRanges.size() * sizeof(SharedIndexCuRange));
+    hdr.StrSize         = strTbl.Buf().size();
+    hdr.StrOffset       = alignUp(hdr.DwarfFuncOffset + dwarfFuncs.size() * sizeof(SharedIndexDwarfFunc));
+    hdr.TotalSize       = hdr.StrOffset + hdr.StrSize;
+
+    std::vector<uint8_t> image(hdr.TotalSize, 0);
+    std::memcpy(&image[0], &hdr, sizeof(hdr));
+    std::memcpy(&image[hdr.FuncOffset], funcs.data(), funcs.size() * sizeof(SharedIndexFunc));
+    std::memcpy(&image[hdr.LineOffset], lines.data(), lines.size() * sizeof(SharedIndexLine));
+    std::memcpy(&image[hdr.CuOffset], cus.data(), cus.size() * sizeof(SharedIndexCu));
+    std::memcpy(&image[hdr.CuRangeOffset], cuRanges.data(), cuRanges.size() * sizeof(SharedIndexCuRange));
+    std::memcpy(&image[hdr.DwarfFuncOffset], dwarfFuncs.data(), dwarfFuncs.size() * sizeof(SharedIndexDwarfFunc));
+    std::memcpy(&image[hdr.StrOffset], strTbl.Buf().data(), hdr.StrSize);
+
+    // write to a temporary file and rename it, so readers never map a partially written index
+    std::string tmpPath = StringHelper::strprintf("%s.tmp.%d", indexPath, (int)getpid());
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        Logger::ELog("open %s failed", tmpPath);
+        return false;
+    }
+
+    uint64_t written = 0;
+    while (written < image.size())
+    {
+        ssize_t ret = write(fd, &image[written], image.size() - written);
+        if (ret <= 0)
+        {
+            Logger::ELog("write %s failed", tmpPath);
+            close(fd);
+            unlink(tmpPath.c_str());
+            return false;
+        }
+        written += ret;
+    }
+    close(fd);
+
+    if (rename(tmpPath.c_str(), indexPath.c_str()) < 0)
+    {
+        Logger::ELog("rename %s failed", indexPath);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    Logger::TLog("SharedIndex::Build Out... size:%ld", hdr.TotalSize);
+    return true;
+}
+
+bool SharedIndex::Open(const std::string &indexPath, const std::string &targetPath)
+{
+    int fd = open(indexPath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        Logger::ELog("open %s failed", indexPath);
+        return false;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) < 0) || ((uint64_t)st.st_size < sizeof(SharedIndexHdr)))
+    {
+        Logger::ELog("%s is not an index", indexPath);
+        close(fd);
+        return false;
+    }
+
+    // MAP_SHARED: every process mapping the file uses the same page cache pages
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        Logger::ELog("mmap %s failed", indexPath);
+        return false;
+    }
+    _base = (const uint8_t *)base;
+    _mapSize = st.st_size;
+    _hdr = (const SharedIndexHdr *)_base;
+
+    if ((std::memcmp(_hdr->Magic, SHARED_INDEX_MAGIC, sizeof(_hdr->Magic)) != 0) || (_hdr->Version != SHARED_INDEX_VERSION) || (_mapSize < _hdr->TotalSize))
+    {
+        Logger::ELog("%s is not an index", indexPath);
+        return false;
+    }
+
+    // a truncated or broken file must not make lookups read outside the mapping
+    // strings are NUL terminated, so the last byte of the string table is NUL
+    if (!isInMap(_hdr->FuncOffset, _hdr->FuncCount, sizeof(SharedIndexFunc), _mapSize) ||
+        !isInMap(_hdr->LineOffset, _hdr->LineCount, sizeof(SharedIndexLine), _mapSize) ||
+        !isInMap(_hdr->CuOffset, _hdr->CuCount, sizeof(SharedIndexCu), _mapSize) ||
+        !isInMap(_hdr->CuRangeOffset, _hdr->CuRangeCount, sizeof(SharedIndexCuRange), _mapSize) ||
+        !isInMap(_hdr->DwarfFuncOffset, _hdr->DwarfFuncCount, sizeof(SharedIndexDwarfFunc), _mapSize) ||
+        !isInMap(_hdr->StrOffset, _hdr->StrSize, 1, _mapSize) ||
+        (_hdr->StrSize == 0) || (_base[_hdr->StrOffset + _hdr->StrSize - 1] != 0))
+    {
+        Logger::ELog("%s is broken", indexPath);
+        return false;
+    }
+
+    struct stat targetSt;
+    if ((stat(targetPath.c_str(), &targetSt) < 0) || ((uint64_t)targetSt.st_size != _hdr->TargetSize) || (targetSt.st_mtime != _hdr->TargetMtime))
+    {
+        Logger::ELog("%s is out of date for %s", indexPath, targetPath);
+        return false;
+    }
+    return true;
+}
+
+const SharedIndexFunc *SharedIndex::FindFunc(const uint64_t addr) const
+{
+    const SharedIndexFunc *begin = (const SharedIndexFunc *)(_base + _hdr->FuncOffset);
+    const SharedIndexFunc *end   = begin + _hdr->FuncCount;
+
+    // last function which starts at or before addr
+    const SharedIndexFunc *it = std::upper_bound(begin, end, addr, [](const uint64_t a, const SharedIndexFunc &func)
+    {
+        return a < func.Addr;
+    });
+    while (it != begin)
+    {
+        it--;
+        if (addr < it->Addr + it->Size)
+        {
+            return it;
+        }
+        if (it->Size != 0)
+        {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+const SharedIndexLine *SharedIndex::FindLine(const SharedIndexFunc &func, const uint64_t addr) const
+{
+    if ((func.LineCount == 0) || (_hdr->LineCount < (uint64_t)func.LineIdx + func.LineCount))
+    {
+        return nullptr;
+    }
+
+    const SharedIndexLine *begin = (const SharedIndexLine *)(_base + _hdr->LineOffset) + func.LineIdx;
+    const SharedIndexLine *end   = begin + func.LineCount;
+    const SharedIndexLine *it = std::upper_bound(begin, end, addr, [](const uint64_t a, const SharedIndexLine &line)
+    {
+        return a < line.Addr;
+    });
+
+    // same as Elf64::FindLineAddr()
+    if ((it == begin) || (((it - 1)->Flags & LINE_FLAG_END_SEQUENCE) != 0))
+    {
+        return nullptr;
+    }
+
+    return it - 1;
+}
+
+const SharedIndexCu *SharedIndex::FindCu(const uint64_t addr) const
+{
+    // same as Dwarf::FindCuIdx()
+    const SharedIndexCuRange *begin = (const SharedIndexCuRange *)(_base + _hdr->CuRangeOffset);
+    const SharedIndexCuRange *end   = begin + _hdr->CuRangeCount;
+    const SharedIndexCuRange *it = std::upper_bound(begin, end, addr, [](const uint64_t a, const SharedIndexCuRange &range)
+    {
+        return a < range.Start;
+    });
+    if (it == begin)
+    {
+        return nullptr;
+    }
+
+    it--;
+    if ((it->End <= addr) || (_hdr->CuCount <= it->CuIdx))
+    {
+        return nullptr;
+    }
+    return (const SharedIndexCu *)(_base + _hdr->CuOffset) + it->CuIdx;
+}
+
+const char *SharedIndex::GetString(const uint32_t strOff) const
+{
+    if (_hdr->StrSize <= strOff)
+    {
+        return "";
+    }
+    return (const char *)(_base + _hdr->StrOffset + strOff);
+}
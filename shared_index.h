@@ -0,0 +1,113 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "elf_parser.h"
+#include "dwarf.h"
+
+// Read-only index shared between processes
+// One process builds the index file (e.g. under /dev/shm) and the others map it read-only,
+// so the function and line tables are stored once per host instead of once per process.
+// Every reference inside the file is an offset or an index, never a pointer.
+
+const char SHARED_INDEX_MAGIC[8] = {'D', 'W', 'V', 'I', 'D', 'X', '0', '1'};
+const uint32_t SHARED_INDEX_VERSION = 5;
+
+struct SharedIndexHdr
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t Reserved;
+    uint64_t TargetSize;        // size of the indexed binary
+    int64_t TargetMtime;        // mtime of the indexed binary
+    uint64_t FuncCount;
+    uint64_t FuncOffset;        // SharedIndexFunc[FuncCount], sorted by Addr
+    uint64_t LineCount;
+    uint64_t LineOffset;        // SharedIndexLine[LineCount], sorted by Addr within a function
+    uint64_t CuCount;
+    uint64_t CuOffset;          // SharedIndexCu[CuCount]
+    uint64_t CuRangeCount;
+    uint64_t CuRangeOffset;     // SharedIndexCuRange[CuRangeCount], sorted by Start
+    uint64_t DwarfFuncCount;
+    uint64_t DwarfFuncOffset;   // SharedIndexDwarfFunc[DwarfFuncCount], sorted by Addr
+    uint64_t StrSize;
+    uint64_t StrOffset;         // NUL terminated strings, string offsets are relative to here
+    uint64_t TotalSize;
+};
+
+// ElfFunctionInfo equivalent
+struct SharedIndexFunc
+{
+    uint64_t Addr;
+    uint64_t Size;
+    uint32_t NameOff;
+    uint32_t SecNameOff;
+    uint32_t SrcDirOff;
+    uint32_t SrcFileOff;
+    uint32_t LineIdx;           // first line of this function
+    uint32_t LineCount;
+    uint32_t ParentNameOff;     // function a fragment was split from, "": not a fragment
+    uint32_t Reserved;
+};
+
+// LineAddrInfo equivalent
+struct SharedIndexLine
+{
+    uint64_t Addr;
+    uint32_t Line;
+    uint32_t SrcDirOff;
+    uint32_t SrcFileOff;        // file of this row, inlined code is in another file than its function
+    uint32_t Discriminator;
+    uint16_t Column;
+    uint8_t View;
+    uint8_t Flags;              // LINE_FLAG_*
+    uint32_t Reserved;
+};
+
+// DwarfCuDebugInfo equivalent
+struct SharedIndexCu
+{
+    uint64_t Offset;
+    uint32_t FileNameOff;
+    uint32_t ProducerOff;
+    uint32_t LanguageOff;
+    uint32_t CompileDirOff;
+};
+
+// DwarfCuRange equivalent, a .debug_aranges segment
+struct SharedIndexCuRange
+{
+    uint64_t Start;
+    uint64_t End;
+    uint32_t CuIdx;
+    uint32_t Reserved;
+};
+
+// DwarfFuncInfo equivalent
+struct SharedIndexDwarfFunc
+{
+    uint64_t Addr;
+    uint32_t Size;
+    uint32_t CuIdx;
+    uint32_t NameOff;
+    uint32_t LinkageNameOff;
+};
+
+class SharedIndex
+{
+public:
+    SharedIndex();
+    ~SharedIndex();
+    static bool Build(const std::string &indexPath, const std::string &targetPath, const ElfFunctionTable &elfFuncTable, const std::vector<DwarfCuDebugInfo> &dbgInfos, const DwarfArangeMap &offsetArangeMap);
+    bool Open(const std::string &indexPath, const std::string &targetPath);
+    const SharedIndexFunc *FindFunc(const uint64_t addr) const;
+    const SharedIndexLine *FindLine(const SharedIndexFunc &func, const uint64_t addr) const;
+    const SharedIndexCu *FindCu(const uint64_t addr) const;
+    const char *GetString(const uint32_t strOff) const;
+
+private:
+    const SharedIndexHdr *_hdr;
+    const uint8_t *_base;
+    uint64_t _mapSize;
+};
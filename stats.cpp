@@ -0,0 +1,321 @@
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include "stats.h"
+#include "common.h"
+
+// every allocation of the process goes through here, so allocation counts of a phase can be taken
+// All forms are replaced and paired with free(), so no allocation is released by a default
+// operator delete (sanitizers report malloc / operator delete mismatches otherwise).
+static void *allocate(size_t size, const size_t align)
+{
+    Stats::CountAlloc(size);
+    size = (size == 0) ? 1 : size;
+    if (align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    {
+        return std::malloc(size);
+    }
+    void *p = nullptr;
+    if (posix_memalign(&p, std::max(align, sizeof(void *)), size) != 0)
+    {
+        return nullptr;
+    }
+    return p;
+}
+
+static void *allocateOrThrow(const size_t size, const size_t align)
+{
+    void *p = allocate(size, align);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(size_t size)
+{
+    return allocateOrThrow(size, 0);
+}
+
+void *operator new[](size_t size)
+{
+    return allocateOrThrow(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+    return allocateOrThrow(size, (size_t)align);
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return allocateOrThrow(size, (size_t)align);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size, 0);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return allocate(size, (size_t)align);
+}
+
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return allocate(size, (size_t)align);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+static double getWallSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double getCpuSec()
+{
+    // all threads of the process
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int openPerfEvent(const uint64_t config)
+{
+    // inherit counts the worker threads started after this, which a group can not be read with
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void Stats::Enable()
+{
+    _enabled = true;
+    _allocCounting = true;
+
+    // cycles, instructions and cache misses of every thread of the process
+    const uint64_t configs[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < 3; i++)
+    {
+        _perfFds[i] = openPerfEvent(configs[i]);
+        if (_perfFds[i] < 0)
+        {
+            for (int j = 0; j < i; j++)
+            {
+                close(_perfFds[j]);
+                _perfFds[j] = -1;
+            }
+            return;
+        }
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        ioctl(_perfFds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(_perfFds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+bool Stats::IsEnabled()
+{
+    return _enabled;
+}
+
+void Stats::BeginPhase(const std::string &name)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+    _phaseName = name;
+    _phaseStart = takeSnapshot();
+}
+
+void Stats::EndPhase()
+{
+    if (!_enabled || (_phaseName.size() == 0))
+    {
+        return;
+    }
+
+    Snapshot end = takeSnapshot();
+    StatsPhase phase;
+    phase.Name = _phaseName;
+    phase.WallSec = end.WallSec - _phaseStart.WallSec;
+    phase.CpuSec = end.CpuSec - _phaseStart.CpuSec;
+    phase.AllocCount = end.AllocCount - _phaseStart.AllocCount;
+    phase.AllocBytes = end.AllocBytes - _phaseStart.AllocBytes;
+    phase.HasPerf = (_perfFds[0] >= 0);
+    phase.Cycles = end.Perf[0] - _phaseStart.Perf[0];
+    phase.Instructions = end.Perf[1] - _phaseStart.Perf[1];
+    phase.CacheMisses = end.Perf[2] - _phaseStart.Perf[2];
+    for (int i = 0; i < STATS_COUNTER_NUM; i++)
+    {
+        phase.Counters[i] = end.Counters[i] - _phaseStart.Counters[i];
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    phase.PeakRssKb = usage.ru_maxrss;
+
+    _phases.push_back(phase);
+    _phaseName.clear();
+}
+
+std::string Stats::ToJson()
+{
+    const char *counterNames[STATS_COUNTER_NUM] = {"cus", "dies", "attrs", "abbrev_tables", "line_rows"};
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::string json = "{\n  \"phases\": [\n";
+    for (size_t i = 0; i < _phases.size(); i++)
+    {
+        const StatsPhase &phase = _phases[i];
+        json += StringHelper::strprintf("    {\"name\": \"%s\", \"wall_sec\": %.6f, \"cpu_sec\": %.6f, \"peak_rss_kb\": %ld, \"allocs\": %ld, \"alloc_bytes\": %ld, ",
+                                        phase.Name, phase.WallSec, phase.CpuSec, phase.PeakRssKb, phase.AllocCount, phase.AllocBytes);
+        if (phase.HasPerf)
+        {
+            json += StringHelper::strprintf("\"cycles\": %ld, \"instructions\": %ld, \"cache_misses\": %ld, ", phase.Cycles, phase.Instructions, phase.CacheMisses);
+        }
+        else
+        {
+            json += "\"cycles\": null, \"instructions\": null, \"cache_misses\": null, ";
+        }
+        json += "\"counters\": {";
+        for (int c = 0; c < STATS_COUNTER_NUM; c++)
+        {
+            json += StringHelper::strprintf("%s\"%s\": %ld", (c == 0) ? "" : ", ", counterNames[c], phase.Counters[c]);
+        }
+        json += StringHelper::strprintf("}}%s\n", (i + 1 < _phases.size()) ? "," : "");
+    }
+    json += "  ],\n  \"counters\": {";
+    for (int c = 0; c < STATS_COUNTER_NUM; c++)
+    {
+        json += StringHelper::strprintf("%s\"%s\": %ld", (c == 0) ? "" : ", ", counterNames[c], _counters[c].load());
+    }
+    json += StringHelper::strprintf("},\n  \"peak_rss_kb\": %ld,\n  \"perf_available\": %s\n}", usage.ru_maxrss, (_perfFds[0] >= 0) ? "true" : "false");
+    return json;
+}
+
+const std::vector<StatsPhase> &Stats::Phases()
+{
+    return _phases;
+}
+
+Stats::Snapshot Stats::takeSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.WallSec = getWallSec();
+    snapshot.CpuSec = getCpuSec();
+    snapshot.AllocCount = _allocCount.load();
+    snapshot.AllocBytes = _allocBytes.load();
+    if (!readPerf(snapshot.Perf))
+    {
+        memset(snapshot.Perf, 0, sizeof(snapshot.Perf));
+    }
+    for (int i = 0; i < STATS_COUNTER_NUM; i++)
+    {
+        snapshot.Counters[i] = _counters[i].load();
+    }
+    return snapshot;
+}
+
+bool Stats::readPerf(uint64_t values[3])
+{
+    if (_perfFds[0] < 0)
+    {
+        return false;
+    }
+
+    // the value of an inherited counter includes the threads started after it was opened
+    for (int i = 0; i < 3; i++)
+    {
+        if (read(_perfFds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
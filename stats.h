@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Work counters updated by the parsers
+enum
+{
+    STATS_COUNTER_CU           = 0,    // compilation units decoded
+    STATS_COUNTER_DIE          = 1,
+    STATS_COUNTER_ATTR         = 2,
+    STATS_COUNTER_ABBREV_TBL   = 3,
+    STATS_COUNTER_LINE_ROW     = 4,    // rows appended to the line number matrix
+    STATS_COUNTER_NUM          = 5,
+};
+
+// Resources used by one phase
+struct StatsPhase
+{
+    std::string Name;
+    double WallSec;
+    double CpuSec;
+    uint64_t PeakRssKb;         // peak RSS of the process at the end of the phase
+    uint64_t AllocCount;        // operator new calls
+    uint64_t AllocBytes;
+    bool HasPerf;               // perf_event_open is available, counted over every thread
+    uint64_t Cycles;
+    uint64_t Instructions;
+    uint64_t CacheMisses;
+    uint64_t Counters[STATS_COUNTER_NUM];
+};
+
+// Phase timing and hardware counter instrumentation (--stats)
+// Counters are always counted (one relaxed atomic add per parser call),
+// phases are measured only after Enable() is called.
+class Stats
+{
+public:
+    static void Enable();
+    static bool IsEnabled();
+    static void BeginPhase(const std::string &name);
+    static void EndPhase();
+    static void Count(const int counter, const uint64_t value)
+    {
+        _counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+    static void CountAlloc(const uint64_t size)
+    {
+        if (_allocCounting)
+        {
+            _allocCount.fetch_add(1, std::memory_order_relaxed);
+            _allocBytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+    static std::string ToJson();
+    static const std::vector<StatsPhase> &Phases();
+
+private:
+    struct Snapshot
+    {
+        double WallSec;
+        double CpuSec;
+        uint64_t AllocCount;
+        uint64_t AllocBytes;
+        uint64_t Perf[3];
+        uint64_t Counters[STATS_COUNTER_NUM];
+    };
+    static Snapshot takeSnapshot();
+    static bool readPerf(uint64_t values[3]);
+
+private:
+    static inline std::atomic<uint64_t> _counters[STATS_COUNTER_NUM];
+    static inline std::atomic<uint64_t> _allocCount;
+    static inline std::atomic<uint64_t> _allocBytes;
+    static inline bool _allocCounting = false;
+    static inline bool _enabled = false;
+    static inline int _perfFds[3] = {-1, -1, -1};  // cycles, instructions, cache misses, -1: not available
+    static inline std::vector<StatsPhase> _phases;
+    static inline std::string _phaseName;
+    static inline Snapshot _phaseStart;
+};
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "struct_layout.h"
+#include "parallel.h"
+#include "logger.h"
+#include "common.h"
+
+StructLayoutAnalyzer::StructLayoutAnalyzer(const uint32_t cacheLineSize, const unsigned threadCount) :
+    _cacheLineSize(cacheLineSize),
+    _threadCount(threadCount)
+{
+    if (_cacheLineSize == 0)
+    {
+        _cacheLineSize = 64;
+    }
+}
+
+void StructLayoutAnalyzer::Build(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr)
+{
+    Logger::TLog("StructLayoutAnalyzer::Build In...");
+    std::vector<DwarfCuEntry> cuEntries = Dwarf::ReadCuHeaders(bin, size, dbgInfoShdr);
+
+    // units do not share anything while being read
+    std::vector<DwarfTypeUnit> typeUnits(cuEntries.size());
+    Parallel::For(cuEntries.size(), _threadCount, [&](const size_t idx)
+    {
+        typeUnits[idx] = DwarfTypeGraph::ReadUnit(bin, size, dbgInfoShdr, dbgStrShdr, dbgLineStrShdr, dbgAbbrevShdr, cuEntries[idx]);
+    });
+
+    // a struct from a header used by many units becomes one node here
+    _typeGraph.AddUnits(typeUnits);
+    Logger::TLog("StructLayoutAnalyzer::Build Out...");
+}
+
+bool StructLayoutAnalyzer::ReadInstanceCounts(const std::string &path)
+{
+    // each line is "<type name> <count>", the type name may contain spaces
+    std::ifstream ifs(path);
+    if (!ifs)
+    {
+        Logger::ELog("%s can not be opened", path);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        auto pos = line.find_last_of(" \t");
+        if ((line.size() == 0) || (line[0] == '#') || (pos == std::string::npos))
+        {
+            continue;
+        }
+        std::string name = line.substr(0, pos);
+        name.erase(name.find_last_not_of(" \t") + 1);
+        _instanceCountMap[name] = std::strtoull(line.c_str() + pos + 1, nullptr, 0);
+    }
+    return true;
+}
+
+std::vector<StructLayout> StructLayoutAnalyzer::Analyze() const
+{
+    std::vector<uint32_t> typeIds;
+    for (uint32_t typeId = 1; typeId < _typeGraph.TypeCount(); typeId++)
+    {
+        const DwarfType &type = _typeGraph.GetType(typeId);
+        if (((type.Kind != DWARF_TYPE_STRUCT) && (type.Kind != DWARF_TYPE_CLASS) && (type.Kind != DWARF_TYPE_UNION)) || type.Declaration)
+        {
+            continue;
+        }
+
+        // anonymous types are shown as a member of the enclosing type
+        if ((type.Name.size() == 0) || (type.ByteSize == 0) || (type.Members.size() == 0))
+        {
+            continue;
+        }
+        typeIds.push_back(typeId);
+    }
+
+    std::vector<StructLayout> layouts(typeIds.size());
+    Parallel::For(typeIds.size(), _threadCount, [&](const size_t idx)
+    {
+        layouts[idx] = analyzeType(typeIds[idx]);
+    });
+
+    // most wasted bytes first
+    std::stable_sort(layouts.begin(), layouts.end(), [](const StructLayout &a, const StructLayout &b)
+    {
+        if (a.Score() != b.Score())
+        {
+            return a.Score() > b.Score();
+        }
+        return a.Name < b.Name;
+    });
+    return layouts;
+}
+
+const DwarfTypeGraph &StructLayoutAnalyzer::TypeGraph() const
+{
+    return _typeGraph;
+}
+
+StructLayout StructLayoutAnalyzer::analyzeType(const uint32_t typeId) const
+{
+    const DwarfType &type = _typeGraph.GetType(typeId);
+    StructLayout layout;
+    layout.TypeId = typeId;
+    layout.Name = type.Name;
+    layout.Size = type.ByteSize;
+    layout.MemberCount = type.Members.size();
+    layout.MemberBytes = 0;
+    layout.HoleCount = 0;
+    layout.HoleBits = 0;
+    layout.PaddingBits = 0;
+    layout.CacheLines = (type.ByteSize + _cacheLineSize - 1) / _cacheLineSize;
+    layout.StraddleCount = 0;
+    layout.InstanceCount = 1;
+    auto countIt = _instanceCountMap.find(type.Name);
+    if (countIt != _instanceCountMap.end())
+    {
+        layout.InstanceCount = countIt->second;
+    }
+
+    // members in offset order
+    std::vector<const DwarfTypeMember *> members;
+    for (auto it = type.Members.begin(); it != type.Members.end(); it++)
+    {
+        members.push_back(&(*it));
+    }
+    std::stable_sort(members.begin(), members.end(), [](const DwarfTypeMember *a, const DwarfTypeMember *b)
+    {
+        return (a->Offset * 8 + a->BitOffset) < (b->Offset * 8 + b->BitOffset);
+    });
+
+    bool isUnion = (type.Kind == DWARF_TYPE_UNION);
+    layout.Lines.push_back(StringHelper::strprintf("%s {", _typeGraph.GetTypeName(typeId)));
+    uint64_t endBit = 0;
+    uint64_t nextBoundary = _cacheLineSize;
+    for (auto it = members.begin(); it != members.end(); it++)
+    {
+        const DwarfTypeMember &member = **it;
+        uint64_t memberSize = _typeGraph.GetTypeSize(member.TypeId);
+        uint64_t startBit = member.Offset * 8 + member.BitOffset;
+        uint64_t memberBits = (member.BitSize != 0) ? member.BitSize : memberSize * 8;
+
+        if (!isUnion && (endBit < startBit))
+        {
+            uint64_t holeBits = startBit - endBit;
+            layout.HoleCount++;
+            layout.HoleBits += holeBits;
+            if ((holeBits % 8) == 0)
+            {
+                layout.Lines.push_back(StringHelper::strprintf("\t/* XXX %ld bytes hole, try to pack */", holeBits / 8));
+            }
+            else
+            {
+                layout.Lines.push_back(StringHelper::strprintf("\t/* XXX %ld bits hole, try to pack */", holeBits));
+            }
+        }
+
+        while (nextBoundary <= member.Offset)
+        {
+            layout.Lines.push_back(StringHelper::strprintf("\t/* --- cacheline %ld boundary (%ld bytes) --- */", nextBoundary / _cacheLineSize, nextBoundary));
+            nextBoundary += _cacheLineSize;
+        }
+
+        std::string line = getMemberLine(member, memberSize);
+        uint64_t lastByte = (startBit + ((memberBits != 0) ? memberBits : 1) - 1) / 8;
+        if ((member.Offset / _cacheLineSize != lastByte / _cacheLineSize) && (memberSize <= _cacheLineSize))
+        {
+            // a member which would fit a cache line but crosses a boundary
+            layout.StraddleCount++;
+            line += " /* XXX straddles cacheline */";
+        }
+        layout.Lines.push_back(line);
+
+        layout.MemberBytes += (member.BitSize != 0) ? (member.BitSize + 7) / 8 : memberSize;
+        if (endBit < startBit + memberBits)
+        {
+            endBit = startBit + memberBits;
+        }
+    }
+
+    if (endBit < type.ByteSize * 8)
+    {
+        layout.PaddingBits = type.ByteSize * 8 - endBit;
+    }
+
+    layout.Lines.push_back("");
+    layout.Lines.push_back(StringHelper::strprintf("\t/* size: %ld, cachelines: %d, members: %d */", layout.Size, layout.CacheLines, layout.MemberCount));
+    if (!isUnion)
+    {
+        layout.Lines.push_back(StringHelper::strprintf("\t/* sum members: %ld, holes: %d, sum holes: %ld */", layout.MemberBytes, layout.HoleCount, layout.HoleBits / 8));
+    }
+    if (layout.PaddingBits != 0)
+    {
+        layout.Lines.push_back(StringHelper::strprintf("\t/* padding: %ld */", layout.PaddingBits / 8));
+    }
+    if (layout.StraddleCount != 0)
+    {
+        layout.Lines.push_back(StringHelper::strprintf("\t/* members straddling cachelines: %d */", layout.StraddleCount));
+    }
+    if ((layout.Size % _cacheLineSize) != 0)
+    {
+        layout.Lines.push_back(StringHelper::strprintf("\t/* last cacheline: %ld bytes */", layout.Size % _cacheLineSize));
+    }
+    layout.Lines.push_back("};");
+    return layout;
+}
+
+std::string StructLayoutAnalyzer::getMemberLine(const DwarfTypeMember &member, const uint64_t memberSize) const
+{
+    std::string typeName = _typeGraph.GetTypeName(member.TypeId);
+    std::string name = member.Name;
+    if (member.IsBase)
+    {
+        name = "<base class>";
+    }
+    if (member.BitSize != 0)
+    {
+        name += StringHelper::strprintf(":%d", member.BitSize);
+    }
+
+    // offset and size in bytes, bit fields show the bit position in the storage unit too
+    std::string pos = StringHelper::strprintf("%5ld %5ld", member.Offset, memberSize);
+    if (member.BitSize != 0)
+    {
+        pos = StringHelper::strprintf("%3ld:%d %5ld", member.Offset, member.BitOffset, memberSize);
+    }
+    return StringHelper::strprintf("\t%-40s %-24s /* %s */", typeName, name + ";", pos);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+
+#include "dwarf_type.h"
+
+// Layout of a struct / class / union
+struct StructLayout
+{
+    uint32_t TypeId;
+    std::string Name;
+    uint64_t Size;
+    uint32_t MemberCount;
+    uint64_t MemberBytes;       // sum of member sizes (bit fields are rounded up)
+    uint32_t HoleCount;
+    uint64_t HoleBits;          // holes between members
+    uint64_t PaddingBits;       // padding after the last member
+    uint32_t CacheLines;
+    uint32_t StraddleCount;     // members crossing a cache line boundary
+    uint64_t InstanceCount;     // 1 unless given by the instance count file
+    std::vector<std::string> Lines;     // printed layout
+
+    uint64_t WastedBytes() const
+    {
+        return (HoleBits + PaddingBits) / 8;
+    };
+    uint64_t Score() const
+    {
+        return WastedBytes() * InstanceCount;
+    };
+};
+
+// pahole-like analyzer of struct layouts
+// Units are read in parallel, merged into one DwarfTypeGraph (so identical types are analyzed once),
+// then every struct definition is analyzed in parallel.
+class StructLayoutAnalyzer
+{
+public:
+    StructLayoutAnalyzer(const uint32_t cacheLineSize, const unsigned threadCount);
+    void Build(const uint8_t *bin, const uint64_t size, const Elf64_Shdr &dbgInfoShdr, const Elf64_Shdr &dbgStrShdr, const Elf64_Shdr &dbgLineStrShdr, const Elf64_Shdr &dbgAbbrevShdr);
+    bool ReadInstanceCounts(const std::string &path);
+    std::vector<StructLayout> Analyze() const;
+    const DwarfTypeGraph &TypeGraph() const;
+
+private:
+    StructLayout analyzeType(const uint32_t typeId) const;
+    std::string getMemberLine(const DwarfTypeMember &member, const uint64_t memberSize) const;
+
+private:
+    uint32_t _cacheLineSize;
+    unsigned _threadCount;
+    DwarfTypeGraph _typeGraph;
+    std::map<std::string, uint64_t> _instanceCountMap;     // key: type name
+};
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include "template_bloat.h"
+#include "code_size.h"
+#include "demangler.h"
+#include "parallel.h"
+#include "logger.h"
+
+TemplateBloatAnalyzer::TemplateBloatAnalyzer(const ElfFunctionTable &elfFuncTable, const unsigned threadCount)
+    : _elfFuncTable(elfFuncTable), _threadCount(threadCount)
+{
+}
+
+void TemplateBloatAnalyzer::Build(const uint8_t *bin, const uint64_t size, const std::vector<Elf64_Shdr> &shdrs)
+{
+    Logger::TLog("TemplateBloatAnalyzer::Build In...");
+    const std::vector<ElfFunctionInfo> &funcInfos = _elfFuncTable.ElfFuncInfos;
+
+    // bytes of a function are in the file image of the executable section holding it
+    _funcBytes.assign(funcInfos.size(), nullptr);
+    for (size_t i = 0; i < funcInfos.size(); i++)
+    {
+        const ElfFunctionInfo &funcInfo = funcInfos[i];
+        for (auto it = shdrs.begin(); it != shdrs.end(); it++)
+        {
+            if ((it->sh_type != SHT_PROGBITS) || ((it->sh_flags & SHF_EXECINSTR) == 0))
+            {
+                continue;
+            }
+            if ((it->sh_addr <= funcInfo.Addr) && (funcInfo.Addr + funcInfo.Size <= it->sh_addr + it->sh_size))
+            {
+                uint64_t offset = it->sh_offset + (funcInfo.Addr - it->sh_addr);
+                if (offset + funcInfo.Size <= size)
+                {
+                    _funcBytes[i] = bin + offset;
+                }
+                break;
+            }
+        }
+    }
+
+    // aliases of one body (C1/C2, D1/D2) are one copy, not identical instantiations
+    std::vector<bool> isAliases = Elf64::FindAliases(_elfFuncTable);
+    std::vector<std::string> families(funcInfos.size());
+    std::vector<std::string> names(funcInfos.size());
+    Parallel::For(funcInfos.size(), _threadCount, [&](const size_t idx)
+    {
+        if ((funcInfos[idx].Size == 0) || isAliases[idx])
+        {
+            return;
+        }
+        names[idx] = Demangler::Demangle(funcInfos[idx].Name);
+        std::string family = CodeSizeAnalyzer::GetTemplateFamily(names[idx]);
+        if (family.find("<>") != std::string::npos)
+        {
+            families[idx] = family;
+        }
+    });
+
+    std::unordered_map<std::string, uint32_t> familyIdxMap;
+    _families.clear();
+    for (size_t i = 0; i < funcInfos.size(); i++)
+    {
+        if (families[i].size() == 0)
+        {
+            continue;
+        }
+        auto result = familyIdxMap.insert(std::make_pair(families[i], (uint32_t)_families.size()));
+        if (result.second)
+        {
+            _families.push_back(TemplateFamily{families[i], 0, 0, {}, {}});
+        }
+        TemplateFamily &family = _families[result.first->second];
+        family.Bytes += funcInfos[i].Size;
+        family.Members.push_back(TemplateMember{(uint32_t)i, names[i], funcInfos[i].Size});
+    }
+    _families.erase(std::remove_if(_families.begin(), _families.end(), [](const TemplateFamily &family)
+    {
+        return family.Members.size() < 2;
+    }), _families.end());
+
+    Parallel::For(_families.size(), _threadCount, [&](const size_t idx)
+    {
+        TemplateFamily &family = _families[idx];
+        std::sort(family.Members.begin(), family.Members.end(), [](const TemplateMember &a, const TemplateMember &b)
+        {
+            return (a.Size != b.Size) ? (b.Size < a.Size) : (a.Name < b.Name);
+        });
+        findIdentical(family);
+    });
+    std::sort(_families.begin(), _families.end(), [](const TemplateFamily &a, const TemplateFamily &b)
+    {
+        return (a.Bytes != b.Bytes) ? (b.Bytes < a.Bytes) : (a.Name < b.Name);
+    });
+    Logger::DLog("functions:%ld, template families:%ld", funcInfos.size(), _families.size());
+    Logger::TLog("TemplateBloatAnalyzer::Build Out...");
+}
+
+const std::vector<TemplateFamily> &TemplateBloatAnalyzer::Families() const
+{
+    return _families;
+}
+
+uint64_t TemplateBloatAnalyzer::hashBytes(const uint8_t *bytes, const uint64_t size)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint64_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void TemplateBloatAnalyzer::findIdentical(TemplateFamily &family) const
+{
+    // members are sorted by size, so candidates of the same size are adjacent
+    std::unordered_map<uint64_t, std::vector<uint32_t>> hashMemberIdxsMap;
+    for (size_t begin = 0; begin < family.Members.size();)
+    {
+        size_t end = begin;
+        while ((end < family.Members.size()) && (family.Members[end].Size == family.Members[begin].Size))
+        {
+            end++;
+        }
+        if (end - begin < 2)
+        {
+            begin = end;
+            continue;
+        }
+
+        hashMemberIdxsMap.clear();
+        for (size_t i = begin; i < end; i++)
+        {
+            const uint8_t *bytes = _funcBytes[family.Members[i].FuncIdx];
+            if (bytes != nullptr)
+            {
+                hashMemberIdxsMap[hashBytes(bytes, family.Members[i].Size)].push_back(i);
+            }
+        }
+        std::vector<std::vector<uint32_t>> sets;
+        for (auto it = hashMemberIdxsMap.begin(); it != hashMemberIdxsMap.end(); it++)
+        {
+            // a hash collision is not identical code
+            const std::vector<uint32_t> &memberIdxs = it->second;
+            const uint8_t *first = _funcBytes[family.Members[memberIdxs[0]].FuncIdx];
+            std::vector<uint32_t> identical;
+            for (auto idxIt = memberIdxs.begin(); idxIt != memberIdxs.end(); idxIt++)
+            {
+                if (std::memcmp(first, _funcBytes[family.Members[*idxIt].FuncIdx], family.Members[*idxIt].Size) == 0)
+                {
+                    identical.push_back(*idxIt);
+                }
+            }
+            if (2 <= identical.size())
+            {
+                family.FoldableBytes += (identical.size() - 1) * family.Members[begin].Size;
+                sets.push_back(identical);
+            }
+        }
+        // sets of one size in member order, the hash map order is not stable
+        std::sort(sets.begin(), sets.end());
+        family.Identical.insert(family.Identical.end(), sets.begin(), sets.end());
+        begin = end;
+    }
+}
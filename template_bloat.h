@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <elf.h>
+#include <string>
+#include <vector>
+
+#include "elf_parser.h"
+
+// one instantiation of a template family
+struct TemplateMember
+{
+    uint32_t FuncIdx;           // Index of ElfFuncInfos
+    std::string Name;           // demangled
+    uint64_t Size;
+};
+
+// instantiations sharing a name without template arguments, "std::vector<>::push_back"
+struct TemplateFamily
+{
+    std::string Name;
+    uint64_t Bytes;
+    uint64_t FoldableBytes;     // bytes of the copies of identical code, kept once by ICF or type erasure
+    std::vector<TemplateMember> Members;            // largest first
+    std::vector<std::vector<uint32_t>> Identical;   // indexes of Members with identical code, largest first
+};
+
+// Template instantiation bloat from the linkage names of the symbol table
+// Names are demangled in parallel and grouped by template family. Members whose .text bytes
+// have the same hash (and compare equal) are identical code candidates. Code calling or
+// addressing anything pc-relative differs at each address, so only self-contained code matches.
+class TemplateBloatAnalyzer
+{
+public:
+    TemplateBloatAnalyzer(const ElfFunctionTable &elfFuncTable, const unsigned threadCount);
+    void Build(const uint8_t *bin, const uint64_t size, const std::vector<Elf64_Shdr> &shdrs);
+    // families of two or more instantiations, most bytes first
+    const std::vector<TemplateFamily> &Families() const;
+
+private:
+    static uint64_t hashBytes(const uint8_t *bytes, const uint64_t size);
+    void findIdentical(TemplateFamily &family) const;
+
+private:
+    const ElfFunctionTable &_elfFuncTable;
+    unsigned _threadCount;
+    std::vector<const uint8_t *> _funcBytes;    // index: Index of ElfFuncInfos, nullptr: not in the file
+    std::vector<TemplateFamily> _families;
+};
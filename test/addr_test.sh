@@ -0,0 +1,66 @@
+#!/bin/sh
+# Compare --addr with addr2line for every instruction of the fixtures, built as DWARF 4 and 5.
+#
+# Usage) ./test/addr_test.sh [<dwarf-viewer>]
+#
+# llvm-addr2line is the reference (binutils 2.40 addr2line mixes up DWARF 5 file 0 and 1),
+# set ADDR2LINE to use another one. DWARF 4 directory 0 is the compilation directory,
+# which the line table does not carry, so only the file name is compared for DWARF 4.
+
+set -e
+
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+ADDR2LINE=${ADDR2LINE:-llvm-addr2line}
+VIEWER=${1:-./dwarf-viewer}
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+OUT_DIR="$TEST_DIR/out"
+
+mkdir -p "$OUT_DIR"
+fail=0
+
+# check <elf> <opt> <functions>
+check() {
+    elf=$1
+    opt=$2
+
+    # every instruction of the functions, without the padding after them
+    addrs=$(nm -S "$elf" | awk -v re="^($3)([.].*)?$" '$4 ~ re { print $1, $2 }' | while read -r addr size; do
+        objdump -d --no-show-raw-insn --start-address=0x$addr --stop-address=$((0x$addr + 0x$size)) "$elf" |
+            awk '/^ +[0-9a-f]+:/ { sub(":", "", $1); print "0x" $1 }'
+    done)
+    args=""
+    for addr in $addrs; do
+        args="$args --addr $addr"
+    done
+
+    $VIEWER $args "$elf" | awk '/^0x/ { loc = "??:0"; for (i = 1; i < NF; i++) if ($i == "at") loc = $(i + 1); print loc }' > "$OUT_DIR/viewer.txt"
+    $ADDR2LINE -e "$elf" $addrs | sed 's/ (discriminator [0-9]*)//' > "$OUT_DIR/addr2line.txt"
+    case "$opt" in
+    *dwarf-4)
+        sed -i 's|.*/||' "$OUT_DIR/viewer.txt" "$OUT_DIR/addr2line.txt"
+        ;;
+    esac
+
+    if cmp -s "$OUT_DIR/viewer.txt" "$OUT_DIR/addr2line.txt"; then
+        echo "ok   addr $(basename "$elf") $opt ($(echo "$addrs" | wc -w) addresses)"
+    else
+        echo "FAIL addr $(basename "$elf") $opt"
+        printf '%s\n' $addrs | paste - "$OUT_DIR/viewer.txt" "$OUT_DIR/addr2line.txt" | awk '$2 != $3'
+        fail=1
+    fi
+}
+
+for opt in "-O0 -gdwarf-5" "-O0 -gdwarf-4" "-O2 -gdwarf-5" "-O2 -gdwarf-4"; do
+    elf="$OUT_DIR/addr$(echo "$opt" | tr -d ' -')"
+    (cd "$TEST_DIR/fixture" && $CC $opt a.c -o "$elf")
+    check "$elf" "$opt" "main|helper|foo"
+done
+
+# .cold fragments, an address before their first row has no line
+for opt in "-O2 -gdwarf-5" "-O2 -gdwarf-4"; do
+    elf="$OUT_DIR/cold$(echo "$opt" | tr -d ' -')"
+    (cd "$TEST_DIR/fixture" && $CXX $opt cold.cc -o "$elf")
+    check "$elf" "$opt" "main|_Z11readSamples.*"
+done
+exit $fail
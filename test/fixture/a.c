@@ -0,0 +1,15 @@
+#include "h.h"
+
+int helper(int y)
+{
+    return y + 1;
+}
+
+int main(int argc, char **argv)
+{
+    int r = helper(argc);
+
+    r += foo(r);
+    r += twice(r);
+    return r;
+}
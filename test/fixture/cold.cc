@@ -0,0 +1,52 @@
+// .cold fragments of readSamples() and main() start before the first line row of the fragment
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+static bool readLines(const std::string &path, const std::function<void(const char *)> &func)
+{
+    FILE *fp = std::fopen(path.c_str(), "r");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    std::vector<char> buf(1 << 12);
+    while (std::fgets(buf.data(), buf.size(), fp) != nullptr)
+    {
+        func(buf.data());
+    }
+    std::fclose(fp);
+    return true;
+}
+
+static bool check(const std::string &path, const size_t count)
+{
+    if (count == 0)
+    {
+        std::fprintf(stderr, "%s: no line\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readSamples(const std::string &path, const std::function<void(const std::vector<unsigned long> &)> &func)
+{
+    std::vector<unsigned long> stack;
+    size_t count = 0;
+    bool result = readLines(path, [&](const char *p)
+    {
+        stack.clear();
+        stack.push_back(std::strtoul(p, nullptr, 16));
+        count++;
+        func(stack);
+    });
+    return result && check(path, count);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 0;
+    readSamples(argv[0], [&](const std::vector<unsigned long> &s) { n += s.size(); });
+    return (int)n;
+}
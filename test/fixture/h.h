@@ -0,0 +1,10 @@
+static int foo(int x)
+{
+    int y = x * 3;
+    return y - 1;
+}
+
+static inline int twice(int x)
+{
+    return x + x;
+}
@@ -0,0 +1,77 @@
+#!/bin/sh
+# Check --line on the fixture, built as DWARF 4 and 5.
+#
+# Usage) ./test/line_test.sh [<dwarf-viewer>]
+#
+# Both DWARF versions of a build must resolve every query to the same addresses.
+# At -O0 every address must be in the queried file (checked with addr2line), and
+# the queries below must resolve to the expected function and line.
+
+set -e
+
+CC=${CC:-cc}
+ADDR2LINE=${ADDR2LINE:-llvm-addr2line}
+VIEWER=${1:-./dwarf-viewer}
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+OUT_DIR="$TEST_DIR/out"
+
+# <query> <function> <file>:<line>, one line per address
+O0_EXPECTED="a.c:5 helper a.c:5
+a.c:10 main a.c:10
+a.c:12 main a.c:12
+a.c:12 main a.c:12
+h.h:3 foo h.h:3
+h.h:9 twice h.h:9
+helper+1 helper a.c:5
+foo+1 foo h.h:3
+main+4 main a.c:13
+main+4 main a.c:13"
+
+args=""
+for file in a.c h.h; do
+    for line in $(seq 1 15); do
+        args="$args --line $file:$line"
+    done
+done
+for query in helper+1 foo+1 main+4; do
+    args="$args --line $query"
+done
+
+mkdir -p "$OUT_DIR"
+fail=0
+for opt in "-O0" "-O2"; do
+    for ver in 4 5; do
+        elf="$OUT_DIR/line$opt-dwarf$ver"
+        (cd "$TEST_DIR/fixture" && $CC $opt -gdwarf-$ver a.c -o "$elf")
+
+        # "<query> <address> <function> <file>:<line>" with the function offset and directories removed
+        $VIEWER $args "$elf" | awk '$2 == "->" { sub(/\+0x[0-9a-f]*$/, "", $4); sub(/.*\//, "", $6); print $1, $3, $4, $6 }' > "$OUT_DIR/line$opt-dwarf$ver.txt"
+
+        if [ "$opt" = "-O0" ]; then
+            # addresses are in the queried file, optimized code has rows of several files at one address
+            awk '{ print $2 }' "$OUT_DIR/line$opt-dwarf$ver.txt" | $ADDR2LINE -e "$elf" | sed 's|.*/||; s|:.*||' > "$OUT_DIR/file.txt"
+            if ! awk '{ sub(/[:+].*/, "", $1); print $1 }' "$OUT_DIR/line$opt-dwarf$ver.txt" | paste - "$OUT_DIR/file.txt" |
+                awk '$1 ~ /\./ && $1 != $2 { print "  " NR ": " $0; bad = 1 } END { exit bad }'; then
+                echo "FAIL line $opt -gdwarf-$ver: address out of the queried file"
+                fail=1
+            fi
+
+            echo "$O0_EXPECTED" > "$OUT_DIR/expected.txt"
+            awk 'NR == FNR { queries[$1] = 1; next } ($1 in queries) { print $1, $3, $4 }' "$OUT_DIR/expected.txt" "$OUT_DIR/line$opt-dwarf$ver.txt" > "$OUT_DIR/got.txt"
+            if ! cmp -s "$OUT_DIR/expected.txt" "$OUT_DIR/got.txt"; then
+                echo "FAIL line $opt -gdwarf-$ver: unexpected results"
+                diff "$OUT_DIR/expected.txt" "$OUT_DIR/got.txt" || true
+                fail=1
+            fi
+        fi
+    done
+
+    if cmp -s "$OUT_DIR/line$opt-dwarf4.txt" "$OUT_DIR/line$opt-dwarf5.txt"; then
+        echo "ok   line $opt DWARF 4 and 5 ($(wc -l < "$OUT_DIR/line$opt-dwarf5.txt") addresses)"
+    else
+        echo "FAIL line $opt DWARF 4 and 5 differ"
+        diff "$OUT_DIR/line$opt-dwarf4.txt" "$OUT_DIR/line$opt-dwarf5.txt" || true
+        fail=1
+    fi
+done
+exit $fail